@@ -14,6 +14,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <TFile.h>
@@ -115,4 +116,225 @@ inline EventArgs parse_event_args(const std::vector<std::string> &args, const st
 
 int run(const EventArgs &event_args, const std::string &log_prefix);
 
+struct EventAugmentArgs
+{
+    std::string event_list_root;
+    std::string definitions_tsv_path;
+    std::string output_root;
+};
+
+inline EventAugmentArgs parse_event_augment_args(const std::vector<std::string> &args, const std::string &usage)
+{
+    if (args.size() != 2 && args.size() != 3)
+    {
+        throw std::runtime_error(usage);
+    }
+
+    EventAugmentArgs out;
+    out.event_list_root = trim(args.at(0));
+    out.definitions_tsv_path = trim(args.at(1));
+    if (args.size() == 3)
+    {
+        out.output_root = trim(args.at(2));
+        if (out.output_root.empty())
+        {
+            throw std::runtime_error("Invalid arguments (empty value)");
+        }
+    }
+
+    if (out.event_list_root.empty() || out.definitions_tsv_path.empty())
+    {
+        throw std::runtime_error("Invalid arguments (empty value)");
+    }
+
+    return out;
+}
+
+int run(const EventAugmentArgs &augment_args, const std::string &log_prefix);
+
+struct EventMergeArgs
+{
+    std::string output_root;
+    std::vector<std::string> inputs;
+    unsigned n_threads = 0;
+};
+
+inline EventMergeArgs parse_event_merge_args(const std::vector<std::string> &args, const std::string &usage)
+{
+    EventMergeArgs out;
+    std::vector<std::string> positional;
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        const std::string arg = trim(args[i]);
+        if (arg == "-j" || arg == "--threads")
+        {
+            if (i + 1 >= args.size())
+            {
+                throw std::runtime_error(usage);
+            }
+            const int n = std::stoi(args[++i]);
+            if (n < 0)
+            {
+                throw std::runtime_error("Invalid thread count: " + args[i]);
+            }
+            out.n_threads = static_cast<unsigned>(n);
+            continue;
+        }
+        if (arg.empty())
+        {
+            throw std::runtime_error("Invalid arguments (empty value)");
+        }
+        positional.push_back(arg);
+    }
+
+    if (positional.size() < 3)
+    {
+        throw std::runtime_error(usage);
+    }
+
+    out.output_root = positional.front();
+    out.inputs.assign(positional.begin() + 1, positional.end());
+
+    std::filesystem::path output_root(out.output_root);
+    if (output_root.is_relative() && output_root.parent_path().empty())
+    {
+        const std::filesystem::path event_dir =
+            stage_output_dir("HERON_EVENT_DIR", "event");
+        out.output_root = (event_dir / output_root).string();
+    }
+
+    for (const auto &input : out.inputs)
+    {
+        if (std::filesystem::exists(input) && std::filesystem::exists(out.output_root) &&
+            std::filesystem::equivalent(input, out.output_root))
+        {
+            throw std::runtime_error("Merged output must differ from the inputs: " + input);
+        }
+    }
+
+    return out;
+}
+
+int run(const EventMergeArgs &merge_args, const std::string &log_prefix);
+
+struct EventSplitArgs
+{
+    std::string event_list_root;
+    std::string output_dir;
+    std::string selection = "true";
+    std::vector<std::pair<std::string, double>> fractions = {{"train", 0.8}, {"val", 0.1}, {"test", 0.1}};
+    std::vector<std::pair<int, double>> keep_fractions;
+    bool balance = false;
+    int n_shards = 1;
+    unsigned long long seed = 0;
+};
+
+/// "a=x,b=y" -> {(a, x), (b, y)}, keys kept as written.
+inline std::vector<std::pair<std::string, double>> parse_fraction_list(const std::string &text)
+{
+    std::vector<std::pair<std::string, double>> out;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        item = trim(item);
+        const auto eq = item.find('=');
+        if (eq == std::string::npos || eq == 0 || eq + 1 == item.size())
+        {
+            throw std::runtime_error("Expected NAME=FRACTION, got: " + item);
+        }
+        out.emplace_back(trim(item.substr(0, eq)), std::stod(item.substr(eq + 1)));
+    }
+    if (out.empty())
+    {
+        throw std::runtime_error("Empty fraction list");
+    }
+    return out;
+}
+
+inline EventSplitArgs parse_event_split_args(const std::vector<std::string> &args, const std::string &usage)
+{
+    EventSplitArgs out;
+    std::vector<std::string> positional;
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        const std::string arg = trim(args[i]);
+        const bool has_value = i + 1 < args.size();
+        if (arg == "-n" || arg == "--shards")
+        {
+            if (!has_value)
+            {
+                throw std::runtime_error(usage);
+            }
+            out.n_shards = std::stoi(args[++i]);
+            if (out.n_shards < 1)
+            {
+                throw std::runtime_error("Invalid shard count: " + args[i]);
+            }
+            continue;
+        }
+        if (arg == "--seed")
+        {
+            if (!has_value)
+            {
+                throw std::runtime_error(usage);
+            }
+            out.seed = std::stoull(args[++i]);
+            continue;
+        }
+        if (arg == "--fractions")
+        {
+            if (!has_value)
+            {
+                throw std::runtime_error(usage);
+            }
+            out.fractions = parse_fraction_list(args[++i]);
+            continue;
+        }
+        if (arg == "--keep")
+        {
+            if (!has_value)
+            {
+                throw std::runtime_error(usage);
+            }
+            out.keep_fractions.clear();
+            for (const auto &kv : parse_fraction_list(args[++i]))
+            {
+                out.keep_fractions.emplace_back(std::stoi(kv.first), kv.second);
+            }
+            continue;
+        }
+        if (arg == "--balance")
+        {
+            out.balance = true;
+            continue;
+        }
+        if (arg.empty())
+        {
+            throw std::runtime_error("Invalid arguments (empty value)");
+        }
+        positional.push_back(arg);
+    }
+
+    if (positional.size() != 2 && positional.size() != 3)
+    {
+        throw std::runtime_error(usage);
+    }
+    if (out.balance && !out.keep_fractions.empty())
+    {
+        throw std::runtime_error("--balance and --keep are mutually exclusive");
+    }
+
+    out.event_list_root = positional[0];
+    out.output_dir = positional[1];
+    if (positional.size() == 3)
+    {
+        out.selection = positional[2];
+    }
+
+    return out;
+}
+
+int run(const EventSplitArgs &split_args, const std::string &log_prefix);
+
 #endif // HERON_CORE_EVENTCLI_H
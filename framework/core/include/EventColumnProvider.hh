@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -19,6 +20,7 @@
 #include <vector>
 
 #include "AppUtils.hh"
+#include "SparseImageService.hh"
 
 
 
@@ -43,6 +45,10 @@ class EventColumnProvider
     }
     const std::string &schema_tag() const noexcept { return m_schema_tag; }
 
+    /// Image columns typed `sparse` or `sparse:THRESHOLD`; columns() and the
+    /// schema list their sparse columns in their place.
+    const std::vector<SparseImageService::Column> &sparse_images() const noexcept { return m_sparse_images; }
+
     std::string schema_tsv() const
     {
         if (m_schema_columns.empty())
@@ -79,6 +85,27 @@ class EventColumnProvider
         return value;
     }
 
+    /// Threshold of a `sparse:THRESHOLD` type: a finite number >= 0.
+    static double parse_sparse_threshold(const std::string &text, const std::string &path, std::size_t line_number)
+    {
+        std::size_t used = 0;
+        double value = 0.0;
+        try
+        {
+            value = std::stod(text, &used);
+        }
+        catch (const std::exception &)
+        {
+            used = 0;
+        }
+        if (text.empty() || used != text.size() || !std::isfinite(value) || value < 0.0)
+        {
+            throw std::runtime_error("EventColumnProvider: invalid sparse threshold '" + text + "' at " + path + ":" +
+                                     std::to_string(line_number) + " (expected sparse:THRESHOLD with THRESHOLD >= 0)");
+        }
+        return value;
+    }
+
     void load_columns_tsv(const std::string &path)
     {
         std::ifstream input(path);
@@ -89,11 +116,14 @@ class EventColumnProvider
 
         std::vector<std::string> columns;
         std::vector<std::pair<std::string, std::string>> schema_columns;
+        std::vector<SparseImageService::Column> sparse_images;
         bool header_checked = false;
 
         std::string line;
+        std::size_t line_number = 0;
         while (std::getline(input, line))
         {
+            ++line_number;
             line = trim(line);
             if (line.empty() || line[0] == '#')
             {
@@ -130,6 +160,26 @@ class EventColumnProvider
                 throw std::runtime_error("EventColumnProvider: missing column name in TSV: " + path);
             }
 
+            const std::string kind = lower(type);
+            if (kind == "sparse" || kind.rfind("sparse:", 0) == 0)
+            {
+                SparseImageService::Column image;
+                image.name = name;
+                if (kind.size() > 6)
+                {
+                    image.threshold = parse_sparse_threshold(trim(type.substr(7)), path, line_number);
+                }
+                sparse_images.push_back(image);
+
+                columns.push_back(SparseImageService::index_column(name));
+                columns.push_back(SparseImageService::value_column(name));
+                columns.push_back(SparseImageService::size_column(name));
+                schema_columns.emplace_back("ROOT::VecOps::RVec<unsigned int>", SparseImageService::index_column(name));
+                schema_columns.emplace_back("auto", SparseImageService::value_column(name));
+                schema_columns.emplace_back("int", SparseImageService::size_column(name));
+                continue;
+            }
+
             columns.push_back(name);
             schema_columns.emplace_back(type, name);
         }
@@ -138,11 +188,13 @@ class EventColumnProvider
         {
             m_columns = std::move(columns);
             m_schema_columns = std::move(schema_columns);
+            m_sparse_images = std::move(sparse_images);
         }
     }
 
     std::vector<std::string> m_columns;
     std::vector<std::pair<std::string, std::string>> m_schema_columns;
+    std::vector<SparseImageService::Column> m_sparse_images;
     std::string m_schema_tag;
 };
 
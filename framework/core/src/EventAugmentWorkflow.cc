@@ -0,0 +1,198 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/core/src/EventAugmentWorkflow.cc
+ *
+ *  @brief Adds derived columns to an existing event list as an aligned
+ *         friend tree (invoked by the unified heron CLI).
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+#include <TROOT.h>
+
+#include "AppUtils.hh"
+#include "EventCLI.hh"
+#include "EventListIO.hh"
+#include "LogitCalibrator.hh"
+#include "SnapshotService.hh"
+
+namespace
+{
+
+struct ColumnDefinition
+{
+    std::string name;
+    std::string expression;
+};
+
+/// name<TAB>expression per line; '#' comments and a "name expression"
+/// header are skipped.
+std::vector<ColumnDefinition> read_definitions(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw std::runtime_error("Failed to open column definitions TSV: " + path);
+    }
+
+    std::vector<ColumnDefinition> out;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        const auto tab = line.find('\t');
+        if (tab == std::string::npos)
+        {
+            throw std::runtime_error("Column definition needs name<TAB>expression: " + line);
+        }
+
+        ColumnDefinition def{trim(line.substr(0, tab)), trim(line.substr(tab + 1))};
+        if (def.name == "name" && def.expression == "expression")
+        {
+            continue;
+        }
+        if (def.name.empty() || def.expression.empty())
+        {
+            throw std::runtime_error("Invalid column definition: " + line);
+        }
+        out.push_back(std::move(def));
+    }
+
+    if (out.empty())
+    {
+        throw std::runtime_error("No column definitions in " + path);
+    }
+    return out;
+}
+
+std::vector<std::string> split_colon(const std::string &s)
+{
+    std::vector<std::string> out;
+    std::string token;
+    std::istringstream stream(s);
+    while (std::getline(stream, token, ':'))
+    {
+        out.push_back(token);
+    }
+    return out;
+}
+
+/// Expressions are RDataFrame strings, or
+/// calibrate:CALIB.root:LOGIT_COLUMN[:prob|log_odds|llr] for a stored
+/// LogitCalibrator.
+ROOT::RDF::RNode define_column(ROOT::RDF::RNode node, const ColumnDefinition &def)
+{
+    if (def.expression.rfind("calibrate:", 0) != 0)
+    {
+        return node.Define(def.name, def.expression);
+    }
+
+    const std::vector<std::string> parts = split_colon(def.expression);
+    if (parts.size() != 3 && parts.size() != 4)
+    {
+        throw std::runtime_error("Calibrator definition must be calibrate:CALIB.root:LOGIT[:OUTPUT]: "
+                                 + def.expression);
+    }
+
+    using Output = heron::LogitCalibrator::Output;
+    Output what = Output::kProb;
+    if (parts.size() == 4)
+    {
+        if (parts[3] == "log_odds")
+            what = Output::kLogOdds;
+        else if (parts[3] == "llr")
+            what = Output::kLLR;
+        else if (parts[3] != "prob")
+            throw std::runtime_error("Unknown calibrator output '" + parts[3] + "' for " + def.name);
+    }
+
+    const heron::LogitCalibrator calib = heron::LogitCalibrator::load_from_root(parts[1].c_str());
+    return calib.define_calibrated(node, def.name, parts[2], what);
+}
+
+std::string friend_file_entry(const std::string &event_list_root, const std::string &output_root)
+{
+    if (output_root.empty())
+    {
+        return "";
+    }
+
+    const std::filesystem::path event_path = std::filesystem::absolute(event_list_root);
+    const std::filesystem::path output_path = std::filesystem::absolute(output_root);
+    if (std::filesystem::exists(output_path) && std::filesystem::equivalent(event_path, output_path))
+    {
+        return "";
+    }
+    return output_path.lexically_relative(event_path.parent_path()).string();
+}
+
+} // namespace
+
+int run(const EventAugmentArgs &augment_args, const std::string &log_prefix)
+{
+    // Friend trees are matched entry by entry, so the event loop must keep
+    // the event tree's order.
+    ROOT::DisableImplicitMT();
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const std::vector<ColumnDefinition> definitions = read_definitions(augment_args.definitions_tsv_path);
+
+    nu::EventListIO event_io(augment_args.event_list_root, nu::EventListIO::OpenMode::kUpdate);
+
+    nu::EventFriend fr;
+    fr.tree = SnapshotService::sanitise_root_key(
+        event_io.event_tree() + "_" + std::filesystem::path(augment_args.definitions_tsv_path).stem().string());
+    fr.file = friend_file_entry(augment_args.event_list_root, augment_args.output_root);
+    const std::string friend_path =
+        augment_args.output_root.empty() ? augment_args.event_list_root : augment_args.output_root;
+
+    log_info(log_prefix,
+             "action=event_augment status=start input=" + augment_args.event_list_root
+                 + " friend_tree=" + fr.tree
+                 + " columns=" + format_count(static_cast<long long>(definitions.size())));
+
+    ROOT::RDF::RNode node = event_io.rdf_without_friend(fr.tree);
+
+    std::vector<std::string> columns;
+    std::vector<std::pair<std::string, std::string>> schema_columns;
+    for (const auto &def : definitions)
+    {
+        log_stage(log_prefix, "define_column", "column=" + def.name + " expression=" + def.expression);
+        node = define_column(node, def);
+        columns.push_back(def.name);
+        schema_columns.emplace_back(node.GetColumnType(def.name), def.name);
+    }
+
+    log_stage(log_prefix, "snapshot", "tree=" + fr.tree + " output=" + friend_path);
+    const ULong64_t n_written = SnapshotService::snapshot_friend(node, friend_path, fr.tree, columns);
+
+    event_io.add_friend(fr, schema_columns);
+
+    const auto end_time = std::chrono::steady_clock::now();
+    const double elapsed_seconds =
+        std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time).count();
+
+    std::ostringstream out;
+    out << "action=event_augment status=complete friend_tree=" << fr.tree
+        << " entries=" << n_written
+        << " output=" << friend_path
+        << " elapsed_s=" << std::fixed << std::setprecision(1) << elapsed_seconds;
+    log_success(log_prefix, out.str());
+
+    return 0;
+}
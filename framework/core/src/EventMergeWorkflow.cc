@@ -0,0 +1,62 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/core/src/EventMergeWorkflow.cc
+ *
+ *  @brief Physical merge of event lists with sample ids remapped into one
+ *         namespace (invoked by the unified heron CLI).
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "AppUtils.hh"
+#include "EventCLI.hh"
+#include "EventListIO.hh"
+#include "EventListSet.hh"
+
+int run(const EventMergeArgs &merge_args, const std::string &log_prefix)
+{
+    const auto start_time = std::chrono::steady_clock::now();
+
+    log_info(log_prefix,
+             "action=event_merge status=start inputs=" + format_count(static_cast<long long>(merge_args.inputs.size()))
+                 + " output=" + merge_args.output_root);
+
+    const nu::EventListSet event_lists = nu::EventListSet::read(merge_args.inputs);
+    for (size_t i = 0; i < event_lists.size(); ++i)
+    {
+        log_stage(log_prefix,
+                  "remap",
+                  "input=" + event_lists.period(i).path
+                      + " first_sample_id=" + std::to_string(event_lists.global_sample_id(i, 0)));
+    }
+
+    log_stage(log_prefix, "fast_clone", "output=" + merge_args.output_root);
+    const Long64_t n_written = event_lists.write_merged(merge_args.output_root, merge_args.n_threads);
+
+    nu::EventListIO merged(merge_args.output_root, nu::EventListIO::OpenMode::kUpdate);
+
+    log_stage(log_prefix, "event_index", "output=" + merge_args.output_root);
+    const Long64_t n_indexed = merged.build_event_index();
+
+    log_stage(log_prefix, "zone_maps", "output=" + merge_args.output_root);
+    const Long64_t n_clusters = merged.build_zone_maps();
+
+    const auto end_time = std::chrono::steady_clock::now();
+    const double elapsed_seconds =
+        std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time).count();
+
+    std::ostringstream out;
+    out << "action=event_merge status=complete inputs=" << event_lists.size()
+        << " samples=" << event_lists.sample_refs().size()
+        << " events_written=" << n_written
+        << " indexed=" << n_indexed
+        << " clusters=" << n_clusters
+        << " output=" << merge_args.output_root
+        << " elapsed_s=" << std::fixed << std::setprecision(1) << elapsed_seconds;
+    log_success(log_prefix, out.str());
+
+    return 0;
+}
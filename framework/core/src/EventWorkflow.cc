@@ -22,6 +22,7 @@
 #include "EventListIO.hh"
 #include "EventSampleFilterService.hh"
 #include "RDataFrameService.hh"
+#include "SparseImageService.hh"
 #include "StatusMonitor.hh"
 
 int run(const EventArgs &event_args, const std::string &log_prefix)
@@ -123,6 +124,15 @@ int run(const EventArgs &event_args, const std::string &log_prefix)
             node = EventSampleFilterService::apply(node, sample.origin);
         }
 
+        if (!column_provider.sparse_images().empty())
+        {
+            log_stage(
+                log_prefix,
+                "sparse_images",
+                "sample=" + sample.sample_name);
+            node = SparseImageService::define_sparse(node, column_provider.sparse_images());
+        }
+
         std::string snapshot_message = "sample=" + sample.sample_name;
         if (!event_args.selection.empty())
         {
@@ -154,6 +164,24 @@ int run(const EventArgs &event_args, const std::string &log_prefix)
         }
         log_success(log_prefix, log_message.str());
     }
+
+    log_stage(
+        log_prefix,
+        "event_index",
+        "output=" + event_args.output_root);
+    const Long64_t n_indexed = event_io.build_event_index();
+    log_success(log_prefix,
+                "action=event_index status=complete entries=" + std::to_string(n_indexed)
+                    + " output=" + event_args.output_root);
+
+    log_stage(
+        log_prefix,
+        "zone_maps",
+        "output=" + event_args.output_root);
+    const Long64_t n_clusters = event_io.build_zone_maps();
+    log_success(log_prefix,
+                "action=zone_maps status=complete clusters=" + std::to_string(n_clusters)
+                    + " output=" + event_args.output_root);
     status_monitor.stop();
 
     const auto end_time = std::chrono::steady_clock::now();
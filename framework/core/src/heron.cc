@@ -100,6 +100,7 @@ void print_main_help(std::ostream &out)
         << "  art         Aggregate art provenance for an input\n"
         << "  sample      Aggregate Sample ROOT files from art provenance\n"
         << "  event       Build event-level output from aggregated samples\n"
+        << "  event-merge Merge event lists into one file with remapped sample ids\n"
         << "  macro       Run ROOT macros (plotting or standalone)\n"
         << "  status      Log status for executable binaries\n"
         << "  paths       Print resolved workspace paths\n"
@@ -629,6 +630,24 @@ int handle_event_command(const std::vector<std::string> &args,
         "heronEventIOdriver",
         [&]()
         {
+            if (!args.empty() && args[0] == "augment")
+            {
+                const EventAugmentArgs augment_args =
+                    parse_event_augment_args(
+                        std::vector<std::string>(args.begin() + 1, args.end()),
+                        "Usage: heron event augment EVENTS.root DEFINITIONS.tsv [OUTPUT.root]");
+                return run(augment_args, "heronEventAugment");
+            }
+            if (!args.empty() && args[0] == "split")
+            {
+                const EventSplitArgs split_args =
+                    parse_event_split_args(
+                        std::vector<std::string>(args.begin() + 1, args.end()),
+                        "Usage: heron event split [-n SHARDS] [--seed SEED] [--fractions NAME=F,...] "
+                        "[--keep CLASS=F,... | --balance] EVENTS.root OUTPUT_DIR [SELECTION]");
+                return run(split_args, "heronEventSplit");
+            }
+
             std::vector<std::string> rewritten = args;
             if (args.size() == 3 && has_suffix(args[0], ".root"))
             {
@@ -656,6 +675,20 @@ int handle_event_command(const std::vector<std::string> &args,
         });
 }
 
+int handle_event_merge_command(const std::vector<std::string> &args)
+{
+    return run_guarded(
+        "heronEventMerge",
+        [&]()
+        {
+            const EventMergeArgs merge_args =
+                parse_event_merge_args(
+                    args,
+                    "Usage: heron event-merge [-j THREADS] OUTPUT.root EVENTS.root EVENTS.root [...]");
+            return run(merge_args, "heronEventMerge");
+        });
+}
+
 struct StatusOptions
 {
     int interval_seconds = 60;
@@ -940,7 +973,22 @@ std::vector<CommandEntry> build_command_table(const std::filesystem::path &repo_
         },
         []()
         {
-            std::cout << "Usage: heron event SAMPLE_LIST.tsv OUTPUT.root SELECTION COLUMNS.tsv\n";
+            std::cout << "Usage: heron event SAMPLE_LIST.tsv OUTPUT.root SELECTION COLUMNS.tsv\n"
+                      << "       heron event augment EVENTS.root DEFINITIONS.tsv [OUTPUT.root]\n"
+                      << "       heron event split [-n SHARDS] [--seed SEED] [--fractions NAME=F,...]\n"
+                      << "                         [--keep CLASS=F,... | --balance] EVENTS.root OUTPUT_DIR\n"
+                      << "                         [SELECTION]\n";
+        }
+    });
+    table.push_back(CommandEntry{
+        "event-merge",
+        [](const std::vector<std::string> &args)
+        {
+            return handle_event_merge_command(args);
+        },
+        []()
+        {
+            std::cout << "Usage: heron event-merge [-j THREADS] OUTPUT.root EVENTS.root EVENTS.root [...]\n";
         }
     });
     return table;
@@ -0,0 +1,93 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/ana/include/CutScanService.hh
+ *
+ *  @brief Grid scan of the SelectionService thresholds, evaluating signal
+ *         and background yields for the whole grid in one event loop.
+ */
+
+#ifndef HERON_ANA_CUT_SCAN_SERVICE_H
+#define HERON_ANA_CUT_SCAN_SERVICE_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+#include <TH2D.h>
+
+
+class CutScanService
+{
+  public:
+    enum Axis
+    {
+        kTopologyScore = 0,
+        kTrackScore = 1,
+        kTrackLength = 2,
+        kTrackDistance = 3,
+        kNumAxes = 4
+    };
+
+    /// Threshold values per cut; each defaults to the SelectionService value.
+    /// Passing means topological_score > t, track score > s, track length
+    /// > l and track distance < d for some track of the required generation.
+    struct Grid
+    {
+        std::vector<float> topology_score;
+        std::vector<float> track_score;
+        std::vector<float> track_length;
+        std::vector<float> track_distance;
+    };
+
+    struct Columns
+    {
+        std::string trigger = "sel_trigger";
+        std::string fiducial = "in_reco_fiducial";
+        std::string num_slices = "num_slices";
+        std::string topology_score = "topological_score";
+        std::string track_score = "track_shower_scores";
+        std::string track_length = "track_length";
+        std::string track_distance = "track_distance_to_vertex";
+        std::string generation = "pfp_generations";
+        std::string signal = "is_signal";
+        std::string weight = "w_nominal";
+    };
+
+    struct Result
+    {
+        /// Sorted, de-duplicated thresholds per axis.
+        std::vector<std::vector<float>> axes;
+        /// Weighted yields per grid point, topology score slowest.
+        std::vector<double> signal;
+        std::vector<double> background;
+        double signal_total = 0.0;
+        double background_total = 0.0;
+
+        std::size_t size() const { return signal.size(); }
+        std::size_t index(std::size_t it, std::size_t is, std::size_t il, std::size_t id) const;
+        std::vector<float> thresholds(std::size_t i) const;
+
+        double efficiency(std::size_t i) const;
+        double purity(std::size_t i) const;
+        /// s / sqrt(s + b)
+        double figure_of_merit(std::size_t i) const;
+        std::size_t best() const;
+
+        void write_table(std::ostream &out) const;
+        /// Best figure of merit over the other axes for each (x, y) pair.
+        std::unique_ptr<TH2D> heat_map(Axis x, Axis y, const std::string &name = "cut_scan") const;
+    };
+
+    /// `node` should hold simulated events only; signal is the `signal`
+    /// column, everything else background.
+    static Result run(ROOT::RDF::RNode node, const Grid &grid, const Columns &columns);
+    static Result run(ROOT::RDF::RNode node, const Grid &grid);
+
+    static const char *axis_name(Axis axis);
+};
+
+
+#endif // HERON_ANA_CUT_SCAN_SERVICE_H
@@ -0,0 +1,78 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/ana/include/CutflowService.hh
+ *
+ *  @brief One-pass cutflow over the packed selection mask, giving cumulative
+ *         and N-1 yields per sample and analysis channel.
+ */
+
+#ifndef HERON_ANA_CUTFLOW_SERVICE_H
+#define HERON_ANA_CUTFLOW_SERVICE_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+
+#include "SelectionService.hh"
+
+
+class CutflowService
+{
+  public:
+    struct Yield
+    {
+        double entries = 0.0;
+        double sum_w = 0.0;
+        double sum_w2 = 0.0;
+
+        void add(double w)
+        {
+            entries += 1.0;
+            sum_w += w;
+            sum_w2 += w * w;
+        }
+
+        Yield &operator+=(const Yield &o)
+        {
+            entries += o.entries;
+            sum_w += o.sum_w;
+            sum_w2 += o.sum_w2;
+            return *this;
+        }
+    };
+
+    struct Row
+    {
+        int sample_id = -1;
+        int channel = -1;
+        /// cumulative[0] is every event, cumulative[k] passes stages 0..k-1.
+        std::vector<Yield> cumulative;
+        /// n_minus_one[k] passes every stage other than k.
+        std::vector<Yield> n_minus_one;
+    };
+
+    struct Columns
+    {
+        std::string mask = "sel_mask";
+        std::string sample_id = "sample_id";
+        std::string channel = "analysis_channels";
+        std::string weight = "w_nominal";
+    };
+
+    /// Rows ordered by (sample_id, channel).
+    static std::vector<Row> run(ROOT::RDF::RNode node,
+                                const Columns &columns,
+                                int n_stages = SelectionService::kNumStages);
+    static std::vector<Row> run(ROOT::RDF::RNode node);
+
+    /// One row per sample (channel -1), or a single row over everything.
+    static std::vector<Row> merge_channels(const std::vector<Row> &rows);
+    static Row total(const std::vector<Row> &rows);
+
+    static void print(std::ostream &out, const std::vector<Row> &rows, bool weighted = true);
+};
+
+
+#endif // HERON_ANA_CUTFLOW_SERVICE_H
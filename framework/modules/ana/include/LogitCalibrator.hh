@@ -4,14 +4,19 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include <ROOT/RDataFrame.hxx>
+
 #include "TDirectory.h"
 #include "TFile.h"
 #include "TParameter.h"
@@ -26,6 +31,15 @@ class LogitCalibrator {
  public:
   enum class Method : int { kNone = 0, kPlatt = 1, kIsotonic = 2 };
 
+  /// Quantity produced by the batch and RDataFrame entry points.
+  enum class Output : int {
+    kProb = 0,
+    kLogOdds = 1,
+    kLLR = 2,
+    kPosterior = 3,
+    kLogOddsTarget = 4
+  };
+
   LogitCalibrator() = default;
 
   /// Get configured calibration method.
@@ -76,6 +90,7 @@ class LogitCalibrator {
     for (double& p : values_) {
       p = clamp_prob(p);
     }
+    compile_isotonic();
     pi_fit_ = clamp_prob_01(pi_fit);
     method_ = Method::kIsotonic;
   }
@@ -93,8 +108,7 @@ class LogitCalibrator {
         if (values_.empty()) {
           throw std::runtime_error("prob: isotonic mapping is empty");
         }
-        const int idx = find_isotonic_bin(raw_logit);
-        return values_.at(static_cast<size_t>(idx));
+        return values_[static_cast<size_t>(lookup_isotonic_bin(raw_logit))];
       }
       default:
         throw std::runtime_error("prob: unknown method");
@@ -109,7 +123,10 @@ class LogitCalibrator {
       case Method::kPlatt:
         return a_ * raw_logit + b_;
       case Method::kIsotonic:
-        return logit(prob(raw_logit));
+        if (values_.empty()) {
+          throw std::runtime_error("log_odds: isotonic mapping is empty");
+        }
+        return table_.log_odds[static_cast<size_t>(lookup_isotonic_bin(raw_logit))];
       default:
         throw std::runtime_error("log_odds: unknown method");
     }
@@ -133,6 +150,138 @@ class LogitCalibrator {
     return llr_val + prior_log_odds(clamp_prob_01(pi_target));
   }
 
+  /// Batch prob() over n contiguous logits; out may alias x for double input.
+  template <typename T>
+  void prob(const T* x, std::size_t n, double* out) const {
+    evaluate(Output::kProb, x, n, out);
+  }
+
+  /// Batch log_odds().
+  template <typename T>
+  void log_odds(const T* x, std::size_t n, double* out) const {
+    evaluate(Output::kLogOdds, x, n, out);
+  }
+
+  /// Batch llr().
+  template <typename T>
+  void llr(const T* x, std::size_t n, double* out) const {
+    evaluate(Output::kLLR, x, n, out);
+  }
+
+  /// Batch posterior().
+  template <typename T>
+  void posterior(const T* x, std::size_t n, double pi_target, double* out) const {
+    evaluate(Output::kPosterior, x, n, out, pi_target);
+  }
+
+  /// Batch log_odds_target().
+  template <typename T>
+  void log_odds_target(const T* x, std::size_t n, double pi_target, double* out) const {
+    evaluate(Output::kLogOddsTarget, x, n, out, pi_target);
+  }
+
+  /// Evaluate one output over n contiguous logits. The method and output are
+  /// resolved once per call, so the loop body carries no dispatch, and it
+  /// gives the same values as the scalar methods. Full blocks of kBlock
+  /// logits go through Kernel::eval_block(); the remainder is scalar.
+  template <typename T>
+  void evaluate(Output what,
+                const T* x,
+                std::size_t n,
+                double* out,
+                double pi_target = 0.5) const {
+    if (n == 0) {
+      return;
+    }
+    if (!x || !out) {
+      throw std::runtime_error("evaluate: null input/output");
+    }
+
+    const Kernel k = make_kernel(pi_target);
+    dispatch(what, [&](auto isotonic, auto output) {
+      constexpr bool kIsotonic = decltype(isotonic)::value;
+      constexpr Output kOutput = decltype(output)::value;
+      std::size_t i = 0;
+      for (; i + kBlock <= n; i += kBlock) {
+        k.template eval_block<kIsotonic, kOutput>(x + i, out + i);
+      }
+      for (; i < n; ++i) {
+        out[i] = k.template eval<kIsotonic, kOutput>(static_cast<double>(x[i]));
+      }
+    });
+  }
+
+  /// Define a calibrated column from a float or double logit column. The
+  /// calibrator is copied, and method and output are fixed at definition, so
+  /// each event runs only the selected kernel.
+  ROOT::RDF::RNode define_calibrated(ROOT::RDF::RNode node,
+                                     const std::string& column,
+                                     const std::string& logit_column,
+                                     Output what = Output::kProb,
+                                     double pi_target = 0.5) const {
+    const std::string type = node.GetColumnType(logit_column);
+    const bool is_float = (type == "float" || type == "Float_t");
+    if (!is_float && type != "double" && type != "Double_t") {
+      throw std::runtime_error("define_calibrated: column " + logit_column +
+                               " must be float or double, found " + type);
+    }
+
+    auto self = std::make_shared<const LogitCalibrator>(*this);
+    auto k = std::make_shared<const Kernel>(self->make_kernel(pi_target));
+
+    return dispatch(what, [&](auto isotonic, auto output) -> ROOT::RDF::RNode {
+      constexpr bool kIsotonic = decltype(isotonic)::value;
+      constexpr Output kOutput = decltype(output)::value;
+      if (is_float) {
+        return node.Define(column, [self, k](float x) {
+          return k->template eval<kIsotonic, kOutput>(static_cast<double>(x));
+        }, {logit_column});
+      }
+      return node.Define(column, [self, k](double x) {
+        return k->template eval<kIsotonic, kOutput>(x);
+      }, {logit_column});
+    });
+  }
+
+  /// Check the isotonic lookup table against the binary search over edges at
+  /// every edge, its neighbouring doubles, each grid cell start and the
+  /// non-finite inputs, and the per-bin log-odds against logit(values).
+  bool verify_isotonic_lookup() const {
+    if (table_.log_odds.size() != values_.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < values_.size(); ++i) {
+      if (table_.log_odds[i] != logit(values_[i])) {
+        return false;
+      }
+    }
+    if (values_.empty()) {
+      return true;
+    }
+
+    const double inf = std::numeric_limits<double>::infinity();
+    auto agrees = [&](double x) {
+      return lookup_isotonic_bin(x) == find_isotonic_bin(x);
+    };
+
+    if (!agrees(inf) || !agrees(-inf) || !agrees(std::numeric_limits<double>::quiet_NaN())) {
+      return false;
+    }
+    for (double e : edges_) {
+      if (!agrees(e) || !agrees(std::nextafter(e, -inf)) || !agrees(std::nextafter(e, inf))) {
+        return false;
+      }
+    }
+    const double width = (table_.hi - table_.lo) / std::max<size_t>(table_.first.size(), 1);
+    for (size_t c = 0; c < table_.first.size(); ++c) {
+      const double x = table_.lo + static_cast<double>(c) * width;
+      if (!agrees(x) || !agrees(std::nextafter(x, -inf)) || !agrees(std::nextafter(x, inf))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   /// Fit Platt scaling from vectors.
   void fit_platt(const std::vector<double>& x,
                  const std::vector<int>& y,
@@ -244,94 +393,18 @@ class LogitCalibrator {
       throw std::runtime_error("fit_isotonic: invalid min_prob/max_prob");
     }
 
-    struct Pt {
-      double x;
-      double y;
-      double w;
-    };
-
-    std::vector<Pt> pts;
+    std::vector<IsotonicPoint> pts;
     pts.reserve(x.size());
     for (size_t i = 0; i < x.size(); ++i) {
       const double wi = (w ? (*w)[i] : 1.0);
-      pts.push_back(Pt{x[i], (y[i] != 0) ? 1.0 : 0.0, wi});
+      pts.push_back(IsotonicPoint{x[i], x[i], wi, wi * ((y[i] != 0) ? 1.0 : 0.0)});
     }
 
-    std::sort(pts.begin(), pts.end(), [](const Pt& a_val, const Pt& b_val) {
-      return a_val.x < b_val.x;
+    std::sort(pts.begin(), pts.end(), [](const IsotonicPoint& a_val, const IsotonicPoint& b_val) {
+      return a_val.xmin < b_val.xmin;
     });
 
-    struct Block {
-      double w = 0.0;
-      double wy = 0.0;
-      double mean = 0.0;
-      double xmin = 0.0;
-      double xmax = 0.0;
-    };
-
-    std::vector<Block> blocks;
-    blocks.reserve(pts.size());
-
-    for (const auto& p : pts) {
-      Block b;
-      b.w = p.w;
-      b.wy = p.w * p.y;
-      b.mean = (b.w > 0.0) ? (b.wy / b.w) : 0.0;
-      b.xmin = p.x;
-      b.xmax = p.x;
-      blocks.push_back(b);
-
-      while (blocks.size() >= 2) {
-        const Block& b2 = blocks.back();
-        const Block& b1 = blocks[blocks.size() - 2];
-        if (b1.mean <= b2.mean) {
-          break;
-        }
-
-        Block merged;
-        merged.w = b1.w + b2.w;
-        merged.wy = b1.wy + b2.wy;
-        merged.mean = (merged.w > 0.0) ? (merged.wy / merged.w) : 0.0;
-        merged.xmin = b1.xmin;
-        merged.xmax = b2.xmax;
-
-        blocks.pop_back();
-        blocks.pop_back();
-        blocks.push_back(merged);
-      }
-    }
-
-    const int n = static_cast<int>(blocks.size());
-    if (n <= 0) {
-      throw std::runtime_error("fit_isotonic: no blocks produced");
-    }
-
-    std::vector<double> edges;
-    std::vector<double> vals;
-    edges.resize(static_cast<size_t>(n + 1));
-    vals.resize(static_cast<size_t>(n));
-
-    const double neg = -1e300;
-    const double pos = 1e300;
-    edges[0] = neg;
-
-    for (int i = 0; i < n; ++i) {
-      double p = blocks[static_cast<size_t>(i)].mean;
-      p = std::max(min_prob, std::min(max_prob, p));
-      vals[static_cast<size_t>(i)] = p;
-
-      if (i < (n - 1)) {
-        const double boundary = 0.5 *
-            (blocks[static_cast<size_t>(i)].xmax + blocks[static_cast<size_t>(i + 1)].xmin);
-        edges[static_cast<size_t>(i + 1)] = boundary;
-      }
-    }
-
-    edges[static_cast<size_t>(n)] = pos;
-
-    edges_ = std::move(edges);
-    values_ = std::move(vals);
-    method_ = Method::kIsotonic;
+    fit_isotonic_points(pts, min_prob, max_prob);
   }
 
   /// Fit Platt scaling from tree expressions.
@@ -367,6 +440,162 @@ class LogitCalibrator {
     fit_isotonic(x, y, (w.empty() ? NULL : &w), min_prob, max_prob);
   }
 
+  /// Fit Platt scaling from RDataFrame expressions without materialising the
+  /// sample. Every Newton iteration is one event loop reducing NLL, gradient
+  /// and Hessian per slot for a ladder of line-search steps.
+  void fit_platt(ROOT::RDF::RNode node,
+                 const std::string& logit_expr,
+                 const std::string& label_expr,
+                 const std::string& weight_expr = "",
+                 int max_iter = 60,
+                 double tol = 1e-10,
+                 double l2 = 0.0) {
+    node = define_fit_columns(node, logit_expr, label_expr, weight_expr);
+    const FitSummary summary = summarise_fit_columns(node);
+    if (summary.n == 0.0) {
+      throw std::runtime_error("fit_platt: no usable entries read");
+    }
+    pi_fit_ = clamp_prob_01((summary.sw > 0.0) ? (summary.swy / summary.sw) : 0.5);
+
+    auto penalised = [&](const PlattSums& sums, double a_val, double b_val) {
+      return sums.nll + ((l2 > 0.0) ? 0.5 * l2 * (a_val * a_val + b_val * b_val) : 0.0);
+    };
+
+    double a = 1.0;
+    double b = prior_log_odds(pi_fit_);
+    PlattSums sums = platt_sums(node, {a}, {b}).front();
+    double prev = penalised(sums, a, b);
+
+    std::vector<double> a_try(kPlattLadder);
+    std::vector<double> b_try(kPlattLadder);
+
+    for (int iter = 0; iter < max_iter; ++iter) {
+      double ga = sums.ga;
+      double gb = sums.gb;
+      double haa = sums.haa;
+      const double hab = sums.hab;
+      double hbb = sums.hbb;
+
+      if (l2 > 0.0) {
+        ga += l2 * a;
+        gb += l2 * b;
+        haa += l2;
+        hbb += l2;
+      }
+
+      const double det = haa * hbb - hab * hab;
+      if (!(det > 0.0) || !std::isfinite(det)) {
+        break;
+      }
+
+      const double da = (hbb * ga - hab * gb) / det;
+      const double db = (-hab * ga + haa * gb) / det;
+
+      double step = 1.0;
+      for (int ls = 0; ls < kPlattLadder; ++ls) {
+        a_try[static_cast<size_t>(ls)] = a - step * da;
+        b_try[static_cast<size_t>(ls)] = b - step * db;
+        step *= 0.5;
+      }
+
+      const std::vector<PlattSums> trial = platt_sums(node, a_try, b_try);
+
+      int accepted = -1;
+      for (int ls = 0; ls < kPlattLadder; ++ls) {
+        const double n_try = penalised(trial[static_cast<size_t>(ls)],
+                                       a_try[static_cast<size_t>(ls)], b_try[static_cast<size_t>(ls)]);
+        if (std::isfinite(n_try) && n_try <= prev) {
+          accepted = ls;
+          prev = n_try;
+          break;
+        }
+      }
+      if (accepted < 0) {
+        break;
+      }
+
+      const size_t k = static_cast<size_t>(accepted);
+      const double max_update = std::max(std::abs(a_try[k] - a), std::abs(b_try[k] - b));
+      a = a_try[k];
+      b = b_try[k];
+      sums = trial[k];
+
+      if (max_update < tol) {
+        break;
+      }
+    }
+
+    a_ = a;
+    b_ = b;
+    method_ = Method::kPlatt;
+  }
+
+  /// Fit isotonic calibration from RDataFrame expressions. One event loop
+  /// finds the logit range, a second fills a weighted fine histogram per
+  /// slot, and PAV then runs on the n_bins histogram bins.
+  void fit_isotonic(ROOT::RDF::RNode node,
+                    const std::string& logit_expr,
+                    const std::string& label_expr,
+                    const std::string& weight_expr = "",
+                    int n_bins = 10000,
+                    double min_prob = 1e-6,
+                    double max_prob = 1.0 - 1e-6) {
+    if (!(min_prob > 0.0 && max_prob < 1.0 && min_prob < max_prob)) {
+      throw std::runtime_error("fit_isotonic: invalid min_prob/max_prob");
+    }
+    if (n_bins <= 0) {
+      throw std::runtime_error("fit_isotonic: n_bins must be > 0");
+    }
+
+    node = define_fit_columns(node, logit_expr, label_expr, weight_expr);
+    const FitSummary summary = summarise_fit_columns(node);
+    if (summary.n == 0.0) {
+      throw std::runtime_error("fit_isotonic: no usable entries read");
+    }
+    pi_fit_ = clamp_prob_01((summary.sw > 0.0) ? (summary.swy / summary.sw) : 0.5);
+
+    const double lo = summary.xmin;
+    const double width = summary.xmax - summary.xmin;
+    const double scale = (width > 0.0) ? n_bins / width : 0.0;
+    const size_t nb = static_cast<size_t>(n_bins);
+
+    struct Slot {
+      std::vector<double> w, wy, xmin, xmax;
+    };
+    std::vector<Slot> slots(node.GetNSlots());
+    for (auto& slot : slots) {
+      slot.w.assign(nb, 0.0);
+      slot.wy.assign(nb, 0.0);
+      slot.xmin.assign(nb, std::numeric_limits<double>::infinity());
+      slot.xmax.assign(nb, -std::numeric_limits<double>::infinity());
+    }
+
+    node.ForeachSlot([&](unsigned int s, double x, double y, double w) {
+      Slot& slot = slots[s];
+      const size_t bin = std::min(static_cast<size_t>((x - lo) * scale), nb - 1);
+      slot.w[bin] += w;
+      slot.wy[bin] += (y > 0.5) ? w : 0.0;
+      slot.xmin[bin] = std::min(slot.xmin[bin], x);
+      slot.xmax[bin] = std::max(slot.xmax[bin], x);
+    }, {kFitX, kFitY, kFitW});
+
+    std::vector<IsotonicPoint> pts;
+    for (size_t bin = 0; bin < nb; ++bin) {
+      IsotonicPoint pt{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), 0.0, 0.0};
+      for (const auto& slot : slots) {
+        pt.w += slot.w[bin];
+        pt.wy += slot.wy[bin];
+        pt.xmin = std::min(pt.xmin, slot.xmin[bin]);
+        pt.xmax = std::max(pt.xmax, slot.xmax[bin]);
+      }
+      if (pt.w > 0.0) {
+        pts.push_back(pt);
+      }
+    }
+
+    fit_isotonic_points(pts, min_prob, max_prob);
+  }
+
   /// Save calibration parameters to ROOT file.
   void save_to_root(const char* filename, const char* dir_name = "calib") const {
     if (!filename || !dir_name) {
@@ -407,6 +636,23 @@ class LogitCalibrator {
     v_edges.Write("edges");
     v_vals.Write("values");
 
+    // Compiled isotonic lookup; readers without it rebuild from edges/values.
+    TParameter<double> p_lookup_lo("lookup_lo", table_.lo);
+    TParameter<double> p_lookup_hi("lookup_hi", table_.hi);
+    TVectorD v_first(static_cast<int>(table_.first.size()));
+    TVectorD v_log_odds(static_cast<int>(table_.log_odds.size()));
+    for (int i = 0; i < v_first.GetNrows(); ++i) {
+      v_first[i] = table_.first[static_cast<size_t>(i)];
+    }
+    for (int i = 0; i < v_log_odds.GetNrows(); ++i) {
+      v_log_odds[i] = table_.log_odds[static_cast<size_t>(i)];
+    }
+
+    p_lookup_lo.Write();
+    p_lookup_hi.Write();
+    v_first.Write("lookup_first");
+    v_log_odds.Write("log_odds");
+
     f.Write();
     f.Close();
   }
@@ -455,6 +701,38 @@ class LogitCalibrator {
       }
     }
 
+    TParameter<double>* p_lookup_lo = dynamic_cast<TParameter<double>*>(d->Get("lookup_lo"));
+    TParameter<double>* p_lookup_hi = dynamic_cast<TParameter<double>*>(d->Get("lookup_hi"));
+    TVectorD* v_first = dynamic_cast<TVectorD*>(d->Get("lookup_first"));
+    TVectorD* v_log_odds = dynamic_cast<TVectorD*>(d->Get("log_odds"));
+
+    if (p_lookup_lo && p_lookup_hi && v_first && v_log_odds) {
+      c.table_ = IsotonicTable{};
+      c.table_.lo = p_lookup_lo->GetVal();
+      c.table_.hi = p_lookup_hi->GetVal();
+      c.table_.first.resize(static_cast<size_t>(v_first->GetNrows()));
+      c.table_.log_odds.resize(static_cast<size_t>(v_log_odds->GetNrows()));
+      for (int i = 0; i < v_first->GetNrows(); ++i) {
+        c.table_.first[static_cast<size_t>(i)] = static_cast<std::int32_t>((*v_first)[i]);
+      }
+      for (int i = 0; i < v_log_odds->GetNrows(); ++i) {
+        c.table_.log_odds[static_cast<size_t>(i)] = (*v_log_odds)[i];
+      }
+      c.table_.inv_width = (c.table_.hi > c.table_.lo)
+          ? static_cast<double>(c.table_.first.size()) / (c.table_.hi - c.table_.lo)
+          : 0.0;
+      if (!(c.table_.inv_width > 0.0) || !std::isfinite(c.table_.inv_width)) {
+        c.table_.first.clear();
+        c.table_.hi = c.table_.lo;
+        c.table_.inv_width = 0.0;
+      }
+      if (!c.verify_isotonic_lookup()) {
+        throw std::runtime_error("load_from_root: stored isotonic lookup disagrees with edges/values");
+      }
+    } else {
+      c.compile_isotonic();
+    }
+
     f.Close();
     return c;
   }
@@ -467,6 +745,463 @@ class LogitCalibrator {
   std::vector<double> edges_;
   std::vector<double> values_;
 
+  /// Isotonic bin lookup compiled from edges_: a uniform grid over the
+  /// interior edges whose cells start at the bin containing their low edge,
+  /// and the log-odds of every bin.
+  struct IsotonicTable {
+    double lo = 0.0;
+    double hi = 0.0;
+    double inv_width = 0.0;
+    std::vector<std::int32_t> first;
+    std::vector<double> log_odds;
+  };
+
+  static constexpr size_t kLookupCellsPerBin = 4;
+  static constexpr size_t kLookupMaxCells = size_t(1) << 22;
+  /// Edges stepped over from the cell start before giving up on the grid
+  /// (edges clustered inside one cell) and binary searching instead.
+  static constexpr std::ptrdiff_t kLookupMaxWalk = 8;
+
+  IsotonicTable table_;
+
+  void compile_isotonic() {
+    table_ = IsotonicTable{};
+    table_.log_odds.reserve(values_.size());
+    for (double p : values_) {
+      table_.log_odds.push_back(logit(p));
+    }
+
+    const size_t n_edges = edges_.size();
+    if (n_edges < 3 || values_.empty()) {
+      return;
+    }
+
+    table_.lo = edges_[1];
+    table_.hi = edges_[n_edges - 2];
+    const size_t n_cells = std::min(std::max<size_t>(kLookupCellsPerBin * values_.size(), 1), kLookupMaxCells);
+    const double inv_width = static_cast<double>(n_cells) / (table_.hi - table_.lo);
+    // No grid (binary search only) for an empty, infinite or subnormally
+    // narrow interior range.
+    if (!(table_.hi > table_.lo) || !std::isfinite(table_.hi - table_.lo) || !std::isfinite(inv_width)) {
+      table_.hi = table_.lo;
+      return;
+    }
+
+    const double width = (table_.hi - table_.lo) / static_cast<double>(n_cells);
+    table_.inv_width = inv_width;
+    table_.first.resize(n_cells);
+
+    size_t idx = 0;
+    for (size_t c = 0; c < n_cells; ++c) {
+      const double cell_lo = table_.lo + static_cast<double>(c) * width;
+      while (idx + 1 < n_edges && !(cell_lo < edges_[idx + 1])) {
+        ++idx;
+      }
+      table_.first[c] = static_cast<std::int32_t>(idx);
+    }
+  }
+
+  /// find_isotonic_bin() over raw arrays.
+  static std::ptrdiff_t search_isotonic_bin(const double* edges,
+                                            std::ptrdiff_t n_edges,
+                                            std::ptrdiff_t n_values,
+                                            double x) {
+    const std::ptrdiff_t idx = std::upper_bound(edges, edges + n_edges, x) - edges - 1;
+    return std::min(std::max<std::ptrdiff_t>(idx, 0), n_values - 1);
+  }
+
+  /// Same bin as find_isotonic_bin(): start from the grid cell, then step
+  /// over the few edges between the cell start and x. Without a grid (fewer
+  /// than three edges, or a non-finite interior range) or after
+  /// kLookupMaxWalk steps it falls back to the binary search.
+  static std::ptrdiff_t isotonic_table_bin(const IsotonicTable& table,
+                                           const double* edges,
+                                           std::ptrdiff_t n_edges,
+                                           std::ptrdiff_t n_values,
+                                           double x) {
+    if (n_edges == 0) {
+      return 0;
+    }
+    if (table.first.empty()) {
+      return search_isotonic_bin(edges, n_edges, n_values, x);
+    }
+
+    std::ptrdiff_t idx = 0;
+    if (std::isnan(x) || x >= table.hi) {
+      idx = n_edges - 1;
+    } else if (x >= table.lo) {
+      const size_t cell = std::min(static_cast<size_t>((x - table.lo) * table.inv_width), table.first.size() - 1);
+      idx = table.first[cell];
+    }
+
+    std::ptrdiff_t steps = 0;
+    while (idx + 1 < n_edges && !(x < edges[idx + 1])) {
+      if (++steps > kLookupMaxWalk) {
+        return search_isotonic_bin(edges, n_edges, n_values, x);
+      }
+      ++idx;
+    }
+    while (idx > 0 && x < edges[idx]) {
+      if (++steps > kLookupMaxWalk) {
+        return search_isotonic_bin(edges, n_edges, n_values, x);
+      }
+      --idx;
+    }
+    return std::min(idx, n_values - 1);
+  }
+
+  std::ptrdiff_t lookup_isotonic_bin(double x) const {
+    return isotonic_table_bin(table_, edges_.data(), static_cast<std::ptrdiff_t>(edges_.size()),
+                              static_cast<std::ptrdiff_t>(values_.size()), x);
+  }
+
+  /// Calibration resolved for one batch: an affine map (none, Platt) or a
+  /// piecewise-constant lookup (isotonic), plus the prior shifts.
+  struct Kernel {
+    double a = 1.0;
+    double b = 0.0;
+    double prior_fit = 0.0;
+    double prior_target = 0.0;
+
+    const double* edges = nullptr;
+    std::ptrdiff_t n_edges = 0;
+    const double* values = nullptr;
+    std::ptrdiff_t n_values = 0;
+    const IsotonicTable* table = nullptr;
+
+    std::ptrdiff_t bin(double x) const {
+      return isotonic_table_bin(*table, edges, n_edges, n_values, x);
+    }
+
+    template <bool Isotonic, Output W>
+    double eval(double x) const {
+      double lo = 0.0;
+      if constexpr (Isotonic) {
+        const std::ptrdiff_t idx = bin(x);
+        if constexpr (W == Output::kProb) {
+          return values[idx];
+        }
+        lo = table->log_odds[static_cast<std::size_t>(idx)];
+      } else {
+        lo = a * x + b;
+        if constexpr (W == Output::kProb) {
+          return sigmoid_branchless(lo);
+        }
+      }
+
+      if constexpr (W == Output::kLogOdds) {
+        return lo;
+      }
+      const double llr_val = lo - prior_fit;
+      if constexpr (W == Output::kLLR) {
+        return llr_val;
+      }
+      const double target = llr_val + prior_target;
+      if constexpr (W == Output::kLogOddsTarget) {
+        return target;
+      }
+      return sigmoid_branchless(target);
+    }
+
+    /// eval() over kBlock logits into out. The values are staged in local
+    /// arrays with a constant trip count, so -O2 vectorises the conversion,
+    /// affine map and prior shifts, and the sigmoid's select and divide; the
+    /// isotonic lookup and std::exp stay scalar.
+    template <bool Isotonic, Output W, typename T>
+    void eval_block(const T* x, double* out) const {
+      constexpr bool kShiftFit = (W == Output::kLLR || W == Output::kPosterior || W == Output::kLogOddsTarget);
+      constexpr bool kShiftTarget = (W == Output::kPosterior || W == Output::kLogOddsTarget);
+      constexpr bool kSigmoid = (W == Output::kPosterior || (W == Output::kProb && !Isotonic));
+
+      double z[kBlock];
+      for (std::size_t i = 0; i < kBlock; ++i) {
+        double lo = 0.0;
+        if constexpr (Isotonic) {
+          const std::size_t idx = static_cast<std::size_t>(bin(static_cast<double>(x[i])));
+          lo = (W == Output::kProb) ? values[idx] : table->log_odds[idx];
+        } else {
+          lo = a * static_cast<double>(x[i]) + b;
+        }
+        if constexpr (kShiftFit) {
+          lo -= prior_fit;
+        }
+        if constexpr (kShiftTarget) {
+          lo += prior_target;
+        }
+        z[i] = lo;
+      }
+
+      if constexpr (kSigmoid) {
+        double e[kBlock];
+        for (std::size_t i = 0; i < kBlock; ++i) {
+          e[i] = std::exp(-std::abs(z[i]));
+        }
+        for (std::size_t i = 0; i < kBlock; ++i) {
+          out[i] = ((z[i] >= 0.0) ? 1.0 : e[i]) / (1.0 + e[i]);
+        }
+      } else {
+        std::copy(z, z + kBlock, out);
+      }
+    }
+  };
+
+  /// Logits per Kernel::eval_block() call.
+  static constexpr std::size_t kBlock = 64;
+
+  Kernel make_kernel(double pi_target) const {
+    Kernel k;
+    k.prior_fit = prior_log_odds(pi_fit_);
+    k.prior_target = prior_log_odds(clamp_prob_01(pi_target));
+
+    switch (method_) {
+      case Method::kNone:
+        k.a = 1.0;
+        k.b = k.prior_fit;
+        break;
+      case Method::kPlatt:
+        k.a = a_;
+        k.b = b_;
+        break;
+      case Method::kIsotonic:
+        if (values_.empty()) {
+          throw std::runtime_error("evaluate: isotonic mapping is empty");
+        }
+        k.edges = edges_.data();
+        k.n_edges = static_cast<std::ptrdiff_t>(edges_.size());
+        k.values = values_.data();
+        k.n_values = static_cast<std::ptrdiff_t>(values_.size());
+        k.table = &table_;
+        break;
+      default:
+        throw std::runtime_error("evaluate: unknown method");
+    }
+    return k;
+  }
+
+  /// Calls fn(isotonic, output) with both as compile-time constants.
+  template <typename Fn>
+  auto dispatch(Output what, Fn&& fn) const
+      -> decltype(fn(std::false_type{}, std::integral_constant<Output, Output::kProb>{})) {
+    if (method_ == Method::kIsotonic) {
+      return dispatch_output(std::true_type{}, what, std::forward<Fn>(fn));
+    }
+    return dispatch_output(std::false_type{}, what, std::forward<Fn>(fn));
+  }
+
+  template <typename Isotonic, typename Fn>
+  static auto dispatch_output(Isotonic isotonic, Output what, Fn&& fn)
+      -> decltype(fn(isotonic, std::integral_constant<Output, Output::kProb>{})) {
+    switch (what) {
+      case Output::kProb:
+        return fn(isotonic, std::integral_constant<Output, Output::kProb>{});
+      case Output::kLogOdds:
+        return fn(isotonic, std::integral_constant<Output, Output::kLogOdds>{});
+      case Output::kLLR:
+        return fn(isotonic, std::integral_constant<Output, Output::kLLR>{});
+      case Output::kPosterior:
+        return fn(isotonic, std::integral_constant<Output, Output::kPosterior>{});
+      case Output::kLogOddsTarget:
+        return fn(isotonic, std::integral_constant<Output, Output::kLogOddsTarget>{});
+      default:
+        throw std::runtime_error("evaluate: unknown output");
+    }
+  }
+
+  /// sigmoid() without the sign branch; identical results.
+  static double sigmoid_branchless(double z) {
+    const double e = std::exp(-std::abs(z));
+    return ((z >= 0.0) ? 1.0 : e) / (1.0 + e);
+  }
+
+  static constexpr int kPlattLadder = 8;
+  static constexpr const char* kFitX = "heron_calib_x_";
+  static constexpr const char* kFitY = "heron_calib_y_";
+  static constexpr const char* kFitW = "heron_calib_w_";
+
+  struct FitSummary {
+    double n = 0.0;
+    double sw = 0.0;
+    double swy = 0.0;
+    double xmin = std::numeric_limits<double>::infinity();
+    double xmax = -std::numeric_limits<double>::infinity();
+  };
+
+  struct PlattSums {
+    double nll = 0.0;
+    double ga = 0.0;
+    double gb = 0.0;
+    double haa = 0.0;
+    double hab = 0.0;
+    double hbb = 0.0;
+  };
+
+  /// Logit, label and weight as double columns, keeping the rows that
+  /// read_tree_columns() would keep.
+  static ROOT::RDF::RNode define_fit_columns(ROOT::RDF::RNode node,
+                                             const std::string& x_expr,
+                                             const std::string& y_expr,
+                                             const std::string& w_expr) {
+    if (x_expr.empty() || y_expr.empty()) {
+      throw std::runtime_error("define_fit_columns: empty expressions");
+    }
+
+    auto out = node.Define(kFitX, "static_cast<double>(" + x_expr + ")")
+                   .Define(kFitY, "static_cast<double>(" + y_expr + ")")
+                   .Define(kFitW, w_expr.empty() ? std::string("1.0") : "static_cast<double>(" + w_expr + ")");
+    return out.Filter([](double x, double y, double w) {
+      return std::isfinite(x) && std::isfinite(y) && std::isfinite(w) && w > 0.0;
+    }, {kFitX, kFitY, kFitW});
+  }
+
+  static FitSummary summarise_fit_columns(ROOT::RDF::RNode node) {
+    std::vector<FitSummary> slots(node.GetNSlots());
+    node.ForeachSlot([&](unsigned int s, double x, double y, double w) {
+      FitSummary& slot = slots[s];
+      slot.n += 1.0;
+      slot.sw += w;
+      slot.swy += (y > 0.5) ? w : 0.0;
+      slot.xmin = std::min(slot.xmin, x);
+      slot.xmax = std::max(slot.xmax, x);
+    }, {kFitX, kFitY, kFitW});
+
+    FitSummary total;
+    for (const auto& slot : slots) {
+      total.n += slot.n;
+      total.sw += slot.sw;
+      total.swy += slot.swy;
+      total.xmin = std::min(total.xmin, slot.xmin);
+      total.xmax = std::max(total.xmax, slot.xmax);
+    }
+    return total;
+  }
+
+  /// One event loop: unpenalised NLL, gradient and Hessian at every (a, b).
+  static std::vector<PlattSums> platt_sums(ROOT::RDF::RNode node,
+                                           const std::vector<double>& a,
+                                           const std::vector<double>& b) {
+    const size_t n_points = a.size();
+    std::vector<std::vector<PlattSums>> slots(node.GetNSlots(), std::vector<PlattSums>(n_points));
+
+    node.ForeachSlot([&](unsigned int s, double x, double y, double w) {
+      std::vector<PlattSums>& sums = slots[s];
+      const int yi = (y > 0.5) ? 1 : 0;
+      for (size_t k = 0; k < n_points; ++k) {
+        const double z = a[k] * x + b[k];
+        const double sig = sigmoid(z);
+        const double p_nll = clamp_prob(sig);
+        const double p = clamp_prob(sig, 1e-12);
+        const double var = p * (1.0 - p);
+        const double r = p - yi;
+
+        PlattSums& out = sums[k];
+        out.nll -= w * (yi * std::log(p_nll) + (1 - yi) * std::log(1.0 - p_nll));
+        out.ga += w * r * x;
+        out.gb += w * r;
+        out.haa += w * var * x * x;
+        out.hab += w * var * x;
+        out.hbb += w * var;
+      }
+    }, {kFitX, kFitY, kFitW});
+
+    std::vector<PlattSums> total(n_points);
+    for (const auto& sums : slots) {
+      for (size_t k = 0; k < n_points; ++k) {
+        total[k].nll += sums[k].nll;
+        total[k].ga += sums[k].ga;
+        total[k].gb += sums[k].gb;
+        total[k].haa += sums[k].haa;
+        total[k].hab += sums[k].hab;
+        total[k].hbb += sums[k].hbb;
+      }
+    }
+    return total;
+  }
+
+  /// Weighted points (or pre-binned groups) ordered in x, for PAV.
+  struct IsotonicPoint {
+    double xmin;
+    double xmax;
+    double w;
+    double wy;
+  };
+
+  void fit_isotonic_points(const std::vector<IsotonicPoint>& pts,
+                           double min_prob,
+                           double max_prob) {
+    struct Block {
+      double w = 0.0;
+      double wy = 0.0;
+      double mean = 0.0;
+      double xmin = 0.0;
+      double xmax = 0.0;
+    };
+
+    std::vector<Block> blocks;
+    blocks.reserve(pts.size());
+
+    for (const auto& p : pts) {
+      Block b;
+      b.w = p.w;
+      b.wy = p.wy;
+      b.mean = (b.w > 0.0) ? (b.wy / b.w) : 0.0;
+      b.xmin = p.xmin;
+      b.xmax = p.xmax;
+      blocks.push_back(b);
+
+      while (blocks.size() >= 2) {
+        const Block& b2 = blocks.back();
+        const Block& b1 = blocks[blocks.size() - 2];
+        if (b1.mean <= b2.mean) {
+          break;
+        }
+
+        Block merged;
+        merged.w = b1.w + b2.w;
+        merged.wy = b1.wy + b2.wy;
+        merged.mean = (merged.w > 0.0) ? (merged.wy / merged.w) : 0.0;
+        merged.xmin = b1.xmin;
+        merged.xmax = b2.xmax;
+
+        blocks.pop_back();
+        blocks.pop_back();
+        blocks.push_back(merged);
+      }
+    }
+
+    const int n = static_cast<int>(blocks.size());
+    if (n <= 0) {
+      throw std::runtime_error("fit_isotonic: no blocks produced");
+    }
+
+    std::vector<double> edges;
+    std::vector<double> vals;
+    edges.resize(static_cast<size_t>(n + 1));
+    vals.resize(static_cast<size_t>(n));
+
+    const double neg = -1e300;
+    const double pos = 1e300;
+    edges[0] = neg;
+
+    for (int i = 0; i < n; ++i) {
+      double p = blocks[static_cast<size_t>(i)].mean;
+      p = std::max(min_prob, std::min(max_prob, p));
+      vals[static_cast<size_t>(i)] = p;
+
+      if (i < (n - 1)) {
+        const double boundary = 0.5 *
+            (blocks[static_cast<size_t>(i)].xmax + blocks[static_cast<size_t>(i + 1)].xmin);
+        edges[static_cast<size_t>(i + 1)] = boundary;
+      }
+    }
+
+    edges[static_cast<size_t>(n)] = pos;
+
+    edges_ = std::move(edges);
+    values_ = std::move(vals);
+    compile_isotonic();
+    method_ = Method::kIsotonic;
+  }
+
   static double sigmoid(double z) {
     if (z >= 0.0) {
       const double ez = std::exp(-z);
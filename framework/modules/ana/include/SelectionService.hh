@@ -10,6 +10,7 @@
 #define HERON_ANA_SELECTION_SERVICE_H
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include <ROOT/RDataFrame.hxx>
@@ -43,6 +44,42 @@ enum class Preset
 class SelectionService
 {
   public:
+    /// Bits of sel_mask; each holds the stage's own cut, so cumulative and
+    /// N-1 decisions are both mask tests. Stages run in bit order.
+    enum StageBit
+    {
+        kTriggerBit = 0,
+        kSliceBit = 1,
+        kFiducialBit = 2,
+        kTopologyBit = 3,
+        kMuonBit = 4,
+        kNumStages = 5
+    };
+
+    static constexpr std::uint32_t all_stages_mask = (1u << kNumStages) - 1u;
+
+    /// Number of leading stages passed in order (0 = failed the trigger).
+    static int cutflow_depth(std::uint32_t mask) noexcept
+    {
+        int depth = 0;
+        while (depth < kNumStages && (mask >> depth & 1u))
+            ++depth;
+        return depth;
+    }
+
+    /// Deepest stage reached as the sel_* flags report it: the slice to muon
+    /// flags do not require the trigger, so 1 + leading stages passed from
+    /// the slice on, else 1 for the trigger alone (0 = neither).
+    static int selection_stage(std::uint32_t mask) noexcept
+    {
+        const int depth = cutflow_depth(mask | 1u << kTriggerBit);
+        if (depth > 1)
+            return depth;
+        return static_cast<int>(mask >> kTriggerBit & 1u);
+    }
+
+    static const char *stage_name(int stage);
+
     static const int slice_required_count;
     static const float slice_min_topology_score;
 
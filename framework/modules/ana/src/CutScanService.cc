@@ -0,0 +1,309 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/ana/src/CutScanService.cc
+ *
+ *  @brief Grid scan of the SelectionService thresholds.
+ */
+
+#include "CutScanService.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+#include <ROOT/RVec.hxx>
+
+#include "SelectionService.hh"
+
+
+namespace
+{
+
+std::vector<float> prepare_axis(std::vector<float> values, float fallback)
+{
+    if (values.empty())
+        values.push_back(fallback);
+    for (float v : values)
+    {
+        if (!std::isfinite(v))
+            throw std::runtime_error("CutScanService: thresholds must be finite");
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    return values;
+}
+
+// Number of thresholds t with t < x, i.e. how many "x > t" cuts x passes.
+std::size_t n_passing_above(const std::vector<float> &axis, float x)
+{
+    if (!std::isfinite(x))
+        return 0;
+    return static_cast<std::size_t>(std::lower_bound(axis.begin(), axis.end(), x) - axis.begin());
+}
+
+// First threshold index d with d > x; "x < d" passes from there on.
+std::size_t first_passing_below(const std::vector<float> &axis, float x)
+{
+    if (!std::isfinite(x))
+        return axis.size();
+    return static_cast<std::size_t>(std::upper_bound(axis.begin(), axis.end(), x) - axis.begin());
+}
+
+} // namespace
+
+CutScanService::Result CutScanService::run(ROOT::RDF::RNode node, const Grid &grid)
+{
+    return run(std::move(node), grid, Columns());
+}
+
+CutScanService::Result CutScanService::run(ROOT::RDF::RNode node, const Grid &grid, const Columns &columns)
+{
+    Result result;
+    result.axes = {prepare_axis(grid.topology_score, SelectionService::slice_min_topology_score),
+                   prepare_axis(grid.track_score, SelectionService::muon_min_track_score),
+                   prepare_axis(grid.track_length, SelectionService::muon_min_track_length),
+                   prepare_axis(grid.track_distance, SelectionService::muon_max_track_distance)};
+
+    const auto &t_axis = result.axes[kTopologyScore];
+    const auto &s_axis = result.axes[kTrackScore];
+    const auto &l_axis = result.axes[kTrackLength];
+    const auto &d_axis = result.axes[kTrackDistance];
+    const std::size_t n_t = t_axis.size();
+    const std::size_t n_s = s_axis.size();
+    const std::size_t n_l = l_axis.size();
+    const std::size_t n_d = d_axis.size();
+    const std::size_t n_points = n_t * n_s * n_l * n_d;
+
+    // Each event adds its weight once per (score, length) pair, at the loosest
+    // topology threshold it fails next to and the tightest distance it passes;
+    // suffix sums over topology and prefix sums over distance at the end give
+    // the yields of every grid point.
+    struct Slot
+    {
+        std::vector<double> signal;
+        std::vector<double> background;
+        double signal_total = 0.0;
+        double background_total = 0.0;
+        std::vector<std::size_t> first_d;
+    };
+    std::vector<Slot> slots(node.GetNSlots());
+    for (auto &slot : slots)
+    {
+        slot.signal.assign(n_points, 0.0);
+        slot.background.assign(n_points, 0.0);
+        slot.first_d.assign(n_s * n_l, n_d);
+    }
+
+    node.ForeachSlot(
+        [&](unsigned int slot_index,
+            bool trigger,
+            bool fiducial,
+            int num_slices,
+            float topology_score,
+            const ROOT::RVec<float> &scores,
+            const ROOT::RVec<float> &lengths,
+            const ROOT::RVec<float> &distances,
+            const ROOT::RVec<unsigned> &generations,
+            bool signal,
+            double w) {
+            Slot &slot = slots[slot_index];
+            (signal ? slot.signal_total : slot.background_total) += w;
+
+            if (!trigger || !fiducial || num_slices != SelectionService::slice_required_count)
+                return;
+
+            const std::size_t passed_t = n_passing_above(t_axis, topology_score);
+            if (passed_t == 0)
+                return;
+
+            auto &first_d = slot.first_d;
+            std::fill(first_d.begin(), first_d.end(), n_d);
+            const std::size_t n_tracks =
+                std::min({scores.size(), lengths.size(), distances.size(), generations.size()});
+            bool any_track = false;
+            for (std::size_t k = 0; k < n_tracks; ++k)
+            {
+                if (generations[k] != SelectionService::muon_required_generation)
+                    continue;
+                const std::size_t passed_s = n_passing_above(s_axis, scores[k]);
+                const std::size_t passed_l = n_passing_above(l_axis, lengths[k]);
+                const std::size_t d0 = first_passing_below(d_axis, distances[k]);
+                if (passed_s == 0 || passed_l == 0 || d0 == n_d)
+                    continue;
+                any_track = true;
+                for (std::size_t is = 0; is < passed_s; ++is)
+                {
+                    std::size_t *row = first_d.data() + is * n_l;
+                    for (std::size_t il = 0; il < passed_l; ++il)
+                        row[il] = std::min(row[il], d0);
+                }
+            }
+            if (!any_track)
+                return;
+
+            double *target = (signal ? slot.signal : slot.background).data() + (passed_t - 1) * n_s * n_l * n_d;
+            for (std::size_t sl = 0; sl < n_s * n_l; ++sl)
+            {
+                if (first_d[sl] < n_d)
+                    target[sl * n_d + first_d[sl]] += w;
+            }
+        },
+        {columns.trigger,
+         columns.fiducial,
+         columns.num_slices,
+         columns.topology_score,
+         columns.track_score,
+         columns.track_length,
+         columns.track_distance,
+         columns.generation,
+         columns.signal,
+         columns.weight});
+
+    result.signal.assign(n_points, 0.0);
+    result.background.assign(n_points, 0.0);
+    for (const auto &slot : slots)
+    {
+        for (std::size_t i = 0; i < n_points; ++i)
+        {
+            result.signal[i] += slot.signal[i];
+            result.background[i] += slot.background[i];
+        }
+        result.signal_total += slot.signal_total;
+        result.background_total += slot.background_total;
+    }
+
+    const std::size_t block = n_s * n_l * n_d;
+    for (auto *yields : {&result.signal, &result.background})
+    {
+        auto &y = *yields;
+        for (std::size_t i = 0; i < n_points; i += n_d)
+        {
+            for (std::size_t id = 1; id < n_d; ++id)
+                y[i + id] += y[i + id - 1];
+        }
+        for (std::size_t it = n_t - 1; it-- > 0;)
+        {
+            for (std::size_t j = 0; j < block; ++j)
+                y[it * block + j] += y[(it + 1) * block + j];
+        }
+    }
+
+    return result;
+}
+
+std::size_t CutScanService::Result::index(std::size_t it, std::size_t is, std::size_t il, std::size_t id) const
+{
+    return ((it * axes[kTrackScore].size() + is) * axes[kTrackLength].size() + il) * axes[kTrackDistance].size() + id;
+}
+
+std::vector<float> CutScanService::Result::thresholds(std::size_t i) const
+{
+    std::vector<float> out(kNumAxes);
+    for (int a = kNumAxes - 1; a >= 0; --a)
+    {
+        const std::size_t n = axes[static_cast<std::size_t>(a)].size();
+        out[static_cast<std::size_t>(a)] = axes[static_cast<std::size_t>(a)][i % n];
+        i /= n;
+    }
+    return out;
+}
+
+double CutScanService::Result::efficiency(std::size_t i) const
+{
+    return (signal_total > 0.0) ? signal[i] / signal_total : 0.0;
+}
+
+double CutScanService::Result::purity(std::size_t i) const
+{
+    const double total = signal[i] + background[i];
+    return (total > 0.0) ? signal[i] / total : 0.0;
+}
+
+double CutScanService::Result::figure_of_merit(std::size_t i) const
+{
+    const double total = signal[i] + background[i];
+    return (total > 0.0) ? signal[i] / std::sqrt(total) : 0.0;
+}
+
+std::size_t CutScanService::Result::best() const
+{
+    std::size_t best_index = 0;
+    for (std::size_t i = 1; i < size(); ++i)
+    {
+        if (figure_of_merit(i) > figure_of_merit(best_index))
+            best_index = i;
+    }
+    return best_index;
+}
+
+void CutScanService::Result::write_table(std::ostream &out) const
+{
+    for (int a = 0; a < kNumAxes; ++a)
+        out << axis_name(static_cast<Axis>(a)) << "\t";
+    out << "signal\tbackground\tefficiency\tpurity\tfom\n";
+
+    out << std::setprecision(6);
+    for (std::size_t i = 0; i < size(); ++i)
+    {
+        for (float t : thresholds(i))
+            out << t << "\t";
+        out << signal[i] << "\t"
+            << background[i] << "\t"
+            << efficiency(i) << "\t"
+            << purity(i) << "\t"
+            << figure_of_merit(i) << "\n";
+    }
+}
+
+std::unique_ptr<TH2D> CutScanService::Result::heat_map(Axis x, Axis y, const std::string &name) const
+{
+    if (x == y || x < 0 || y < 0 || x >= kNumAxes || y >= kNumAxes)
+        throw std::runtime_error("CutScanService::heat_map: need two different axes");
+
+    const auto &x_axis = axes[static_cast<std::size_t>(x)];
+    const auto &y_axis = axes[static_cast<std::size_t>(y)];
+    const std::string title = std::string(";") + axis_name(x) + ";" + axis_name(y) + ";s/#sqrt{s+b}";
+    auto h = std::make_unique<TH2D>(name.c_str(), title.c_str(),
+                                    static_cast<int>(x_axis.size()), 0.0, static_cast<double>(x_axis.size()),
+                                    static_cast<int>(y_axis.size()), 0.0, static_cast<double>(y_axis.size()));
+    h->SetDirectory(nullptr);
+    for (std::size_t ix = 0; ix < x_axis.size(); ++ix)
+        h->GetXaxis()->SetBinLabel(static_cast<int>(ix + 1), std::to_string(x_axis[ix]).c_str());
+    for (std::size_t iy = 0; iy < y_axis.size(); ++iy)
+        h->GetYaxis()->SetBinLabel(static_cast<int>(iy + 1), std::to_string(y_axis[iy]).c_str());
+
+    std::vector<std::size_t> coord(kNumAxes);
+    for (std::size_t i = 0; i < size(); ++i)
+    {
+        std::size_t rest = i;
+        for (int a = kNumAxes - 1; a >= 0; --a)
+        {
+            const std::size_t n = axes[static_cast<std::size_t>(a)].size();
+            coord[static_cast<std::size_t>(a)] = rest % n;
+            rest /= n;
+        }
+        const int bx = static_cast<int>(coord[static_cast<std::size_t>(x)] + 1);
+        const int by = static_cast<int>(coord[static_cast<std::size_t>(y)] + 1);
+        h->SetBinContent(bx, by, std::max(h->GetBinContent(bx, by), figure_of_merit(i)));
+    }
+    return h;
+}
+
+const char *CutScanService::axis_name(Axis axis)
+{
+    switch (axis)
+    {
+    case kTopologyScore:
+        return "topological_score_min";
+    case kTrackScore:
+        return "track_score_min";
+    case kTrackLength:
+        return "track_length_min";
+    case kTrackDistance:
+        return "track_distance_max";
+    default:
+        return "unknown";
+    }
+}
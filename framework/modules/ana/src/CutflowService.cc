@@ -0,0 +1,202 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/ana/src/CutflowService.cc
+ *
+ *  @brief One-pass cutflow over the packed selection mask.
+ */
+
+#include "CutflowService.hh"
+
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+
+namespace
+{
+
+// Per (sample, channel): events by how many leading stages they pass, events
+// failing exactly one stage, and events passing all of them. Cumulative and
+// N-1 yields follow from these at the end.
+struct Accumulator
+{
+    std::vector<CutflowService::Yield> by_depth;
+    std::vector<CutflowService::Yield> only_fail;
+    CutflowService::Yield all_pass;
+
+    explicit Accumulator(int n_stages)
+        : by_depth(static_cast<std::size_t>(n_stages) + 1), only_fail(static_cast<std::size_t>(n_stages))
+    {
+    }
+
+    Accumulator &operator+=(const Accumulator &o)
+    {
+        for (std::size_t i = 0; i < by_depth.size(); ++i)
+            by_depth[i] += o.by_depth[i];
+        for (std::size_t i = 0; i < only_fail.size(); ++i)
+            only_fail[i] += o.only_fail[i];
+        all_pass += o.all_pass;
+        return *this;
+    }
+};
+
+std::int64_t row_key(int sample_id, int channel)
+{
+    return (static_cast<std::int64_t>(sample_id) << 32) | static_cast<std::uint32_t>(channel);
+}
+
+} // namespace
+
+std::vector<CutflowService::Row> CutflowService::run(ROOT::RDF::RNode node)
+{
+    return run(std::move(node), Columns());
+}
+
+std::vector<CutflowService::Row> CutflowService::run(ROOT::RDF::RNode node,
+                                                     const Columns &columns,
+                                                     int n_stages)
+{
+    if (n_stages < 1 || n_stages > 31)
+        throw std::runtime_error("CutflowService::run: n_stages must be in [1, 31]");
+
+    const std::uint32_t all_bits = (1u << n_stages) - 1u;
+    std::vector<std::unordered_map<std::int64_t, Accumulator>> slots(node.GetNSlots());
+
+    node.ForeachSlot(
+        [&](unsigned int slot, std::uint32_t mask, int sample_id, int channel, double w) {
+            auto &map = slots[slot];
+            auto it = map.find(row_key(sample_id, channel));
+            if (it == map.end())
+                it = map.emplace(row_key(sample_id, channel), Accumulator(n_stages)).first;
+            Accumulator &acc = it->second;
+
+            mask &= all_bits;
+            const std::uint32_t failed = ~mask & all_bits;
+
+            // Leading passed stages = trailing ones of the mask.
+            const int depth = (failed == 0u) ? n_stages : __builtin_ctz(failed);
+            acc.by_depth[static_cast<std::size_t>(depth)].add(w);
+
+            if (failed == 0u)
+                acc.all_pass.add(w);
+            else if (__builtin_popcount(failed) == 1)
+                acc.only_fail[static_cast<std::size_t>(__builtin_ctz(failed))].add(w);
+        },
+        {columns.mask, columns.sample_id, columns.channel, columns.weight});
+
+    std::map<std::pair<int, int>, Accumulator> merged;
+    for (const auto &map : slots)
+    {
+        for (const auto &kv : map)
+        {
+            const int sample_id = static_cast<int>(kv.first >> 32);
+            const int channel = static_cast<int>(static_cast<std::uint32_t>(kv.first & 0xffffffffu));
+            auto it = merged.find({sample_id, channel});
+            if (it == merged.end())
+                it = merged.emplace(std::make_pair(sample_id, channel), Accumulator(n_stages)).first;
+            it->second += kv.second;
+        }
+    }
+
+    std::vector<Row> rows;
+    rows.reserve(merged.size());
+    for (const auto &kv : merged)
+    {
+        const Accumulator &acc = kv.second;
+        Row row;
+        row.sample_id = kv.first.first;
+        row.channel = kv.first.second;
+        row.cumulative.assign(static_cast<std::size_t>(n_stages) + 1, Yield{});
+        row.n_minus_one.assign(static_cast<std::size_t>(n_stages), Yield{});
+
+        Yield suffix;
+        for (int k = n_stages; k >= 0; --k)
+        {
+            suffix += acc.by_depth[static_cast<std::size_t>(k)];
+            row.cumulative[static_cast<std::size_t>(k)] = suffix;
+        }
+        for (int k = 0; k < n_stages; ++k)
+        {
+            row.n_minus_one[static_cast<std::size_t>(k)] = acc.all_pass;
+            row.n_minus_one[static_cast<std::size_t>(k)] += acc.only_fail[static_cast<std::size_t>(k)];
+        }
+        rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+std::vector<CutflowService::Row> CutflowService::merge_channels(const std::vector<Row> &rows)
+{
+    std::map<int, Row> by_sample;
+    for (const auto &r : rows)
+    {
+        auto it = by_sample.find(r.sample_id);
+        if (it == by_sample.end())
+        {
+            Row first = r;
+            first.channel = -1;
+            by_sample.emplace(r.sample_id, std::move(first));
+            continue;
+        }
+        for (std::size_t k = 0; k < r.cumulative.size(); ++k)
+            it->second.cumulative[k] += r.cumulative[k];
+        for (std::size_t k = 0; k < r.n_minus_one.size(); ++k)
+            it->second.n_minus_one[k] += r.n_minus_one[k];
+    }
+
+    std::vector<Row> out;
+    out.reserve(by_sample.size());
+    for (auto &kv : by_sample)
+        out.push_back(std::move(kv.second));
+    return out;
+}
+
+CutflowService::Row CutflowService::total(const std::vector<Row> &rows)
+{
+    Row out;
+    for (const auto &r : rows)
+    {
+        if (out.cumulative.empty())
+        {
+            out.cumulative.assign(r.cumulative.size(), Yield{});
+            out.n_minus_one.assign(r.n_minus_one.size(), Yield{});
+        }
+        for (std::size_t k = 0; k < r.cumulative.size() && k < out.cumulative.size(); ++k)
+            out.cumulative[k] += r.cumulative[k];
+        for (std::size_t k = 0; k < r.n_minus_one.size() && k < out.n_minus_one.size(); ++k)
+            out.n_minus_one[k] += r.n_minus_one[k];
+    }
+    return out;
+}
+
+void CutflowService::print(std::ostream &out, const std::vector<Row> &rows, bool weighted)
+{
+    auto value = [weighted](const Yield &y) { return weighted ? y.sum_w : y.entries; };
+
+    for (const auto &r : rows)
+    {
+        out << "sample_id=" << r.sample_id;
+        if (r.channel >= 0)
+            out << " channel=" << r.channel;
+        out << (weighted ? " (weighted)" : " (entries)") << "\n";
+        out << "  " << std::left << std::setw(12) << "stage"
+            << std::right << std::setw(16) << "cumulative"
+            << std::setw(12) << "eff"
+            << std::setw(16) << "N-1" << "\n";
+
+        const double all = r.cumulative.empty() ? 0.0 : value(r.cumulative[0]);
+        out << "  " << std::left << std::setw(12) << "All"
+            << std::right << std::setw(16) << all << "\n";
+        for (std::size_t k = 0; k < r.n_minus_one.size(); ++k)
+        {
+            const double cum = value(r.cumulative[k + 1]);
+            out << "  " << std::left << std::setw(12) << SelectionService::stage_name(static_cast<int>(k))
+                << std::right << std::setw(16) << cum
+                << std::setw(12) << ((all != 0.0) ? cum / all : 0.0)
+                << std::setw(16) << value(r.n_minus_one[k]) << "\n";
+        }
+    }
+}
@@ -8,6 +8,7 @@
 #include "SelectionService.hh"
 
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -55,6 +56,14 @@ inline bool passes_slice(int ns, float topo)
            topo > SelectionService::slice_min_topology_score;
 }
 
+// The topology stage has no cut of its own at baseline, so sel_topology
+// equals sel_fiducial and its sel_mask bit is always set. Both read it from
+// here, so a real topology cut only needs to change this predicate.
+inline bool passes_topology()
+{
+    return true;
+}
+
 inline bool passes_muon(const ROOT::RVec<float> &scores,
                         const ROOT::RVec<float> &lengths,
                         const ROOT::RVec<float> &distances,
@@ -161,7 +170,7 @@ ROOT::RDF::RNode SelectionService::decorate(ROOT::RDF::RNode node)
         {"sel_slice", "in_reco_fiducial"});
     define_if_missing(
         "sel_topology",
-        [](bool fid) { return fid; },
+        [](bool fid) { return fid && passes_topology(); },
         {"sel_fiducial"});
 
     define_if_missing(
@@ -181,9 +190,55 @@ ROOT::RDF::RNode SelectionService::decorate(ROOT::RDF::RNode node)
          "track_distance_to_vertex",
          "pfp_generations"});
 
+    define_if_missing(
+        "sel_mask",
+        [](bool trigger,
+           int ns,
+           float topo,
+           bool fv,
+           const ROOT::RVec<float> &scores,
+           const ROOT::RVec<float> &lengths,
+           const ROOT::RVec<float> &distances,
+           const ROOT::RVec<unsigned> &generations) {
+            std::uint32_t mask = 0u;
+            mask |= static_cast<std::uint32_t>(trigger) << kTriggerBit;
+            mask |= static_cast<std::uint32_t>(passes_slice(ns, topo)) << kSliceBit;
+            mask |= static_cast<std::uint32_t>(fv) << kFiducialBit;
+            mask |= static_cast<std::uint32_t>(passes_topology()) << kTopologyBit;
+            mask |= static_cast<std::uint32_t>(passes_muon(scores, lengths, distances, generations)) << kMuonBit;
+            return mask;
+        },
+        {"sel_trigger",
+         "num_slices",
+         "topological_score",
+         "in_reco_fiducial",
+         "track_shower_scores",
+         "track_length",
+         "track_distance_to_vertex",
+         "pfp_generations"});
+
     return node;
 }
 
+const char *SelectionService::stage_name(int stage)
+{
+    switch (stage)
+    {
+    case kTriggerBit:
+        return "Trigger";
+    case kSliceBit:
+        return "Slice";
+    case kFiducialBit:
+        return "Fiducial";
+    case kTopologyBit:
+        return "Topology";
+    case kMuonBit:
+        return "Muon";
+    default:
+        return "Unknown";
+    }
+}
+
 std::string SelectionService::selection_label(Preset p)
 {
     switch (p)
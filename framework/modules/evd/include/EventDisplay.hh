@@ -81,7 +81,14 @@ class EventDisplay
     struct BatchOptions
     {
         std::string selection_expr;
+        // Selected events to render (0 => all): the n_events smallest
+        // (sample_id, run, sub, evt), whatever the thread count or entry
+        // order. Once a thread has n_events, later entries with larger keys
+        // are skipped before the selection or any image column is read.
         unsigned long long n_events = 1;
+        // Also report how many rows pass the selection, in the same event
+        // loop. The selection then runs on every entry.
+        bool count_matches = false;
 
         std::string out_dir = "./plots/event_displays";
         std::string image_format = "pdf";
@@ -92,6 +99,8 @@ class EventDisplay
 
         struct Columns
         {
+            // Missing from the input => every row belongs to one sample.
+            std::string sample_id = "sample_id";
             std::string run = "run";
             std::string sub = "sub";
             std::string evt = "evt";
@@ -107,11 +116,22 @@ class EventDisplay
 
         Mode mode = Mode::Detector;
         Options display;
+
+        // Images are extracted in one data pass and rendered by this many
+        // forked batch-mode processes; 1 renders in-process, 0 => one per
+        // hardware thread.
+        int n_workers = 1;
+        // Without an event budget (n_events == 0) nothing is held back for
+        // the final choice, so each thread slot hands its images on to the
+        // renderer every flush_jobs images instead of buffering them all.
+        std::size_t flush_jobs = 64;
     };
 
     static void render_from_rdf(ROOT::RDF::RNode df, const BatchOptions &opt);
 
   private:
+    struct RenderJob;
+
     EventDisplay(Spec spec, Options opt, DetectorData data);
     EventDisplay(Spec spec, Options opt, SemanticData data);
 
@@ -126,6 +146,15 @@ class EventDisplay
                                            int requested_h,
                                            std::size_t flat_size);
 
+    static bool render_job(const RenderJob &job,
+                           const std::string &image_format,
+                           const std::string &file_override);
+
+    // Byte encoding of a job for forked workers; display options other than
+    // the per-plane detector range come from `display`.
+    static std::string encode_job(const RenderJob &job);
+    static RenderJob decode_job(const std::string &bytes, const Options &display);
+
   private:
     Spec spec_;
     Options opt_;
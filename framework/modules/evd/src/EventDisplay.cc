@@ -9,19 +9,25 @@
 
 #include <algorithm>
 #include <array>
-#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <mutex>
 #include <numeric>
+#include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <tuple>
 #include <utility>
 
-#include <ROOT/RConfig.h>
 #include <ROOT/RVec.hxx>
 #include <TCanvas.h>
 #include <TColor.h>
@@ -32,10 +38,32 @@
 #include <nlohmann/json.hpp>
 
 #include "Plotter.hh"
+#include "RenderQueue.hh"
+#include "SparseImageService.hh"
 
 namespace heron {
 namespace evd {
 
+// Semantic class colours; index 0 is the empty-pixel background.
+static constexpr int k_semantic_palette_size = 15;
+static constexpr std::array<std::array<int, 3>, k_semantic_palette_size> k_semantic_rgb = {{
+    {230, 230, 230},
+    {0x66, 0x66, 0x66},
+    {0xe4, 0x1a, 0x1c},
+    {0x37, 0x7e, 0xb8},
+    {0x4d, 0xaf, 0x4a},
+    {0xff, 0x7f, 0x00},
+    {0x98, 0x4e, 0xa3},
+    {0xff, 0xff, 0x33},
+    {0x1b, 0x9e, 0x77},
+    {0xf7, 0x81, 0xbf},
+    {0xa6, 0x56, 0x28},
+    {0x66, 0xa6, 0x1e},
+    {0xe6, 0xab, 0x02},
+    {0xa6, 0xce, 0xe3},
+    {0xb1, 0x59, 0x28},
+}};
+
 //____________________________________________________________________________
 EventDisplay::EventDisplay(Spec spec, Options opt, DetectorData data)
     : spec_(std::move(spec)),
@@ -81,6 +109,7 @@ void EventDisplay::draw(TCanvas &canvas)
 void EventDisplay::draw_and_save(const std::string &image_format)
 {
     std::filesystem::create_directories(output_directory_);
+
     TCanvas canvas(plot_name_.c_str(),
                    spec_.title.c_str(),
                    opt_.canvas_size,
@@ -96,6 +125,7 @@ void EventDisplay::draw_and_save(const std::string &image_format,
                                  const std::string &file_override)
 {
     std::filesystem::create_directories(output_directory_);
+
     TCanvas canvas(plot_name_.c_str(),
                    spec_.title.c_str(),
                    opt_.canvas_size,
@@ -243,25 +273,15 @@ void EventDisplay::draw_detector(TCanvas &c)
 //____________________________________________________________________________
 void EventDisplay::draw_semantic(TCanvas &c)
 {
-    constexpr int palette_size = 15;
+    constexpr int palette_size = k_semantic_palette_size;
     const int background = TColor::GetColor(230, 230, 230);
 
-    std::array<int, palette_size> palette = {
-        background,
-        TColor::GetColor("#666666"),
-        TColor::GetColor("#e41a1c"),
-        TColor::GetColor("#377eb8"),
-        TColor::GetColor("#4daf4a"),
-        TColor::GetColor("#ff7f00"),
-        TColor::GetColor("#984ea3"),
-        TColor::GetColor("#ffff33"),
-        TColor::GetColor("#1b9e77"),
-        TColor::GetColor("#f781bf"),
-        TColor::GetColor("#a65628"),
-        TColor::GetColor("#66a61e"),
-        TColor::GetColor("#e6ab02"),
-        TColor::GetColor("#a6cee3"),
-        TColor::GetColor("#b15928")};
+    std::array<int, palette_size> palette{};
+    for (int i = 0; i < palette_size; ++i)
+    {
+        const auto &rgb = k_semantic_rgb[static_cast<std::size_t>(i)];
+        palette[static_cast<std::size_t>(i)] = TColor::GetColor(rgb[0], rgb[1], rgb[2]);
+    }
     gStyle->SetPalette(palette_size, palette.data());
 
     c.SetFillColor(kWhite);
@@ -293,7 +313,7 @@ void EventDisplay::draw_semantic(TCanvas &c)
 //____________________________________________________________________________
 void EventDisplay::draw_semantic_legend()
 {
-    constexpr int palette_size = 15;
+    constexpr int palette_size = k_semantic_palette_size;
     const int background = TColor::GetColor(230, 230, 230);
     const double margin = std::clamp(opt_.margin, 0.02, 0.25);
 
@@ -339,22 +359,12 @@ void EventDisplay::draw_semantic_legend()
         "#Sigma^{0}",
         "Other"};
 
-    std::array<int, palette_size> palette = {
-        background,
-        TColor::GetColor("#666666"),
-        TColor::GetColor("#e41a1c"),
-        TColor::GetColor("#377eb8"),
-        TColor::GetColor("#4daf4a"),
-        TColor::GetColor("#ff7f00"),
-        TColor::GetColor("#984ea3"),
-        TColor::GetColor("#ffff33"),
-        TColor::GetColor("#1b9e77"),
-        TColor::GetColor("#f781bf"),
-        TColor::GetColor("#a65628"),
-        TColor::GetColor("#66a61e"),
-        TColor::GetColor("#e6ab02"),
-        TColor::GetColor("#a6cee3"),
-        TColor::GetColor("#b15928")};
+    std::array<int, palette_size> palette{};
+    for (int i = 0; i < palette_size; ++i)
+    {
+        const auto &rgb = k_semantic_rgb[static_cast<std::size_t>(i)];
+        palette[static_cast<std::size_t>(i)] = TColor::GetColor(rgb[0], rgb[1], rgb[2]);
+    }
 
     legend_entries_.clear();
     for (int idx : order)
@@ -414,6 +424,153 @@ static std::string format_tag(std::string pattern,
     return pattern;
 }
 
+//____________________________________________________________________________
+struct EventDisplay::RenderJob
+{
+    int sample = 0;
+    int run = 0;
+    int sub = 0;
+    int evt = 0;
+    std::string plane;
+    Spec spec;
+    Options display;
+    DetectorData det;
+    SemanticData sem;
+};
+
+//____________________________________________________________________________
+bool EventDisplay::render_job(const RenderJob &job,
+                              const std::string &image_format,
+                              const std::string &file_override)
+{
+    try
+    {
+        if (job.spec.mode == Mode::Detector)
+        {
+            EventDisplay ed(job.spec, job.display, job.det);
+            ed.draw_and_save(image_format, file_override);
+        }
+        else
+        {
+            EventDisplay ed(job.spec, job.display, job.sem);
+            ed.draw_and_save(image_format, file_override);
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[EventDisplay] Render failed for " << job.spec.id
+                  << ": " << e.what() << '\n';
+        return false;
+    }
+}
+
+//____________________________________________________________________________
+static void put_raw(std::string &out, const void *data, std::size_t n)
+{
+    out.append(static_cast<const char *>(data), n);
+}
+
+template <typename T>
+static void put_value(std::string &out, const T &v)
+{
+    put_raw(out, &v, sizeof(T));
+}
+
+static void put_string(std::string &out, const std::string &s)
+{
+    put_value<std::uint64_t>(out, s.size());
+    out += s;
+}
+
+template <typename T>
+static void put_vector(std::string &out, const std::vector<T> &v)
+{
+    put_value<std::uint64_t>(out, v.size());
+    put_raw(out, v.data(), v.size() * sizeof(T));
+}
+
+static void get_raw(const std::string &in, std::size_t &pos, void *data, std::size_t n)
+{
+    if (n > in.size() - pos)
+        throw std::runtime_error("EventDisplay::decode_job: truncated job");
+    std::memcpy(data, in.data() + pos, n);
+    pos += n;
+}
+
+template <typename T>
+static T get_value(const std::string &in, std::size_t &pos)
+{
+    T v{};
+    get_raw(in, pos, &v, sizeof(T));
+    return v;
+}
+
+static std::string get_string(const std::string &in, std::size_t &pos)
+{
+    const auto n = get_value<std::uint64_t>(in, pos);
+    if (n > in.size() - pos)
+        throw std::runtime_error("EventDisplay::decode_job: truncated job");
+    std::string s = in.substr(pos, n);
+    pos += n;
+    return s;
+}
+
+template <typename T>
+static std::vector<T> get_vector(const std::string &in, std::size_t &pos)
+{
+    const auto n = get_value<std::uint64_t>(in, pos);
+    if (n > (in.size() - pos) / sizeof(T))
+        throw std::runtime_error("EventDisplay::decode_job: truncated job");
+    std::vector<T> v(n);
+    get_raw(in, pos, v.data(), n * sizeof(T));
+    return v;
+}
+
+//____________________________________________________________________________
+std::string EventDisplay::encode_job(const RenderJob &job)
+{
+    std::string out;
+    put_value(out, job.sample);
+    put_value(out, job.run);
+    put_value(out, job.sub);
+    put_value(out, job.evt);
+    put_string(out, job.plane);
+    put_string(out, job.spec.id);
+    put_string(out, job.spec.title);
+    put_value(out, static_cast<int>(job.spec.mode));
+    put_value(out, job.spec.grid_w);
+    put_value(out, job.spec.grid_h);
+    put_value(out, job.display.det_min);
+    put_value(out, job.display.det_max);
+    put_vector(out, job.det);
+    put_vector(out, job.sem);
+    return out;
+}
+
+//____________________________________________________________________________
+EventDisplay::RenderJob EventDisplay::decode_job(const std::string &bytes, const Options &display)
+{
+    std::size_t pos = 0;
+    RenderJob job;
+    job.sample = get_value<int>(bytes, pos);
+    job.run = get_value<int>(bytes, pos);
+    job.sub = get_value<int>(bytes, pos);
+    job.evt = get_value<int>(bytes, pos);
+    job.plane = get_string(bytes, pos);
+    job.spec.id = get_string(bytes, pos);
+    job.spec.title = get_string(bytes, pos);
+    job.spec.mode = static_cast<Mode>(get_value<int>(bytes, pos));
+    job.spec.grid_w = get_value<int>(bytes, pos);
+    job.spec.grid_h = get_value<int>(bytes, pos);
+    job.display = display;
+    job.display.det_min = get_value<double>(bytes, pos);
+    job.display.det_max = get_value<double>(bytes, pos);
+    job.det = get_vector<float>(bytes, pos);
+    job.sem = get_vector<int>(bytes, pos);
+    return job;
+}
+
 //____________________________________________________________________________
 void EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions &opt)
 {
@@ -425,64 +582,183 @@ void EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions &opt)
                   << opt.out_dir << "': " << ec.message() << '\n';
     }
 
-    auto filtered = df;
+    // Selection and extraction share one event loop. With an event budget,
+    // each slot keeps the n_events smallest (sample, run, sub, evt) it has
+    // selected, and the global n_events smallest are taken from the union
+    // afterwards, so the choice does not depend on how entries are spread
+    // over threads. Once a slot holds n_events keys, a key filter drops every
+    // later entry whose key is above the slot's largest: in front of the
+    // selection, so such entries cost only their key columns, unless the
+    // selection has to run on every entry for count_matches.
+    const bool limited = opt.n_events > 0;
+    const bool early_stop = limited && !opt.count_matches;
+    using EventKey = std::tuple<int, int, int, int>;
+    std::vector<std::set<EventKey>> slot_keys(df.GetNSlots());
+
+    // Event numbers repeat across samples, so the sample is part of the key;
+    // inputs without a sample column count as one sample.
+    auto keyed = df;
+    std::string sample_col = opt.cols.sample_id;
+    if (!df.HasColumn(sample_col))
+    {
+        sample_col = "evd_sample_id_";
+        keyed = keyed.Define(sample_col, [] { return 0; });
+    }
+
+    auto key_filter = [&slot_keys, &opt](unsigned int slot, int sample, int run, int sub, int evt)
+    {
+        const auto &keys = slot_keys[slot];
+        return keys.size() < opt.n_events || EventKey{sample, run, sub, evt} < *keys.rbegin();
+    };
+    const std::vector<std::string> key_cols{"rdfslot_", sample_col, opt.cols.run, opt.cols.sub, opt.cols.evt};
+
+    auto filtered = keyed;
+    if (early_stop)
+        filtered = filtered.Filter(key_filter, key_cols);
     if (!opt.selection_expr.empty())
         filtered = filtered.Filter(opt.selection_expr);
 
-    const auto n_rows = static_cast<std::size_t>(filtered.Count().GetValue());
-    if (n_rows == 0)
+    ROOT::RDF::RResultPtr<ULong64_t> n_matches;
+    if (opt.count_matches)
+        n_matches = filtered.Count();
+
+    if (limited)
     {
-        std::cerr << "[EventDisplay] No rows matched selection; nothing to render."
-                  << '\n';
-        return;
+        if (!early_stop)
+            filtered = filtered.Filter(key_filter, key_cols);
+        std::clog << "[EventDisplay] Rendering up to " << opt.n_events << " selected events." << '\n';
+    }
+    else
+    {
+        std::clog << "[EventDisplay] Rendering every selected event." << '\n';
     }
 
-    const std::size_t n_to_render =
-        (opt.n_events > 0)
-            ? std::min<std::size_t>(n_rows,
-                                    static_cast<std::size_t>(opt.n_events))
-            : n_rows;
+    const bool use_combined_pdf =
+        (!opt.combined_pdf.empty() && opt.image_format == "pdf");
+    const std::filesystem::path combined_path =
+        use_combined_pdf ? std::filesystem::path(opt.out_dir) / opt.combined_pdf : std::filesystem::path();
 
-    std::clog << "[EventDisplay] Selection matched " << n_rows
-              << " rows; rendering up to " << n_to_render << " events."
-              << '\n';
+    auto display_opts = opt.display;
+    display_opts.out_dir = opt.out_dir;
 
-    auto limited = filtered.Range(static_cast<ULong64_t>(n_to_render));
+    // Every slot buffers the images it extracts, with their display ranges;
+    // rendering happens afterwards, outside the event loop.
+    std::vector<std::vector<RenderJob>> slot_jobs(filtered.GetNSlots());
 
-    const bool use_combined_pdf =
-        (!opt.combined_pdf.empty() && opt.image_format == "pdf");
-    std::filesystem::path combined_path;
-    std::size_t total_pages = 0;
-    if (use_combined_pdf)
+    // Records the event in its slot's budget, evicting the slot's largest
+    // key (and its images) when the budget overflows.
+    auto claim = [&](unsigned int slot, int sample, int run, int sub, int evt)
+    {
+        if (!limited)
+            return;
+        auto &keys = slot_keys[slot];
+        keys.insert(EventKey{sample, run, sub, evt});
+        if (keys.size() <= opt.n_events)
+            return;
+        const EventKey evicted = *keys.rbegin();
+        keys.erase(std::prev(keys.end()));
+        auto &buffer = slot_jobs[slot];
+        buffer.erase(std::remove_if(buffer.begin(), buffer.end(),
+                                    [&evicted](const RenderJob &job)
+                                    { return EventKey{job.sample, job.run, job.sub, job.evt} == evicted; }),
+                     buffer.end());
+    };
+
+    int n_workers = opt.n_workers;
+    if (n_workers <= 0)
+        n_workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const std::string format = use_combined_pdf ? std::string("pdf") : opt.image_format;
+
+    // An image that reached the renderer; index is its page number.
+    struct Rendered
     {
-        combined_path = std::filesystem::path(opt.out_dir) / opt.combined_pdf;
-        total_pages = n_to_render * opt.planes.size();
+        int sample = 0;
+        int run = 0;
+        int sub = 0;
+        int evt = 0;
+        std::string plane;
+        std::string id;
+        std::size_t index = 0;
+        bool ok = false;
+    };
+    std::vector<Rendered> rendered;
+
+    // Without a budget nothing is ever evicted, so slots hand their images on
+    // every flush_jobs images instead of holding the whole selection: to
+    // workers forked before the event loop starts, or rendered in-process one
+    // at a time, appending to a combined PDF in that order.
+    const bool streaming = !limited;
+    std::filesystem::path scratch;
+    std::unique_ptr<nu::RenderQueue::Stream> stream;
+    std::mutex render_mutex;
+    if (streaming && n_workers > 1)
+    {
+        scratch = nu::RenderQueue::make_scratch_dir(opt.out_dir, ".evd_pages_");
+        stream = std::make_unique<nu::RenderQueue::Stream>(
+            n_workers, scratch.string(),
+            [&](std::size_t index, const std::string &bytes)
+            {
+                const std::string target =
+                    use_combined_pdf ? (scratch / nu::RenderQueue::page_name(index)).string() : std::string();
+                return render_job(decode_job(bytes, display_opts), format, target);
+            });
+        std::clog << "[EventDisplay] Streaming images to " << n_workers << " worker(s), "
+                  << opt.flush_jobs << " at a time per slot." << '\n';
+    }
 
-#if defined(R__HAS_IMPLICITMT)
-        if (ROOT::IsImplicitMTEnabled())
+    auto hand_on = [&](std::vector<RenderJob> &buffer)
+    {
+        for (const auto &job : buffer)
         {
-            ROOT::DisableImplicitMT();
-            std::clog << "[EventDisplay] Implicit MT disabled for stable combined PDF output." << '\n';
+            Rendered r{job.sample, job.run, job.sub, job.evt, job.plane, job.spec.id, 0, false};
+            if (stream)
+            {
+                r.index = stream->submit(encode_job(job));
+                std::lock_guard<std::mutex> lock(render_mutex);
+                if (rendered.size() <= r.index)
+                    rendered.resize(r.index + 1);
+                rendered[r.index] = std::move(r);
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(render_mutex);
+            r.index = rendered.size();
+            std::string target;
+            if (use_combined_pdf)
+                target = combined_path.string() + (r.index == 0 ? "(" : "");
+            r.ok = render_job(job, format, target);
+            rendered.push_back(std::move(r));
         }
-#else
-        if (ROOT::IsImplicitMTEnabled())
+        buffer.clear();
+    };
+    auto flush = [&](unsigned int slot)
+    {
+        if (streaming && slot_jobs[slot].size() >= opt.flush_jobs)
+            hand_on(slot_jobs[slot]);
+    };
+
+    // Event lists written with sparse images are decoded here, past the key
+    // filter, so rejected events never expand to dense images.
+    const std::string &first_image = (opt.mode == Mode::Detector) ? opt.cols.det_u : opt.cols.sem_u;
+    const bool sparse = !df.HasColumn(first_image) && SparseImageService::has_sparse(df, first_image);
+    auto sparse_cols = [&](const std::string &u, const std::string &v, const std::string &w)
+    {
+        std::vector<std::string> cols{sample_col, opt.cols.run, opt.cols.sub, opt.cols.evt};
+        for (const auto *image : {&u, &v, &w})
         {
-            ROOT::DisableImplicitMT();
-            std::clog << "[EventDisplay] ROOT built without R__HAS_IMPLICITMT; disabling MT for combined PDF." << '\n';
+            cols.push_back(SparseImageService::index_column(*image));
+            cols.push_back(SparseImageService::value_column(*image));
+            cols.push_back(SparseImageService::size_column(*image));
         }
-#endif
-    }
-
-    using nlohmann::json;
-    json manifest = json::array();
-    std::mutex manifest_mutex;
-
-    auto display_opts = opt.display;
-    display_opts.out_dir = opt.out_dir;
+        return cols;
+    };
+    if (sparse)
+        std::clog << "[EventDisplay] Reading sparse image columns." << '\n';
 
     if (opt.mode == Mode::Detector)
     {
         const std::vector<std::string> cols{
+            sample_col,
             opt.cols.run,
             opt.cols.sub,
             opt.cols.evt,
@@ -490,20 +766,22 @@ void EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions &opt)
             opt.cols.det_v,
             opt.cols.det_w};
 
-        std::atomic<std::size_t> page_idx{0};
-        limited.Foreach(
-            [&](int run,
+        auto extract =
+            [&](unsigned int slot,
+                int sample,
+                int run,
                 int sub,
                 int evt,
                 const ROOT::VecOps::RVec<float> &det_u,
                 const ROOT::VecOps::RVec<float> &det_v,
                 const ROOT::VecOps::RVec<float> &det_w)
             {
-                std::clog << "[EventDisplay] Rendering detector images for "
-                          << "run=" << run
-                          << " sub=" << sub
-                          << " evt=" << evt
-                          << '\n';
+                std::ostringstream log;
+                log << "[EventDisplay] Extracting detector images for "
+                    << "run=" << run
+                    << " sub=" << sub
+                    << " evt=" << evt
+                    << '\n';
 
                 auto pick = [&](const std::string &plane) -> const ROOT::VecOps::RVec<float> &
                 {
@@ -558,74 +836,93 @@ void EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions &opt)
                         }
                     }
 
-                    std::clog << "[EventDisplay] Plane range summary "
-                              << "run=" << run
-                              << " sub=" << sub
-                              << " evt=" << evt
-                              << " plane=" << plane
-                              << " raw_min=" << raw_min
-                              << " raw_max=" << raw_max
-                              << " positive_pixels=" << positive_pixels
-                              << " q02=" << q02
-                              << " q999=" << q999
-                              << " display_min=" << plane_opts.det_min
-                              << " display_max=" << plane_opts.det_max
-                              << '\n';
-
-                    const std::string tag = format_tag(opt.file_pattern, plane, run, sub, evt);
-                    const std::string title =
-                        "Detector Image, Plane " + plane +
-                        " - Run " + std::to_string(run) +
-                        ", Subrun " + std::to_string(sub) +
-                        ", Event " + std::to_string(evt);
-
-                    EventDisplay::Spec spec{tag, title, Mode::Detector};
-                    EventDisplay::DetectorData det_data(img.begin(), img.end());
-                    EventDisplay ed(spec, plane_opts, std::move(det_data));
-
-                    if (use_combined_pdf)
-                    {
-                        const std::size_t idx = page_idx++;
-                        std::string target = combined_path.string();
-                        if (idx == 0)
-                            target += "(";
-                        else if (idx + 1 == total_pages)
-                            target += ")";
-                        ed.draw_and_save("pdf", target);
-                        if (!opt.manifest_path.empty())
-                        {
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run},
-                                                {"sub", sub},
-                                                {"evt", evt},
-                                                {"plane", plane},
-                                                {"file", combined_path.string()}});
-                        }
-                    }
-                    else
-                    {
-                        ed.draw_and_save(opt.image_format);
-                        if (!opt.manifest_path.empty())
-                        {
-                            const std::string file =
-                                (std::filesystem::path(opt.out_dir) /
-                                 (nu::Plotter::sanitise(tag) + "." + opt.image_format))
-                                    .string();
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run},
-                                                {"sub", sub},
-                                                {"evt", evt},
-                                                {"plane", plane},
-                                                {"file", file}});
-                        }
-                    }
+                    log << "[EventDisplay] Plane range summary "
+                        << "run=" << run
+                        << " sub=" << sub
+                        << " evt=" << evt
+                        << " plane=" << plane
+                        << " raw_min=" << raw_min
+                        << " raw_max=" << raw_max
+                        << " positive_pixels=" << positive_pixels
+                        << " q02=" << q02
+                        << " q999=" << q999
+                        << " display_min=" << plane_opts.det_min
+                        << " display_max=" << plane_opts.det_max
+                        << '\n';
+
+                    RenderJob job;
+                    job.sample = sample;
+                    job.run = run;
+                    job.sub = sub;
+                    job.evt = evt;
+                    job.plane = plane;
+                    job.spec = Spec{format_tag(opt.file_pattern, plane, run, sub, evt),
+                                    "Detector Image, Plane " + plane +
+                                        " - Run " + std::to_string(run) +
+                                        ", Subrun " + std::to_string(sub) +
+                                        ", Event " + std::to_string(evt),
+                                    Mode::Detector};
+                    job.display = plane_opts;
+                    job.det.assign(img.begin(), img.end());
+                    slot_jobs[slot].push_back(std::move(job));
                 }
-            },
-            cols);
+                std::clog << log.str();
+            };
+
+        if (sparse)
+        {
+            filtered.ForeachSlot(
+                [&](unsigned int slot,
+                    int sample,
+                    int run,
+                    int sub,
+                    int evt,
+                    const ROOT::VecOps::RVec<unsigned int> &idx_u,
+                    const ROOT::VecOps::RVec<float> &val_u,
+                    int n_u,
+                    const ROOT::VecOps::RVec<unsigned int> &idx_v,
+                    const ROOT::VecOps::RVec<float> &val_v,
+                    int n_v,
+                    const ROOT::VecOps::RVec<unsigned int> &idx_w,
+                    const ROOT::VecOps::RVec<float> &val_w,
+                    int n_w)
+                {
+                    claim(slot, sample, run, sub, evt);
+                    extract(slot,
+                            sample,
+                            run,
+                            sub,
+                            evt,
+                            SparseImageService::decode(idx_u, val_u, n_u),
+                            SparseImageService::decode(idx_v, val_v, n_v),
+                            SparseImageService::decode(idx_w, val_w, n_w));
+                    flush(slot);
+                },
+                sparse_cols(opt.cols.det_u, opt.cols.det_v, opt.cols.det_w));
+        }
+        else
+        {
+            filtered.ForeachSlot(
+                [&](unsigned int slot,
+                    int sample,
+                    int run,
+                    int sub,
+                    int evt,
+                    const ROOT::VecOps::RVec<float> &det_u,
+                    const ROOT::VecOps::RVec<float> &det_v,
+                    const ROOT::VecOps::RVec<float> &det_w)
+                {
+                    claim(slot, sample, run, sub, evt);
+                    extract(slot, sample, run, sub, evt, det_u, det_v, det_w);
+                    flush(slot);
+                },
+                cols);
+        }
     }
     else
     {
         const std::vector<std::string> cols{
+            sample_col,
             opt.cols.run,
             opt.cols.sub,
             opt.cols.evt,
@@ -633,20 +930,22 @@ void EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions &opt)
             opt.cols.sem_v,
             opt.cols.sem_w};
 
-        std::atomic<std::size_t> page_idx{0};
-        limited.Foreach(
-            [&](int run,
+        auto extract =
+            [&](unsigned int slot,
+                int sample,
+                int run,
                 int sub,
                 int evt,
                 const ROOT::VecOps::RVec<int> &sem_u,
                 const ROOT::VecOps::RVec<int> &sem_v,
                 const ROOT::VecOps::RVec<int> &sem_w)
             {
-                std::clog << "[EventDisplay] Rendering semantic images for "
-                          << "run=" << run
-                          << " sub=" << sub
-                          << " evt=" << evt
-                          << '\n';
+                std::ostringstream log;
+                log << "[EventDisplay] Extracting semantic images for "
+                    << "run=" << run
+                    << " sub=" << sub
+                    << " evt=" << evt
+                    << '\n';
 
                 auto pick = [&](const std::string &plane) -> const ROOT::VecOps::RVec<int> &
                 {
@@ -661,59 +960,223 @@ void EventDisplay::render_from_rdf(ROOT::RDF::RNode df, const BatchOptions &opt)
                 for (const auto &plane : opt.planes)
                 {
                     const auto &img = pick(plane);
-                    const std::string tag = format_tag(opt.file_pattern, plane, run, sub, evt);
-                    const std::string title =
-                        "Semantic Image, Plane " + plane +
-                        " - Run " + std::to_string(run) +
-                        ", Subrun " + std::to_string(sub) +
-                        ", Event " + std::to_string(evt);
-
-                    EventDisplay::Spec spec{tag, title, Mode::Semantic};
-                    EventDisplay::SemanticData sem_data(img.begin(), img.end());
-                    EventDisplay ed(spec, display_opts, std::move(sem_data));
-
-                    if (use_combined_pdf)
-                    {
-                        const std::size_t idx = page_idx++;
-                        std::string target = combined_path.string();
-                        if (idx == 0)
-                            target += "(";
-                        else if (idx + 1 == total_pages)
-                            target += ")";
-                        ed.draw_and_save("pdf", target);
-                        if (!opt.manifest_path.empty())
-                        {
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run},
-                                                {"sub", sub},
-                                                {"evt", evt},
-                                                {"plane", plane},
-                                                {"file", combined_path.string()}});
-                        }
-                    }
-                    else
-                    {
-                        ed.draw_and_save(opt.image_format);
-                        if (!opt.manifest_path.empty())
-                        {
-                            const std::string file =
-                                (std::filesystem::path(opt.out_dir) /
-                                 (nu::Plotter::sanitise(tag) + "." + opt.image_format))
-                                    .string();
-                            std::lock_guard<std::mutex> lock(manifest_mutex);
-                            manifest.push_back({{"run", run},
-                                                {"sub", sub},
-                                                {"evt", evt},
-                                                {"plane", plane},
-                                                {"file", file}});
-                        }
-                    }
+
+                    RenderJob job;
+                    job.sample = sample;
+                    job.run = run;
+                    job.sub = sub;
+                    job.evt = evt;
+                    job.plane = plane;
+                    job.spec = Spec{format_tag(opt.file_pattern, plane, run, sub, evt),
+                                    "Semantic Image, Plane " + plane +
+                                        " - Run " + std::to_string(run) +
+                                        ", Subrun " + std::to_string(sub) +
+                                        ", Event " + std::to_string(evt),
+                                    Mode::Semantic};
+                    job.display = display_opts;
+                    job.sem.assign(img.begin(), img.end());
+                    slot_jobs[slot].push_back(std::move(job));
                 }
-            },
-            cols);
+                std::clog << log.str();
+            };
+
+        if (sparse)
+        {
+            filtered.ForeachSlot(
+                [&](unsigned int slot,
+                    int sample,
+                    int run,
+                    int sub,
+                    int evt,
+                    const ROOT::VecOps::RVec<unsigned int> &idx_u,
+                    const ROOT::VecOps::RVec<int> &val_u,
+                    int n_u,
+                    const ROOT::VecOps::RVec<unsigned int> &idx_v,
+                    const ROOT::VecOps::RVec<int> &val_v,
+                    int n_v,
+                    const ROOT::VecOps::RVec<unsigned int> &idx_w,
+                    const ROOT::VecOps::RVec<int> &val_w,
+                    int n_w)
+                {
+                    claim(slot, sample, run, sub, evt);
+                    extract(slot,
+                            sample,
+                            run,
+                            sub,
+                            evt,
+                            SparseImageService::decode(idx_u, val_u, n_u),
+                            SparseImageService::decode(idx_v, val_v, n_v),
+                            SparseImageService::decode(idx_w, val_w, n_w));
+                    flush(slot);
+                },
+                sparse_cols(opt.cols.sem_u, opt.cols.sem_v, opt.cols.sem_w));
+        }
+        else
+        {
+            filtered.ForeachSlot(
+                [&](unsigned int slot,
+                    int sample,
+                    int run,
+                    int sub,
+                    int evt,
+                    const ROOT::VecOps::RVec<int> &sem_u,
+                    const ROOT::VecOps::RVec<int> &sem_v,
+                    const ROOT::VecOps::RVec<int> &sem_w)
+                {
+                    claim(slot, sample, run, sub, evt);
+                    extract(slot, sample, run, sub, evt, sem_u, sem_v, sem_w);
+                    flush(slot);
+                },
+                cols);
+        }
     }
+
+    if (opt.count_matches)
+    {
+        std::clog << "[EventDisplay] Selection matched " << n_matches.GetValue()
+                  << " rows." << '\n';
+    }
+
+    if (streaming)
+    {
+        for (auto &buffer : slot_jobs)
+            hand_on(buffer);
+        if (stream)
+        {
+            const std::vector<bool> ok = stream->finish();
+            for (auto &r : rendered)
+                r.ok = r.index < ok.size() && ok[r.index];
+        }
+        else if (use_combined_pdf && !rendered.empty())
+        {
+            TCanvas closer("evd_close", "", display_opts.canvas_size, display_opts.canvas_size);
+            closer.SaveAs((combined_path.string() + "]").c_str());
+        }
+        std::clog << "[EventDisplay] Rendered " << rendered.size() << " images." << '\n';
+    }
+    else
+    {
+        // Slots see events in no fixed order, so order by event id; planes
+        // keep their configured order within an event. Then keep the
+        // n_events smallest keys over all slots.
+        std::vector<RenderJob> jobs;
+        for (auto &buffer : slot_jobs)
+            std::move(buffer.begin(), buffer.end(), std::back_inserter(jobs));
+        slot_jobs.clear();
+        std::stable_sort(jobs.begin(), jobs.end(),
+                         [](const RenderJob &a, const RenderJob &b)
+                         { return std::tie(a.sample, a.run, a.sub, a.evt) < std::tie(b.sample, b.run, b.sub, b.evt); });
+        std::set<EventKey> kept;
+        for (auto &keys : slot_keys)
+            kept.insert(keys.begin(), keys.end());
+        while (kept.size() > opt.n_events)
+            kept.erase(std::prev(kept.end()));
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                                  [&kept](const RenderJob &job)
+                                  { return kept.count(EventKey{job.sample, job.run, job.sub, job.evt}) == 0; }),
+                   jobs.end());
+
+        const std::size_t n_jobs = jobs.size();
+        if (n_jobs > 0)
+        {
+            n_workers = std::max(1, std::min<int>(n_workers, static_cast<int>(n_jobs)));
+            std::clog << "[EventDisplay] Extracted " << n_jobs << " images; rendering with "
+                      << n_workers << " worker(s)." << '\n';
+
+            // In-process, a combined PDF is appended page by page; forked
+            // workers write one PDF per page, merged afterwards. The event
+            // loop is over here, so forking does not race its threads.
+            if (n_workers > 1)
+                scratch = nu::RenderQueue::make_scratch_dir(opt.out_dir, ".evd_pages_");
+            auto target_for = [&](std::size_t i) -> std::string
+            {
+                if (!use_combined_pdf)
+                    return std::string();
+                if (!scratch.empty())
+                    return (scratch / nu::RenderQueue::page_name(i)).string();
+                std::string target = combined_path.string();
+                if (i == 0)
+                    target += "(";
+                else if (i + 1 == n_jobs)
+                    target += ")";
+                return target;
+            };
+
+            const std::vector<bool> ok = nu::RenderQueue::run_forked(
+                n_jobs, n_workers, scratch.string(),
+                [&](std::size_t i) { return render_job(jobs[i], format, target_for(i)); });
+            for (std::size_t i = 0; i < n_jobs; ++i)
+            {
+                const RenderJob &job = jobs[i];
+                rendered.push_back(Rendered{job.sample, job.run, job.sub, job.evt, job.plane, job.spec.id, i, ok[i]});
+            }
+        }
+    }
+
+    if (rendered.empty())
+    {
+        if (!scratch.empty())
+            std::filesystem::remove_all(scratch, ec);
+        std::cerr << "[EventDisplay] No rows matched selection; nothing to render."
+                  << '\n';
+        return;
+    }
+
+    // Pages and manifest follow event order; within an event the planes are
+    // already in page order.
+    std::stable_sort(rendered.begin(), rendered.end(),
+                     [](const Rendered &a, const Rendered &b)
+                     { return std::tie(a.sample, a.run, a.sub, a.evt) < std::tie(b.sample, b.run, b.sub, b.evt); });
+
+    if (use_combined_pdf && !scratch.empty())
+    {
+        std::vector<std::string> ok_pages;
+        for (const auto &r : rendered)
+        {
+            const std::string page = (scratch / nu::RenderQueue::page_name(r.index)).string();
+            if (r.ok && std::filesystem::exists(page))
+                ok_pages.push_back(page);
+        }
+        if (nu::RenderQueue::merge_pdfs(ok_pages, combined_path.string()))
+        {
+            std::filesystem::remove_all(scratch, ec);
+            std::clog << "[EventDisplay] Merged " << ok_pages.size()
+                      << " pages into " << combined_path.string() << '\n';
+        }
+        else
+        {
+            std::cerr << "[EventDisplay] Failed to merge pages; kept them in "
+                      << scratch.string() << '\n';
+        }
+    }
+    else if (!scratch.empty())
+    {
+        std::filesystem::remove_all(scratch, ec);
+    }
+
     if (!opt.manifest_path.empty())
     {
+        using nlohmann::json;
+        json manifest = json::array();
+        for (const auto &r : rendered)
+        {
+            if (!r.ok)
+                continue;
+
+            const std::string file =
+                use_combined_pdf
+                    ? combined_path.string()
+                    : (std::filesystem::path(opt.out_dir) /
+                       (nu::Plotter::sanitise(r.id) + "." + opt.image_format))
+                          .string();
+            manifest.push_back({{"sample_id", r.sample},
+                                {"run", r.run},
+                                {"sub", r.sub},
+                                {"evt", r.evt},
+                                {"plane", r.plane},
+                                {"file", file}});
+        }
+
         std::ofstream ofs(opt.manifest_path);
         ofs << manifest.dump(2);
         std::clog << "[EventDisplay] Wrote event display manifest: "
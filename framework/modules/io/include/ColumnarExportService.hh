@@ -0,0 +1,84 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/io/include/ColumnarExportService.hh
+ *
+ *  @brief Columnar (Arrow IPC / Feather v2) export of event columns for
+ *         training loaders, streamed from an RDataFrame in record batches.
+ */
+
+#ifndef HERON_IO_COLUMNAR_EXPORT_SERVICE_H
+#define HERON_IO_COLUMNAR_EXPORT_SERVICE_H
+
+#include <string>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+
+
+class ColumnarExportService final
+{
+  public:
+    struct Options
+    {
+        /// Training batch size: every record batch but a shard's last holds
+        /// a multiple of it, so no GPU batch straddles two chunks.
+        Long64_t batch_rows = 256;
+
+        /// A record batch is closed at the first batch_rows boundary at which
+        /// its buffers reach this size. A slot's buffers therefore peak just
+        /// below chunk_bytes plus batch_rows rows; with three 512x512 float
+        /// images per row, batch_rows = 256 alone is ~800 MB. Every slot
+        /// buffers at once, so the export holds n_slots times that, plus a
+        /// bit-packed copy of its bool columns while a batch is written.
+        size_t chunk_bytes = 256u << 20;
+
+        /// List columns written as FixedSizeList; the length is taken from
+        /// the first row and every other row must match it.
+        std::vector<std::string> fixed_size_columns = {"detector_image_u",
+                                                       "detector_image_v",
+                                                       "detector_image_w",
+                                                       "semantic_image_u",
+                                                       "semantic_image_v",
+                                                       "semantic_image_w"};
+    };
+
+    struct Column
+    {
+        std::string name;
+        /// Arrow type, e.g. "float32" or "fixed_size_list<float32>[262144]";
+        /// a fixed-size list has no "[n]" when no rows were exported.
+        std::string type;
+    };
+
+    struct Shard
+    {
+        std::string path;
+        Long64_t rows = 0;
+        Long64_t batches = 0;
+    };
+
+    struct Manifest
+    {
+        std::vector<Column> columns;
+        std::vector<Shard> shards;
+        Long64_t rows = 0;
+        Long64_t batch_rows = 0;
+    };
+
+    /// Streams `columns` of `node` into <out_dir>/<stem>_<shard>.arrow, one
+    /// shard per RDataFrame slot, written by that slot's thread as its
+    /// batches fill, and writes <out_dir>/<stem>_manifest.json. Numeric and
+    /// bool scalars and RVec/std::vector of them are supported; lists not in
+    /// fixed_size_columns become LargeList columns. No file is written for a
+    /// slot that sees no rows.
+    static Manifest write_arrow(ROOT::RDF::RNode node,
+                                const std::string &out_dir,
+                                const std::string &stem,
+                                const std::vector<std::string> &columns,
+                                const Options &opt);
+
+    static void write_manifest(const Manifest &manifest, const std::string &path);
+};
+
+
+#endif // HERON_IO_COLUMNAR_EXPORT_SERVICE_H
@@ -0,0 +1,111 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/io/include/DatasetSplitService.hh
+ *
+ *  @brief Deterministic train/validation/test splitting of an event list,
+ *         keyed on a hash of (run, sub, evt) and written as sharded event
+ *         lists in one pass.
+ */
+
+#ifndef HERON_IO_DATASET_SPLIT_SERVICE_H
+#define HERON_IO_DATASET_SPLIT_SERVICE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+
+
+class DatasetSplitService final
+{
+  public:
+    struct Split
+    {
+        std::string name;
+        double fraction = 0.0;
+    };
+
+    struct Options
+    {
+        /// Fractions are normalised to their sum.
+        std::vector<Split> splits = {{"train", 0.8}, {"val", 0.1}, {"test", 0.1}};
+
+        /// Shards per split.
+        int n_shards = 1;
+
+        /// Mixed into the event hash; a different seed gives an unrelated split.
+        std::uint64_t seed = 0;
+
+        /// Integer class column counted per split; empty disables counting
+        /// and class_keep_fraction.
+        std::string class_column = "analysis_channels";
+
+        /// Hashed keep probability per class, for balancing; classes not
+        /// listed are kept whole.
+        std::map<int, double> class_keep_fraction;
+
+        /// Counts class_column over the selected events in a pass of its
+        /// own and replaces class_keep_fraction by balanced_keep_fractions()
+        /// of those counts.
+        bool balance_classes = false;
+    };
+
+    struct Shard
+    {
+        std::string path;
+        ULong64_t rows = 0;
+    };
+
+    struct SplitSummary
+    {
+        std::string name;
+        double fraction = 0.0;
+        ULong64_t rows = 0;
+        std::map<int, ULong64_t> class_counts;
+        std::vector<Shard> shards;
+    };
+
+    struct Manifest
+    {
+        std::string input;
+        std::uint64_t seed = 0;
+        int n_shards = 0;
+        std::string class_column;
+        ULong64_t rows_dropped = 0;
+        std::map<int, double> class_keep_fraction;
+        std::vector<SplitSummary> splits;
+    };
+
+    /// Stable 64-bit hash of an event id; the same on every platform and in
+    /// every re-skim, independent of file order and of other events.
+    static std::uint64_t event_hash(int run, int sub, int evt, std::uint64_t seed);
+
+    /// Split index for a hash given cumulative split fractions ending at 1.
+    static int split_index(std::uint64_t hash, const std::vector<double> &cumulative);
+
+    /// Shard index, from hash bits independent of those picking the split.
+    static int shard_index(std::uint64_t hash, int n_shards);
+
+    /// Hashed keep decision for class balancing, again from independent bits.
+    static bool keep_event(std::uint64_t hash, double keep_fraction);
+
+    /// Keep fractions that bring every class down to the smallest count.
+    static std::map<int, double> balanced_keep_fractions(const std::map<int, ULong64_t> &class_counts);
+
+    /// Writes every (split, shard) of the event list at `event_list_root`
+    /// (after `selection`) to <out_dir>/<split>_<shard>.root as an event list
+    /// with the input's sample_refs and schema, friend columns included, and
+    /// writes <out_dir>/split_manifest.json. All outputs are filled by one
+    /// event loop.
+    static Manifest split_event_list(const std::string &event_list_root,
+                                     const std::string &out_dir,
+                                     const std::string &selection,
+                                     const Options &opt);
+
+    static void write_manifest(const Manifest &manifest, const std::string &path);
+};
+
+
+#endif // HERON_IO_DATASET_SPLIT_SERVICE_H
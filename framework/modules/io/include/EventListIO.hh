@@ -10,15 +10,19 @@
 #define HERON_IO_EVENT_LIST_IO_H
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <ROOT/RDataFrame.hxx>
 
 #include "SampleIO.hh"
 
+class TTree;
+
 namespace nu
 {
 struct EventListHeader
@@ -42,6 +46,30 @@ struct SampleInfo
     double db_tor101_pot_sum = 0.0;
 };
 
+/// Tree aligned entry by entry with the event tree; file is relative to the
+/// event list's directory, empty for the event list file itself.
+struct EventFriend
+{
+    std::string tree;
+    std::string file;
+};
+
+struct EventKey
+{
+    int run = 0;
+    int sub = 0;
+    int evt = 0;
+};
+
+struct EventIndexEntry
+{
+    int run = 0;
+    int sub = 0;
+    int evt = 0;
+    int sample_id = -1;
+    Long64_t entry = -1;
+};
+
 class EventListIO
 {
   public:
@@ -57,6 +85,12 @@ class EventListIO
                      const std::string &event_schema_tsv,
                      const std::string &schema_tag);
 
+    /// As above, recording each event_schema* key of `event_schemas` as given.
+    static void init(const std::string &out_path,
+                     const EventListHeader &header,
+                     const std::vector<SampleInfo> &sample_refs,
+                     const std::map<std::string, std::string> &event_schemas);
+
     static EventListIO read(std::string path);
 
     explicit EventListIO(std::string path, OpenMode mode = OpenMode::kRead);
@@ -65,10 +99,33 @@ class EventListIO
     const EventListHeader &header() const noexcept { return m_header; }
 
     const std::unordered_map<int, SampleInfo> &sample_refs() const noexcept { return m_sample_refs; }
+    int max_sample_id() const noexcept { return m_max_sample_id; }
 
     std::string event_tree() const;
 
-    ROOT::RDataFrame rdf() const;
+    /// event_schema* key -> schema TSV.
+    std::map<std::string, std::string> event_schemas() const;
+
+    const std::vector<EventFriend> &friends() const noexcept { return m_friends; }
+
+    /// Registers an aligned friend tree and appends its (type, name) columns
+    /// to the recorded event schema; needs OpenMode::kUpdate.
+    void add_friend(const EventFriend &fr,
+                    const std::vector<std::pair<std::string, std::string>> &schema_columns);
+
+    /// Event tree with every registered friend attached. The chain is built
+    /// once; the returned node shares ownership of it, so it may outlive
+    /// this EventListIO.
+    ROOT::RDF::RNode rdf() const;
+
+    /// As rdf(), leaving out the friend tree `skip` (e.g. one being
+    /// rewritten), on a chain of its own.
+    ROOT::RDF::RNode rdf_without_friend(const std::string &skip) const;
+
+    /// Event tree filtered by `selection`. Clusters whose zone maps rule the
+    /// selection out are left off the chain's TEntryList, so none of their
+    /// baskets are read, serially or under implicit MT.
+    ROOT::RDF::RNode rdf(const std::string &selection) const;
 
     std::shared_ptr<const std::vector<char>> mask_for_origin(SampleIO::SampleOrigin origin) const;
     std::shared_ptr<const std::vector<char>> mask_for_mc_like() const;
@@ -97,12 +154,39 @@ class EventListIO
                                          const std::string &selection,
                                          const std::string &tree_name = "events") const;
 
+    /// Sorts (run, sub, evt) -> (sample_id, entry) over the event tree and
+    /// writes it as the event_index tree; needs OpenMode::kUpdate.
+    Long64_t build_event_index() const;
+    bool has_event_index() const;
+
+    /// Per-cluster zone maps of the event tree, see SnapshotService.
+    Long64_t build_zone_maps(const std::vector<std::string> &columns = {}) const;
+
+    /// Index entries for one event; several when samples share an event id.
+    std::vector<EventIndexEntry> lookup(int run, int sub, int evt) const;
+    std::vector<EventIndexEntry> lookup(const std::vector<EventKey> &keys) const;
+
+    /// Event tree restricted to the listed events, in tree order. A
+    /// TEntryList on the chain limits the loop to those entries, with or
+    /// without implicit MT.
+    ROOT::RDF::RNode rdf_for_events(const std::vector<EventKey> &keys) const;
+    ROOT::RDF::RNode rdf_for_events(const std::string &event_list_path) const;
+
+    /// Reads "run sub evt" per line (whitespace or commas, '#' comments).
+    static std::vector<EventKey> read_event_keys(const std::string &path);
+
   private:
+    const std::vector<EventIndexEntry> &event_index() const;
+
     std::string m_path;
     OpenMode m_mode;
     EventListHeader m_header{};
     std::unordered_map<int, SampleInfo> m_sample_refs;
     int m_max_sample_id = -1;
+    mutable std::shared_ptr<const std::vector<EventIndexEntry>> m_event_index;
+    std::vector<EventFriend> m_friends;
+    struct EventChain;
+    std::shared_ptr<EventChain> m_chain;
 };
 }
 
@@ -0,0 +1,105 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/io/include/EventListSet.hh
+ *
+ *  @brief Several event-list files (e.g. one per run period) read as one
+ *         dataset, with sample ids remapped into a global namespace.
+ */
+
+#ifndef HERON_IO_EVENT_LIST_SET_H
+#define HERON_IO_EVENT_LIST_SET_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+
+#include "EventListIO.hh"
+#include "SampleIO.hh"
+
+class TTree;
+
+namespace nu
+{
+struct EventListPeriod
+{
+    std::string label;
+    std::string path;
+};
+
+/**
+ *  @brief Chains the event trees of several event lists without copying.
+ *
+ *  Period p's local sample ids are shifted by the number of ids used by the
+ *  periods before it, so global ids are dense and stable for a given period
+ *  order. rdf() defines the global id as sample_id_column() from the file
+ *  each entry comes from; the masks are indexed by it and can be passed
+ *  straight to filter_by_sample_mask. Friend trees registered in every
+ *  period are attached as chains of their own.
+ */
+class EventListSet
+{
+  public:
+    static constexpr const char *k_sample_id_column = "global_sample_id";
+
+    explicit EventListSet(std::vector<EventListPeriod> periods);
+
+    /// Period labels default to the file stems.
+    static EventListSet read(const std::vector<std::string> &paths);
+
+    size_t size() const noexcept { return m_lists.size(); }
+    const EventListPeriod &period(size_t i) const { return m_periods.at(i); }
+    const EventListIO &event_list(size_t i) const { return m_lists.at(i); }
+
+    std::string event_tree() const { return m_event_tree; }
+    const char *sample_id_column() const noexcept { return k_sample_id_column; }
+
+    /// Global id of a period's local sample id, and back.
+    int global_sample_id(size_t period, int local_sample_id) const;
+    size_t period_of(int global_sample_id) const;
+
+    /// Sample references keyed by global id.
+    const std::unordered_map<int, SampleInfo> &sample_refs() const noexcept { return m_sample_refs; }
+
+    /// Chained event trees with sample_id_column() defined, from a per-sample
+    /// period offset (also under implicit MT). The frame owns its chains.
+    ROOT::RDF::RNode rdf() const;
+
+    std::shared_ptr<const std::vector<char>> mask_for_origin(SampleIO::SampleOrigin origin) const;
+    std::shared_ptr<const std::vector<char>> mask_for_mc_like() const;
+    std::shared_ptr<const std::vector<char>> mask_for_data() const;
+    std::shared_ptr<const std::vector<char>> mask_for_ext() const;
+
+    /// Summed over periods; event_list(i).total_pot_data() gives one period.
+    double total_pot_data() const;
+    double total_pot_mc() const;
+
+    std::string beamline_label() const;
+
+    /// Physical merge into a new event list at out_path: event tree baskets
+    /// are fast-cloned without decompression, sample_refs get the global ids
+    /// and only the sample_id branch is rewritten. Friends shared by
+    /// every period are merged alongside. The recorded event schemas must
+    /// agree. Up to n_threads inputs (0 => hardware concurrency) have their
+    /// sample_id read concurrently with the cloning. Returns the entries
+    /// written.
+    Long64_t write_merged(const std::string &out_path, unsigned n_threads = 0) const;
+
+  private:
+    /// Files holding friend tree `tree` per period; empty unless every
+    /// period registers it.
+    std::vector<std::string> friend_files(const std::string &tree) const;
+
+    std::vector<EventListPeriod> m_periods;
+    std::vector<EventListIO> m_lists;
+    std::string m_event_tree;
+    /// Per period: first global sample id; one extra trailing element holds
+    /// the total.
+    std::vector<int> m_id_offsets;
+    std::unordered_map<int, SampleInfo> m_sample_refs;
+};
+}
+
+#endif
@@ -9,6 +9,7 @@
 #define HERON_IO_SNAPSHOT_SERVICE_H
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <ROOT/RDataFrame.hxx>
@@ -34,6 +35,35 @@ class SnapshotService final
                                                 const std::vector<std::string> &columns,
                                                 const std::string &selection,
                                                 const std::string &tree_name = "events");
+
+    /// Writes `columns` of every entry of `node` as tree_name in out_path,
+    /// replacing any tree of that name, so that it can be attached as a
+    /// friend of the tree `node` reads. Entry order must be preserved, i.e.
+    /// implicit MT disabled. Returns the number of entries written.
+    static ULong64_t snapshot_friend(ROOT::RDF::RNode node,
+                                     const std::string &out_path,
+                                     const std::string &tree_name,
+                                     const std::vector<std::string> &columns);
+
+    /// Entry range [first, second) of the event tree.
+    using EntryRange = std::pair<Long64_t, Long64_t>;
+
+    static std::string zone_map_tree_name(const std::string &tree_name);
+
+    /// Records min, max and any-nonzero of each column per TTree cluster in
+    /// the side tree zone_map_tree_name(tree_name). Empty columns => every
+    /// scalar numeric branch. Returns the number of clusters.
+    static Long64_t build_zone_maps(const std::string &path,
+                                    const std::string &tree_name,
+                                    const std::vector<std::string> &columns = {});
+
+    /// Cluster ranges that may hold entries passing `predicate`, merged
+    /// where adjacent. Only top-level conjunctions of `col`, `!col` and
+    /// `col <op> number` prune; anything else keeps every cluster, as does
+    /// a file without zone maps.
+    static std::vector<EntryRange> zone_map_ranges(const std::string &path,
+                                                   const std::string &tree_name,
+                                                   const std::string &predicate);
 };
 
 
@@ -0,0 +1,111 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/io/include/SparseImageService.hh
+ *
+ *  @brief Sparse (COO) encoding of the flat detector and semantic image
+ *         columns, as a snapshot-time transform and a read-time decode.
+ */
+
+#ifndef HERON_IO_SPARSE_IMAGE_SERVICE_H
+#define HERON_IO_SPARSE_IMAGE_SERVICE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RVec.hxx>
+
+
+/**
+ *  An image column <name> is stored as three columns: <name>_idx, the
+ *  ascending flat indices of the cells kept; <name>_val, their values; and
+ *  <name>_n, the dense length. Cells not listed decode to zero.
+ */
+class SparseImageService final
+{
+  public:
+    struct Column
+    {
+        std::string name;
+        /// Cells with |value| below this are dropped as well as zeros; 0
+        /// keeps the encoding lossless.
+        double threshold = 0.0;
+    };
+
+    static std::string index_column(const std::string &image) { return image + "_idx"; }
+    static std::string value_column(const std::string &image) { return image + "_val"; }
+    static std::string size_column(const std::string &image) { return image + "_n"; }
+
+    /// detector_image_u/v/w and semantic_image_u/v/w.
+    static const std::vector<std::string> &image_columns();
+
+    template <typename T>
+    static ROOT::VecOps::RVec<unsigned int> encode_indices(const ROOT::VecOps::RVec<T> &dense,
+                                                           double threshold = 0.0)
+    {
+        ROOT::VecOps::RVec<unsigned int> idx;
+        const std::size_t n = dense.size();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const T x = dense[i];
+            if (x != T(0) && !(std::abs(static_cast<double>(x)) < threshold))
+                idx.push_back(static_cast<unsigned int>(i));
+        }
+        return idx;
+    }
+
+    template <typename T>
+    static ROOT::VecOps::RVec<T> encode_values(const ROOT::VecOps::RVec<T> &dense,
+                                               const ROOT::VecOps::RVec<unsigned int> &idx)
+    {
+        ROOT::VecOps::RVec<T> val(idx.size());
+        for (std::size_t i = 0; i < idx.size(); ++i)
+            val[i] = dense[idx[i]];
+        return val;
+    }
+
+    template <typename T>
+    static ROOT::VecOps::RVec<T> decode(const ROOT::VecOps::RVec<unsigned int> &idx,
+                                        const ROOT::VecOps::RVec<T> &val,
+                                        int size)
+    {
+        if (idx.size() != val.size())
+            throw std::runtime_error("SparseImageService::decode: index and value lengths differ");
+
+        ROOT::VecOps::RVec<T> dense(static_cast<std::size_t>(std::max(size, 0)), T(0));
+        for (std::size_t i = 0; i < idx.size(); ++i)
+        {
+            if (idx[i] >= dense.size())
+                throw std::runtime_error("SparseImageService::decode: index beyond image size");
+            dense[idx[i]] = val[i];
+        }
+        return dense;
+    }
+
+    /// Defines the sparse columns of every image; float, double and int
+    /// images are supported.
+    static ROOT::RDF::RNode define_sparse(ROOT::RDF::RNode node, const std::vector<Column> &images);
+
+    /// `columns` with every image in `images` replaced by its sparse columns.
+    static std::vector<std::string> sparse_columns(const std::vector<std::string> &columns,
+                                                   const std::vector<Column> &images);
+
+    /// True when the node holds the sparse columns of `image`.
+    static bool has_sparse(ROOT::RDF::RNode node, const std::string &image)
+    {
+        return node.HasColumn(index_column(image)) && node.HasColumn(value_column(image))
+               && node.HasColumn(size_column(image));
+    }
+
+    /// Defines each image the node only holds in sparse form as its decoded
+    /// dense column; images already present are left as they are.
+    static ROOT::RDF::RNode define_dense(ROOT::RDF::RNode node,
+                                         const std::vector<std::string> &images = image_columns());
+};
+
+
+#endif // HERON_IO_SPARSE_IMAGE_SERVICE_H
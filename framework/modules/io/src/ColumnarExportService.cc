@@ -0,0 +1,902 @@
+#include "ColumnarExportService.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ROOT/RVec.hxx>
+
+namespace
+{
+
+// Minimal FlatBuffers encoder for the Arrow IPC metadata (Schema.fbs,
+// Message.fbs, File.fbs). Objects are written parent first, so every
+// uoffset points forward, with scalars aligned to their width relative to
+// the buffer start as the verifier expects.
+
+struct FbObject;
+using FbRef = std::shared_ptr<const FbObject>;
+
+struct FbObject
+{
+    enum class Kind
+    {
+        kTable,
+        kTableVector,
+        kStructVector,
+        kString
+    };
+
+    struct Field
+    {
+        int slot = 0;
+        int size = 0; // scalar width in bytes, 0 for an offset to ref
+        uint64_t bits = 0;
+        FbRef ref;
+    };
+
+    Kind kind = Kind::kTable;
+    std::vector<Field> fields;
+    std::vector<FbRef> items;
+    std::vector<uint8_t> bytes;
+    uint32_t count = 0;
+};
+
+class FbTable
+{
+  public:
+    template <class T>
+    FbTable &scalar(int slot, T value)
+    {
+        static_assert(std::is_arithmetic_v<T>, "FbTable::scalar: arithmetic types only");
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(T));
+        m_obj->fields.push_back({slot, static_cast<int>(sizeof(T)), bits, nullptr});
+        return *this;
+    }
+
+    FbTable &ref(int slot, FbRef r)
+    {
+        m_obj->fields.push_back({slot, 0, 0, std::move(r)});
+        return *this;
+    }
+
+    FbRef done() const { return m_obj; }
+
+  private:
+    std::shared_ptr<FbObject> m_obj = std::make_shared<FbObject>();
+};
+
+FbRef fb_string(const std::string &s)
+{
+    auto obj = std::make_shared<FbObject>();
+    obj->kind = FbObject::Kind::kString;
+    obj->bytes.assign(s.begin(), s.end());
+    return obj;
+}
+
+FbRef fb_tables(std::vector<FbRef> items)
+{
+    auto obj = std::make_shared<FbObject>();
+    obj->kind = FbObject::Kind::kTableVector;
+    obj->items = std::move(items);
+    return obj;
+}
+
+/// Vector of 8-byte aligned structs given as packed little-endian bytes.
+FbRef fb_structs(std::vector<uint8_t> bytes, uint32_t count)
+{
+    auto obj = std::make_shared<FbObject>();
+    obj->kind = FbObject::Kind::kStructVector;
+    obj->bytes = std::move(bytes);
+    obj->count = count;
+    return obj;
+}
+
+template <class T>
+void put_le(std::vector<uint8_t> &out, T value)
+{
+    uint8_t raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    out.insert(out.end(), raw, raw + sizeof(T));
+}
+
+class FbWriter
+{
+  public:
+    /// Root offset followed by the object tree, padded to 8 bytes.
+    std::vector<uint8_t> finish(const FbRef &root)
+    {
+        m_buf.assign(4, 0);
+        patch(0, write(*root));
+        align(8);
+        return std::move(m_buf);
+    }
+
+  private:
+    void align(size_t a)
+    {
+        while (m_buf.size() % a)
+            m_buf.push_back(0);
+    }
+
+    void patch(size_t at, size_t target)
+    {
+        const uint32_t off = static_cast<uint32_t>(target - at);
+        std::memcpy(&m_buf[at], &off, sizeof(off));
+    }
+
+    size_t write(const FbObject &o)
+    {
+        switch (o.kind)
+        {
+        case FbObject::Kind::kTable: return write_table(o);
+        case FbObject::Kind::kTableVector: return write_table_vector(o);
+        case FbObject::Kind::kStructVector: return write_struct_vector(o);
+        case FbObject::Kind::kString: return write_string(o);
+        }
+        return 0;
+    }
+
+    size_t write_table(const FbObject &o)
+    {
+        int n_slots = 0;
+        for (const auto &f : o.fields)
+            n_slots = std::max(n_slots, f.slot + 1);
+
+        // Widest fields first, from an 8-aligned table start.
+        std::vector<size_t> order(o.fields.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        auto width = [&](size_t i) { return o.fields[i].size ? o.fields[i].size : 4; };
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return width(a) > width(b); });
+
+        std::vector<uint16_t> field_offset(o.fields.size(), 0);
+        size_t table_size = 4;
+        for (const size_t i : order)
+        {
+            const size_t w = static_cast<size_t>(width(i));
+            table_size = (table_size + w - 1) / w * w;
+            field_offset[i] = static_cast<uint16_t>(table_size);
+            table_size += w;
+        }
+
+        std::vector<uint16_t> vtable(static_cast<size_t>(n_slots), 0);
+        for (size_t i = 0; i < o.fields.size(); ++i)
+            vtable[static_cast<size_t>(o.fields[i].slot)] = field_offset[i];
+
+        align(2);
+        const size_t vtable_pos = m_buf.size();
+        put_le<uint16_t>(m_buf, static_cast<uint16_t>(4 + 2 * n_slots));
+        put_le<uint16_t>(m_buf, static_cast<uint16_t>(table_size));
+        for (const uint16_t v : vtable)
+            put_le<uint16_t>(m_buf, v);
+
+        align(8);
+        const size_t table_pos = m_buf.size();
+        m_buf.resize(table_pos + table_size, 0);
+        const int32_t soffset = static_cast<int32_t>(table_pos - vtable_pos);
+        std::memcpy(&m_buf[table_pos], &soffset, sizeof(soffset));
+
+        for (size_t i = 0; i < o.fields.size(); ++i)
+        {
+            const auto &f = o.fields[i];
+            if (f.size)
+                std::memcpy(&m_buf[table_pos + field_offset[i]], &f.bits, static_cast<size_t>(f.size));
+        }
+        for (size_t i = 0; i < o.fields.size(); ++i)
+        {
+            if (!o.fields[i].size)
+                patch(table_pos + field_offset[i], write(*o.fields[i].ref));
+        }
+        return table_pos;
+    }
+
+    size_t write_table_vector(const FbObject &o)
+    {
+        align(4);
+        const size_t pos = m_buf.size();
+        put_le<uint32_t>(m_buf, static_cast<uint32_t>(o.items.size()));
+        m_buf.resize(m_buf.size() + 4 * o.items.size(), 0);
+        for (size_t i = 0; i < o.items.size(); ++i)
+            patch(pos + 4 + 4 * i, write(*o.items[i]));
+        return pos;
+    }
+
+    size_t write_struct_vector(const FbObject &o)
+    {
+        align(4);
+        if ((m_buf.size() + 4) % 8)
+            m_buf.resize(m_buf.size() + 4, 0);
+        const size_t pos = m_buf.size();
+        put_le<uint32_t>(m_buf, o.count);
+        m_buf.insert(m_buf.end(), o.bytes.begin(), o.bytes.end());
+        return pos;
+    }
+
+    size_t write_string(const FbObject &o)
+    {
+        align(4);
+        const size_t pos = m_buf.size();
+        put_le<uint32_t>(m_buf, static_cast<uint32_t>(o.bytes.size()));
+        m_buf.insert(m_buf.end(), o.bytes.begin(), o.bytes.end());
+        m_buf.push_back(0);
+        return pos;
+    }
+
+    std::vector<uint8_t> m_buf;
+};
+
+// Arrow enum values (Schema.fbs / Message.fbs).
+constexpr int16_t k_metadata_v5 = 4;
+constexpr uint8_t k_header_schema = 1;
+constexpr uint8_t k_header_record_batch = 3;
+constexpr uint8_t k_type_int = 2;
+constexpr uint8_t k_type_floating_point = 3;
+constexpr uint8_t k_type_bool = 6;
+constexpr uint8_t k_type_fixed_size_list = 16;
+constexpr uint8_t k_type_large_list = 21;
+constexpr size_t k_body_alignment = 64;
+
+struct ValueType
+{
+    enum class Kind
+    {
+        kBool,
+        kInt,
+        kFloat
+    };
+    Kind kind = Kind::kInt;
+    int bit_width = 32;
+    bool is_signed = true;
+
+    std::string name() const
+    {
+        if (kind == Kind::kBool)
+            return "bool";
+        if (kind == Kind::kFloat)
+            return "float" + std::to_string(bit_width);
+        return (is_signed ? "int" : "uint") + std::to_string(bit_width);
+    }
+};
+
+template <class T>
+ValueType value_type_of()
+{
+    if constexpr (std::is_same_v<T, bool>)
+        return {ValueType::Kind::kBool, 1, false};
+    else if constexpr (std::is_floating_point_v<T>)
+        return {ValueType::Kind::kFloat, static_cast<int>(8 * sizeof(T)), true};
+    else
+        return {ValueType::Kind::kInt, static_cast<int>(8 * sizeof(T)), std::is_signed_v<T>};
+}
+
+template <class T>
+struct Tag
+{
+    using type = T;
+};
+
+/// Calls f(Tag<T>{}) for the C++ type named by an RDataFrame column type.
+template <class F>
+void visit_value_type(const std::string &name, F &&f)
+{
+    if (name == "bool" || name == "Bool_t")
+        f(Tag<bool>{});
+    else if (name == "char" || name == "Char_t")
+        f(Tag<char>{});
+    else if (name == "unsigned char" || name == "UChar_t")
+        f(Tag<unsigned char>{});
+    else if (name == "short" || name == "Short_t")
+        f(Tag<short>{});
+    else if (name == "unsigned short" || name == "UShort_t")
+        f(Tag<unsigned short>{});
+    else if (name == "int" || name == "Int_t")
+        f(Tag<int>{});
+    else if (name == "unsigned int" || name == "unsigned" || name == "UInt_t")
+        f(Tag<unsigned int>{});
+    else if (name == "long" || name == "Long_t")
+        f(Tag<long>{});
+    else if (name == "unsigned long" || name == "ULong_t")
+        f(Tag<unsigned long>{});
+    else if (name == "long long" || name == "Long64_t")
+        f(Tag<long long>{});
+    else if (name == "unsigned long long" || name == "ULong64_t")
+        f(Tag<unsigned long long>{});
+    else if (name == "float" || name == "Float_t")
+        f(Tag<float>{});
+    else if (name == "double" || name == "Double_t")
+        f(Tag<double>{});
+    else
+        throw std::runtime_error("ColumnarExportService: unsupported column type " + name);
+}
+
+/// Element type of an RVec / std::vector column type, empty otherwise.
+std::string list_element_type(const std::string &type)
+{
+    const size_t open = type.find('<');
+    const size_t close = type.rfind('>');
+    if (open == std::string::npos || close == std::string::npos || close < open)
+        return {};
+
+    std::string outer = type.substr(0, open);
+    outer.erase(std::remove(outer.begin(), outer.end(), ' '), outer.end());
+    if (outer != "ROOT::VecOps::RVec" && outer != "ROOT::RVec" && outer != "RVec" && outer != "std::vector" &&
+        outer != "vector")
+        return {};
+
+    std::string elem = type.substr(open + 1, close - open - 1);
+    const size_t first = elem.find_first_not_of(' ');
+    const size_t last = elem.find_last_not_of(' ');
+    return (first == std::string::npos) ? std::string() : elem.substr(first, last - first + 1);
+}
+
+struct ColumnSpec
+{
+    enum class Layout
+    {
+        kScalar,
+        kFixedList,
+        kList
+    };
+    std::string name;
+    ValueType value;
+    Layout layout = Layout::kScalar;
+};
+
+FbRef value_type_table(const ValueType &t)
+{
+    FbTable table;
+    if (t.kind == ValueType::Kind::kInt)
+        table.scalar<int32_t>(0, t.bit_width).scalar<uint8_t>(1, t.is_signed ? 1 : 0);
+    else if (t.kind == ValueType::Kind::kFloat)
+        table.scalar<int16_t>(0, static_cast<int16_t>(t.bit_width == 16 ? 0 : (t.bit_width == 32 ? 1 : 2)));
+    return table.done();
+}
+
+uint8_t value_type_id(const ValueType &t)
+{
+    switch (t.kind)
+    {
+    case ValueType::Kind::kBool: return k_type_bool;
+    case ValueType::Kind::kFloat: return k_type_floating_point;
+    case ValueType::Kind::kInt: break;
+    }
+    return k_type_int;
+}
+
+FbRef field_table(const std::string &name, uint8_t type_id, FbRef type, std::vector<FbRef> children)
+{
+    return FbTable()
+        .ref(0, fb_string(name))
+        .scalar<uint8_t>(1, 0)
+        .scalar<uint8_t>(2, type_id)
+        .ref(3, std::move(type))
+        .ref(5, fb_tables(std::move(children)))
+        .done();
+}
+
+FbRef schema_table(const std::vector<ColumnSpec> &specs, const std::vector<Long64_t> &fixed_sizes)
+{
+    std::vector<FbRef> fields;
+    for (size_t i = 0; i < specs.size(); ++i)
+    {
+        const ColumnSpec &c = specs[i];
+        if (c.layout == ColumnSpec::Layout::kScalar)
+        {
+            fields.push_back(field_table(c.name, value_type_id(c.value), value_type_table(c.value), {}));
+            continue;
+        }
+
+        FbRef item = field_table("item", value_type_id(c.value), value_type_table(c.value), {});
+        if (c.layout == ColumnSpec::Layout::kFixedList)
+        {
+            FbRef list = FbTable().scalar<int32_t>(0, static_cast<int32_t>(fixed_sizes[i])).done();
+            fields.push_back(field_table(c.name, k_type_fixed_size_list, list, {item}));
+        }
+        else
+        {
+            fields.push_back(field_table(c.name, k_type_large_list, FbTable().done(), {item}));
+        }
+    }
+    return FbTable().scalar<int16_t>(0, 0).ref(1, fb_tables(std::move(fields))).done();
+}
+
+struct Block
+{
+    int64_t offset = 0;
+    int32_t metadata_length = 0;
+    int64_t body_length = 0;
+};
+
+struct BodyBuffer
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+/// Arrow IPC file (Feather v2): magic, schema message, record batches, and
+/// a footer indexing the batches.
+class ArrowFileWriter
+{
+  public:
+    ArrowFileWriter(const std::string &path, FbRef schema)
+        : m_path(path), m_out(path, std::ios::binary | std::ios::trunc), m_schema(std::move(schema))
+    {
+        if (!m_out)
+            throw std::runtime_error("ColumnarExportService: failed to open " + path);
+        write_raw("ARROW1\0\0", 8);
+        write_message(k_header_schema, m_schema, {});
+    }
+
+    /// nodes: (length, null_count) per field in pre-order.
+    void write_batch(Long64_t rows,
+                     const std::vector<std::pair<int64_t, int64_t>> &nodes,
+                     const std::vector<BodyBuffer> &buffers)
+    {
+        std::vector<uint8_t> node_bytes;
+        for (const auto &n : nodes)
+        {
+            put_le<int64_t>(node_bytes, n.first);
+            put_le<int64_t>(node_bytes, n.second);
+        }
+
+        std::vector<uint8_t> buffer_bytes;
+        int64_t offset = 0;
+        for (const auto &b : buffers)
+        {
+            put_le<int64_t>(buffer_bytes, offset);
+            put_le<int64_t>(buffer_bytes, static_cast<int64_t>(b.size));
+            offset += static_cast<int64_t>(padded(b.size));
+        }
+
+        FbRef batch = FbTable()
+                          .scalar<int64_t>(0, rows)
+                          .ref(1, fb_structs(std::move(node_bytes), static_cast<uint32_t>(nodes.size())))
+                          .ref(2, fb_structs(std::move(buffer_bytes), static_cast<uint32_t>(buffers.size())))
+                          .done();
+        m_blocks.push_back(write_message(k_header_record_batch, batch, buffers));
+    }
+
+    void close()
+    {
+        const uint32_t eos[2] = {0xFFFFFFFFu, 0u};
+        write_raw(eos, sizeof(eos));
+
+        std::vector<uint8_t> block_bytes;
+        for (const auto &b : m_blocks)
+        {
+            put_le<int64_t>(block_bytes, b.offset);
+            put_le<int32_t>(block_bytes, b.metadata_length);
+            put_le<int32_t>(block_bytes, 0);
+            put_le<int64_t>(block_bytes, b.body_length);
+        }
+
+        FbRef footer = FbTable()
+                           .scalar<int16_t>(0, k_metadata_v5)
+                           .ref(1, m_schema)
+                           .ref(2, fb_structs({}, 0))
+                           .ref(3, fb_structs(std::move(block_bytes), static_cast<uint32_t>(m_blocks.size())))
+                           .done();
+        const std::vector<uint8_t> fb = FbWriter().finish(footer);
+        write_raw(fb.data(), fb.size());
+        const int32_t footer_size = static_cast<int32_t>(fb.size());
+        write_raw(&footer_size, sizeof(footer_size));
+        write_raw("ARROW1", 6);
+
+        m_out.close();
+        if (!m_out)
+            throw std::runtime_error("ColumnarExportService: failed to write " + m_path);
+    }
+
+  private:
+    static size_t padded(size_t n) { return (n + k_body_alignment - 1) / k_body_alignment * k_body_alignment; }
+
+    void write_raw(const void *data, size_t n)
+    {
+        m_out.write(static_cast<const char *>(data), static_cast<std::streamsize>(n));
+        m_pos += n;
+    }
+
+    Block write_message(uint8_t header_type, FbRef header, const std::vector<BodyBuffer> &body)
+    {
+        int64_t body_length = 0;
+        for (const auto &b : body)
+            body_length += static_cast<int64_t>(padded(b.size));
+
+        FbRef message = FbTable()
+                            .scalar<int16_t>(0, k_metadata_v5)
+                            .scalar<uint8_t>(1, header_type)
+                            .ref(2, std::move(header))
+                            .scalar<int64_t>(3, body_length)
+                            .done();
+        const std::vector<uint8_t> fb = FbWriter().finish(message);
+
+        Block block;
+        block.offset = static_cast<int64_t>(m_pos);
+        block.metadata_length = static_cast<int32_t>(8 + fb.size());
+        block.body_length = body_length;
+
+        const uint32_t continuation = 0xFFFFFFFFu;
+        const int32_t fb_size = static_cast<int32_t>(fb.size());
+        write_raw(&continuation, sizeof(continuation));
+        write_raw(&fb_size, sizeof(fb_size));
+        write_raw(fb.data(), fb.size());
+
+        static const char zeros[k_body_alignment] = {};
+        for (const auto &b : body)
+        {
+            if (b.size)
+                write_raw(b.data, b.size);
+            write_raw(zeros, padded(b.size) - b.size);
+        }
+        return block;
+    }
+
+    std::string m_path;
+    std::ofstream m_out;
+    FbRef m_schema;
+    size_t m_pos = 0;
+    std::vector<Block> m_blocks;
+};
+
+struct ColumnBuffer
+{
+    std::vector<uint8_t> values;
+    std::vector<int64_t> offsets{0};
+    int64_t n_values = 0;
+};
+
+struct SlotState
+{
+    std::vector<ColumnBuffer> columns;
+    Long64_t rows = 0;
+    size_t bytes = 0;
+    std::unique_ptr<ArrowFileWriter> writer;
+    ColumnarExportService::Shard shard;
+};
+
+struct ExportState
+{
+    std::vector<ColumnSpec> specs;
+    std::unique_ptr<std::atomic<Long64_t>[]> fixed_sizes;
+    std::vector<SlotState> slots;
+    ColumnarExportService::Options opt;
+    std::string out_dir;
+    std::string stem;
+
+    std::vector<Long64_t> fixed_size_snapshot() const
+    {
+        std::vector<Long64_t> out(specs.size());
+        for (size_t i = 0; i < specs.size(); ++i)
+            out[i] = fixed_sizes[i].load();
+        return out;
+    }
+};
+
+std::vector<uint8_t> pack_bits(const std::vector<uint8_t> &bytes, int64_t n)
+{
+    std::vector<uint8_t> out(static_cast<size_t>((n + 7) / 8), 0);
+    for (int64_t i = 0; i < n; ++i)
+    {
+        if (bytes[static_cast<size_t>(i)])
+            out[static_cast<size_t>(i / 8)] |= static_cast<uint8_t>(1u << (i % 8));
+    }
+    return out;
+}
+
+/// Writes the slot's buffered rows as one record batch and clears them.
+void flush_slot(ExportState &state, unsigned slot)
+{
+    SlotState &s = state.slots[slot];
+    if (s.rows == 0)
+        return;
+
+    if (!s.writer)
+    {
+        s.shard.path = state.stem + "_" + std::to_string(slot) + ".arrow";
+        const std::string path = (std::filesystem::path(state.out_dir) / s.shard.path).string();
+        s.writer = std::make_unique<ArrowFileWriter>(path, schema_table(state.specs, state.fixed_size_snapshot()));
+    }
+
+    std::vector<std::pair<int64_t, int64_t>> nodes;
+    std::vector<BodyBuffer> buffers;
+    std::vector<std::vector<uint8_t>> packed;
+    packed.reserve(state.specs.size());
+
+    for (size_t i = 0; i < state.specs.size(); ++i)
+    {
+        const ColumnSpec &spec = state.specs[i];
+        const ColumnBuffer &c = s.columns[i];
+
+        nodes.emplace_back(s.rows, 0);
+        buffers.push_back(BodyBuffer{});
+        if (spec.layout != ColumnSpec::Layout::kScalar)
+        {
+            if (spec.layout == ColumnSpec::Layout::kList)
+            {
+                buffers.push_back(BodyBuffer{reinterpret_cast<const uint8_t *>(c.offsets.data()),
+                                             c.offsets.size() * sizeof(int64_t)});
+            }
+            nodes.emplace_back(c.n_values, 0);
+            buffers.push_back(BodyBuffer{});
+        }
+
+        if (spec.value.kind == ValueType::Kind::kBool)
+        {
+            packed.push_back(pack_bits(c.values, c.n_values));
+            buffers.push_back(BodyBuffer{packed.back().data(), packed.back().size()});
+        }
+        else
+        {
+            buffers.push_back(BodyBuffer{c.values.data(), c.values.size()});
+        }
+    }
+
+    s.writer->write_batch(s.rows, nodes, buffers);
+    s.shard.rows += s.rows;
+    ++s.shard.batches;
+
+    for (auto &c : s.columns)
+    {
+        c.values.clear();
+        c.offsets.assign(1, 0);
+        c.n_values = 0;
+    }
+    s.rows = 0;
+    s.bytes = 0;
+}
+
+using State = std::shared_ptr<ExportState>;
+
+template <class T>
+ROOT::RDF::RNode book_scalar(ROOT::RDF::RNode node, const State &state, size_t i,
+                             const std::string &out, const std::string &prev)
+{
+    return node.DefineSlot(
+        out,
+        [state, i](unsigned slot, T v, ULong64_t entry)
+        {
+            SlotState &s = state->slots[slot];
+            ColumnBuffer &c = s.columns[i];
+            const size_t at = c.values.size();
+            c.values.resize(at + sizeof(T));
+            std::memcpy(c.values.data() + at, &v, sizeof(T));
+            ++c.n_values;
+            s.bytes += sizeof(T);
+            return entry;
+        },
+        {state->specs[i].name, prev});
+}
+
+template <class T>
+ROOT::RDF::RNode book_list(ROOT::RDF::RNode node, const State &state, size_t i,
+                           const std::string &out, const std::string &prev)
+{
+    return node.DefineSlot(
+        out,
+        [state, i](unsigned slot, const ROOT::RVec<T> &v, ULong64_t entry)
+        {
+            const ColumnSpec &spec = state->specs[i];
+            const Long64_t n = static_cast<Long64_t>(v.size());
+            if (spec.layout == ColumnSpec::Layout::kFixedList)
+            {
+                Long64_t expected = -1;
+                state->fixed_sizes[i].compare_exchange_strong(expected, n);
+                if (expected >= 0 && expected != n)
+                {
+                    throw std::runtime_error("ColumnarExportService: column " + spec.name + " has "
+                                             + std::to_string(n) + " values, expected "
+                                             + std::to_string(expected));
+                }
+            }
+
+            SlotState &s = state->slots[slot];
+            ColumnBuffer &c = s.columns[i];
+            const size_t at = c.values.size();
+            c.values.resize(at + v.size() * sizeof(T));
+            if (!v.empty())
+                std::memcpy(c.values.data() + at, v.data(), v.size() * sizeof(T));
+            c.n_values += n;
+            c.offsets.push_back(c.n_values);
+            s.bytes += v.size() * sizeof(T) + sizeof(int64_t);
+            return entry;
+        },
+        {state->specs[i].name, prev});
+}
+
+std::string json_escape(const std::string &s)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    for (const char ch : s)
+    {
+        const auto byte = static_cast<unsigned char>(ch);
+        if (byte < 0x20)
+        {
+            out += "\\u00";
+            out += hex[byte >> 4];
+            out += hex[byte & 0xf];
+            continue;
+        }
+        if (ch == '"' || ch == '\\')
+            out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+} // namespace
+
+ColumnarExportService::Manifest ColumnarExportService::write_arrow(ROOT::RDF::RNode node,
+                                                                   const std::string &out_dir,
+                                                                   const std::string &stem,
+                                                                   const std::vector<std::string> &columns,
+                                                                   const Options &opt)
+{
+    if (columns.empty())
+        throw std::runtime_error("ColumnarExportService::write_arrow: no columns requested");
+    if (opt.batch_rows <= 0)
+        throw std::runtime_error("ColumnarExportService::write_arrow: batch_rows must be > 0");
+
+    std::filesystem::create_directories(out_dir);
+
+    auto state = std::make_shared<ExportState>();
+    state->opt = opt;
+    state->out_dir = out_dir;
+    state->stem = stem;
+    state->fixed_sizes = std::make_unique<std::atomic<Long64_t>[]>(columns.size());
+
+    // Each column is appended by a DefineSlot that also takes the previous
+    // one as input, so a row's columns are buffered in order before the
+    // final action counts it.
+    std::string prev = "rdfentry_";
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        const std::string type = node.GetColumnType(columns[i]);
+        const std::string elem = list_element_type(type);
+
+        ColumnSpec spec;
+        spec.name = columns[i];
+        if (!elem.empty())
+        {
+            const bool fixed = std::find(opt.fixed_size_columns.begin(), opt.fixed_size_columns.end(), columns[i])
+                               != opt.fixed_size_columns.end();
+            spec.layout = fixed ? ColumnSpec::Layout::kFixedList : ColumnSpec::Layout::kList;
+        }
+        state->fixed_sizes[i].store(-1);
+
+        const std::string out = "__heron_arrow_" + std::to_string(i);
+        visit_value_type(elem.empty() ? type : elem,
+                         [&](auto tag)
+                         {
+                             using T = typename decltype(tag)::type;
+                             spec.value = value_type_of<T>();
+                             state->specs.push_back(spec);
+                             node = elem.empty() ? book_scalar<T>(node, state, i, out, prev)
+                                                 : book_list<T>(node, state, i, out, prev);
+                         });
+        prev = out;
+    }
+
+    const unsigned n_slots = node.GetNSlots();
+    state->slots.resize(n_slots);
+    for (auto &s : state->slots)
+        s.columns.resize(columns.size());
+
+    node.ForeachSlot(
+        [state](unsigned slot, ULong64_t)
+        {
+            // Batches only end on batch_rows boundaries: the first one
+            // reached with chunk_bytes buffered closes the batch.
+            SlotState &s = state->slots[slot];
+            ++s.rows;
+            if (s.rows % state->opt.batch_rows != 0)
+                return;
+            if (s.bytes >= state->opt.chunk_bytes)
+                flush_slot(*state, slot);
+        },
+        {prev});
+
+    // Remaining rows of every shard, and the footers, in parallel.
+    std::vector<std::exception_ptr> errors(n_slots);
+    std::vector<std::thread> workers;
+    for (unsigned slot = 0; slot < n_slots; ++slot)
+    {
+        workers.emplace_back(
+            [&state, &errors, slot]()
+            {
+                try
+                {
+                    flush_slot(*state, slot);
+                    SlotState &s = state->slots[slot];
+                    if (s.writer)
+                        s.writer->close();
+                    // The graph keeps `state` alive; drop the slot's buffers
+                    // and writer now rather than with the last node.
+                    std::vector<ColumnBuffer>().swap(s.columns);
+                    s.writer.reset();
+                }
+                catch (...)
+                {
+                    errors[slot] = std::current_exception();
+                }
+            });
+    }
+    for (auto &w : workers)
+        w.join();
+    for (const auto &e : errors)
+    {
+        if (e)
+            std::rethrow_exception(e);
+    }
+
+    Manifest manifest;
+    manifest.batch_rows = opt.batch_rows;
+    const std::vector<Long64_t> fixed_sizes = state->fixed_size_snapshot();
+    for (size_t i = 0; i < state->specs.size(); ++i)
+    {
+        const ColumnSpec &spec = state->specs[i];
+        std::string type = spec.value.name();
+        if (spec.layout == ColumnSpec::Layout::kFixedList)
+        {
+            // No row was seen (and no shard written) without a length.
+            type = "fixed_size_list<" + type + ">";
+            if (fixed_sizes[i] >= 0)
+                type += "[" + std::to_string(fixed_sizes[i]) + "]";
+        }
+        else if (spec.layout == ColumnSpec::Layout::kList)
+            type = "large_list<" + type + ">";
+        manifest.columns.push_back(Column{spec.name, type});
+    }
+    for (const auto &s : state->slots)
+    {
+        if (s.shard.rows == 0)
+            continue;
+        manifest.shards.push_back(s.shard);
+        manifest.rows += s.shard.rows;
+    }
+
+    write_manifest(manifest, (std::filesystem::path(out_dir) / (stem + "_manifest.json")).string());
+    return manifest;
+}
+
+void ColumnarExportService::write_manifest(const Manifest &manifest, const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("ColumnarExportService::write_manifest: failed to open " + path);
+
+    out << "{\n"
+        << "  \"format\": \"arrow_ipc_file\",\n"
+        << "  \"rows\": " << manifest.rows << ",\n"
+        << "  \"batch_rows\": " << manifest.batch_rows << ",\n"
+        << "  \"columns\": [\n";
+    for (size_t i = 0; i < manifest.columns.size(); ++i)
+    {
+        const auto &c = manifest.columns[i];
+        out << "    {\"name\": \"" << json_escape(c.name) << "\", \"type\": \"" << json_escape(c.type) << "\"}"
+            << (i + 1 < manifest.columns.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n"
+        << "  \"shards\": [\n";
+    for (size_t i = 0; i < manifest.shards.size(); ++i)
+    {
+        const auto &s = manifest.shards[i];
+        out << "    {\"path\": \"" << json_escape(s.path) << "\", \"rows\": " << s.rows
+            << ", \"batches\": " << s.batches << "}" << (i + 1 < manifest.shards.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n"
+        << "}\n";
+}
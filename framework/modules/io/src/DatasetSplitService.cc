@@ -0,0 +1,381 @@
+#include "DatasetSplitService.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <Compression.h>
+#include <ROOT/RSnapshotOptions.hxx>
+
+#include "EventListIO.hh"
+
+namespace
+{
+const char *const k_hash_column = "__heron_split_hash";
+const char *const k_split_column = "__heron_split";
+const char *const k_shard_column = "__heron_shard";
+
+// Salts that derive the shard and keep decisions from the event hash, so they
+// are independent of the bits that pick the split.
+constexpr std::uint64_t k_shard_salt = 0x5348415244ULL;
+constexpr std::uint64_t k_keep_salt = 0x4b454550ULL;
+
+/// splitmix64 finaliser.
+std::uint64_t mix64(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/// Uniform in [0, 1) from the top 53 bits.
+double unit_interval(std::uint64_t h)
+{
+    return static_cast<double>(h >> 11) * 0x1.0p-53;
+}
+
+bool valid_split_name(const std::string &name)
+{
+    if (name.empty())
+        return false;
+    return std::all_of(name.begin(), name.end(), [](char c)
+                       { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-'; });
+}
+
+std::string json_escape(const std::string &s)
+{
+    std::string out;
+    out.reserve(s.size());
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+using ClassCounts = std::map<int, ULong64_t>;
+
+/// Lazy per-class event count of the integer column `column`.
+ROOT::RDF::RResultPtr<ClassCounts> count_classes(ROOT::RDF::RNode node, const std::string &column)
+{
+    return node.Aggregate([](ClassCounts &acc, int cls) { ++acc[cls]; },
+                          [](std::vector<ClassCounts> &all)
+                          {
+                              for (size_t i = 1; i < all.size(); ++i)
+                              {
+                                  for (const auto &kv : all[i])
+                                      all.front()[kv.first] += kv.second;
+                              }
+                          },
+                          column,
+                          ClassCounts{});
+}
+
+/// Event tree and friend columns under their plain names; friends show up as
+/// "<tree>.<column>" too, which is left out.
+std::vector<std::string> snapshot_columns(ROOT::RDF::RNode node, const nu::EventListIO &in)
+{
+    std::set<std::string> friend_trees;
+    for (const auto &fr : in.friends())
+        friend_trees.insert(fr.tree);
+
+    std::vector<std::string> out;
+    std::set<std::string> seen;
+    auto add = [&](const std::string &c)
+    {
+        if (seen.insert(c).second)
+            out.push_back(c);
+    };
+    for (const auto &c : node.GetColumnNames())
+    {
+        const auto dot = c.find('.');
+        if (c.rfind("__heron_", 0) == 0)
+            continue;
+        if (dot == std::string::npos)
+            add(c);
+        else if (friend_trees.count(c.substr(0, dot)))
+            add(c.substr(dot + 1));
+    }
+    return out;
+}
+}
+
+std::uint64_t DatasetSplitService::event_hash(int run, int sub, int evt, std::uint64_t seed)
+{
+    std::uint64_t h = mix64(seed);
+    h = mix64(h ^ static_cast<std::uint32_t>(run));
+    h = mix64(h ^ static_cast<std::uint32_t>(sub));
+    h = mix64(h ^ static_cast<std::uint32_t>(evt));
+    return h;
+}
+
+int DatasetSplitService::split_index(std::uint64_t hash, const std::vector<double> &cumulative)
+{
+    const double u = unit_interval(hash);
+    for (size_t i = 0; i < cumulative.size(); ++i)
+    {
+        if (u < cumulative[i])
+            return static_cast<int>(i);
+    }
+    return static_cast<int>(cumulative.size()) - 1;
+}
+
+int DatasetSplitService::shard_index(std::uint64_t hash, int n_shards)
+{
+    return static_cast<int>(mix64(hash ^ k_shard_salt) % static_cast<std::uint64_t>(n_shards));
+}
+
+bool DatasetSplitService::keep_event(std::uint64_t hash, double keep_fraction)
+{
+    if (keep_fraction >= 1.0)
+        return true;
+    return unit_interval(mix64(hash ^ k_keep_salt)) < keep_fraction;
+}
+
+std::map<int, double> DatasetSplitService::balanced_keep_fractions(const std::map<int, ULong64_t> &class_counts)
+{
+    ULong64_t smallest = 0;
+    for (const auto &kv : class_counts)
+    {
+        if (kv.second > 0 && (smallest == 0 || kv.second < smallest))
+            smallest = kv.second;
+    }
+
+    std::map<int, double> out;
+    for (const auto &kv : class_counts)
+    {
+        if (kv.second > 0)
+            out[kv.first] = static_cast<double>(smallest) / static_cast<double>(kv.second);
+    }
+    return out;
+}
+
+DatasetSplitService::Manifest DatasetSplitService::split_event_list(const std::string &event_list_root,
+                                                                    const std::string &out_dir,
+                                                                    const std::string &selection,
+                                                                    const Options &opt)
+{
+    if (opt.splits.empty())
+        throw std::runtime_error("DatasetSplitService::split_event_list: no splits configured");
+    if (opt.n_shards < 1)
+        throw std::runtime_error("DatasetSplitService::split_event_list: n_shards must be positive");
+
+    double total = 0.0;
+    std::set<std::string> names;
+    for (const auto &s : opt.splits)
+    {
+        if (!valid_split_name(s.name) || !names.insert(s.name).second)
+            throw std::runtime_error("DatasetSplitService::split_event_list: bad or repeated split name '" + s.name
+                                     + "'");
+        if (!(s.fraction >= 0.0) || !std::isfinite(s.fraction))
+            throw std::runtime_error("DatasetSplitService::split_event_list: bad fraction for split " + s.name);
+        total += s.fraction;
+    }
+    if (!(total > 0.0))
+        throw std::runtime_error("DatasetSplitService::split_event_list: split fractions sum to zero");
+
+    std::vector<double> cumulative;
+    double running = 0.0;
+    for (const auto &s : opt.splits)
+    {
+        running += s.fraction / total;
+        cumulative.push_back(running);
+    }
+    cumulative.back() = 1.0;
+
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    if (ec)
+        throw std::runtime_error("DatasetSplitService::split_event_list: failed to create " + out_dir + " ("
+                                 + ec.message() + ")");
+
+    const nu::EventListIO in = nu::EventListIO::read(event_list_root);
+    ROOT::RDF::RNode node = in.rdf(selection);
+    const std::vector<std::string> columns = snapshot_columns(node, in);
+
+    const bool use_classes = !opt.class_column.empty();
+    if (!use_classes && (!opt.class_keep_fraction.empty() || opt.balance_classes))
+        throw std::runtime_error("DatasetSplitService::split_event_list: class balancing needs class_column");
+
+    // Balancing needs the class totals before any event is assigned, so they
+    // come from a loop of their own that reads only the class column (and
+    // whatever the selection reads).
+    std::map<int, double> keep = opt.class_keep_fraction;
+    if (opt.balance_classes)
+    {
+        keep = balanced_keep_fractions(*count_classes(node, opt.class_column));
+        std::cerr << "[DatasetSplitService] stage=balance"
+                  << " input=" << event_list_root
+                  << " classes=" << keep.size()
+                  << "\n";
+    }
+
+    // The split, shard and keep decisions read only the event's own id, so an
+    // event lands in the same place whatever else the skim contains.
+    const std::uint64_t seed = opt.seed;
+    node = node.Define(k_hash_column,
+                       [seed](int run, int sub, int evt) -> ULong64_t { return event_hash(run, sub, evt, seed); },
+                       {"run", "sub", "evt"});
+    if (use_classes)
+    {
+        node = node.Define(k_split_column,
+                           [cumulative, keep](ULong64_t h, int cls)
+                           {
+                               const auto it = keep.find(cls);
+                               if (it != keep.end() && !keep_event(h, it->second))
+                                   return -1;
+                               return split_index(h, cumulative);
+                           },
+                           {k_hash_column, opt.class_column});
+    }
+    else
+    {
+        node = node.Define(k_split_column, [cumulative](ULong64_t h) { return split_index(h, cumulative); },
+                           {k_hash_column});
+    }
+    const int n_shards = opt.n_shards;
+    node = node.Define(k_shard_column, [n_shards](ULong64_t h) { return shard_index(h, n_shards); },
+                       {k_hash_column});
+
+    nu::EventListHeader header = in.header();
+    header.sample_list_source = event_list_root;
+    header.event_output_dir = out_dir;
+
+    std::vector<nu::SampleInfo> refs(static_cast<size_t>(in.max_sample_id() + 1));
+    for (const auto &kv : in.sample_refs())
+        refs[static_cast<size_t>(kv.first)] = kv.second;
+    const std::map<std::string, std::string> schemas = in.event_schemas();
+
+    ROOT::RDF::RSnapshotOptions options;
+    options.fMode = "UPDATE";
+    options.fOverwriteIfExists = true;
+    options.fLazy = true;
+    options.fCompressionAlgorithm = ROOT::kLZ4;
+    options.fCompressionLevel = 1;
+    options.fAutoFlush = -50LL * 1024 * 1024;
+    options.fSplitLevel = 0;
+
+    const std::string tree_name = in.event_tree();
+
+    Manifest manifest;
+    manifest.input = event_list_root;
+    manifest.seed = opt.seed;
+    manifest.n_shards = opt.n_shards;
+    manifest.class_column = opt.class_column;
+    manifest.class_keep_fraction = keep;
+
+    // Everything below is booked lazily, so one event loop fills every shard
+    // of every split, each written by RDataFrame's per-slot buffers.
+    std::vector<ROOT::RDF::RResultPtr<ULong64_t>> shard_counts;
+    std::vector<ROOT::RDF::RResultPtr<ClassCounts>> class_counts;
+    std::vector<ROOT::RDF::RResultPtr<ROOT::RDF::RInterface<ROOT::Detail::RDF::RLoopManager>>> snapshots;
+    for (size_t k = 0; k < opt.splits.size(); ++k)
+    {
+        SplitSummary summary;
+        summary.name = opt.splits[k].name;
+        summary.fraction = opt.splits[k].fraction / total;
+
+        const int split = static_cast<int>(k);
+        auto in_split = node.Filter([split](int s) { return s == split; }, {k_split_column});
+        if (use_classes)
+            class_counts.push_back(count_classes(in_split, opt.class_column));
+
+        for (int s = 0; s < opt.n_shards; ++s)
+        {
+            const std::string path =
+                (std::filesystem::path(out_dir) / (summary.name + "_" + std::to_string(s) + ".root")).string();
+            nu::EventListIO::init(path, header, refs, schemas);
+
+            auto in_shard = in_split.Filter([s](int shard) { return shard == s; }, {k_shard_column});
+            shard_counts.push_back(in_shard.Count());
+            snapshots.push_back(in_shard.Snapshot(tree_name, path, columns, options));
+
+            Shard shard;
+            shard.path = path;
+            summary.shards.push_back(std::move(shard));
+        }
+        manifest.splits.push_back(std::move(summary));
+    }
+    auto dropped = node.Filter([](int s) { return s < 0; }, {k_split_column}).Count();
+
+    std::cerr << "[DatasetSplitService] stage=split_run"
+              << " input=" << event_list_root
+              << " splits=" << opt.splits.size()
+              << " shards=" << opt.n_shards
+              << " columns=" << columns.size()
+              << "\n";
+    manifest.rows_dropped = *dropped;
+
+    for (size_t k = 0, i = 0; k < manifest.splits.size(); ++k)
+    {
+        auto &summary = manifest.splits[k];
+        for (auto &shard : summary.shards)
+        {
+            shard.rows = *shard_counts[i++];
+            summary.rows += shard.rows;
+        }
+        if (use_classes)
+            summary.class_counts = *class_counts[k];
+    }
+
+    write_manifest(manifest, (std::filesystem::path(out_dir) / "split_manifest.json").string());
+    return manifest;
+}
+
+void DatasetSplitService::write_manifest(const Manifest &manifest, const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("DatasetSplitService::write_manifest: failed to open " + path);
+
+    out << "{\n"
+        << "  \"input\": \"" << json_escape(manifest.input) << "\",\n"
+        << "  \"key\": [\"run\", \"sub\", \"evt\"],\n"
+        << "  \"hash\": \"splitmix64\",\n"
+        << "  \"seed\": " << manifest.seed << ",\n"
+        << "  \"n_shards\": " << manifest.n_shards << ",\n"
+        << "  \"class_column\": \"" << json_escape(manifest.class_column) << "\",\n"
+        << "  \"rows_dropped\": " << manifest.rows_dropped << ",\n"
+        << "  \"class_keep_fraction\": {";
+    size_t n_keep = 0;
+    for (const auto &kv : manifest.class_keep_fraction)
+        out << (n_keep++ ? ", " : "") << "\"" << kv.first << "\": " << kv.second;
+    out << "},\n"
+        << "  \"splits\": [\n";
+    for (size_t k = 0; k < manifest.splits.size(); ++k)
+    {
+        const auto &s = manifest.splits[k];
+        out << "    {\n"
+            << "      \"name\": \"" << json_escape(s.name) << "\",\n"
+            << "      \"fraction\": " << s.fraction << ",\n"
+            << "      \"rows\": " << s.rows << ",\n"
+            << "      \"class_counts\": {";
+        size_t c = 0;
+        for (const auto &kv : s.class_counts)
+            out << (c++ ? ", " : "") << "\"" << kv.first << "\": " << kv.second;
+        out << "},\n"
+            << "      \"shards\": [\n";
+        for (size_t i = 0; i < s.shards.size(); ++i)
+        {
+            out << "        {\"path\": \"" << json_escape(s.shards[i].path) << "\", \"rows\": " << s.shards[i].rows
+                << "}" << (i + 1 < s.shards.size() ? ",\n" : "\n");
+        }
+        out << "      ]\n"
+            << "    }" << (k + 1 < manifest.splits.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n"
+        << "}\n";
+}
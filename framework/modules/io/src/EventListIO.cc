@@ -1,15 +1,25 @@
 #include "EventListIO.hh"
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <tuple>
 #include <stdexcept>
 #include <string>
 #include <system_error>
 #include <utility>
 #include <vector>
 
+#include <TChain.h>
+#include <TEntryList.h>
 #include <TFile.h>
+#include <TKey.h>
 #include <TObjString.h>
 #include <TTree.h>
 
@@ -28,6 +38,96 @@ std::string read_objstring_optional(TFile &f, const char *key)
     return s->GetString().Data();
 }
 
+const char *const k_event_index_tree = "event_index";
+const char *const k_event_friends_key = "event_friends";
+
+std::vector<nu::EventFriend> parse_friends(const std::string &text)
+{
+    std::vector<nu::EventFriend> out;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty())
+            continue;
+        const auto tab = line.find('\t');
+        nu::EventFriend fr;
+        fr.tree = line.substr(0, tab);
+        if (tab != std::string::npos)
+            fr.file = line.substr(tab + 1);
+        out.push_back(std::move(fr));
+    }
+    return out;
+}
+
+bool key_less(const nu::EventIndexEntry &a, const nu::EventIndexEntry &b)
+{
+    return std::tie(a.run, a.sub, a.evt) < std::tie(b.run, b.sub, b.evt);
+}
+
+// Chains (and entry list) behind a node. Members are destroyed bottom-up, so
+// the event chain goes before the friends and entry list it points at.
+struct ChainSource
+{
+    std::unique_ptr<TEntryList> entries;
+    std::vector<std::shared_ptr<TChain>> friends;
+    std::shared_ptr<TChain> chain;
+};
+
+std::shared_ptr<ChainSource> make_chain_source(const std::string &path,
+                                               const std::string &tree,
+                                               const std::vector<nu::EventFriend> &friends,
+                                               const std::string &skip)
+{
+    const std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    auto src = std::make_shared<ChainSource>();
+    src->chain = std::make_shared<TChain>(tree.c_str());
+    src->chain->Add(path.c_str());
+    for (const auto &fr : friends)
+    {
+        if (fr.tree == skip)
+            continue;
+        const std::string file = fr.file.empty() ? path : (dir / fr.file).string();
+        auto friend_chain = std::make_shared<TChain>(fr.tree.c_str());
+        friend_chain->Add(file.c_str());
+        src->chain->AddFriend(friend_chain.get());
+        src->friends.push_back(std::move(friend_chain));
+    }
+    return src;
+}
+
+// The RDataFrame only points at the chain; the pass-through filter's closure
+// keeps the source alive for as long as any node or result built on it.
+ROOT::RDF::RNode chain_source_node(std::shared_ptr<ChainSource> src)
+{
+    ROOT::RDF::RNode node = ROOT::RDataFrame(*src->chain);
+    return node.Filter([src]() { return true; }, {});
+}
+
+// Event tree restricted to `ranges` (sorted, disjoint) through a TEntryList
+// on the chain, so the event loop, serial or under implicit MT, only visits
+// those entries.
+ROOT::RDF::RNode entry_range_node(const std::string &path,
+                                  const std::string &tree,
+                                  const std::vector<nu::EventFriend> &friends,
+                                  const std::vector<SnapshotService::EntryRange> &ranges)
+{
+    auto src = make_chain_source(path, tree, friends, "");
+    ROOT::RDF::RNode node = chain_source_node(src);
+    // An empty entry list reads as "no list"; reject everything instead.
+    if (ranges.empty())
+        return node.Filter([]() { return false; }, {}, "entry_list");
+    // One range over the whole tree needs no list.
+    if (ranges.size() == 1 && ranges.front().first == 0 && ranges.front().second >= src->chain->GetEntries())
+        return node;
+
+    src->entries = std::make_unique<TEntryList>();
+    for (const auto &r : ranges)
+        src->entries->EnterRange(r.first, r.second, src->chain.get());
+    src->chain->SetEntryList(src->entries.get());
+    return node;
+}
+
 }
 
 namespace nu
@@ -114,13 +214,30 @@ void EventListIO::init(const std::string &out_path,
     fout->Close();
 }
 
+void EventListIO::init(const std::string &out_path,
+                       const EventListHeader &header,
+                       const std::vector<SampleInfo> &sample_refs,
+                       const std::map<std::string, std::string> &event_schemas)
+{
+    init(out_path, header, sample_refs, std::string(), std::string());
+    if (event_schemas.empty())
+        return;
+
+    std::unique_ptr<TFile> fout(TFile::Open(out_path.c_str(), "UPDATE"));
+    if (!fout || fout->IsZombie())
+        throw std::runtime_error("EventListIO::init: failed to open " + out_path);
+    for (const auto &kv : event_schemas)
+        TObjString(kv.second.c_str()).Write(kv.first.c_str(), TObject::kOverwrite);
+    fout->Close();
+}
+
 EventListIO EventListIO::read(std::string path)
 {
     return EventListIO(std::move(path), OpenMode::kRead);
 }
 
 EventListIO::EventListIO(std::string path, OpenMode mode)
-    : m_path(std::move(path)), m_mode(mode)
+    : m_path(std::move(path)), m_mode(mode), m_chain(std::make_shared<EventChain>())
 {
     const char *opt = (m_mode == OpenMode::kRead) ? "READ" : "UPDATE";
     std::unique_ptr<TFile> fin(TFile::Open(m_path.c_str(), opt));
@@ -133,6 +250,7 @@ EventListIO::EventListIO(std::string path, OpenMode mode)
     m_header.sample_list_source = read_objstring_optional(*fin, "sample_list_source");
     m_header.heron_set = read_objstring_optional(*fin, "heron_set");
     m_header.event_output_dir = read_objstring_optional(*fin, "event_output_dir");
+    m_friends = parse_friends(read_objstring_optional(*fin, k_event_friends_key));
 
     auto *t = dynamic_cast<TTree *>(fin->Get("sample_refs"));
     if (!t)
@@ -185,6 +303,25 @@ std::string EventListIO::event_tree() const
     return m_header.event_tree.empty() ? "events" : m_header.event_tree;
 }
 
+std::map<std::string, std::string> EventListIO::event_schemas() const
+{
+    std::unique_ptr<TFile> f(TFile::Open(m_path.c_str(), "READ"));
+    if (!f || f->IsZombie())
+        throw std::runtime_error("EventListIO: failed to open " + m_path);
+
+    std::map<std::string, std::string> out;
+    TIter next(f->GetListOfKeys());
+    while (auto *key = dynamic_cast<TKey *>(next()))
+    {
+        const std::string name = key->GetName();
+        if (name.rfind("event_schema", 0) != 0 || out.count(name))
+            continue;
+        if (auto *s = dynamic_cast<TObjString *>(f->Get(name.c_str())))
+            out.emplace(name, s->GetString().Data());
+    }
+    return out;
+}
+
 std::string EventListIO::sample_tree_name(const std::string &sample_name,
                                           const std::string &tree_prefix) const
 {
@@ -224,9 +361,117 @@ ULong64_t EventListIO::snapshot_event_list(ROOT::RDF::RNode node,
                                                 overwrite_if_exists);
 }
 
-ROOT::RDataFrame EventListIO::rdf() const
+// Built on the first rdf() and shared by copies of the EventListIO; each
+// node returned holds the source as well.
+struct EventListIO::EventChain
+{
+    std::once_flag once;
+    std::shared_ptr<ChainSource> source;
+};
+
+ROOT::RDF::RNode EventListIO::rdf() const
+{
+    if (m_friends.empty())
+        return ROOT::RDataFrame(event_tree(), m_path);
+
+    std::call_once(m_chain->once,
+                   [this]() { m_chain->source = make_chain_source(m_path, event_tree(), m_friends, ""); });
+    return chain_source_node(m_chain->source);
+}
+
+ROOT::RDF::RNode EventListIO::rdf_without_friend(const std::string &skip) const
+{
+    const bool attach = std::any_of(m_friends.begin(), m_friends.end(),
+                                    [&](const EventFriend &fr) { return fr.tree != skip; });
+    if (!attach)
+        return ROOT::RDataFrame(event_tree(), m_path);
+    return chain_source_node(make_chain_source(m_path, event_tree(), m_friends, skip));
+}
+
+void EventListIO::add_friend(const EventFriend &fr,
+                             const std::vector<std::pair<std::string, std::string>> &schema_columns)
+{
+    if (m_mode != OpenMode::kUpdate)
+        throw std::runtime_error("EventListIO::add_friend: " + m_path + " is not open for update");
+
+    const std::string file =
+        fr.file.empty() ? m_path : (std::filesystem::path(m_path).parent_path() / fr.file).string();
+    Long64_t n_friend = -1;
+    {
+        std::unique_ptr<TFile> ffriend(TFile::Open(file.c_str(), "READ"));
+        auto *t = (ffriend && !ffriend->IsZombie()) ? dynamic_cast<TTree *>(ffriend->Get(fr.tree.c_str())) : nullptr;
+        if (!t)
+            throw std::runtime_error("EventListIO::add_friend: missing tree " + fr.tree + " in " + file);
+        n_friend = t->GetEntries();
+    }
+
+    std::unique_ptr<TFile> f(TFile::Open(m_path.c_str(), "UPDATE"));
+    if (!f || f->IsZombie())
+        throw std::runtime_error("EventListIO::add_friend: failed to open " + m_path);
+
+    auto *events = dynamic_cast<TTree *>(f->Get(event_tree().c_str()));
+    if (!events || events->GetEntries() != n_friend)
+    {
+        throw std::runtime_error("EventListIO::add_friend: " + fr.tree + " has " + std::to_string(n_friend)
+                                 + " entries, not aligned with " + event_tree());
+    }
+
+    std::vector<EventFriend> updated;
+    for (const auto &existing : m_friends)
+    {
+        if (existing.tree != fr.tree)
+            updated.push_back(existing);
+    }
+    updated.push_back(fr);
+
+    std::ostringstream friends_text;
+    for (const auto &e : updated)
+        friends_text << e.tree << "\t" << e.file << "\n";
+
+    f->cd();
+    TObjString(friends_text.str().c_str()).Write(k_event_friends_key, TObject::kOverwrite);
+
+    // Each recorded schema gains the new columns (replacing same-named ones).
+    std::vector<std::string> schema_keys;
+    TIter next(f->GetListOfKeys());
+    while (auto *key = dynamic_cast<TKey *>(next()))
+    {
+        const std::string name = key->GetName();
+        if (name.rfind("event_schema", 0) == 0 &&
+            std::find(schema_keys.begin(), schema_keys.end(), name) == schema_keys.end())
+            schema_keys.push_back(name);
+    }
+    for (const auto &key : schema_keys)
+    {
+        std::istringstream in(read_objstring_optional(*f, key.c_str()));
+        std::ostringstream out;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            const auto tab = line.find('\t');
+            const std::string name = (tab == std::string::npos) ? line : line.substr(tab + 1);
+            const bool replaced = std::any_of(schema_columns.begin(), schema_columns.end(),
+                                              [&](const auto &c) { return c.second == name; });
+            if (!line.empty() && !replaced)
+                out << line << "\n";
+        }
+        for (const auto &c : schema_columns)
+            out << c.first << "\t" << c.second << "\n";
+        TObjString(out.str().c_str()).Write(key.c_str(), TObject::kOverwrite);
+    }
+
+    f->Close();
+    m_friends = std::move(updated);
+    m_chain = std::make_shared<EventChain>();
+}
+
+ROOT::RDF::RNode EventListIO::rdf(const std::string &selection) const
 {
-    return ROOT::RDataFrame(event_tree(), m_path);
+    if (selection.empty() || selection == "true")
+        return rdf();
+
+    const auto ranges = SnapshotService::zone_map_ranges(m_path, event_tree(), selection);
+    return entry_range_node(m_path, event_tree(), m_friends, ranges).Filter(selection, "selection");
 }
 
 std::shared_ptr<const std::vector<char>> EventListIO::mask_for_origin(SampleIO::SampleOrigin origin) const
@@ -317,4 +562,207 @@ std::string EventListIO::beamline_label() const
     return "unknown";
 }
 
+Long64_t EventListIO::build_event_index() const
+{
+    if (m_mode != OpenMode::kUpdate)
+        throw std::runtime_error("EventListIO::build_event_index: " + m_path + " is not open for update");
+
+    std::unique_ptr<TFile> f(TFile::Open(m_path.c_str(), "UPDATE"));
+    if (!f || f->IsZombie())
+        throw std::runtime_error("EventListIO::build_event_index: failed to open " + m_path);
+
+    auto *events = dynamic_cast<TTree *>(f->Get(event_tree().c_str()));
+    if (!events)
+        throw std::runtime_error("EventListIO::build_event_index: missing " + event_tree() + " tree in " + m_path);
+
+    for (const char *b : {"run", "sub", "evt", "sample_id"})
+    {
+        if (!events->GetBranch(b))
+            throw std::runtime_error(std::string("EventListIO::build_event_index: missing branch ") + b);
+    }
+
+    int run = 0;
+    int sub = 0;
+    int evt = 0;
+    int sample_id = -1;
+    events->SetBranchStatus("*", 0);
+    for (const char *b : {"run", "sub", "evt", "sample_id"})
+        events->SetBranchStatus(b, 1);
+    events->SetBranchAddress("run", &run);
+    events->SetBranchAddress("sub", &sub);
+    events->SetBranchAddress("evt", &evt);
+    events->SetBranchAddress("sample_id", &sample_id);
+
+    const Long64_t n = events->GetEntries();
+    auto index = std::make_shared<std::vector<EventIndexEntry>>();
+    index->reserve(static_cast<size_t>(n));
+    for (Long64_t i = 0; i < n; ++i)
+    {
+        events->GetEntry(i);
+        index->push_back(EventIndexEntry{run, sub, evt, sample_id, i});
+    }
+    events->ResetBranchAddresses();
+
+    // Entries of one event id stay in tree order, hence sample order.
+    std::stable_sort(index->begin(), index->end(), key_less);
+
+    f->cd();
+    TTree tindex(k_event_index_tree, "Sorted (run, sub, evt) -> (sample_id, entry) over the event tree");
+    EventIndexEntry row;
+    tindex.Branch("run", &row.run);
+    tindex.Branch("sub", &row.sub);
+    tindex.Branch("evt", &row.evt);
+    tindex.Branch("sample_id", &row.sample_id);
+    tindex.Branch("entry", &row.entry);
+    for (const auto &e : *index)
+    {
+        row = e;
+        tindex.Fill();
+    }
+    tindex.Write(nullptr, TObject::kOverwrite);
+    f->Close();
+
+    m_event_index = std::move(index);
+    return n;
+}
+
+Long64_t EventListIO::build_zone_maps(const std::vector<std::string> &columns) const
+{
+    if (m_mode != OpenMode::kUpdate)
+        throw std::runtime_error("EventListIO::build_zone_maps: " + m_path + " is not open for update");
+    return SnapshotService::build_zone_maps(m_path, event_tree(), columns);
+}
+
+bool EventListIO::has_event_index() const
+{
+    if (m_event_index)
+        return true;
+
+    std::unique_ptr<TFile> f(TFile::Open(m_path.c_str(), "READ"));
+    return f && !f->IsZombie() && dynamic_cast<TTree *>(f->Get(k_event_index_tree)) != nullptr;
+}
+
+const std::vector<EventIndexEntry> &EventListIO::event_index() const
+{
+    if (m_event_index)
+        return *m_event_index;
+
+    std::unique_ptr<TFile> f(TFile::Open(m_path.c_str(), "READ"));
+    if (!f || f->IsZombie())
+        throw std::runtime_error("EventListIO: failed to open " + m_path);
+
+    auto *t = dynamic_cast<TTree *>(f->Get(k_event_index_tree));
+    if (!t)
+        throw std::runtime_error("EventListIO: no event_index tree in " + m_path + "; run build_event_index first");
+
+    EventIndexEntry row;
+    t->SetBranchAddress("run", &row.run);
+    t->SetBranchAddress("sub", &row.sub);
+    t->SetBranchAddress("evt", &row.evt);
+    t->SetBranchAddress("sample_id", &row.sample_id);
+    t->SetBranchAddress("entry", &row.entry);
+
+    const Long64_t n = t->GetEntries();
+    auto index = std::make_shared<std::vector<EventIndexEntry>>();
+    index->reserve(static_cast<size_t>(n));
+    for (Long64_t i = 0; i < n; ++i)
+    {
+        t->GetEntry(i);
+        index->push_back(row);
+    }
+    t->ResetBranchAddresses();
+
+    if (!std::is_sorted(index->begin(), index->end(), key_less))
+        throw std::runtime_error("EventListIO: event_index in " + m_path + " is not sorted");
+
+    m_event_index = std::move(index);
+    return *m_event_index;
+}
+
+std::vector<EventIndexEntry> EventListIO::lookup(int run, int sub, int evt) const
+{
+    const auto &index = event_index();
+    EventIndexEntry key;
+    key.run = run;
+    key.sub = sub;
+    key.evt = evt;
+    const auto range = std::equal_range(index.begin(), index.end(), key, key_less);
+    return std::vector<EventIndexEntry>(range.first, range.second);
+}
+
+std::vector<EventIndexEntry> EventListIO::lookup(const std::vector<EventKey> &keys) const
+{
+    std::vector<EventIndexEntry> out;
+    for (const auto &k : keys)
+    {
+        auto found = lookup(k.run, k.sub, k.evt);
+        if (found.empty())
+        {
+            std::cerr << "[EventListIO] event not found: run=" << k.run
+                      << " sub=" << k.sub
+                      << " evt=" << k.evt
+                      << "\n";
+        }
+        out.insert(out.end(), found.begin(), found.end());
+    }
+    return out;
+}
+
+ROOT::RDF::RNode EventListIO::rdf_for_events(const std::vector<EventKey> &keys) const
+{
+    const auto found = lookup(keys);
+    std::vector<Long64_t> entries;
+    entries.reserve(found.size());
+    for (const auto &e : found)
+        entries.push_back(e.entry);
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    std::vector<SnapshotService::EntryRange> ranges;
+    for (Long64_t e : entries)
+    {
+        if (!ranges.empty() && ranges.back().second == e)
+            ++ranges.back().second;
+        else
+            ranges.emplace_back(e, e + 1);
+    }
+    return entry_range_node(m_path, event_tree(), m_friends, ranges);
+}
+
+ROOT::RDF::RNode EventListIO::rdf_for_events(const std::string &event_list_path) const
+{
+    return rdf_for_events(read_event_keys(event_list_path));
+}
+
+std::vector<EventKey> EventListIO::read_event_keys(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("EventListIO::read_event_keys: failed to open " + path);
+
+    std::vector<EventKey> keys;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line))
+    {
+        ++line_no;
+        const auto hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        std::replace(line.begin(), line.end(), ',', ' ');
+
+        std::istringstream iss(line);
+        EventKey k;
+        if (!(iss >> k.run))
+            continue;
+        if (!(iss >> k.sub >> k.evt))
+        {
+            throw std::runtime_error("EventListIO::read_event_keys: expected run sub evt at "
+                                     + path + ":" + std::to_string(line_no));
+        }
+        keys.push_back(k);
+    }
+    return keys;
+}
+
 }
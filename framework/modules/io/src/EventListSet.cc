@@ -0,0 +1,391 @@
+#include "EventListSet.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <TBranch.h>
+#include <TChain.h>
+#include <TFile.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+namespace
+{
+/// Fast-clones tree_name of every input into the open output, in order,
+/// leaving out the branch `skip` when given.
+TTree *clone_trees_fast(TFile &fout,
+                        const std::vector<std::string> &inputs,
+                        const std::string &tree_name,
+                        const std::string &skip)
+{
+    TTree *tout = nullptr;
+    for (const auto &path : inputs)
+    {
+        std::unique_ptr<TFile> fin(TFile::Open(path.c_str(), "READ"));
+        auto *tin = (fin && !fin->IsZombie()) ? dynamic_cast<TTree *>(fin->Get(tree_name.c_str())) : nullptr;
+        if (!tin)
+            throw std::runtime_error("EventListSet::write_merged: missing tree " + tree_name + " in " + path);
+
+        if (!skip.empty())
+            tin->SetBranchStatus(skip.c_str(), false);
+
+        fout.cd();
+        if (!tout)
+        {
+            tout = tin->CloneTree(0);
+            tout->SetDirectory(&fout);
+        }
+        tout->CopyEntries(tin, -1, "fast");
+        tout->ResetBranchAddresses();
+        fin->Close();
+    }
+    return tout;
+}
+}
+
+namespace nu
+{
+
+EventListSet::EventListSet(std::vector<EventListPeriod> periods)
+    : m_periods(std::move(periods))
+{
+    if (m_periods.empty())
+        throw std::runtime_error("EventListSet: no event lists given");
+
+    m_lists.reserve(m_periods.size());
+    m_id_offsets.push_back(0);
+    for (const auto &period : m_periods)
+    {
+        m_lists.emplace_back(period.path, EventListIO::OpenMode::kRead);
+        const EventListIO &list = m_lists.back();
+
+        if (m_event_tree.empty())
+            m_event_tree = list.event_tree();
+        else if (list.event_tree() != m_event_tree)
+        {
+            throw std::runtime_error("EventListSet: " + period.path + " has event tree " + list.event_tree()
+                                     + ", expected " + m_event_tree);
+        }
+
+        std::unique_ptr<TFile> f(TFile::Open(period.path.c_str(), "READ"));
+        auto *t = (f && !f->IsZombie()) ? dynamic_cast<TTree *>(f->Get(m_event_tree.c_str())) : nullptr;
+        if (!t)
+            throw std::runtime_error("EventListSet: missing tree " + m_event_tree + " in " + period.path);
+
+        const int offset = m_id_offsets.back();
+        for (const auto &kv : list.sample_refs())
+            m_sample_refs.emplace(offset + kv.first, kv.second);
+
+        m_id_offsets.push_back(offset + list.max_sample_id() + 1);
+    }
+}
+
+EventListSet EventListSet::read(const std::vector<std::string> &paths)
+{
+    std::vector<EventListPeriod> periods;
+    periods.reserve(paths.size());
+    for (const auto &path : paths)
+        periods.push_back(EventListPeriod{std::filesystem::path(path).stem().string(), path});
+    return EventListSet(std::move(periods));
+}
+
+int EventListSet::global_sample_id(size_t period, int local_sample_id) const
+{
+    if (period >= m_lists.size())
+        throw std::runtime_error("EventListSet::global_sample_id: period out of range");
+    return m_id_offsets[period] + local_sample_id;
+}
+
+size_t EventListSet::period_of(int global_sample_id) const
+{
+    if (global_sample_id < 0 || global_sample_id >= m_id_offsets.back())
+        throw std::runtime_error("EventListSet::period_of: sample id " + std::to_string(global_sample_id)
+                                 + " out of range");
+    const auto it = std::upper_bound(m_id_offsets.begin(), m_id_offsets.end(), global_sample_id);
+    return static_cast<size_t>(std::distance(m_id_offsets.begin(), it) - 1);
+}
+
+std::vector<std::string> EventListSet::friend_files(const std::string &tree) const
+{
+    std::vector<std::string> files;
+    for (size_t i = 0; i < m_lists.size(); ++i)
+    {
+        const auto &friends = m_lists[i].friends();
+        const auto it = std::find_if(friends.begin(), friends.end(),
+                                     [&](const EventFriend &fr) { return fr.tree == tree; });
+        if (it == friends.end())
+            return {};
+
+        const std::filesystem::path dir = std::filesystem::path(m_periods[i].path).parent_path();
+        files.push_back(it->file.empty() ? m_periods[i].path : (dir / it->file).string());
+    }
+    return files;
+}
+
+ROOT::RDF::RNode EventListSet::rdf() const
+{
+    // The per-sample callback below holds the chains, so they live as long
+    // as the frame.
+    auto chains = std::make_shared<std::vector<std::shared_ptr<TChain>>>();
+    auto chain = std::make_shared<TChain>(m_event_tree.c_str());
+    for (const auto &period : m_periods)
+        chain->Add(period.path.c_str());
+
+    for (const auto &fr : m_lists.front().friends())
+    {
+        const std::vector<std::string> files = friend_files(fr.tree);
+        if (files.empty())
+            continue;
+
+        auto friend_chain = std::make_shared<TChain>(fr.tree.c_str());
+        for (const auto &file : files)
+            friend_chain->Add(file.c_str());
+        chain->AddFriend(friend_chain.get());
+        chains->push_back(friend_chain);
+    }
+    chains->insert(chains->begin(), chain);
+
+    // Each file is one sample to RDataFrame, named "<file>/<tree>", so the
+    // period offset is fixed per sample whatever the entry or thread.
+    auto offsets = std::make_shared<std::map<std::string, int>>();
+    for (size_t i = 0; i < m_periods.size(); ++i)
+        offsets->emplace(m_periods[i].path + "/" + m_event_tree, m_id_offsets[i]);
+
+    ROOT::RDF::RNode node = ROOT::RDataFrame(*chain);
+    const std::string offset_column = std::string(k_sample_id_column) + "_offset";
+    node = node.DefinePerSample(
+        offset_column,
+        [chains, offsets](unsigned int, const ROOT::RDF::RSampleInfo &info)
+        {
+            const auto it = offsets->find(info.AsString());
+            if (it == offsets->end())
+                throw std::runtime_error("EventListSet::rdf: no period for sample " + info.AsString());
+            return it->second;
+        });
+    return node.Define(
+        k_sample_id_column,
+        [](int offset, int sample_id) { return (sample_id < 0) ? -1 : offset + sample_id; },
+        {offset_column, "sample_id"});
+}
+
+std::shared_ptr<const std::vector<char>> EventListSet::mask_for_origin(SampleIO::SampleOrigin origin) const
+{
+    const int want = static_cast<int>(origin);
+    auto mask = std::make_shared<std::vector<char>>(static_cast<size_t>(m_id_offsets.back()), 0);
+
+    for (const auto &kv : m_sample_refs)
+        (*mask)[static_cast<size_t>(kv.first)] = (kv.second.sample_origin == want) ? 1 : 0;
+    return mask;
+}
+
+std::shared_ptr<const std::vector<char>> EventListSet::mask_for_data() const
+{
+    return mask_for_origin(SampleIO::SampleOrigin::kData);
+}
+
+std::shared_ptr<const std::vector<char>> EventListSet::mask_for_ext() const
+{
+    return mask_for_origin(SampleIO::SampleOrigin::kEXT);
+}
+
+std::shared_ptr<const std::vector<char>> EventListSet::mask_for_mc_like() const
+{
+    auto mask = std::make_shared<std::vector<char>>(static_cast<size_t>(m_id_offsets.back()), 0);
+    const int data_id = static_cast<int>(SampleIO::SampleOrigin::kData);
+
+    for (const auto &kv : m_sample_refs)
+        (*mask)[static_cast<size_t>(kv.first)] = (kv.second.sample_origin != data_id) ? 1 : 0;
+    return mask;
+}
+
+double EventListSet::total_pot_data() const
+{
+    double tot = 0.0;
+    for (const auto &list : m_lists)
+        tot += list.total_pot_data();
+    return tot;
+}
+
+double EventListSet::total_pot_mc() const
+{
+    double tot = 0.0;
+    for (const auto &list : m_lists)
+        tot += list.total_pot_mc();
+    return tot;
+}
+
+Long64_t EventListSet::write_merged(const std::string &out_path, unsigned n_threads) const
+{
+    const std::map<std::string, std::string> schemas = m_lists.front().event_schemas();
+    for (size_t i = 1; i < m_periods.size(); ++i)
+    {
+        if (m_lists[i].event_schemas() != schemas)
+        {
+            throw std::runtime_error("EventListSet::write_merged: event schema of " + m_periods[i].path
+                                     + " differs from " + m_periods.front().path);
+        }
+    }
+
+    std::vector<std::string> inputs;
+    inputs.reserve(m_periods.size());
+    for (const auto &period : m_periods)
+        inputs.push_back(period.path);
+
+    EventListHeader header = m_lists.front().header();
+    header.sample_list_source.clear();
+    for (const auto &period : m_periods)
+        header.sample_list_source += (header.sample_list_source.empty() ? "" : ",") + period.path;
+    header.event_output_dir = std::filesystem::path(out_path).parent_path().string();
+
+    // Global ids are positions in sample_refs; ids no period uses stay as
+    // placeholders with unknown origin.
+    std::vector<SampleInfo> refs(static_cast<size_t>(m_id_offsets.back()));
+    for (const auto &kv : m_sample_refs)
+        refs[static_cast<size_t>(kv.first)] = kv.second;
+
+    EventListIO::init(out_path, header, refs, schemas);
+
+    // Remapped sample ids are decoded concurrently while the baskets are
+    // copied; only this branch is ever decompressed.
+    ROOT::EnableThreadSafety();
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min<unsigned>(n_threads, static_cast<unsigned>(inputs.size()));
+
+    std::vector<std::vector<int>> sample_ids(inputs.size());
+    std::vector<std::exception_ptr> errors(inputs.size());
+    std::atomic<size_t> next_input{0};
+    auto read_sample_ids = [&]()
+    {
+        for (size_t i = next_input++; i < inputs.size(); i = next_input++)
+        {
+            try
+            {
+                std::unique_ptr<TFile> fin(TFile::Open(inputs[i].c_str(), "READ"));
+                auto *tin = (fin && !fin->IsZombie()) ? dynamic_cast<TTree *>(fin->Get(m_event_tree.c_str()))
+                                                      : nullptr;
+                if (!tin)
+                    throw std::runtime_error("EventListSet::write_merged: missing tree " + m_event_tree + " in "
+                                             + inputs[i]);
+
+                int sample_id = -1;
+                tin->SetBranchStatus("*", false);
+                tin->SetBranchStatus("sample_id", true);
+                tin->SetBranchAddress("sample_id", &sample_id);
+
+                const Long64_t n = tin->GetEntries();
+                std::vector<int> &out = sample_ids[i];
+                out.resize(static_cast<size_t>(n));
+                for (Long64_t e = 0; e < n; ++e)
+                {
+                    tin->GetEntry(e);
+                    out[static_cast<size_t>(e)] = (sample_id < 0) ? -1 : m_id_offsets[i] + sample_id;
+                }
+                tin->ResetBranchAddresses();
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(n_threads);
+    for (unsigned t = 0; t < n_threads; ++t)
+        workers.emplace_back(read_sample_ids);
+
+    Long64_t n_written = 0;
+    std::exception_ptr clone_error;
+    std::vector<EventFriend> merged_friends;
+    try
+    {
+        std::unique_ptr<TFile> fout(TFile::Open(out_path.c_str(), "UPDATE"));
+        if (!fout || fout->IsZombie())
+            throw std::runtime_error("EventListSet::write_merged: failed to open " + out_path);
+
+        TTree *tout = clone_trees_fast(*fout, inputs, m_event_tree, "sample_id");
+
+        for (auto &w : workers)
+            w.join();
+        workers.clear();
+        for (const auto &e : errors)
+        {
+            if (e)
+                std::rethrow_exception(e);
+        }
+
+        int sample_id = -1;
+        TBranch *branch = tout->Branch("sample_id", &sample_id);
+        for (const auto &ids : sample_ids)
+        {
+            for (const int id : ids)
+            {
+                sample_id = id;
+                branch->Fill();
+            }
+        }
+        n_written = tout->GetEntries();
+        tout->Write("", TObject::kOverwrite);
+
+        for (const auto &fr : m_lists.front().friends())
+        {
+            const std::vector<std::string> files = friend_files(fr.tree);
+            if (files.empty())
+            {
+                std::cerr << "[EventListSet] warning=friend_not_merged tree=" << fr.tree
+                          << " reason=missing_in_some_period\n";
+                continue;
+            }
+            TTree *fout_tree = clone_trees_fast(*fout, files, fr.tree, "");
+            fout_tree->Write("", TObject::kOverwrite);
+            merged_friends.push_back(EventFriend{fr.tree, ""});
+        }
+
+        fout->Close();
+    }
+    catch (...)
+    {
+        clone_error = std::current_exception();
+    }
+
+    for (auto &w : workers)
+        w.join();
+    if (clone_error)
+        std::rethrow_exception(clone_error);
+
+    // Friend columns are already part of the copied schemas.
+    EventListIO merged(out_path, EventListIO::OpenMode::kUpdate);
+    for (const auto &fr : merged_friends)
+        merged.add_friend(fr, {});
+
+    return n_written;
+}
+
+std::string EventListSet::beamline_label() const
+{
+    std::string seen;
+    for (const auto &list : m_lists)
+    {
+        const std::string label = list.beamline_label();
+        if (label == "unknown")
+            continue;
+        if (seen.empty())
+            seen = label;
+        else if (label != seen)
+            return "mixed";
+    }
+    return seen.empty() ? "unknown" : seen;
+}
+
+}
@@ -10,10 +10,15 @@
 #include <algorithm>
 #include <cctype>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
+#include <regex>
+#include <set>
 #include <stdexcept>
 #include <system_error>
 #include <unistd.h>
@@ -25,7 +30,10 @@
 
 #include <TFile.h>
 #include <TFileMerger.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
 #include <TObject.h>
+#include <TROOT.h>
 #include <TTree.h>
 
 
@@ -89,8 +97,384 @@ std::filesystem::path snapshot_scratch_dir()
 
     return std::filesystem::path("/exp/uboone/data/users") / user / "heron" / "scratch";
 }
+
+struct Zone
+{
+    Long64_t begin = 0;
+    Long64_t end = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    bool any = false;
+};
+
+struct ZoneTerm
+{
+    enum class Op
+    {
+        kTrue,
+        kFalse,
+        kLt,
+        kLe,
+        kGt,
+        kGe,
+        kEq,
+        kNe
+    };
+
+    std::string column;
+    Op op = Op::kTrue;
+    double value = 0.0;
+};
+
+bool is_zone_map_leaf(const TLeaf &leaf)
+{
+    static const std::set<std::string> types{"Bool_t", "Char_t", "UChar_t", "Short_t", "UShort_t",
+                                             "Int_t", "UInt_t", "Long_t", "ULong_t", "Long64_t",
+                                             "ULong64_t", "Float_t", "Double_t"};
+    return !leaf.GetLeafCount() && leaf.GetLenStatic() == 1 && types.count(leaf.GetTypeName()) > 0;
+}
+
+std::string trim(const std::string &s)
+{
+    const auto first = s.find_first_not_of(" \t\n");
+    if (first == std::string::npos)
+        return {};
+    const auto last = s.find_last_not_of(" \t\n");
+    return s.substr(first, last - first + 1);
+}
+
+// True when the '=' at i is an assignment rather than part of ==, !=, <=
+// or >=.
+bool is_assignment(const std::string &expr, std::size_t i)
+{
+    if (i + 1 < expr.size() && expr[i + 1] == '=')
+        return false;
+    if (i > 0 && std::string("=!<>").find(expr[i - 1]) != std::string::npos)
+        return false;
+    return true;
+}
+
+// Splits on top-level "&&"; false when a top-level "||", "?:", ",", an
+// assignment or unbalanced parentheses mean the expression is not a plain
+// conjunction (e.g. `a && b ? c : d` parses as `(a && b) ? c : d`).
+bool split_conjunction(const std::string &expr, std::vector<std::string> &parts)
+{
+    int depth = 0;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < expr.size(); ++i)
+    {
+        const char c = expr[i];
+        if (c == '(')
+            ++depth;
+        else if (c == ')' && --depth < 0)
+            return false;
+        else if (depth == 0 && i + 1 < expr.size() && c == '|' && expr[i + 1] == '|')
+            return false;
+        else if (depth == 0 && (c == '?' || c == ',' || (c == '=' && is_assignment(expr, i))))
+            return false;
+        else if (depth == 0 && i + 1 < expr.size() && c == '&' && expr[i + 1] == '&')
+        {
+            parts.push_back(expr.substr(start, i - start));
+            start = i + 2;
+            ++i;
+        }
+    }
+    if (depth != 0)
+        return false;
+    parts.push_back(expr.substr(start));
+    return true;
+}
+
+bool enclosed_in_parentheses(const std::string &t)
+{
+    if (t.size() < 2 || t.front() != '(' || t.back() != ')')
+        return false;
+    int depth = 0;
+    for (std::size_t i = 0; i + 1 < t.size(); ++i)
+    {
+        if (t[i] == '(')
+            ++depth;
+        else if (t[i] == ')' && --depth == 0)
+            return false;
+    }
+    return true;
+}
+
+bool parse_zone_term(const std::string &t, ZoneTerm &term)
+{
+    static const std::regex flag(R"(^(!?)\s*([A-Za-z_]\w*)$)");
+    static const std::regex col_op_num(R"(^([A-Za-z_]\w*)\s*(<=|>=|==|!=|<|>)\s*([-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?)$)");
+    static const std::regex num_op_col(R"(^([-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?)\s*(<=|>=|==|!=|<|>)\s*([A-Za-z_]\w*)$)");
+
+    using Op = ZoneTerm::Op;
+    auto op_of = [](const std::string &op, bool flipped) {
+        if (op == "==")
+            return Op::kEq;
+        if (op == "!=")
+            return Op::kNe;
+        if (op == "<")
+            return flipped ? Op::kGt : Op::kLt;
+        if (op == "<=")
+            return flipped ? Op::kGe : Op::kLe;
+        if (op == ">")
+            return flipped ? Op::kLt : Op::kGt;
+        return flipped ? Op::kLe : Op::kGe;
+    };
+
+    std::smatch m;
+    if (std::regex_match(t, m, flag))
+    {
+        if (m[2] == "true" || m[2] == "false")
+            return false;
+        term.column = m[2];
+        term.op = m[1].length() ? Op::kFalse : Op::kTrue;
+        return true;
+    }
+    if (std::regex_match(t, m, col_op_num))
+    {
+        term.column = m[1];
+        term.op = op_of(m[2], false);
+        term.value = std::stod(m[3]);
+        return true;
+    }
+    if (std::regex_match(t, m, num_op_col))
+    {
+        term.column = m[3];
+        term.op = op_of(m[2], true);
+        term.value = std::stod(m[1]);
+        return true;
+    }
+    return false;
+}
+
+void collect_zone_terms(const std::string &expr, std::vector<ZoneTerm> &terms)
+{
+    std::vector<std::string> parts;
+    if (!split_conjunction(expr, parts))
+        return;
+
+    for (const auto &part : parts)
+    {
+        const std::string t = trim(part);
+        if (enclosed_in_parentheses(t))
+        {
+            collect_zone_terms(t.substr(1, t.size() - 2), terms);
+            continue;
+        }
+        ZoneTerm term;
+        if (parse_zone_term(t, term))
+            terms.push_back(std::move(term));
+    }
+}
+
+// True when no value in the zone can satisfy the term.
+bool zone_excludes(const Zone &z, const ZoneTerm &term)
+{
+    using Op = ZoneTerm::Op;
+    switch (term.op)
+    {
+    case Op::kTrue: return !z.any;
+    case Op::kFalse: return z.min > 0.0 || z.max < 0.0;
+    case Op::kLt: return z.min >= term.value;
+    case Op::kLe: return z.min > term.value;
+    case Op::kGt: return z.max <= term.value;
+    case Op::kGe: return z.max < term.value;
+    case Op::kEq: return term.value < z.min || term.value > z.max;
+    case Op::kNe: return z.min == term.value && z.max == term.value;
+    }
+    return false;
+}
 } // namespace
 
+std::string SnapshotService::zone_map_tree_name(const std::string &tree_name)
+{
+    return sanitise_root_key(tree_name) + "_zone_maps";
+}
+
+Long64_t SnapshotService::build_zone_maps(const std::string &path,
+                                          const std::string &tree_name,
+                                          const std::vector<std::string> &columns)
+{
+    std::unique_ptr<TFile> f(TFile::Open(path.c_str(), "UPDATE"));
+    if (!f || f->IsZombie())
+        throw std::runtime_error("SnapshotService: failed to open for zone maps: " + path);
+
+    auto *tree = dynamic_cast<TTree *>(f->Get(tree_name.c_str()));
+    if (!tree)
+        throw std::runtime_error("SnapshotService: missing tree " + tree_name + " in " + path);
+
+    struct Column
+    {
+        std::string name;
+        TBranch *branch = nullptr;
+        TLeaf *leaf = nullptr;
+    };
+
+    std::vector<Column> selected;
+    auto add_column = [&](TBranch *b) {
+        TObjArray *leaves = b ? b->GetListOfLeaves() : nullptr;
+        auto *leaf = (leaves && leaves->GetEntriesFast() == 1) ? dynamic_cast<TLeaf *>(leaves->At(0)) : nullptr;
+        if (!leaf || !is_zone_map_leaf(*leaf))
+            return false;
+        b->SetAddress(nullptr);
+        selected.push_back(Column{b->GetName(), b, leaf});
+        return true;
+    };
+
+    if (columns.empty())
+    {
+        TObjArray *branches = tree->GetListOfBranches();
+        for (Int_t i = 0; i < branches->GetEntriesFast(); ++i)
+            add_column(dynamic_cast<TBranch *>(branches->At(i)));
+    }
+    else
+    {
+        for (const auto &c : columns)
+        {
+            if (!add_column(tree->GetBranch(c.c_str())))
+                std::cerr << "[SnapshotService] warning=zone_map_column_skipped column=" << c
+                          << " reason=missing_or_not_scalar\n";
+        }
+    }
+
+    std::string column;
+    Zone zone;
+    TTree zm(zone_map_tree_name(tree_name).c_str(), ("Per-cluster column statistics of " + tree_name).c_str());
+    zm.SetDirectory(f.get());
+    zm.Branch("column", &column);
+    zm.Branch("begin", &zone.begin);
+    zm.Branch("end", &zone.end);
+    zm.Branch("min", &zone.min);
+    zm.Branch("max", &zone.max);
+    zm.Branch("any", &zone.any);
+
+    const Long64_t n = tree->GetEntries();
+    Long64_t n_clusters = 0;
+    auto clusters = tree->GetClusterIterator(0);
+    for (Long64_t begin = clusters(); begin < n; begin = clusters())
+    {
+        const Long64_t end = std::min(n, clusters.GetNextEntry());
+        for (const auto &c : selected)
+        {
+            column = c.name;
+            zone = Zone{};
+            zone.begin = begin;
+            zone.end = end;
+            for (Long64_t e = begin; e < end; ++e)
+            {
+                c.branch->GetEntry(e);
+                const double x = c.leaf->GetValue(0);
+                zone.any = zone.any || x != 0.0;
+                if (std::isnan(x))
+                {
+                    // NaN passes only !=; drop the bounds rather than track it.
+                    zone.min = -std::numeric_limits<double>::infinity();
+                    zone.max = std::numeric_limits<double>::infinity();
+                }
+                zone.min = std::min(zone.min, x);
+                zone.max = std::max(zone.max, x);
+            }
+            zm.Fill();
+        }
+        ++n_clusters;
+    }
+
+    tree->ResetBranchAddresses();
+    f->cd();
+    zm.Write(nullptr, TObject::kOverwrite);
+    f->Close();
+
+    std::cerr << "[SnapshotService] stage=zone_maps"
+              << " tree=" << tree_name
+              << " columns=" << selected.size()
+              << " clusters=" << n_clusters
+              << "\n";
+    return n_clusters;
+}
+
+std::vector<SnapshotService::EntryRange> SnapshotService::zone_map_ranges(const std::string &path,
+                                                                          const std::string &tree_name,
+                                                                          const std::string &predicate)
+{
+    std::unique_ptr<TFile> f(TFile::Open(path.c_str(), "READ"));
+    if (!f || f->IsZombie())
+        throw std::runtime_error("SnapshotService: failed to open " + path);
+
+    auto *tree = dynamic_cast<TTree *>(f->Get(tree_name.c_str()));
+    if (!tree)
+        throw std::runtime_error("SnapshotService: missing tree " + tree_name + " in " + path);
+
+    const Long64_t n = tree->GetEntries();
+    const std::vector<EntryRange> everything = (n > 0) ? std::vector<EntryRange>{{0, n}} : std::vector<EntryRange>{};
+
+    std::vector<ZoneTerm> terms;
+    collect_zone_terms(predicate, terms);
+    auto *zm = dynamic_cast<TTree *>(f->Get(zone_map_tree_name(tree_name).c_str()));
+    if (terms.empty() || !zm)
+        return everything;
+
+    std::set<std::string> wanted;
+    for (const auto &t : terms)
+        wanted.insert(t.column);
+
+    std::string *column = nullptr;
+    Zone zone;
+    zm->SetBranchAddress("column", &column);
+    zm->SetBranchAddress("begin", &zone.begin);
+    zm->SetBranchAddress("end", &zone.end);
+    zm->SetBranchAddress("min", &zone.min);
+    zm->SetBranchAddress("max", &zone.max);
+    zm->SetBranchAddress("any", &zone.any);
+
+    std::map<std::string, std::vector<Zone>> zones;
+    std::map<Long64_t, Long64_t> cluster_end;
+    for (Long64_t i = 0; i < zm->GetEntries(); ++i)
+    {
+        zm->GetEntry(i);
+        cluster_end[zone.begin] = zone.end;
+        if (column && wanted.count(*column))
+            zones[*column].push_back(zone);
+    }
+    zm->ResetBranchAddresses();
+
+    std::set<Long64_t> excluded;
+    for (const auto &t : terms)
+    {
+        const auto it = zones.find(t.column);
+        if (it == zones.end())
+            continue;
+        for (const auto &z : it->second)
+        {
+            if (zone_excludes(z, t))
+                excluded.insert(z.begin);
+        }
+    }
+    if (excluded.empty())
+        return everything;
+
+    // Anything the maps do not cover (e.g. entries appended later) is kept.
+    std::vector<EntryRange> ranges;
+    auto keep = [&ranges](Long64_t begin, Long64_t end) {
+        if (begin >= end)
+            return;
+        if (!ranges.empty() && ranges.back().second == begin)
+            ranges.back().second = end;
+        else
+            ranges.emplace_back(begin, end);
+    };
+
+    Long64_t covered = 0;
+    for (const auto &c : cluster_end)
+    {
+        keep(covered, std::min(c.first, n));
+        if (!excluded.count(c.first))
+            keep(c.first, std::min(c.second, n));
+        covered = std::max(covered, std::min(c.second, n));
+    }
+    keep(covered, n);
+    return ranges;
+}
+
 ULong64_t SnapshotService::snapshot_event_list_merged(ROOT::RDF::RNode node,
                                                       const std::string &out_path,
                                                       int sample_id,
@@ -181,6 +565,75 @@ ULong64_t SnapshotService::snapshot_event_list_merged(ROOT::RDF::RNode node,
     return count.GetValue();
 }
 
+ULong64_t SnapshotService::snapshot_friend(ROOT::RDF::RNode node,
+                                           const std::string &out_path,
+                                           const std::string &tree_name_in,
+                                           const std::vector<std::string> &columns)
+{
+    if (ROOT::IsImplicitMTEnabled())
+        throw std::runtime_error("SnapshotService::snapshot_friend: implicit MT would reorder entries");
+
+    const std::string tree_name = sanitise_root_key(tree_name_in);
+
+    std::filesystem::path scratch_dir = snapshot_scratch_dir();
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(scratch_dir, ec);
+        if (ec)
+        {
+            throw std::runtime_error(
+                "SnapshotService: failed to create scratch directory: "
+                + scratch_dir.string()
+                + " (" + ec.message() + ")");
+        }
+    }
+
+    const std::string scratch_file =
+        (scratch_dir / ("heron_friend_" + tree_name + "_" + std::to_string(::getpid()) + ".root")).string();
+
+    ROOT::RDF::RSnapshotOptions options;
+    options.fMode = "RECREATE";
+    options.fOverwriteIfExists = false;
+    options.fLazy = true;
+    options.fCompressionAlgorithm = ROOT::kLZ4;
+    options.fCompressionLevel = 1;
+    options.fAutoFlush = -50LL * 1024 * 1024;
+    options.fSplitLevel = 0;
+
+    std::cerr << "[SnapshotService] stage=friend_snapshot"
+              << " tree=" << tree_name
+              << " scratch_file=" << scratch_file
+              << "\n";
+    auto count = node.Count();
+    auto snapshot = node.Snapshot(tree_name, scratch_file, columns, options);
+    (void)snapshot.GetValue();
+    const ULong64_t n_written = count.GetValue();
+
+    {
+        std::unique_ptr<TFile> fout(TFile::Open(out_path.c_str(), "UPDATE"));
+        if (!fout || fout->IsZombie())
+            throw std::runtime_error("SnapshotService: failed to open output for friend tree: " + out_path);
+        fout->Delete((tree_name + ";*").c_str());
+        fout->Close();
+    }
+
+    std::cerr << "[SnapshotService] stage=friend_append"
+              << " tree=" << tree_name
+              << " out_file=" << out_path
+              << "\n";
+    append_tree_fast(out_path, scratch_file, tree_name);
+
+    {
+        std::error_code ec;
+        std::filesystem::remove(scratch_file, ec);
+        if (ec)
+            std::cerr << "[SnapshotService] warning=failed_to_remove_scratch_file path=" << scratch_file
+                      << " err=" << ec.message() << "\n";
+    }
+
+    return n_written;
+}
+
 ULong64_t SnapshotService::snapshot_event_list(ROOT::RDF::RNode node,
                                                const std::string &out_path,
                                                const std::string &sample_name,
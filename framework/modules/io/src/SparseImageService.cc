@@ -0,0 +1,140 @@
+#include "SparseImageService.hh"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+enum class ElementType
+{
+    kFloat,
+    kDouble,
+    kInt
+};
+
+/// Element type of a list column from its RDataFrame type name, e.g.
+/// "ROOT::VecOps::RVec<float>" or "vector<int>".
+ElementType element_type(ROOT::RDF::RNode node, const std::string &column)
+{
+    const std::string type = node.GetColumnType(column);
+    const auto open = type.find('<');
+    const auto close = type.rfind('>');
+    const std::string element =
+        (open == std::string::npos || close == std::string::npos || close < open)
+            ? type
+            : type.substr(open + 1, close - open - 1);
+
+    if (element == "float" || element == "Float_t")
+        return ElementType::kFloat;
+    if (element == "double" || element == "Double_t")
+        return ElementType::kDouble;
+    if (element == "int" || element == "Int_t")
+        return ElementType::kInt;
+    throw std::runtime_error("SparseImageService: unsupported image type " + type + " for " + column);
+}
+
+template <typename T>
+ROOT::RDF::RNode define_sparse_as(ROOT::RDF::RNode node, const SparseImageService::Column &image)
+{
+    const double threshold = image.threshold;
+    const std::string idx = SparseImageService::index_column(image.name);
+    node = node.Define(idx,
+                       [threshold](const ROOT::VecOps::RVec<T> &dense)
+                       { return SparseImageService::encode_indices(dense, threshold); },
+                       {image.name});
+    node = node.Define(SparseImageService::value_column(image.name),
+                       [](const ROOT::VecOps::RVec<T> &dense, const ROOT::VecOps::RVec<unsigned int> &i)
+                       { return SparseImageService::encode_values(dense, i); },
+                       {image.name, idx});
+    return node.Define(SparseImageService::size_column(image.name),
+                       [](const ROOT::VecOps::RVec<T> &dense) { return static_cast<int>(dense.size()); },
+                       {image.name});
+}
+
+template <typename T>
+ROOT::RDF::RNode define_dense_as(ROOT::RDF::RNode node, const std::string &image)
+{
+    return node.Define(image,
+                       [](const ROOT::VecOps::RVec<unsigned int> &idx, const ROOT::VecOps::RVec<T> &val, int size)
+                       { return SparseImageService::decode(idx, val, size); },
+                       {SparseImageService::index_column(image),
+                        SparseImageService::value_column(image),
+                        SparseImageService::size_column(image)});
+}
+}
+
+const std::vector<std::string> &SparseImageService::image_columns()
+{
+    static const std::vector<std::string> columns = {"detector_image_u",
+                                                     "detector_image_v",
+                                                     "detector_image_w",
+                                                     "semantic_image_u",
+                                                     "semantic_image_v",
+                                                     "semantic_image_w"};
+    return columns;
+}
+
+ROOT::RDF::RNode SparseImageService::define_sparse(ROOT::RDF::RNode node, const std::vector<Column> &images)
+{
+    for (const auto &image : images)
+    {
+        switch (element_type(node, image.name))
+        {
+            case ElementType::kFloat:
+                node = define_sparse_as<float>(node, image);
+                break;
+            case ElementType::kDouble:
+                node = define_sparse_as<double>(node, image);
+                break;
+            case ElementType::kInt:
+                node = define_sparse_as<int>(node, image);
+                break;
+        }
+    }
+    return node;
+}
+
+std::vector<std::string> SparseImageService::sparse_columns(const std::vector<std::string> &columns,
+                                                            const std::vector<Column> &images)
+{
+    std::vector<std::string> out;
+    out.reserve(columns.size() + 2 * images.size());
+    for (const auto &c : columns)
+    {
+        bool sparse = false;
+        for (const auto &image : images)
+            sparse = sparse || image.name == c;
+        if (!sparse)
+        {
+            out.push_back(c);
+            continue;
+        }
+        out.push_back(index_column(c));
+        out.push_back(value_column(c));
+        out.push_back(size_column(c));
+    }
+    return out;
+}
+
+ROOT::RDF::RNode SparseImageService::define_dense(ROOT::RDF::RNode node, const std::vector<std::string> &images)
+{
+    for (const auto &image : images)
+    {
+        if (node.HasColumn(image) || !has_sparse(node, image))
+            continue;
+        switch (element_type(node, value_column(image)))
+        {
+            case ElementType::kFloat:
+                node = define_dense_as<float>(node, image);
+                break;
+            case ElementType::kDouble:
+                node = define_dense_as<double>(node, image);
+                break;
+            case ElementType::kInt:
+                node = define_dense_as<int>(node, image);
+                break;
+        }
+    }
+    return node;
+}
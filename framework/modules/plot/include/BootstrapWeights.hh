@@ -0,0 +1,213 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/include/BootstrapWeights.hh
+ *
+ *  @brief Poisson(1) bootstrap weights from a counter-based generator keyed on
+ *         (run, sub, evt, universe), and an RDataFrame fill action that
+ *         generates them on the fly for MC statistical uncertainties.
+ */
+
+#ifndef HERON_PLOT_BOOTSTRAP_WEIGHTS_H
+#define HERON_PLOT_BOOTSTRAP_WEIGHTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+
+
+namespace nu
+{
+
+class BootstrapWeights
+{
+  public:
+    // Largest weight drawn; P(Poisson(1) > 12) ~ 1e-10.
+    static constexpr int k_max_weight = 12;
+
+    static std::uint64_t mix(std::uint64_t z)
+    {
+        z += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static std::uint64_t event_key(int run, int sub, int evt, std::uint64_t seed = 0)
+    {
+        const std::uint64_t rs = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(run)) << 32) |
+                                 static_cast<std::uint32_t>(sub);
+        return mix(mix(seed ^ mix(rs)) ^ static_cast<std::uint32_t>(evt));
+    }
+
+    // Stateless: the same (key, universe) always gives the same weight, on any
+    // thread and in any event order.
+    static int poisson1(std::uint64_t key, std::uint32_t universe)
+    {
+        const double u = static_cast<double>(mix(key + universe * 0x9E3779B97F4A7C15ULL) >> 11) * 0x1.0p-53;
+        const double *cdf = cdf_table();
+        int k = 0;
+        for (int i = 0; i < k_max_weight; ++i)
+        {
+            k += (u >= cdf[i]) ? 1 : 0;
+        }
+        return k;
+    }
+
+    static void fill(std::uint64_t key, int n_universes, double *out)
+    {
+        for (int u = 0; u < n_universes; ++u)
+        {
+            out[u] = static_cast<double>(poisson1(key, static_cast<std::uint32_t>(u)));
+        }
+    }
+
+  private:
+    static const double *cdf_table()
+    {
+        static const std::vector<double> cdf = []() {
+            std::vector<double> c(k_max_weight);
+            double p = std::exp(-1.0);
+            double sum = 0.0;
+            for (int k = 0; k < k_max_weight; ++k)
+            {
+                sum += p;
+                c[k] = sum;
+                p /= (k + 1);
+            }
+            return c;
+        }();
+        return cdf.data();
+    }
+};
+
+// Bootstrap replicas of one histogram, bin-major ([bin][universe]) including
+// underflow (bin 0) and overflow (bin n_bins - 1).
+struct BootstrapSums
+{
+    int n_bins = 0;
+    int n_universes = 0;
+    std::vector<double> sumw;
+
+    double at(int bin, int universe) const
+    {
+        return sumw[static_cast<std::size_t>(bin) * n_universes + universe];
+    }
+};
+
+// RDF action: Book<double, double, int, int, int>(helper, {x, w, run, sub, evt}).
+class BootstrapFillHelper : public ROOT::Detail::RDF::RActionImpl<BootstrapFillHelper>
+{
+  public:
+    using Result_t = BootstrapSums;
+
+    BootstrapFillHelper(std::vector<double> edges, int n_universes, unsigned int n_slots, std::uint64_t seed)
+        : edges_(std::move(edges)),
+          seed_(seed),
+          result_(std::make_shared<Result_t>())
+    {
+        result_->n_bins = static_cast<int>(edges_.size()) + 1;
+        result_->n_universes = n_universes;
+        const std::size_t n = static_cast<std::size_t>(result_->n_bins) * n_universes;
+        slots_.assign(std::max(1u, n_slots), std::vector<double>(n, 0.0));
+    }
+
+    BootstrapFillHelper(BootstrapFillHelper &&) = default;
+    BootstrapFillHelper(const BootstrapFillHelper &) = delete;
+
+    std::shared_ptr<Result_t> GetResultPtr() const { return result_; }
+
+    void Initialize() {}
+    void InitTask(TTreeReader *, unsigned int) {}
+
+    void Exec(unsigned int slot, double x, double w, int run, int sub, int evt)
+    {
+        if (!std::isfinite(x))
+        {
+            return;
+        }
+        int bin = 0;
+        if (x >= edges_.back())
+        {
+            bin = static_cast<int>(edges_.size());
+        }
+        else if (x >= edges_.front())
+        {
+            bin = static_cast<int>(std::upper_bound(edges_.begin(), edges_.end(), x) - edges_.begin());
+        }
+
+        const int n_univ = result_->n_universes;
+        const std::uint64_t key = BootstrapWeights::event_key(run, sub, evt, seed_);
+        double *row = slots_[slot].data() + static_cast<std::size_t>(bin) * n_univ;
+        for (int u = 0; u < n_univ; ++u)
+        {
+            row[u] += w * BootstrapWeights::poisson1(key, static_cast<std::uint32_t>(u));
+        }
+    }
+
+    void Finalize()
+    {
+        std::vector<double> &out = result_->sumw;
+        out = std::move(slots_.front());
+        for (std::size_t s = 1; s < slots_.size(); ++s)
+        {
+            const std::vector<double> &in = slots_[s];
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                out[i] += in[i];
+            }
+        }
+        slots_.clear();
+    }
+
+    std::string GetActionName() const { return "BootstrapFill"; }
+
+  private:
+    std::vector<double> edges_;
+    std::uint64_t seed_ = 0;
+    std::shared_ptr<Result_t> result_;
+    std::vector<std::vector<double>> slots_;
+};
+
+// Uniform edges matching TH1D(nbins, xmin, xmax).
+inline std::vector<double> uniform_edges(int nbins, double xmin, double xmax)
+{
+    std::vector<double> edges(static_cast<std::size_t>(nbins) + 1);
+    for (int i = 0; i <= nbins; ++i)
+    {
+        edges[static_cast<std::size_t>(i)] = xmin + (xmax - xmin) * i / nbins;
+    }
+    return edges;
+}
+
+// Books bootstrap replicas of x (weighted by w) keyed on the run/sub/evt columns.
+inline ROOT::RDF::RResultPtr<BootstrapSums> book_bootstrap(ROOT::RDF::RNode node,
+                                                           const std::vector<double> &edges,
+                                                           const std::string &x_column,
+                                                           const std::string &w_column,
+                                                           int n_universes,
+                                                           std::uint64_t seed = 0,
+                                                           const std::string &run_column = "run",
+                                                           const std::string &sub_column = "sub",
+                                                           const std::string &evt_column = "evt")
+{
+    auto n = node.Define("_nx_bs_x_", "static_cast<double>(" + x_column + ")")
+                 .Define("_nx_bs_w_", "static_cast<double>(" + (w_column.empty() ? std::string("1.0") : w_column) + ")")
+                 .Define("_nx_bs_run_", "static_cast<int>(" + run_column + ")")
+                 .Define("_nx_bs_sub_", "static_cast<int>(" + sub_column + ")")
+                 .Define("_nx_bs_evt_", "static_cast<int>(" + evt_column + ")");
+    return n.Book<double, double, int, int, int>(
+        BootstrapFillHelper(edges, n_universes, n.GetNSlots(), seed),
+        {"_nx_bs_x_", "_nx_bs_w_", "_nx_bs_run_", "_nx_bs_sub_", "_nx_bs_evt_"});
+}
+
+} // namespace nu
+
+
+#endif // HERON_PLOT_BOOTSTRAP_WEIGHTS_H
@@ -0,0 +1,101 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/include/CovarianceSolver.hh
+ *
+ *  @brief Small linear-algebra helper for plot uncertainties: total-error
+ *         bands, ratio bands and covariance chi² via cached Cholesky factors
+ *         and triangular solves instead of matrix inversion.
+ */
+
+#ifndef HERON_PLOT_COVARIANCE_SOLVER_H
+#define HERON_PLOT_COVARIANCE_SOLVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TH1D.h>
+#include <TMatrixDSym.h>
+
+
+namespace nu
+{
+
+// A covariance matrix tagged with a process-wide unique generation number.
+// Copies share the generation; edit() takes a new one, so factors cached for
+// the old content are never reused. Do not keep the reference from edit()
+// across chi² calls.
+class VersionedCovariance
+{
+  public:
+    VersionedCovariance();
+    explicit VersionedCovariance(const TMatrixDSym &m);
+
+    const TMatrixDSym &matrix() const noexcept { return matrix_; }
+    std::uint64_t generation() const noexcept { return generation_; }
+    TMatrixDSym &edit();
+
+  private:
+    static std::uint64_t next_generation();
+
+    TMatrixDSym matrix_;
+    std::uint64_t generation_ = 0;
+};
+
+class CovarianceSolver
+{
+  public:
+    // Sets bin errors to sqrt(stat^2 + syst^2), with syst from the covariance
+    // diagonal (or syst_bin when cov is null), scaled by 1/width in density mode.
+    static void apply_total_errors(TH1D &h,
+                                   const TMatrixDSym *cov,
+                                   const std::vector<double> *syst_bin,
+                                   bool density_mode);
+
+    // Unit-centred band with relative errors of mc_total (which should already
+    // carry total errors).
+    static std::unique_ptr<TH1D> ratio_band(const TH1D &mc_total, const std::string &name);
+
+    // chi² = r^T (D + S) ^-1 r over the given 1-based bins, where
+    //   D = diag_var (data + MC stat variance per bin),
+    //   S_ab = cov(bins[a]-1, bins[b]-1) * scale[a] * scale[b].
+    // Rows beyond the covariance dimension contribute only to D. The
+    // Cholesky factor is cached on the covariance generation plus the bins,
+    // scale and D, so redrawing a plot or re-evaluating chi² reuses it without
+    // touching the O(n²) matrix. Returns false if the matrix is not positive
+    // definite.
+    static bool chi2(const VersionedCovariance &cov,
+                     const std::vector<int> &bins,
+                     const std::vector<double> &scale,
+                     const std::vector<double> &diag_var,
+                     const std::vector<double> &resid,
+                     double &chi2_out);
+
+    static void clear_cache();
+
+  private:
+    struct Factor
+    {
+        int n = 0;
+        std::vector<double> l; // packed lower triangle, row-major
+    };
+
+    static std::vector<double> pack(const TMatrixDSym &cov,
+                                    const std::vector<int> &bins,
+                                    const std::vector<double> &scale,
+                                    const std::vector<double> &diag_var);
+
+    static bool decompose(std::vector<double> &packed, int n);
+    static double solve_norm2(const Factor &f, const std::vector<double> &r);
+    static std::shared_ptr<const Factor> factor(const VersionedCovariance &cov,
+                                                const std::vector<int> &bins,
+                                                const std::vector<double> &scale,
+                                                const std::vector<double> &diag_var);
+};
+
+} // namespace nu
+
+
+#endif // HERON_PLOT_COVARIANCE_SOLVER_H
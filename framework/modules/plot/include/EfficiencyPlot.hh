@@ -54,6 +54,14 @@ class EfficiencyPlot
         TEfficiency::EStatOption stat = TEfficiency::kFCP;
         bool use_weighted_events = false;
 
+        // Poisson(1) bootstrap over (run, sub, evt) for MC statistical errors
+        // on the efficiency; 0 disables. Replicas are filled in the same event
+        // loop as the histograms and share weights between denom and numer.
+        int bootstrap_universes = 0;
+        std::uint64_t bootstrap_seed = 0;
+        // Replace the TEfficiency interval with the bootstrap standard deviation.
+        bool use_bootstrap_errors = false;
+
         // --- Presentation / logging ---
         // Do NOT draw denom/numer/overall eff text on the plot (cleaner, publication-like).
         // Instead print to stdout (see print_stats).
@@ -91,6 +99,9 @@ class EfficiencyPlot
     const TH1D *passed_hist() const noexcept { return h_passed_.get(); }
     const TGraphAsymmErrors *eff_graph() const noexcept { return g_eff_.get(); }
 
+    // Per-bin bootstrap standard deviation of the efficiency (index = bin, incl. underflow).
+    const std::vector<double> &bootstrap_errors() const noexcept { return eff_bootstrap_err_; }
+
     std::uint64_t denom_entries() const noexcept { return n_denom_; }
     std::uint64_t pass_entries() const noexcept { return n_pass_; }
 
@@ -104,6 +115,7 @@ class EfficiencyPlot
     std::unique_ptr<TH1D> h_total_;
     std::unique_ptr<TH1D> h_passed_;
     std::unique_ptr<TGraphAsymmErrors> g_eff_;
+    std::vector<double> eff_bootstrap_err_;
 
     std::uint64_t n_denom_ = 0;
     std::uint64_t n_pass_ = 0;
@@ -0,0 +1,69 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/include/HistogramCache.hh
+ *
+ *  @brief Fine-binned per-channel MC and data histograms, filled once and
+ *         rebinned to coarser variable binnings by exact bin summation.
+ */
+
+#ifndef HERON_PLOT_HISTOGRAM_CACHE_H
+#define HERON_PLOT_HISTOGRAM_CACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TH1D.h>
+
+#include "PlotDescriptors.hh"
+
+class TemplateBinningBlock;
+
+namespace nu
+{
+
+class HistogramCache
+{
+  public:
+    HistogramCache() = default;
+
+    // One event loop per entry at the fine binning of spec. Channel histograms
+    // carry sumw2 so rebinned errors are exact. Without an explicit channel
+    // list the cache holds Channels::mc_keys() plus opt.unstack_channel_keys.
+    static HistogramCache build(const TH1DModel &spec,
+                                const Options &opt,
+                                const std::vector<const Entry *> &mc,
+                                const std::vector<const Entry *> &data,
+                                const std::vector<int> &channels);
+    static HistogramCache build(const TH1DModel &spec,
+                                const Options &opt,
+                                const std::vector<const Entry *> &mc,
+                                const std::vector<const Entry *> &data);
+
+    // Every coarse edge must coincide with a fine edge; no event loop is run.
+    HistogramCache rebin(const std::vector<double> &edges) const;
+    HistogramCache rebin(const TemplateBinningBlock &block) const;
+
+    static std::unique_ptr<TH1D> rebin_exact(const TH1D &fine,
+                                             const std::vector<double> &edges,
+                                             const std::string &name);
+
+    const TH1D *channel(int ch) const;
+    const TH1D *data() const noexcept { return data_.get(); }
+    bool has_data() const noexcept { return static_cast<bool>(data_); }
+    bool empty() const noexcept { return mc_.empty() && !data_; }
+
+    std::vector<int> channel_keys() const;
+    std::vector<double> edges() const;
+
+  private:
+    std::string id_;
+    std::map<int, std::shared_ptr<const TH1D>> mc_;
+    std::shared_ptr<const TH1D> data_;
+};
+
+} // namespace nu
+
+
+#endif // HERON_PLOT_HISTOGRAM_CACHE_H
@@ -0,0 +1,171 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/modules/plot/include/PackedSymMatrix.hh
+ *
+ *  @brief Small symmetric matrices in packed storage, with kernels sized at
+ *         compile time for the per-bin Fisher algebra of the binning
+ *         optimisers.
+ */
+
+#ifndef HERON_PLOT_PACKED_SYM_MATRIX_H
+#define HERON_PLOT_PACKED_SYM_MATRIX_H
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+/**
+ *  @brief Symmetric n x n matrix holding only its upper triangle.
+ *
+ *  Element (i, j) with i <= j sits at j(j+1)/2 + i, i.e. the upper triangle
+ *  column by column, which is the same layout as the lower triangle row by
+ *  row. Up to kInlineDim parameters the storage lives inside the object, so
+ *  per-bin matrices need no heap allocation; larger matrices fall back to a
+ *  vector.
+ */
+class PackedSymMatrix final
+{
+  public:
+    static constexpr int kInlineDim = 8;
+    static constexpr int kInlineSize = kInlineDim * (kInlineDim + 1) / 2;
+
+    static int packed_size(const int n) { return n * (n + 1) / 2; }
+    static int index(const int i, const int j) { return (i <= j) ? j * (j + 1) / 2 + i : i * (i + 1) / 2 + j; }
+
+    PackedSymMatrix() = default;
+    explicit PackedSymMatrix(const int n) : m_n(n)
+    {
+        if (n > kInlineDim)
+            m_heap.assign(packed_size(n), 0.0);
+    }
+
+    int dim() const { return m_n; }
+    int size() const { return packed_size(m_n); }
+
+    double *data() { return (m_n > kInlineDim) ? m_heap.data() : m_inline.data(); }
+    const double *data() const { return (m_n > kInlineDim) ? m_heap.data() : m_inline.data(); }
+
+    double operator()(const int i, const int j) const { return data()[index(i, j)]; }
+    double &operator()(const int i, const int j) { return data()[index(i, j)]; }
+
+  private:
+    int m_n = 0;
+    std::array<double, kInlineSize> m_inline{};
+    std::vector<double> m_heap;
+};
+
+/**
+ *  @brief Packed symmetric kernels; N > 0 fixes the dimension at compile time
+ *         so the loops unroll, N = 0 takes it at run time.
+ */
+template <int N>
+struct PackedSymKernel
+{
+    static int dim(const int n) { return (N > 0) ? N : n; }
+
+    /// a += w u u^T
+    static void rank_one(double *a, const double *u, const double w, const int n_runtime)
+    {
+        const int n = dim(n_runtime);
+        int k = 0;
+        for (int j = 0; j < n; ++j)
+        {
+            const double wu = w * u[j];
+            for (int i = 0; i <= j; ++i)
+                a[k++] += wu * u[i];
+        }
+    }
+
+    /// a += scale b
+    static void add(double *a, const double *b, const double scale, const int n_runtime)
+    {
+        const int n = dim(n_runtime);
+        const int size = n * (n + 1) / 2;
+        for (int k = 0; k < size; ++k)
+            a[k] += scale * b[k];
+    }
+
+    /// In-place Cholesky a = L L^T, L stored row by row in the packed layout.
+    /// Returns false if a is not positive definite.
+    static bool cholesky(double *a, const int n_runtime)
+    {
+        const int n = dim(n_runtime);
+        for (int i = 0; i < n; ++i)
+        {
+            double *row_i = a + i * (i + 1) / 2;
+            for (int j = 0; j <= i; ++j)
+            {
+                const double *row_j = a + j * (j + 1) / 2;
+                double sum = row_i[j];
+                for (int k = 0; k < j; ++k)
+                    sum -= row_i[k] * row_j[k];
+
+                if (i == j)
+                {
+                    if (!(sum > 0.0) || !std::isfinite(sum))
+                        return false;
+                    row_i[i] = std::sqrt(sum);
+                }
+                else
+                    row_i[j] = sum / row_j[j];
+            }
+        }
+        return true;
+    }
+
+    /// Solves L x = b in place, for b vanishing above index `first`.
+    static void forward(const double *l, double *x, const int first, const int n_runtime)
+    {
+        const int n = dim(n_runtime);
+        for (int i = 0; i < first; ++i)
+            x[i] = 0.0;
+
+        for (int i = first; i < n; ++i)
+        {
+            const double *row = l + i * (i + 1) / 2;
+            double sum = x[i];
+            for (int k = first; k < i; ++k)
+                sum -= row[k] * x[k];
+            x[i] = sum / row[i];
+        }
+    }
+};
+
+/// Kernel entry points resolved once for a given dimension.
+struct PackedSymOps
+{
+    void (*rank_one)(double *, const double *, double, int) = &PackedSymKernel<0>::rank_one;
+    void (*add)(double *, const double *, double, int) = &PackedSymKernel<0>::add;
+    bool (*cholesky)(double *, int) = &PackedSymKernel<0>::cholesky;
+    void (*forward)(const double *, double *, int, int) = &PackedSymKernel<0>::forward;
+};
+
+template <int N>
+PackedSymOps make_packed_sym_ops()
+{
+    PackedSymOps ops;
+    ops.rank_one = &PackedSymKernel<N>::rank_one;
+    ops.add = &PackedSymKernel<N>::add;
+    ops.cholesky = &PackedSymKernel<N>::cholesky;
+    ops.forward = &PackedSymKernel<N>::forward;
+    return ops;
+}
+
+/// Specialised kernels for the common parameter counts, dynamic otherwise.
+inline PackedSymOps packed_sym_ops(const int n)
+{
+    switch (n)
+    {
+    case 1: return make_packed_sym_ops<1>();
+    case 2: return make_packed_sym_ops<2>();
+    case 3: return make_packed_sym_ops<3>();
+    case 4: return make_packed_sym_ops<4>();
+    case 5: return make_packed_sym_ops<5>();
+    case 6: return make_packed_sym_ops<6>();
+    case 7: return make_packed_sym_ops<7>();
+    case 8: return make_packed_sym_ops<8>();
+    default: return make_packed_sym_ops<0>();
+    }
+}
+
+#endif // HERON_PLOT_PACKED_SYM_MATRIX_H
@@ -10,6 +10,7 @@
 #define HERON_PLOT_DESCRIPTORS_H
 
 #include <cctype>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -79,6 +80,15 @@ struct Options
     std::vector<int> signal_channels;
     std::shared_ptr<TMatrixDSym> total_cov;
     std::vector<double> syst_bin;
+    // MC statistical covariance replacing the sumw2 errors in the band and
+    // chi². Either given here (e.g. SystematicUniverseHist::mc_stat_covariance_ptr)
+    // or, when bootstrap_universes > 0, filled by StackedHist from Poisson
+    // bootstrap replicas in the same event loop as the stack (not from a
+    // HistogramCache, which has no events). Its size must equal the plot's
+    // bin count.
+    std::shared_ptr<TMatrixDSym> mc_stat_cov;
+    int bootstrap_universes = 0;
+    std::uint64_t bootstrap_seed = 0;
     std::vector<CutSpec> cuts;
     double total_protons_on_target = 0.0;
     std::string beamline;
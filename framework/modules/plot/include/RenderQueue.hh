@@ -0,0 +1,140 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/include/RenderQueue.hh
+ *
+ *  @brief Render queue that fans canvas drawing for filled stacked/unstacked
+ *         histograms out to forked batch-mode worker processes and collects
+ *         the outputs, including a merged multi-page PDF, in queue order.
+ */
+
+#ifndef HERON_PLOT_RENDER_QUEUE_H
+#define HERON_PLOT_RENDER_QUEUE_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "HistogramCache.hh"
+#include "PlotDescriptors.hh"
+
+
+namespace nu
+{
+
+class RenderQueue
+{
+  public:
+    enum class Kind
+    {
+        kStacked,
+        kUnstacked
+    };
+
+    // Jobs hold filled histograms only; workers inherit them through fork, so
+    // no event loop or RDataFrame state is touched after the fork.
+    struct Job
+    {
+        Kind kind = Kind::kStacked;
+        TH1DModel spec;
+        Options opt;
+        HistogramCache cache;
+    };
+
+    struct Config
+    {
+        // 0 => one worker per hardware thread; 1 renders in-process.
+        int n_workers = 0;
+        // If set, every job also contributes one page (in queue order).
+        std::string merged_pdf;
+        // Per-page PDFs and worker status files; defaults to a fresh
+        // directory next to merged_pdf (or under the system temp dir).
+        std::string scratch_dir;
+        bool keep_pages = false;
+    };
+
+    struct Output
+    {
+        std::string path;
+        bool ok = false;
+    };
+
+    RenderQueue();
+    explicit RenderQueue(Config cfg);
+
+    std::size_t add_stacked(TH1DModel spec, Options opt, HistogramCache cache);
+    std::size_t add_unstacked(TH1DModel spec, Options opt, HistogramCache cache);
+
+    std::size_t size() const noexcept { return jobs_.size(); }
+
+    // Renders every queued job and returns outputs aligned with queue order.
+    std::vector<Output> run();
+
+    // Calls render(i) for every i < n_jobs, round-robin over n_workers forked
+    // batch-mode processes (in-process if n_workers <= 1), and returns the
+    // per-job results in job order. Status files go to scratch_dir. Call it
+    // only once every event loop feeding the jobs has run: the implicit-MT
+    // pool is shut down before forking and restored afterwards.
+    static std::vector<bool> run_forked(std::size_t n_jobs,
+                                        int n_workers,
+                                        const std::string &scratch_dir,
+                                        const std::function<bool(std::size_t)> &render);
+
+    // Forked workers fed while an event loop is still running, so a caller
+    // can hand jobs over in bounded batches instead of buffering all of them.
+    // The workers are forked on construction, before the loop starts, with
+    // the implicit-MT pool shut down across the fork. Each reads jobs (opaque
+    // bytes) from a socket and calls render(index, bytes); status files go
+    // to scratch_dir. submit() is thread-safe, assigns jobs round-robin by
+    // index and blocks while that worker's socket is full. finish() reaps
+    // the workers and returns the per-job results by index.
+    class Stream
+    {
+      public:
+        using Render = std::function<bool(std::size_t, const std::string &)>;
+
+        Stream(int n_workers, const std::string &scratch_dir, const Render &render);
+        ~Stream();
+
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+
+        std::size_t submit(const std::string &payload);
+        std::vector<bool> finish();
+
+      private:
+        std::vector<pid_t> pids_;
+        std::vector<int> sockets_;
+        std::vector<std::unique_ptr<std::mutex>> locks_;
+        std::vector<std::string> status_files_;
+        std::atomic<std::size_t> n_submitted_{0};
+        bool finished_ = false;
+        std::vector<bool> ok_;
+    };
+
+    // Concatenates PDFs with pdfunite or gs; false if neither is available.
+    static bool merge_pdfs(const std::vector<std::string> &pages, const std::string &output);
+
+    static std::string page_name(std::size_t index);
+
+    // Creates a new, uniquely named directory <parent>/<prefix>XXXXXX (mkdtemp).
+    static std::string make_scratch_dir(const std::string &parent, const std::string &prefix);
+
+  private:
+    static std::string output_path(const Job &job);
+    static bool render(const Job &job, const std::string &page_pdf);
+    int worker_count() const;
+
+    Config cfg_;
+    std::vector<Job> jobs_;
+};
+
+} // namespace nu
+
+
+#endif // HERON_PLOT_RENDER_QUEUE_H
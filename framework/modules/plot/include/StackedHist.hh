@@ -21,7 +21,10 @@
 #include "TPaveText.h"
 #include "TPad.h"
 
+#include "CovarianceSolver.hh"
 #include "EventListIO.hh"
+#include "EventListSet.hh"
+#include "HistogramCache.hh"
 #include "PlotDescriptors.hh"
 
 
@@ -32,9 +35,16 @@ class StackedHist
 {
   public:
     StackedHist(TH1DModel spec, Options opt, const EventListIO &event_list);
+    // Several periods as one dataset, split on the global sample ids.
+    StackedHist(TH1DModel spec, Options opt, const EventListSet &event_lists);
+    // Draws from pre-filled (typically rebinned) histograms; no event loop.
+    StackedHist(TH1DModel spec, Options opt, HistogramCache cache);
     ~StackedHist() = default;
 
-    void draw_and_save(const std::string &image_format);
+    // extra_outputs are additional files written from the same canvas (e.g. a
+    // PDF page for RenderQueue's merged document).
+    void draw_and_save(const std::string &image_format,
+                       const std::vector<std::string> &extra_outputs = {});
 
   protected:
     void draw(TCanvas &canvas);
@@ -43,6 +53,10 @@ class StackedHist
     bool has_data() const { return data_hist_ && data_hist_->GetEntries() > 0.0; }
     bool want_ratio() const { return opt_.show_ratio && has_data() && mc_total_; }
     void build_histograms();
+    void init_entries(ROOT::RDF::RNode base,
+                      const std::shared_ptr<const std::vector<char>> &data_mask,
+                      const std::shared_ptr<const std::vector<char>> &ext_mask,
+                      const std::string &sample_id_column);
     void setup_pads(TCanvas &c, TPad *&p_main, TPad *&p_ratio, TPad *&p_legend) const;
     void draw_stack_and_unc(TPad *p_main, double &max_y);
     void draw_ratio(TPad *p_ratio);
@@ -55,6 +69,7 @@ class StackedHist
     std::vector<const Entry *> mc_;
     std::vector<const Entry *> data_;
     std::vector<Entry> owned_entries_;
+    std::shared_ptr<const HistogramCache> cache_;
     std::string plot_name_;
     std::string output_directory_;
     std::unique_ptr<THStack> stack_;
@@ -62,6 +77,10 @@ class StackedHist
     std::unique_ptr<TH1D> mc_total_;
     // A copy of the MC total with *statistical* errors only (after any density scaling).
     std::unique_ptr<TH1D> mc_total_stat_;
+    // MC stat covariance (bootstrap or Options::mc_stat_cov), and its sum with
+    // Options::total_cov as used by the chi².
+    std::shared_ptr<TMatrixDSym> mc_stat_cov_;
+    std::shared_ptr<const VersionedCovariance> chi2_cov_;
     std::unique_ptr<TH1D> data_hist_;
     std::unique_ptr<TH1D> mc_unc_hist_;
     std::unique_ptr<TH1D> sig_hist_;
@@ -0,0 +1,140 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/include/SystematicUniverseHist.hh
+ *
+ *  @brief Multisim universe histogramming engine that fills every universe of
+ *         every systematic family in a single event loop and reduces the
+ *         result to per-channel covariance and correlation matrices.
+ */
+
+#ifndef HERON_PLOT_SYSTEMATIC_UNIVERSE_HIST_H
+#define HERON_PLOT_SYSTEMATIC_UNIVERSE_HIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+#include <TH1D.h>
+#include <TMatrixDSym.h>
+
+#include "PlotDescriptors.hh"
+
+
+namespace nu
+{
+
+class SystematicUniverseHist
+{
+  public:
+    // One multisim family (e.g. flux, genie, reint). The column holds one
+    // multiplicative weight per universe, applied on top of TH1DModel::weight.
+    // Bootstrap families have no column: Poisson(1) weights are generated in
+    // the fill from (run, sub, evt, universe), giving MC statistical universes.
+    struct Family
+    {
+        std::string name;
+        std::string column;
+        int n_universes = 0;
+        bool bootstrap = false;
+        std::uint64_t seed = 0;
+    };
+
+    static Family bootstrap_family(std::string name, int n_universes, std::uint64_t seed = 0)
+    {
+        Family f;
+        f.name = std::move(name);
+        f.n_universes = n_universes;
+        f.bootstrap = true;
+        f.seed = seed;
+        return f;
+    }
+
+    // Per-slot (and, after the event loop, merged) universe sums for one
+    // family. Storage is bin-major: the universes of a bin are contiguous so
+    // the per-event update is a unit-stride multiply-add over universes.
+    struct UniverseSums
+    {
+        int n_channels = 0;
+        int n_bins = 0; // including underflow/overflow
+        int n_universes = 0;
+        std::vector<double> sumw;
+
+        std::size_t offset(int ci, int bin) const
+        {
+            return (static_cast<std::size_t>(ci) * static_cast<std::size_t>(n_bins) +
+                    static_cast<std::size_t>(bin)) *
+                   static_cast<std::size_t>(n_universes);
+        }
+    };
+
+    enum class Centre
+    {
+        kNominal, // deviations from the central-value histogram
+        kMean     // deviations from the mean over universes
+    };
+
+    SystematicUniverseHist(TH1DModel spec, std::vector<Family> families, Options opt = Options{});
+
+    // Books the central value and all families on every MC entry and runs one
+    // event loop per entry.
+    void compute(const std::vector<const Entry *> &mc);
+
+    bool ready() const noexcept { return ready_; }
+
+    Centre centre() const noexcept { return centre_; }
+    void set_centre(Centre c) noexcept { centre_ = c; }
+    // Non-finite or negative universe weights are replaced by 1 when enabled.
+    bool sanitise_weights() const noexcept { return sanitise_weights_; }
+    void set_sanitise_weights(bool v) noexcept { sanitise_weights_ = v; }
+
+    const TH1DModel &spec() const noexcept { return spec_; }
+    const std::vector<Family> &families() const noexcept { return families_; }
+    const std::vector<int> &channel_keys() const noexcept { return channel_keys_; }
+
+    // Central-value histograms (sum over channels when channel < 0).
+    std::unique_ptr<TH1D> nominal_hist(int channel = -1) const;
+    std::unique_ptr<TH1D> universe_hist(const std::string &family, int universe, int channel = -1) const;
+
+    // Covariance over the in-range bins, indexed [bin-1][bin-1] so it can be
+    // handed to Plotter::draw_stack_cov / Options::total_cov unchanged.
+    TMatrixDSym covariance(const std::string &family, int channel = -1) const;
+    // Sum over non-bootstrap families.
+    TMatrixDSym total_covariance(int channel = -1) const;
+    // Sum over bootstrap families: the MC statistical covariance, for
+    // Options::mc_stat_cov (StackedHist then uses it in place of sumw2).
+    TMatrixDSym mc_stat_covariance(int channel = -1) const;
+    // Per-bin variance of one family; for a bootstrap family this is the MC
+    // statistical variance, usable as TemplateBinningOptimizer1D::Channel::p_mc_variance.
+    std::unique_ptr<TH1D> variance_hist(const std::string &family, int channel = -1) const;
+    std::shared_ptr<TMatrixDSym> total_covariance_ptr(int channel = -1) const;
+    std::shared_ptr<TMatrixDSym> mc_stat_covariance_ptr(int channel = -1) const;
+
+    static TMatrixDSym correlation(const TMatrixDSym &cov);
+
+  private:
+    int channel_index(int channel) const;
+    std::size_t family_index(const std::string &family) const;
+    void universe_counts(const UniverseSums &sums, int channel, std::vector<double> &out) const;
+    void nominal_counts(int channel, std::vector<double> &out) const;
+
+    TH1DModel spec_;
+    std::vector<Family> families_;
+    Options opt_;
+    Centre centre_ = Centre::kNominal;
+    bool sanitise_weights_ = true;
+    bool ready_ = false;
+
+    std::vector<int> channel_keys_;
+    std::vector<int> channel_lookup_;
+    std::vector<std::unique_ptr<TH1D>> nominal_;
+    std::vector<UniverseSums> sums_;
+};
+
+} // namespace nu
+
+
+#endif // HERON_PLOT_SYSTEMATIC_UNIVERSE_HIST_H
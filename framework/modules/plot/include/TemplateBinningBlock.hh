@@ -3,6 +3,9 @@
  *  @file framework/modules/plot/include/TemplateBinningBlock.hh
  *
  *  @brief Block-style binning container for template-based optimisation output.
+ *
+ *  Higher dimensions are conditional: every x bin carries its own y edges and
+ *  every (x, y) bin its own z edges; a rectilinear binning simply repeats them.
  */
 
 #ifndef heron_plot_template_binning_block_H
@@ -21,11 +24,25 @@ class TemplateBinningBlock : public TNamed
                          const std::vector<double> &edges,
                          const std::string &selection,
                          int bin_type);
+    TemplateBinningBlock(const std::string &name,
+                         const std::string &title,
+                         const std::vector<double> &x_edges,
+                         const std::vector<std::vector<double>> &y_edges,
+                         const std::string &selection,
+                         int bin_type);
+    TemplateBinningBlock(const std::string &name,
+                         const std::string &title,
+                         const std::vector<double> &x_edges,
+                         const std::vector<std::vector<double>> &y_edges,
+                         const std::vector<std::vector<std::vector<double>>> &z_edges,
+                         const std::string &selection,
+                         int bin_type);
     virtual ~TemplateBinningBlock() = default;
 
     int GetNBinsX() const;
     int GetNBinsY(int idx) const;
     int GetNBinsZ(int idx, int idy) const;
+    int GetNBinsTotal() const;
 
     std::string GetBinDef(int idx) const;
     std::string GetBinDef(int x, int y) const;
@@ -37,6 +54,8 @@ class TemplateBinningBlock : public TNamed
     Double_t GetBinXHigh(int i) const;
     Double_t GetBinYLow(int i, int j) const;
     Double_t GetBinYHigh(int i, int j) const;
+    Double_t GetBinZLow(int i, int j, int k) const;
+    Double_t GetBinZHigh(int i, int j, int k) const;
 
     std::string GetXName() const;
     std::string GetXNameUnit() const;
@@ -75,8 +94,11 @@ class TemplateBinningBlock : public TNamed
     std::string m_name;
     std::string m_title;
     std::vector<double> m_edges;
+    std::vector<std::vector<double>> m_y_edges;
+    std::vector<std::vector<std::vector<double>>> m_z_edges;
     std::string m_selection;
     int m_bin_type = 0;
+    int m_dimension = 1;
 
     std::vector<std::string> m_bin_def;
 
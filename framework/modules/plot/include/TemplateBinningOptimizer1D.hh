@@ -9,6 +9,7 @@
 #ifndef HERON_PLOT_TEMPLATE_BINNING_OPTIMIZER_1D_H
 #define HERON_PLOT_TEMPLATE_BINNING_OPTIMIZER_1D_H
 
+#include <cstdint>
 #include <iosfwd>
 #include <limits>
 #include <memory>
@@ -28,6 +29,11 @@ class TemplateBinningBlock;
  *
  *  Inputs are ROOT histograms (nominal + parameter variations or derivatives).
  *  Output is a vector of bin edges suitable for TH1::Rebin(..., edges.data()).
+ *
+ *  Merging is incremental: each adjacent pair keeps a cached candidate that is
+ *  rebuilt only when one of its bins is merged, and candidates are priced by a
+ *  rank-r update of the POI variance. With an unprofiled objective the costs
+ *  sit in a lazily re-priced heap. The result is identical to a full rescan.
  */
 class TemplateBinningOptimizer1D final
 {
@@ -54,10 +60,19 @@ class TemplateBinningOptimizer1D final
         std::string name;
         /// Expected total (signal+background) reco template, fine-binned.
         const TH1 *p_nominal = nullptr;
+        /// Optional per-bin MC variance (e.g. bootstrap); replaces the sumw2 of p_nominal.
+        const TH1 *p_mc_variance = nullptr;
         /// POI + selected nuisances (optional).
         std::vector<Parameter> parameters;
     };
 
+    /// One multi-start setting; overrides the corresponding Config fields.
+    struct Start
+    {
+        double width_penalty = 0.0;
+        std::uint64_t tie_seed = 0;
+    };
+
     struct Config
     {
         /// Constraints applied during merging.
@@ -77,6 +92,18 @@ class TemplateBinningOptimizer1D final
         /// Optional small preference against wide bins (tie-breaker).
         double width_penalty = 0.0;
 
+        /// Equal-cost merges: 0 keeps the leftmost pair, any other seed breaks
+        /// ties by a seeded hash of the pair position.
+        std::uint64_t tie_seed = 0;
+
+        /// Threads pricing candidate merges (0 => hardware concurrency). The
+        /// chosen merges do not depend on the thread count.
+        int n_threads = 1;
+
+        /// Multi-start: if non-empty, run once per entry (concurrently, up to
+        /// n_threads) and return the best run, with every run in Result::runs.
+        std::vector<Start> starts;
+
         /// Diagnostics.
         bool verbose = false;
         std::ostream *p_log = nullptr;
@@ -93,12 +120,25 @@ class TemplateBinningOptimizer1D final
         bool passes_constraints = true;
     };
 
+    struct Run
+    {
+        Start start;
+        std::vector<double> edges;
+        double expected_sigma_poi = std::numeric_limits<double>::infinity();
+        std::vector<BinReport> bins;
+    };
+
     struct Result
     {
         std::vector<double> edges;
         double expected_sigma_poi = std::numeric_limits<double>::infinity();
         std::vector<BinReport> bins;
 
+        /// Multi-start only: every run in start order. The best one is the
+        /// first of those with all bins passing, else of all, with the
+        /// smallest expected_sigma_poi.
+        std::vector<Run> runs;
+
         std::shared_ptr<TemplateBinningBlock> make_block(const std::string &name,
                                                          const std::string &title,
                                                          const std::string &selection = "",
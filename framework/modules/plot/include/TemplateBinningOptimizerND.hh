@@ -0,0 +1,112 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/modules/plot/include/TemplateBinningOptimizerND.hh
+ *
+ *  @brief Greedy bin merger for 2D/3D reco-space binning on fine-binned
+ *         TH2/TH3 templates, with the objective and constraints of the 1D
+ *         optimiser.
+ */
+
+#ifndef HERON_PLOT_TEMPLATE_BINNING_OPTIMIZER_ND_H
+#define HERON_PLOT_TEMPLATE_BINNING_OPTIMIZER_ND_H
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TemplateBinningOptimizer1D.hh"
+
+class TemplateBinningBlock;
+
+/**
+ *  @brief Template-based 2D/3D binning optimiser.
+ *
+ *  Channels and parameters are those of TemplateBinningOptimizer1D, with
+ *  TH2/TH3 histograms sharing one fine binning. All cell sums come from
+ *  cumulative-sum tables built once over the fine grid, so any box of fine
+ *  bins costs a constant number of lookups.
+ *
+ *  Strategies:
+ *   - conditional: x edges from the x projection, then y edges per x bin,
+ *                  then z edges per (x, y) bin, each with the 1D optimiser
+ *   - rectilinear: shared edges per axis; greedily merges whole adjacent
+ *                  rows/columns/planes, every resulting cell constrained
+ *
+ *  Output is a conditional TemplateBinningBlock either way.
+ */
+class TemplateBinningOptimizerND final
+{
+  public:
+    using Parameter = TemplateBinningOptimizer1D::Parameter;
+    using Channel = TemplateBinningOptimizer1D::Channel;
+
+    enum class Strategy
+    {
+        kConditional,
+        kRectilinear
+    };
+
+    struct Config
+    {
+        /// Objective, constraints, threading and diagnostics as in 1D. The
+        /// conditional strategy optimises every slice with it; in the
+        /// rectilinear strategy max_bins limits the total number of cells.
+        TemplateBinningOptimizer1D::Config base;
+
+        Strategy strategy = Strategy::kConditional;
+
+        /// Per-axis bin limits (<= 0 => none); per slice when conditional.
+        int max_bins_x = -1;
+        int max_bins_y = -1;
+        int max_bins_z = -1;
+    };
+
+    struct CellReport
+    {
+        double x_low = 0.0;
+        double x_high = 0.0;
+        double y_low = 0.0;
+        double y_high = 0.0;
+        double z_low = 0.0;
+        double z_high = 0.0;
+
+        double mu_sum = 0.0;
+        double rel_mc_worst = 0.0;
+
+        bool passes_constraints = true;
+    };
+
+    struct Result
+    {
+        int dimension = 2;
+
+        std::vector<double> x_edges;
+        /// y edges per x bin.
+        std::vector<std::vector<double>> y_edges;
+        /// z edges per (x, y) bin; empty in 2D.
+        std::vector<std::vector<std::vector<double>>> z_edges;
+
+        double expected_sigma_poi = std::numeric_limits<double>::infinity();
+        /// Cells ordered x, then y, then z.
+        std::vector<CellReport> cells;
+
+        std::shared_ptr<TemplateBinningBlock> make_block(const std::string &name,
+                                                         const std::string &title,
+                                                         const std::string &selection = "",
+                                                         int bin_type = 1) const;
+    };
+
+    explicit TemplateBinningOptimizerND(Config cfg);
+
+    /// Optimise using a single channel.
+    Result optimise(const Channel &channel) const;
+
+    /// Optimise using multiple channels and return shared edges.
+    Result optimise(const std::vector<Channel> &channels) const;
+
+  private:
+    Config m_cfg;
+};
+
+#endif // HERON_PLOT_TEMPLATE_BINNING_OPTIMIZER_ND_H
@@ -16,6 +16,7 @@
 #include <THStack.h>
 #include <TLegend.h>
 
+#include "HistogramCache.hh"
 #include "PlotDescriptors.hh"
 
 class TCanvas;
@@ -31,9 +32,14 @@ class UnstackedHist
                   Options opt,
                   std::vector<const Entry *> mc,
                   std::vector<const Entry *> data);
+    // Draws from pre-filled (typically rebinned) histograms; no event loop.
+    UnstackedHist(TH1DModel spec, Options opt, HistogramCache cache);
 
     void draw(TCanvas &canvas);
-    void draw_and_save(const std::string &image_format);
+    // extra_outputs are additional files written from the same canvas (e.g. a
+    // PDF page for RenderQueue's merged document).
+    void draw_and_save(const std::string &image_format,
+                       const std::vector<std::string> &extra_outputs = {});
 
   private:
     bool has_data() const noexcept { return static_cast<bool>(data_hist_); }
@@ -53,6 +59,7 @@ class UnstackedHist
     Options opt_;
     std::vector<const Entry *> mc_;
     std::vector<const Entry *> data_;
+    std::shared_ptr<const HistogramCache> cache_;
 
     std::string plot_name_;
     std::string output_directory_;
@@ -0,0 +1,315 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/src/CovarianceSolver.cc
+ *
+ *  @brief Cached Cholesky solves for plot chi² and uncertainty bands.
+ */
+
+#include "CovarianceSolver.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace nu
+{
+
+namespace
+{
+
+constexpr std::size_t k_max_cached_factors = 32;
+
+struct FactorKey
+{
+    std::uint64_t generation = 0;
+    int cov_rows = 0;
+    int n_bins = 0;
+    // Fingerprint of (bins, scale, diag_var): O(n), unlike the matrix.
+    std::uint64_t fingerprint = 0;
+
+    bool operator<(const FactorKey &o) const
+    {
+        return std::tie(generation, cov_rows, n_bins, fingerprint) <
+               std::tie(o.generation, o.cov_rows, o.n_bins, o.fingerprint);
+    }
+};
+
+std::uint64_t fingerprint_add(std::uint64_t h, double x)
+{
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &x, sizeof(bits));
+    h ^= bits;
+    h *= 1099511628211ULL;
+    return h;
+}
+
+std::uint64_t fingerprint(const std::vector<double> &v, std::uint64_t h = 1469598103934665603ULL)
+{
+    for (double x : v)
+    {
+        h = fingerprint_add(h, x);
+    }
+    return h;
+}
+
+std::mutex &cache_mutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+template <typename Factor>
+std::map<FactorKey, std::shared_ptr<const Factor>> &cache()
+{
+    static std::map<FactorKey, std::shared_ptr<const Factor>> c;
+    return c;
+}
+
+inline std::size_t packed_index(int i, int j)
+{
+    return static_cast<std::size_t>(i) * (i + 1) / 2 + j;
+}
+
+} // namespace
+
+VersionedCovariance::VersionedCovariance()
+    : generation_(next_generation())
+{
+}
+
+VersionedCovariance::VersionedCovariance(const TMatrixDSym &m)
+    : matrix_(m),
+      generation_(next_generation())
+{
+}
+
+TMatrixDSym &VersionedCovariance::edit()
+{
+    generation_ = next_generation();
+    return matrix_;
+}
+
+std::uint64_t VersionedCovariance::next_generation()
+{
+    static std::atomic<std::uint64_t> counter{0};
+    return ++counter;
+}
+
+void CovarianceSolver::apply_total_errors(TH1D &h,
+                                          const TMatrixDSym *cov,
+                                          const std::vector<double> *syst_bin,
+                                          bool density_mode)
+{
+    const int nb = h.GetNbinsX();
+    const int n_cov = cov ? cov->GetNrows() : 0;
+    const double *a = cov ? cov->GetMatrixArray() : nullptr;
+    const int n_syst = syst_bin ? static_cast<int>(syst_bin->size()) : 0;
+    const TAxis *axis = h.GetXaxis();
+
+    for (int i = 1; i <= nb; ++i)
+    {
+        const double stat = h.GetBinError(i);
+        double syst = 0.0;
+        if (i - 1 < n_cov)
+        {
+            syst = std::sqrt(std::max(0.0, a[static_cast<std::size_t>(i - 1) * n_cov + (i - 1)]));
+        }
+        else if (i - 1 < n_syst)
+        {
+            syst = std::max(0.0, (*syst_bin)[i - 1]);
+        }
+
+        // Density-scaled contents need syst in the same units: V'_ii = V_ii / w_i^2.
+        if (density_mode)
+        {
+            const double w = axis ? axis->GetBinWidth(i) : 0.0;
+            if (w > 0.0)
+            {
+                syst /= w;
+            }
+        }
+
+        h.SetBinError(i, std::sqrt(stat * stat + syst * syst));
+    }
+}
+
+std::unique_ptr<TH1D> CovarianceSolver::ratio_band(const TH1D &mc_total, const std::string &name)
+{
+    std::unique_ptr<TH1D> band(static_cast<TH1D *>(mc_total.Clone(name.c_str())));
+    band->SetDirectory(nullptr);
+    const int nb = band->GetNbinsX();
+    for (int i = 1; i <= nb; ++i)
+    {
+        const double m = mc_total.GetBinContent(i);
+        const double em = mc_total.GetBinError(i);
+        band->SetBinContent(i, 1.0);
+        band->SetBinError(i, (m > 0 ? em / m : 0.0));
+    }
+    return band;
+}
+
+bool CovarianceSolver::decompose(std::vector<double> &p, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        double *row_i = p.data() + packed_index(i, 0);
+        for (int j = 0; j <= i; ++j)
+        {
+            const double *row_j = p.data() + packed_index(j, 0);
+            double s = row_i[j];
+            for (int k = 0; k < j; ++k)
+            {
+                s -= row_i[k] * row_j[k];
+            }
+            if (i == j)
+            {
+                if (!(s > 0.0))
+                {
+                    return false;
+                }
+                row_i[i] = std::sqrt(s);
+            }
+            else
+            {
+                row_i[j] = s / row_j[j];
+            }
+        }
+    }
+    return true;
+}
+
+double CovarianceSolver::solve_norm2(const Factor &f, const std::vector<double> &r)
+{
+    // Forward substitution L y = r; chi² = |y|^2 = r^T V^-1 r.
+    std::vector<double> y(static_cast<std::size_t>(f.n));
+    double norm2 = 0.0;
+    for (int i = 0; i < f.n; ++i)
+    {
+        const double *row = f.l.data() + packed_index(i, 0);
+        double s = r[static_cast<std::size_t>(i)];
+        for (int k = 0; k < i; ++k)
+        {
+            s -= row[k] * y[static_cast<std::size_t>(k)];
+        }
+        y[static_cast<std::size_t>(i)] = s / row[i];
+        norm2 += y[static_cast<std::size_t>(i)] * y[static_cast<std::size_t>(i)];
+    }
+    return norm2;
+}
+
+std::vector<double> CovarianceSolver::pack(const TMatrixDSym &cov,
+                                           const std::vector<int> &bins,
+                                           const std::vector<double> &scale,
+                                           const std::vector<double> &diag_var)
+{
+    const int n = static_cast<int>(bins.size());
+    const int n_cov = cov.GetNrows();
+    const double *a = cov.GetMatrixArray();
+
+    std::vector<double> packed(packed_index(n, 0), 0.0);
+    for (int i = 0; i < n; ++i)
+    {
+        const int bi = bins[static_cast<std::size_t>(i)] - 1;
+        double *row = packed.data() + packed_index(i, 0);
+        if (bi < n_cov)
+        {
+            const double *cov_row = a + static_cast<std::size_t>(bi) * n_cov;
+            const double si = scale[static_cast<std::size_t>(i)];
+            for (int j = 0; j <= i; ++j)
+            {
+                const int bj = bins[static_cast<std::size_t>(j)] - 1;
+                if (bj < n_cov)
+                {
+                    row[j] = cov_row[bj] * si * scale[static_cast<std::size_t>(j)];
+                }
+            }
+        }
+        row[i] += diag_var[static_cast<std::size_t>(i)];
+    }
+    return packed;
+}
+
+std::shared_ptr<const CovarianceSolver::Factor> CovarianceSolver::factor(const VersionedCovariance &cov,
+                                                                         const std::vector<int> &bins,
+                                                                         const std::vector<double> &scale,
+                                                                         const std::vector<double> &diag_var)
+{
+    const int n = static_cast<int>(bins.size());
+
+    FactorKey key;
+    key.generation = cov.generation();
+    key.cov_rows = cov.matrix().GetNrows();
+    key.n_bins = n;
+    std::uint64_t h = 1469598103934665603ULL;
+    for (int b : bins)
+    {
+        h = fingerprint_add(h, static_cast<double>(b));
+    }
+    key.fingerprint = fingerprint(diag_var, fingerprint(scale, h));
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex());
+        auto &c = cache<Factor>();
+        auto it = c.find(key);
+        if (it != c.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::vector<double> packed = pack(cov.matrix(), bins, scale, diag_var);
+    if (!decompose(packed, n))
+    {
+        return nullptr;
+    }
+
+    auto f = std::make_shared<Factor>();
+    f->n = n;
+    f->l = std::move(packed);
+
+    std::lock_guard<std::mutex> lock(cache_mutex());
+    auto &c = cache<Factor>();
+    if (c.size() >= k_max_cached_factors)
+    {
+        c.clear();
+    }
+    c.emplace(key, f);
+    return f;
+}
+
+bool CovarianceSolver::chi2(const VersionedCovariance &cov,
+                            const std::vector<int> &bins,
+                            const std::vector<double> &scale,
+                            const std::vector<double> &diag_var,
+                            const std::vector<double> &resid,
+                            double &chi2_out)
+{
+    chi2_out = 0.0;
+    if (bins.empty() || scale.size() != bins.size() || diag_var.size() != bins.size() ||
+        resid.size() != bins.size())
+    {
+        return false;
+    }
+
+    const auto f = factor(cov, bins, scale, diag_var);
+    if (!f)
+    {
+        return false;
+    }
+    chi2_out = solve_norm2(*f, resid);
+    return true;
+}
+
+void CovarianceSolver::clear_cache()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex());
+    cache<Factor>().clear();
+}
+
+} // namespace nu
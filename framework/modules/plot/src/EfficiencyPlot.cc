@@ -26,6 +26,7 @@
 #include <TStyle.h>
 #include <TSystem.h>
 
+#include "BootstrapWeights.hh"
 #include "PlotEnv.hh"
 
 
@@ -165,6 +166,7 @@ int EfficiencyPlot::compute(ROOT::RDF::RNode denom_node, ROOT::RDF::RNode pass_n
     h_total_.reset();
     h_passed_.reset();
     g_eff_.reset();
+    eff_bootstrap_err_.clear();
     n_denom_ = 0;
     n_pass_ = 0;
 
@@ -222,6 +224,17 @@ int EfficiencyPlot::compute(ROOT::RDF::RNode denom_node, ROOT::RDF::RNode pass_n
                                      spec_.expr);
     }
 
+    ROOT::RDF::RResultPtr<BootstrapSums> btot_r;
+    ROOT::RDF::RResultPtr<BootstrapSums> bpas_r;
+    if (cfg_.bootstrap_universes > 0)
+    {
+        const std::vector<double> edges = uniform_edges(nbins, xmin, xmax);
+        btot_r = book_bootstrap(denom_finite, edges, spec_.expr, spec_.weight,
+                                cfg_.bootstrap_universes, cfg_.bootstrap_seed);
+        bpas_r = book_bootstrap(pass_finite, edges, spec_.expr, spec_.weight,
+                                cfg_.bootstrap_universes, cfg_.bootstrap_seed);
+    }
+
     TH1D *htot = htot_r.GetPtr();
     TH1D *hpas = hpas_r.GetPtr();
     if (htot == nullptr || hpas == nullptr)
@@ -270,6 +283,52 @@ int EfficiencyPlot::compute(ROOT::RDF::RNode denom_node, ROOT::RDF::RNode pass_n
         return 1;
     }
 
+    if (cfg_.bootstrap_universes > 0)
+    {
+        const BootstrapSums &btot = *btot_r;
+        const BootstrapSums &bpas = *bpas_r;
+        eff_bootstrap_err_.assign(static_cast<std::size_t>(btot.n_bins), 0.0);
+        for (int b = 0; b < btot.n_bins; ++b)
+        {
+            double sum = 0.0;
+            double sum2 = 0.0;
+            int n_used = 0;
+            for (int u = 0; u < btot.n_universes; ++u)
+            {
+                const double tot = btot.at(b, u);
+                if (!(tot > 0.0))
+                {
+                    continue;
+                }
+                const double e = bpas.at(b, u) / tot;
+                sum += e;
+                sum2 += e * e;
+                ++n_used;
+            }
+            if (n_used > 1)
+            {
+                const double mean = sum / n_used;
+                eff_bootstrap_err_[b] = std::sqrt(std::max(0.0, (sum2 - n_used * mean * mean) / (n_used - 1)));
+            }
+        }
+
+        if (cfg_.use_bootstrap_errors)
+        {
+            for (int i = 0; i < g_eff_->GetN(); ++i)
+            {
+                const int b = h_total_->FindFixBin(g_eff_->GetX()[i]);
+                if (b < 0 || b >= static_cast<int>(eff_bootstrap_err_.size()))
+                {
+                    continue;
+                }
+                const double y = g_eff_->GetY()[i];
+                const double err = eff_bootstrap_err_[b];
+                g_eff_->SetPointEYlow(i, std::min(err, y));
+                g_eff_->SetPointEYhigh(i, std::min(err, 1.0 - y));
+            }
+        }
+    }
+
     ready_ = true;
     return 0;
 }
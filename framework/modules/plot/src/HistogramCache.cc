@@ -0,0 +1,264 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/src/HistogramCache.cc
+ *
+ *  @brief Fine-binned histogram cache with exact rebinning.
+ */
+
+#include "HistogramCache.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ROOT/RDFHelpers.hxx"
+#include "ROOT/RResultHandle.hxx"
+
+#include "PlotChannels.hh"
+#include "TemplateBinningBlock.hh"
+
+namespace nu
+{
+
+namespace
+{
+
+std::vector<double> axis_edges(const TH1D &h)
+{
+    const TAxis *axis = h.GetXaxis();
+    const int n = axis->GetNbins();
+    std::vector<double> edges(static_cast<std::size_t>(n) + 1);
+    for (int i = 1; i <= n; ++i)
+    {
+        edges[static_cast<std::size_t>(i - 1)] = axis->GetBinLowEdge(i);
+    }
+    edges[static_cast<std::size_t>(n)] = axis->GetBinUpEdge(n);
+    return edges;
+}
+
+std::shared_ptr<const TH1D> sum_parts(std::vector<ROOT::RDF::RResultPtr<TH1D>> &parts, const std::string &name)
+{
+    std::unique_ptr<TH1D> sum;
+    for (auto &rr : parts)
+    {
+        const TH1D &h = rr.GetValue();
+        if (!sum)
+        {
+            sum.reset(static_cast<TH1D *>(h.Clone(name.c_str())));
+            sum->SetDirectory(nullptr);
+            if (sum->GetSumw2N() == 0)
+            {
+                sum->Sumw2();
+            }
+        }
+        else
+        {
+            sum->Add(&h);
+        }
+    }
+    return std::shared_ptr<const TH1D>(std::move(sum));
+}
+
+} // namespace
+
+HistogramCache HistogramCache::build(const TH1DModel &spec,
+                                     const Options &opt,
+                                     const std::vector<const Entry *> &mc,
+                                     const std::vector<const Entry *> &data)
+{
+    // Cover both the stacked channels and any UnstackedHist channel override,
+    // so one cache serves either plot.
+    std::vector<int> channels = Channels::mc_keys();
+    for (int ch : opt.unstack_channel_keys)
+    {
+        if (std::find(channels.begin(), channels.end(), ch) == channels.end())
+        {
+            channels.push_back(ch);
+        }
+    }
+    return build(spec, opt, mc, data, channels);
+}
+
+HistogramCache HistogramCache::build(const TH1DModel &spec,
+                                     const Options &opt,
+                                     const std::vector<const Entry *> &mc,
+                                     const std::vector<const Entry *> &data,
+                                     const std::vector<int> &channels)
+{
+    if (opt.particle_level)
+    {
+        throw std::runtime_error("HistogramCache::build: particle-level plots are not supported");
+    }
+
+    const std::string channel_column = opt.channel_column.empty() ? "analysis_channels" : opt.channel_column;
+    const std::string var = spec.expr.empty() ? spec.id : "_nx_expr_";
+
+    std::vector<ROOT::RDF::RResultHandle> handles;
+    std::map<int, std::vector<ROOT::RDF::RResultPtr<TH1D>>> booked;
+    for (std::size_t ie = 0; ie < mc.size(); ++ie)
+    {
+        const Entry *e = mc[ie];
+        if (!e)
+        {
+            continue;
+        }
+        auto n0 = apply(e->rnode(), spec.sel);
+        auto n = (spec.expr.empty() ? n0 : n0.Define("_nx_expr_", spec.expr));
+        for (int ch : channels)
+        {
+            auto nf = n.Filter([ch](int c) { return c == ch; }, {channel_column});
+            auto h = nf.Histo1D(spec.model("_fine_mc_ch" + std::to_string(ch) + "_src" + std::to_string(ie)),
+                                var, spec.weight);
+            handles.emplace_back(h);
+            booked[ch].push_back(h);
+        }
+    }
+
+    std::vector<ROOT::RDF::RResultPtr<TH1D>> data_parts;
+    for (std::size_t ie = 0; ie < data.size(); ++ie)
+    {
+        const Entry *e = data[ie];
+        if (!e)
+        {
+            continue;
+        }
+        auto n0 = apply(e->rnode(), spec.sel);
+        auto n = (spec.expr.empty() ? n0 : n0.Define("_nx_expr_", spec.expr));
+        data_parts.push_back(n.Histo1D(spec.model("_fine_data_src" + std::to_string(ie)), var));
+        handles.emplace_back(data_parts.back());
+    }
+
+    ROOT::RDF::RunGraphs(handles);
+
+    HistogramCache cache;
+    cache.id_ = spec.id;
+    for (auto &kv : booked)
+    {
+        auto sum = sum_parts(kv.second, spec.id + "_fine_mc_ch" + std::to_string(kv.first));
+        if (sum)
+        {
+            cache.mc_.emplace(kv.first, std::move(sum));
+        }
+    }
+    cache.data_ = sum_parts(data_parts, spec.id + "_fine_data");
+    return cache;
+}
+
+std::unique_ptr<TH1D> HistogramCache::rebin_exact(const TH1D &fine,
+                                                  const std::vector<double> &edges,
+                                                  const std::string &name)
+{
+    if (edges.size() < 2 || !std::is_sorted(edges.begin(), edges.end()))
+    {
+        throw std::runtime_error("HistogramCache::rebin_exact: edges must be increasing with at least two entries");
+    }
+
+    const std::vector<double> fine_edges = axis_edges(fine);
+    const double tol = 1e-9 * std::max(1.0, std::abs(fine_edges.back() - fine_edges.front()));
+
+    // Fine edge index of every coarse edge.
+    std::vector<int> index(edges.size());
+    for (std::size_t k = 0; k < edges.size(); ++k)
+    {
+        auto it = std::lower_bound(fine_edges.begin(), fine_edges.end(), edges[k] - tol);
+        if (it == fine_edges.end() || std::abs(*it - edges[k]) > tol)
+        {
+            throw std::runtime_error("HistogramCache::rebin_exact: edge " + std::to_string(edges[k]) +
+                                     " of " + name + " is not a fine bin edge");
+        }
+        index[k] = static_cast<int>(it - fine_edges.begin());
+    }
+
+    const int n_fine = fine.GetNbinsX();
+    const int n = static_cast<int>(edges.size()) - 1;
+    auto out = std::make_unique<TH1D>(name.c_str(), fine.GetTitle(), n, edges.data());
+    out->SetDirectory(nullptr);
+    out->Sumw2();
+    out->GetXaxis()->SetTitle(fine.GetXaxis()->GetTitle());
+    out->GetYaxis()->SetTitle(fine.GetYaxis()->GetTitle());
+
+    // Coarse bin b collects fine bins (index[b-1], index[b]]; fine bin j spans
+    // fine_edges[j-1]..fine_edges[j]. Flow bins absorb everything outside.
+    auto add_range = [&](int coarse, int fine_first, int fine_last) {
+        double sumw = 0.0;
+        double sumw2 = 0.0;
+        for (int j = fine_first; j <= fine_last; ++j)
+        {
+            sumw += fine.GetBinContent(j);
+            const double err = fine.GetBinError(j);
+            sumw2 += err * err;
+        }
+        out->SetBinContent(coarse, sumw);
+        out->SetBinError(coarse, std::sqrt(sumw2));
+    };
+
+    add_range(0, 0, index.front());
+    for (int b = 1; b <= n; ++b)
+    {
+        add_range(b, index[static_cast<std::size_t>(b - 1)] + 1, index[static_cast<std::size_t>(b)]);
+    }
+    add_range(n + 1, index.back() + 1, n_fine + 1);
+
+    out->SetEntries(fine.GetEntries());
+    return out;
+}
+
+HistogramCache HistogramCache::rebin(const std::vector<double> &edges) const
+{
+    HistogramCache out;
+    out.id_ = id_;
+    for (const auto &kv : mc_)
+    {
+        out.mc_.emplace(kv.first,
+                        rebin_exact(*kv.second, edges, id_ + "_rebin_mc_ch" + std::to_string(kv.first)));
+    }
+    if (data_)
+    {
+        out.data_ = rebin_exact(*data_, edges, id_ + "_rebin_data");
+    }
+    return out;
+}
+
+HistogramCache HistogramCache::rebin(const TemplateBinningBlock &block) const
+{
+    if (!block.Is1D())
+    {
+        throw std::runtime_error("HistogramCache::rebin: only 1D binning blocks can rebin a 1D cache");
+    }
+    return rebin(block.GetVector());
+}
+
+const TH1D *HistogramCache::channel(int ch) const
+{
+    auto it = mc_.find(ch);
+    return it == mc_.end() ? nullptr : it->second.get();
+}
+
+std::vector<int> HistogramCache::channel_keys() const
+{
+    std::vector<int> keys;
+    keys.reserve(mc_.size());
+    for (const auto &kv : mc_)
+    {
+        keys.push_back(kv.first);
+    }
+    return keys;
+}
+
+std::vector<double> HistogramCache::edges() const
+{
+    if (!mc_.empty())
+    {
+        return axis_edges(*mc_.begin()->second);
+    }
+    if (data_)
+    {
+        return axis_edges(*data_);
+    }
+    return {};
+}
+
+} // namespace nu
@@ -0,0 +1,587 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/src/RenderQueue.cc
+ *
+ *  @brief Forked batch-mode render queue for filled plots.
+ */
+
+#include "RenderQueue.hh"
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <TROOT.h>
+
+#include "Plotter.hh"
+#include "StackedHist.hh"
+#include "UnstackedHist.hh"
+
+namespace nu
+{
+
+namespace
+{
+
+std::string shell_quote(const std::string &s)
+{
+    std::string out = "'";
+    for (char c : s)
+    {
+        if (c == '\'')
+        {
+            out += "'\\''";
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+    out.push_back('\'');
+    return out;
+}
+
+bool have_command(const std::string &name)
+{
+    const std::string cmd = "command -v " + name + " >/dev/null 2>&1";
+    return std::system(cmd.c_str()) == 0;
+}
+
+// Shuts the implicit-MT pool down for the guard's lifetime, so no worker
+// thread (or a lock one holds) is alive across a fork, and brings it back
+// at its previous size.
+class ImtPause
+{
+  public:
+    ImtPause()
+    {
+#ifdef R__HAS_IMPLICITMT
+        if (ROOT::IsImplicitMTEnabled())
+        {
+            pool_size_ = ROOT::GetThreadPoolSize();
+            ROOT::DisableImplicitMT();
+        }
+#endif
+    }
+
+    ~ImtPause()
+    {
+#ifdef R__HAS_IMPLICITMT
+        if (pool_size_ > 0)
+        {
+            ROOT::EnableImplicitMT(pool_size_);
+        }
+#endif
+    }
+
+    ImtPause(const ImtPause &) = delete;
+    ImtPause &operator=(const ImtPause &) = delete;
+
+  private:
+    unsigned int pool_size_ = 0;
+};
+
+bool write_all(int fd, const char *data, std::size_t n)
+{
+    while (n > 0)
+    {
+        const ssize_t written = ::send(fd, data, n, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        n -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, char *data, std::size_t n)
+{
+    while (n > 0)
+    {
+        const ssize_t got = ::read(fd, data, n);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            return false;
+        }
+        data += got;
+        n -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+} // namespace
+
+std::string RenderQueue::page_name(std::size_t index)
+{
+    std::ostringstream ss;
+    ss << "page_" << std::setw(5) << std::setfill('0') << index << ".pdf";
+    return ss.str();
+}
+
+std::string RenderQueue::make_scratch_dir(const std::string &parent, const std::string &prefix)
+{
+    const std::filesystem::path dir = parent.empty() ? std::filesystem::path(".") : std::filesystem::path(parent);
+    std::filesystem::create_directories(dir);
+    const std::string tmpl = (dir / (prefix + "XXXXXX")).string();
+    std::vector<char> buf(tmpl.begin(), tmpl.end());
+    buf.push_back('\0');
+    if (::mkdtemp(buf.data()) == nullptr)
+    {
+        throw std::runtime_error("RenderQueue::make_scratch_dir: mkdtemp failed for " + tmpl);
+    }
+    return std::string(buf.data());
+}
+
+RenderQueue::RenderQueue()
+    : RenderQueue(Config{})
+{
+}
+
+RenderQueue::RenderQueue(Config cfg)
+    : cfg_(std::move(cfg))
+{
+}
+
+std::size_t RenderQueue::add_stacked(TH1DModel spec, Options opt, HistogramCache cache)
+{
+    jobs_.push_back(Job{Kind::kStacked, std::move(spec), std::move(opt), std::move(cache)});
+    return jobs_.size() - 1;
+}
+
+std::size_t RenderQueue::add_unstacked(TH1DModel spec, Options opt, HistogramCache cache)
+{
+    jobs_.push_back(Job{Kind::kUnstacked, std::move(spec), std::move(opt), std::move(cache)});
+    return jobs_.size() - 1;
+}
+
+int RenderQueue::worker_count() const
+{
+    int n = cfg_.n_workers;
+    if (n <= 0)
+    {
+        n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    return std::max(1, std::min<int>(n, static_cast<int>(jobs_.size())));
+}
+
+std::string RenderQueue::output_path(const Job &job)
+{
+    const std::string fmt = job.opt.image_format.empty() ? "png" : job.opt.image_format;
+    // An empty out_dir means the working directory, not "/".
+    return (std::filesystem::path(job.opt.out_dir) / (Plotter::sanitise(job.spec.id) + "." + fmt)).string();
+}
+
+bool RenderQueue::render(const Job &job, const std::string &page_pdf)
+{
+    try
+    {
+        Plotter plotter(job.opt);
+        plotter.set_global_style();
+
+        std::vector<std::string> extra;
+        if (!page_pdf.empty())
+        {
+            extra.push_back(page_pdf);
+        }
+
+        if (job.kind == Kind::kStacked)
+        {
+            StackedHist plot(job.spec, job.opt, job.cache);
+            plot.draw_and_save(job.opt.image_format, extra);
+        }
+        else
+        {
+            UnstackedHist plot(job.spec, job.opt, job.cache);
+            plot.draw_and_save(job.opt.image_format, extra);
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[RenderQueue] render failed for " << job.spec.id << ": " << e.what() << "\n";
+        return false;
+    }
+}
+
+std::vector<bool> RenderQueue::run_forked(std::size_t n_jobs,
+                                         int n_workers,
+                                         const std::string &scratch_dir,
+                                         const std::function<bool(std::size_t)> &render)
+{
+    std::vector<bool> ok(n_jobs, false);
+    n_workers = std::max(1, std::min<int>(n_workers, static_cast<int>(n_jobs)));
+
+    if (n_workers <= 1)
+    {
+        for (std::size_t i = 0; i < n_jobs; ++i)
+        {
+            ok[i] = render(i);
+        }
+        return ok;
+    }
+
+    std::filesystem::create_directories(scratch_dir);
+    std::cout.flush();
+    std::cerr.flush();
+
+    // Callers have finished their event loops; the implicit-MT pool is down
+    // until the children are reaped.
+    const ImtPause imt_pause;
+
+    // Static round-robin assignment keeps the job -> worker mapping
+    // independent of timing; results are collected by job index.
+    std::vector<pid_t> pids;
+    std::vector<std::string> status_files;
+    for (int w = 0; w < n_workers; ++w)
+    {
+        status_files.push_back((std::filesystem::path(scratch_dir) / ("worker_" + std::to_string(w) + ".status")).string());
+        const pid_t pid = ::fork();
+        if (pid < 0)
+        {
+            // Reap the workers already started so none is left as a zombie.
+            for (const pid_t started : pids)
+            {
+                int wstatus = 0;
+                ::waitpid(started, &wstatus, 0);
+            }
+            for (const auto &f : status_files)
+            {
+                std::error_code ec;
+                std::filesystem::remove(f, ec);
+            }
+            throw std::runtime_error("RenderQueue::run_forked: fork failed");
+        }
+        if (pid == 0)
+        {
+            gROOT->SetBatch(kTRUE);
+            std::ofstream status(status_files.back());
+            for (std::size_t i = static_cast<std::size_t>(w); i < n_jobs; i += n_workers)
+            {
+                const bool job_ok = render(i);
+                status << i << "\t" << (job_ok ? 1 : 0) << "\n";
+                status.flush();
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+
+    for (std::size_t w = 0; w < pids.size(); ++w)
+    {
+        int wstatus = 0;
+        ::waitpid(pids[w], &wstatus, 0);
+        if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+        {
+            std::cerr << "[RenderQueue] worker " << w << " terminated abnormally\n";
+        }
+
+        std::ifstream status(status_files[w]);
+        std::size_t index = 0;
+        int job_ok = 0;
+        while (status >> index >> job_ok)
+        {
+            if (index < ok.size())
+            {
+                ok[index] = (job_ok != 0);
+            }
+        }
+        status.close();
+        std::error_code ec;
+        std::filesystem::remove(status_files[w], ec);
+    }
+
+    return ok;
+}
+
+RenderQueue::Stream::Stream(int n_workers, const std::string &scratch_dir, const Render &render)
+{
+    n_workers = std::max(1, n_workers);
+    std::filesystem::create_directories(scratch_dir);
+    std::cout.flush();
+    std::cerr.flush();
+
+    const ImtPause imt_pause;
+    for (int w = 0; w < n_workers; ++w)
+    {
+        int fds[2] = {-1, -1};
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        {
+            finish();
+            throw std::runtime_error("RenderQueue::Stream: socketpair failed");
+        }
+        status_files_.push_back((std::filesystem::path(scratch_dir) / ("worker_" + std::to_string(w) + ".status")).string());
+
+        const pid_t pid = ::fork();
+        if (pid < 0)
+        {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            status_files_.pop_back();
+            finish();
+            throw std::runtime_error("RenderQueue::Stream: fork failed");
+        }
+        if (pid == 0)
+        {
+            // Keep only this worker's end: an inherited parent end of an
+            // earlier worker would stop that worker from ever seeing EOF.
+            ::close(fds[0]);
+            for (const int fd : sockets_)
+            {
+                ::close(fd);
+            }
+
+            gROOT->SetBatch(kTRUE);
+            std::ofstream status(status_files_.back());
+            std::uint64_t header[2] = {0, 0};
+            std::string payload;
+            while (read_all(fds[1], reinterpret_cast<char *>(header), sizeof(header)))
+            {
+                payload.resize(header[1]);
+                if (!read_all(fds[1], &payload[0], payload.size()))
+                {
+                    break;
+                }
+                bool job_ok = false;
+                try
+                {
+                    job_ok = render(static_cast<std::size_t>(header[0]), payload);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "[RenderQueue] job " << header[0] << " failed: " << e.what() << "\n";
+                }
+                status << header[0] << "\t" << (job_ok ? 1 : 0) << "\n";
+                status.flush();
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            ::_exit(0);
+        }
+
+        ::close(fds[1]);
+        sockets_.push_back(fds[0]);
+        pids_.push_back(pid);
+        locks_.push_back(std::make_unique<std::mutex>());
+    }
+}
+
+RenderQueue::Stream::~Stream()
+{
+    finish();
+}
+
+std::size_t RenderQueue::Stream::submit(const std::string &payload)
+{
+    if (finished_)
+    {
+        throw std::runtime_error("RenderQueue::Stream::submit: stream already finished");
+    }
+
+    const std::size_t index = n_submitted_++;
+    const std::size_t w = index % sockets_.size();
+    const std::uint64_t header[2] = {static_cast<std::uint64_t>(index), static_cast<std::uint64_t>(payload.size())};
+
+    std::lock_guard<std::mutex> lock(*locks_[w]);
+    if (!write_all(sockets_[w], reinterpret_cast<const char *>(header), sizeof(header)) ||
+        !write_all(sockets_[w], payload.data(), payload.size()))
+    {
+        std::cerr << "[RenderQueue] worker " << w << " is gone; job " << index << " not rendered\n";
+    }
+    return index;
+}
+
+std::vector<bool> RenderQueue::Stream::finish()
+{
+    if (finished_)
+    {
+        return ok_;
+    }
+    finished_ = true;
+
+    for (const int fd : sockets_)
+    {
+        ::close(fd);
+    }
+    sockets_.clear();
+
+    ok_.assign(n_submitted_, false);
+    for (std::size_t w = 0; w < pids_.size(); ++w)
+    {
+        int wstatus = 0;
+        ::waitpid(pids_[w], &wstatus, 0);
+        if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+        {
+            std::cerr << "[RenderQueue] worker " << w << " terminated abnormally\n";
+        }
+
+        std::ifstream status(status_files_[w]);
+        std::size_t index = 0;
+        int job_ok = 0;
+        while (status >> index >> job_ok)
+        {
+            if (index < ok_.size())
+            {
+                ok_[index] = (job_ok != 0);
+            }
+        }
+        status.close();
+        std::error_code ec;
+        std::filesystem::remove(status_files_[w], ec);
+    }
+    pids_.clear();
+    return ok_;
+}
+
+bool RenderQueue::merge_pdfs(const std::vector<std::string> &pages, const std::string &output)
+{
+    if (pages.empty())
+    {
+        return false;
+    }
+
+    std::string cmd;
+    if (have_command("pdfunite"))
+    {
+        cmd = "pdfunite";
+        for (const auto &p : pages)
+        {
+            cmd += " " + shell_quote(p);
+        }
+        cmd += " " + shell_quote(output);
+    }
+    else if (have_command("gs"))
+    {
+        cmd = "gs -q -dBATCH -dNOPAUSE -sDEVICE=pdfwrite -sOutputFile=" + shell_quote(output);
+        for (const auto &p : pages)
+        {
+            cmd += " " + shell_quote(p);
+        }
+    }
+    else
+    {
+        std::cerr << "[RenderQueue] neither pdfunite nor gs found; keeping per-page PDFs\n";
+        return false;
+    }
+
+    return std::system(cmd.c_str()) == 0;
+}
+
+std::vector<RenderQueue::Output> RenderQueue::run()
+{
+    std::vector<Output> outputs(jobs_.size());
+    if (jobs_.empty())
+    {
+        return outputs;
+    }
+
+    const bool want_merged = !cfg_.merged_pdf.empty();
+    std::filesystem::path scratch = cfg_.scratch_dir;
+    if (scratch.empty())
+    {
+        scratch = want_merged ? make_scratch_dir(std::filesystem::path(cfg_.merged_pdf).parent_path().string(),
+                                                 ".render_queue_")
+                              : make_scratch_dir(std::filesystem::temp_directory_path().string(), "heron_render_");
+    }
+    std::filesystem::create_directories(scratch);
+    if (want_merged && !std::filesystem::path(cfg_.merged_pdf).parent_path().empty())
+    {
+        std::filesystem::create_directories(std::filesystem::path(cfg_.merged_pdf).parent_path());
+    }
+
+    std::vector<std::string> pages(jobs_.size());
+    for (std::size_t i = 0; i < jobs_.size(); ++i)
+    {
+        outputs[i].path = output_path(jobs_[i]);
+        if (want_merged)
+        {
+            pages[i] = (scratch / page_name(i)).string();
+        }
+        std::filesystem::create_directories(jobs_[i].opt.out_dir);
+    }
+
+    const int n_workers = worker_count();
+    std::cerr << "[RenderQueue] stage=render jobs=" << jobs_.size() << " workers=" << n_workers << "\n";
+
+    const std::vector<bool> ok = run_forked(jobs_.size(), n_workers, scratch.string(),
+                                            [&](std::size_t i) { return render(jobs_[i], pages[i]); });
+    for (std::size_t i = 0; i < jobs_.size(); ++i)
+    {
+        outputs[i].ok = ok[i];
+    }
+
+    bool keep_pages = cfg_.keep_pages;
+    if (want_merged)
+    {
+        std::vector<std::string> ok_pages;
+        for (std::size_t i = 0; i < jobs_.size(); ++i)
+        {
+            if (outputs[i].ok && std::filesystem::exists(pages[i]))
+            {
+                ok_pages.push_back(pages[i]);
+            }
+        }
+        if (merge_pdfs(ok_pages, cfg_.merged_pdf))
+        {
+            std::cerr << "[RenderQueue] stage=merge pages=" << ok_pages.size() << " output=" << cfg_.merged_pdf << "\n";
+        }
+        else
+        {
+            keep_pages = true;
+        }
+    }
+
+    if (!keep_pages)
+    {
+        for (const auto &p : pages)
+        {
+            std::error_code ec;
+            if (!p.empty())
+            {
+                std::filesystem::remove(p, ec);
+            }
+        }
+        std::error_code ec;
+        std::filesystem::remove(scratch, ec);
+    }
+
+    std::size_t n_ok = 0;
+    for (const auto &o : outputs)
+    {
+        n_ok += o.ok ? 1 : 0;
+    }
+    std::cerr << "[RenderQueue] stage=done ok=" << n_ok << " failed=" << (outputs.size() - n_ok) << "\n";
+    return outputs;
+}
+
+} // namespace nu
@@ -16,6 +16,7 @@
 #include <map>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -23,16 +24,17 @@
 #include "ROOT/RDFHelpers.hxx"
 #include "ROOT/RVec.hxx"
 #include "TArrow.h"
+#include "TAxis.h"
 #include "TCanvas.h"
 #include "TColor.h"
-#include "TDecompChol.h"
 #include "TImage.h"
 #include "TLine.h"
 #include "TList.h"
 #include "TMatrixDSym.h"
 #include "TPaveText.h"
-#include "TVectorD.h"
 
+#include "BootstrapWeights.hh"
+#include "CovarianceSolver.hh"
 #include "PlotChannels.hh"
 #include "ParticleChannels.hh"
 #include "PlottingHelper.hh"
@@ -93,6 +95,78 @@ ROOT::VecOps::RVec<double> select_particle_values(const ROOT::VecOps::RVec<doubl
     return out;
 }
 
+// Bin edges of an axis, variable or uniform.
+std::vector<double> axis_edges(const TAxis &axis)
+{
+    std::vector<double> edges(static_cast<std::size_t>(axis.GetNbins()) + 1);
+    for (int i = 1; i <= axis.GetNbins(); ++i)
+    {
+        edges[static_cast<std::size_t>(i) - 1] = axis.GetBinLowEdge(i);
+    }
+    edges.back() = axis.GetBinUpEdge(axis.GetNbins());
+    return edges;
+}
+
+// Covariance over the in-range bins of the summed bootstrap replicas,
+// centred on the replica mean.
+TMatrixDSym bootstrap_covariance(std::vector<ROOT::RDF::RResultPtr<BootstrapSums>> &parts, int nbins)
+{
+    TMatrixDSym cov(nbins);
+    cov.Zero();
+    if (parts.empty())
+    {
+        return cov;
+    }
+
+    const int n_univ = parts.front()->n_universes;
+    std::vector<double> counts(static_cast<std::size_t>(nbins) * n_univ, 0.0);
+    for (auto &rr : parts)
+    {
+        const BootstrapSums &s = rr.GetValue();
+        for (int i = 0; i < nbins && i + 1 < s.n_bins; ++i)
+        {
+            for (int u = 0; u < n_univ; ++u)
+            {
+                counts[static_cast<std::size_t>(u) * nbins + i] += s.at(i + 1, u);
+            }
+        }
+    }
+
+    std::vector<double> mean(static_cast<std::size_t>(nbins), 0.0);
+    for (int u = 0; u < n_univ; ++u)
+    {
+        for (int i = 0; i < nbins; ++i)
+        {
+            mean[i] += counts[static_cast<std::size_t>(u) * nbins + i];
+        }
+    }
+    for (double &m : mean)
+    {
+        m /= n_univ;
+    }
+
+    for (int u = 0; u < n_univ; ++u)
+    {
+        const double *row = counts.data() + static_cast<std::size_t>(u) * nbins;
+        for (int i = 0; i < nbins; ++i)
+        {
+            const double di = row[i] - mean[i];
+            for (int j = i; j < nbins; ++j)
+            {
+                cov(i, j) += di * (row[j] - mean[j]) / n_univ;
+            }
+        }
+    }
+    for (int i = 0; i < nbins; ++i)
+    {
+        for (int j = 0; j < i; ++j)
+        {
+            cov(i, j) = cov(j, i);
+        }
+    }
+    return cov;
+}
+
 std::pair<int, int> visible_bin_range(const TH1D &h, double xmin, double xmax)
 {
     const TAxis *axis = h.GetXaxis();
@@ -117,36 +191,7 @@ void apply_total_errors(TH1D &h,
                         const std::vector<double> *syst_bin,
                         bool density_mode)
 {
-    const int nb = h.GetNbinsX();
-    for (int i = 1; i <= nb; ++i)
-    {
-        const double stat = h.GetBinError(i);
-        double syst = 0.0;
-        if (cov && i - 1 < cov->GetNrows())
-        {
-            syst = std::sqrt((*cov)(i - 1, i - 1));
-        }
-        else if (syst_bin && i - 1 < static_cast<int>(syst_bin->size()))
-        {
-            syst = std::max(0.0, (*syst_bin)[i - 1]);
-        }
-
-        // If the histogram content has been scaled to a density (events / unit-x)
-        // via h.Scale(1, "width"), then the systematic uncertainties must be put
-        // in the same units. For diagonal-only usage, that is a 1/width factor.
-        // (Full covariance needs V'_{ij} = V_{ij} / (w_i w_j).)
-        if (density_mode)
-        {
-            const double w = h.GetXaxis() ? h.GetXaxis()->GetBinWidth(i) : 0.0;
-            if (w > 0.0)
-            {
-                syst /= w;
-            }
-        }
-
-        const double tot = std::sqrt(stat * stat + syst * syst);
-        h.SetBinError(i, tot);
-    }
+    CovarianceSolver::apply_total_errors(h, cov, syst_bin, density_mode);
 }
 
 double integral_in_visible_range(const TH1D &h, double xmin, double xmax)
@@ -183,11 +228,26 @@ StackedHist::StackedHist(TH1DModel spec, Options opt, const EventListIO &event_l
       plot_name_(Plotter::sanitise(spec_.id)),
       output_directory_(opt_.out_dir)
 {
-    auto base = event_list.rdf();
+    init_entries(event_list.rdf(), event_list.mask_for_data(), event_list.mask_for_ext(), "sample_id");
+}
 
-    auto data_mask = event_list.mask_for_data();
-    auto ext_mask = event_list.mask_for_ext();
+StackedHist::StackedHist(TH1DModel spec, Options opt, const EventListSet &event_lists)
+    : spec_(std::move(spec)),
+      opt_(std::move(opt)),
+      plot_name_(Plotter::sanitise(spec_.id)),
+      output_directory_(opt_.out_dir)
+{
+    init_entries(event_lists.rdf(),
+                 event_lists.mask_for_data(),
+                 event_lists.mask_for_ext(),
+                 event_lists.sample_id_column());
+}
 
+void StackedHist::init_entries(ROOT::RDF::RNode base,
+                               const std::shared_ptr<const std::vector<char>> &data_mask,
+                               const std::shared_ptr<const std::vector<char>> &ext_mask,
+                               const std::string &sample_id_column)
+{
     std::shared_ptr<std::vector<char>> data_like = std::make_shared<std::vector<char>>();
     if (data_mask || ext_mask)
     {
@@ -211,8 +271,8 @@ StackedHist::StackedHist(TH1DModel spec, Options opt, const EventListIO &event_l
     }
 
     const std::shared_ptr<const std::vector<char>> data_like_const = data_like;
-    auto data_node = filter_by_sample_mask(base, data_like_const);
-    auto mc_node = filter_not_sample_mask(base, data_like_const);
+    auto data_node = filter_by_sample_mask(base, data_like_const, sample_id_column);
+    auto mc_node = filter_not_sample_mask(base, data_like_const, sample_id_column);
 
     owned_entries_.reserve(2);
     SelectionEntry mc_sel{Type::kMC, Frame{mc_node}};
@@ -224,6 +284,30 @@ StackedHist::StackedHist(TH1DModel spec, Options opt, const EventListIO &event_l
     data_.push_back(&owned_entries_.back());
 }
 
+StackedHist::StackedHist(TH1DModel spec, Options opt, HistogramCache cache)
+    : spec_(std::move(spec)),
+      opt_(std::move(opt)),
+      cache_(std::make_shared<const HistogramCache>(std::move(cache))),
+      plot_name_(Plotter::sanitise(spec_.id)),
+      output_directory_(opt_.out_dir)
+{
+    if (opt_.particle_level)
+    {
+        throw std::runtime_error("StackedHist: particle-level plots are not supported from a histogram cache");
+    }
+    if (opt_.bootstrap_universes > 0)
+    {
+        throw std::runtime_error("StackedHist: bootstrap MC stat needs the events; pass mc_stat_cov with a histogram cache");
+    }
+    const std::vector<double> edges = cache_->edges();
+    if (edges.size() >= 2)
+    {
+        spec_.nbins = static_cast<int>(edges.size()) - 1;
+        spec_.xmin = edges.front();
+        spec_.xmax = edges.back();
+    }
+}
+
 
 void StackedHist::setup_pads(TCanvas &c, TPad *&p_main, TPad *&p_ratio, TPad *&p_legend) const
 {
@@ -364,6 +448,8 @@ void StackedHist::build_histograms()
     mc_ch_hists_.clear();
     mc_total_.reset();
     mc_total_stat_.reset();
+    mc_stat_cov_.reset();
+    chi2_cov_.reset();
     data_hist_.reset();
     mc_unc_hist_.reset();
     sig_hist_.reset();
@@ -383,7 +469,16 @@ void StackedHist::build_histograms()
                                        : std::string{};
     const std::string channel_column = opt_.channel_column.empty() ? "analysis_channels" : opt_.channel_column;
 
-    for (size_t ie = 0; ie < mc_.size(); ++ie)
+    // Bootstrap replicas ride along in the stack's event loop; the cache has
+    // no events to resample.
+    std::vector<ROOT::RDF::RResultPtr<BootstrapSums>> bootstrap;
+    const bool book_bootstrap_sums = !particle_level && opt_.bootstrap_universes > 0;
+    const std::vector<int> stacked_keys(channels.begin(), channels.end());
+    // Replicas are binned exactly as the channel histograms booked below.
+    const std::vector<double> bootstrap_edges =
+        book_bootstrap_sums ? axis_edges(*spec_.model("_bs_edges").GetHistogram()->GetXaxis()) : std::vector<double>{};
+
+    for (size_t ie = 0; !cache_ && ie < mc_.size(); ++ie)
     {
         const Entry *e = mc_[ie];
         if (!e)
@@ -403,6 +498,14 @@ void StackedHist::build_histograms()
                 auto h = nf.Histo1D(spec_.model("_mc_ch" + std::to_string(ch) + "_src" + std::to_string(ie)), var, spec_.weight);
                 booked[ch].push_back(h);
             }
+            if (book_bootstrap_sums)
+            {
+                auto nb = n.Filter(
+                    [keys = stacked_keys](int c) { return std::find(keys.begin(), keys.end(), c) != keys.end(); },
+                    {channel_column});
+                bootstrap.push_back(book_bootstrap(nb, bootstrap_edges, var, spec_.weight, opt_.bootstrap_universes,
+                                                   opt_.bootstrap_seed));
+            }
             continue;
         }
 
@@ -430,6 +533,17 @@ void StackedHist::build_histograms()
     std::map<int, std::unique_ptr<TH1D>> sum_by_channel;
     for (int ch : channels)
     {
+        if (cache_)
+        {
+            if (const TH1D *h = cache_->channel(ch))
+            {
+                std::unique_ptr<TH1D> sum(static_cast<TH1D *>(h->Clone((spec_.id + "_mc_sum_ch" + std::to_string(ch)).c_str())));
+                sum->SetDirectory(nullptr);
+                sum_by_channel.emplace(ch, std::move(sum));
+            }
+            continue;
+        }
+
         auto it = booked.find(ch);
         if (it == booked.end() || it->second.empty())
         {
@@ -525,7 +639,64 @@ void StackedHist::build_histograms()
 
     total_mc_events_ = mc_total_ ? mc_total_->Integral() : 0.0;
 
-    if (!data_.empty())
+    if (!bootstrap.empty())
+    {
+        mc_stat_cov_ = std::make_shared<TMatrixDSym>(
+            bootstrap_covariance(bootstrap, static_cast<int>(bootstrap_edges.size()) - 1));
+    }
+    else if (opt_.mc_stat_cov)
+    {
+        mc_stat_cov_ = opt_.mc_stat_cov;
+    }
+    if (mc_total_ && mc_stat_cov_ && mc_stat_cov_->GetNrows() != mc_total_->GetNbinsX())
+    {
+        throw std::runtime_error("StackedHist: MC stat covariance has " + std::to_string(mc_stat_cov_->GetNrows())
+                                 + " rows but " + spec_.id + " has " + std::to_string(mc_total_->GetNbinsX())
+                                 + " bins");
+    }
+    if (mc_total_ && mc_stat_cov_)
+    {
+        for (int i = 1; i <= mc_total_->GetNbinsX(); ++i)
+        {
+            mc_total_->SetBinError(i, std::sqrt(std::max(0.0, (*mc_stat_cov_)(i - 1, i - 1))));
+        }
+        mc_total_stat_.reset(static_cast<TH1D *>(mc_total_->Clone((spec_.id + "_mc_total_stat").c_str())));
+        mc_total_stat_->SetDirectory(nullptr);
+    }
+
+    // One versioned chi² covariance per build, so redraws reuse its factor.
+    if (mc_stat_cov_ || opt_.total_cov)
+    {
+        const int n_cov = mc_stat_cov_ ? mc_stat_cov_->GetNrows() : 0;
+        const int n_syst = opt_.total_cov ? opt_.total_cov->GetNrows() : 0;
+        const int n = std::max(n_cov, n_syst);
+        TMatrixDSym sum(n);
+        for (int i = 0; i < n; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                double v = 0.0;
+                if (i < n_cov && j < n_cov)
+                {
+                    v += (*mc_stat_cov_)(i, j);
+                }
+                if (i < n_syst && j < n_syst)
+                {
+                    v += (*opt_.total_cov)(i, j);
+                }
+                sum(i, j) = v;
+            }
+        }
+        chi2_cov_ = std::make_shared<const VersionedCovariance>(sum);
+    }
+
+    if (cache_ && cache_->data())
+    {
+        data_hist_.reset(static_cast<TH1D *>(cache_->data()->Clone((spec_.id + "_data").c_str())));
+        data_hist_->SetDirectory(nullptr);
+    }
+
+    if (!cache_ && !data_.empty())
     {
         std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
         for (size_t ie = 0; ie < data_.size(); ++ie)
@@ -554,14 +725,14 @@ void StackedHist::build_histograms()
                 data_hist_->Add(&h);
             }
         }
+    }
 
-        if (data_hist_)
-        {
-            data_hist_->SetMarkerStyle(kFullCircle);
-            data_hist_->SetMarkerSize(0.9);
-            data_hist_->SetLineColor(kBlack);
-            data_hist_->SetFillStyle(0);
-        }
+    if (data_hist_)
+    {
+        data_hist_->SetMarkerStyle(kFullCircle);
+        data_hist_->SetMarkerSize(0.9);
+        data_hist_->SetLineColor(kBlack);
+        data_hist_->SetFillStyle(0);
     }
 
     if (opt_.overlay_signal && !opt_.signal_channels.empty() && !mc_ch_hists_.empty())
@@ -606,6 +777,10 @@ void StackedHist::build_histograms()
         {
             scale_width(*mc_total_);
         }
+        if (mc_total_stat_)
+        {
+            scale_width(*mc_total_stat_);
+        }
         if (data_hist_)
         {
             scale_width(*data_hist_);
@@ -837,16 +1012,7 @@ void StackedHist::draw_ratio(TPad *p_ratio)
 
     if (opt_.show_ratio_band)
     {
-        ratio_band_.reset(static_cast<TH1D *>(mc_total_->Clone((spec_.id + "_ratio_band").c_str())));
-        ratio_band_->SetDirectory(nullptr);
-        const int nb2 = ratio_band_->GetNbinsX();
-        for (int i = 1; i <= nb2; ++i)
-        {
-            const double m = mc_total_->GetBinContent(i);
-            const double em = mc_total_->GetBinError(i);
-            ratio_band_->SetBinContent(i, 1.0);
-            ratio_band_->SetBinError(i, (m > 0 ? em / m : 0.0));
-        }
+        ratio_band_ = CovarianceSolver::ratio_band(*mc_total_, spec_.id + "_ratio_band");
         ratio_band_->SetFillColor(k_uncertainty_fill_colour);
         ratio_band_->SetFillStyle(k_uncertainty_fill_style);
         ratio_band_->SetLineColor(kGray + 2);
@@ -930,52 +1096,29 @@ bool StackedHist::compute_chi2(double &chi2_out, int &ndf_out) const
     }
     ndf_out = static_cast<int>(bins.size());
 
-    if (opt_.total_cov)
+    // chi2_cov_ holds total_cov plus the MC stat covariance, when there is one.
+    if (chi2_cov_)
     {
-        const int n = static_cast<int>(bins.size());
-        TMatrixDSym V(n);
-        for (int a = 0; a < n; ++a)
+        const std::size_t n = bins.size();
+        std::vector<double> scale(n, 1.0);
+        std::vector<double> diag_var(n);
+        std::vector<double> resid(n);
+        // Bins the MC stat covariance covers take that term from chi2_cov_.
+        const int n_mc_cov = mc_stat_cov_ ? mc_stat_cov_->GetNrows() : 0;
+        for (std::size_t a = 0; a < n; ++a)
         {
             const int i = bins[a];
-            const double wi = density_mode_ && m.GetXaxis() ? m.GetXaxis()->GetBinWidth(i) : 1.0;
-            for (int b = 0; b < n; ++b)
+            const double w = density_mode_ && m.GetXaxis() ? m.GetXaxis()->GetBinWidth(i) : 1.0;
+            if (density_mode_ && w > 0.0)
             {
-                const int j = bins[b];
-                const double wj = density_mode_ && m.GetXaxis() ? m.GetXaxis()->GetBinWidth(j) : 1.0;
-
-                double v = 0.0;
-                if (a == b)
-                {
-                    v += std::pow(d.GetBinError(i), 2);
-                    v += std::pow(mstat.GetBinError(i), 2);
-                }
-
-                if ((i - 1) < opt_.total_cov->GetNrows() && (j - 1) < opt_.total_cov->GetNrows())
-                {
-                    double c = (*opt_.total_cov)(i - 1, j - 1);
-                    if (density_mode_ && wi > 0.0 && wj > 0.0)
-                    {
-                        c /= (wi * wj);
-                    }
-                    v += c;
-                }
-                V(a, b) = v;
+                scale[a] = 1.0 / w;
             }
+            diag_var[a] = std::pow(d.GetBinError(i), 2) + (i - 1 < n_mc_cov ? 0.0 : std::pow(mstat.GetBinError(i), 2));
+            resid[a] = d.GetBinContent(i) - m.GetBinContent(i);
         }
 
-        TVectorD r(n);
-        for (int a = 0; a < n; ++a)
+        if (CovarianceSolver::chi2(*chi2_cov_, bins, scale, diag_var, resid, chi2_out))
         {
-            const int i = bins[a];
-            r[a] = d.GetBinContent(i) - m.GetBinContent(i);
-        }
-
-        TDecompChol chol(V);
-        if (chol.Decompose())
-        {
-            TVectorD x(r);
-            chol.Solve(x);
-            chi2_out = r * x;
             return true;
         }
     }
@@ -1103,7 +1246,8 @@ void StackedHist::draw(TCanvas &canvas)
     canvas.Update();
 }
 
-void StackedHist::draw_and_save(const std::string &image_format)
+void StackedHist::draw_and_save(const std::string &image_format,
+                                const std::vector<std::string> &extra_outputs)
 {
     std::filesystem::create_directories(output_directory_);
     stack_debug_log("draw_and_save enter: plot='" + plot_name_ +
@@ -1120,6 +1264,10 @@ void StackedHist::draw_and_save(const std::string &image_format)
 
     stack_debug_log("SaveAs start: plot='" + plot_name_ + "', file='" + out + "'");
     canvas.SaveAs(out.c_str());
+    for (const auto &extra : extra_outputs)
+    {
+        canvas.SaveAs(extra.c_str());
+    }
     stack_debug_log("SaveAs done: plot='" + plot_name_ + "'");
 
     // The stacked histograms are owned by this StackedHist instance (unique_ptr).
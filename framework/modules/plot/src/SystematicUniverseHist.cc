@@ -0,0 +1,668 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/plot/src/SystematicUniverseHist.cc
+ *
+ *  @brief Multisim universe histogramming engine.
+ */
+
+#include "SystematicUniverseHist.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ROOT/RDFHelpers.hxx"
+#include "ROOT/RResultHandle.hxx"
+#include "ROOT/RVec.hxx"
+
+#include "BootstrapWeights.hh"
+#include "PlotChannels.hh"
+
+namespace nu
+{
+
+namespace
+{
+
+using UniverseSums = SystematicUniverseHist::UniverseSums;
+
+const char *const k_x_column = "_nx_su_x_";
+const char *const k_w_column = "_nx_su_w_";
+const char *const k_ch_column = "_nx_su_ch_";
+
+// Fills [channel][bin][universe] sums per slot; slots are summed in Finalize.
+template <typename T>
+class UniverseFillHelper : public ROOT::Detail::RDF::RActionImpl<UniverseFillHelper<T>>
+{
+  public:
+    using Result_t = UniverseSums;
+
+    UniverseFillHelper(std::vector<double> edges,
+                       std::vector<int> lookup,
+                       int n_channels,
+                       int n_universes,
+                       unsigned int n_slots,
+                       bool sanitise,
+                       std::string family)
+        : edges_(std::move(edges)),
+          lookup_(std::move(lookup)),
+          sanitise_(sanitise),
+          family_(std::move(family)),
+          result_(std::make_shared<Result_t>())
+    {
+        result_->n_channels = n_channels;
+        result_->n_bins = static_cast<int>(edges_.size()) + 1;
+        result_->n_universes = n_universes;
+        const std::size_t n = result_->offset(n_channels, 0);
+        slots_.assign(std::max(1u, n_slots), std::vector<double>(n, 0.0));
+    }
+
+    UniverseFillHelper(UniverseFillHelper &&) = default;
+    UniverseFillHelper(const UniverseFillHelper &) = delete;
+
+    std::shared_ptr<Result_t> GetResultPtr() const { return result_; }
+
+    void Initialize() {}
+    void InitTask(TTreeReader *, unsigned int) {}
+
+    void Exec(unsigned int slot, double x, double w, int ch, const ROOT::VecOps::RVec<T> &uw)
+    {
+        if (ch < 0 || ch >= static_cast<int>(lookup_.size()) || !std::isfinite(x))
+        {
+            return;
+        }
+        const int ci = lookup_[ch];
+        if (ci < 0)
+        {
+            return;
+        }
+        const int n_univ = result_->n_universes;
+        if (static_cast<int>(uw.size()) != n_univ)
+        {
+            throw std::runtime_error("SystematicUniverseHist: family " + family_ + " expects " +
+                                     std::to_string(n_univ) + " universes, event has " +
+                                     std::to_string(uw.size()));
+        }
+
+        int bin = 0;
+        if (x >= edges_.back())
+        {
+            bin = static_cast<int>(edges_.size());
+        }
+        else if (x >= edges_.front())
+        {
+            bin = static_cast<int>(std::upper_bound(edges_.begin(), edges_.end(), x) - edges_.begin());
+        }
+
+        double *row = slots_[slot].data() + result_->offset(ci, bin);
+        const T *src = uw.data();
+        if (sanitise_)
+        {
+            for (int u = 0; u < n_univ; ++u)
+            {
+                const double f = static_cast<double>(src[u]);
+                row[u] += w * ((std::isfinite(f) && f >= 0.0) ? f : 1.0);
+            }
+            return;
+        }
+        for (int u = 0; u < n_univ; ++u)
+        {
+            row[u] += w * static_cast<double>(src[u]);
+        }
+    }
+
+    void Finalize()
+    {
+        std::vector<double> &out = result_->sumw;
+        out = std::move(slots_.front());
+        for (std::size_t s = 1; s < slots_.size(); ++s)
+        {
+            const std::vector<double> &in = slots_[s];
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                out[i] += in[i];
+            }
+        }
+        slots_.clear();
+    }
+
+    std::string GetActionName() const { return "UniverseFill"; }
+
+  private:
+    std::vector<double> edges_;
+    std::vector<int> lookup_;
+    bool sanitise_ = true;
+    std::string family_;
+    std::shared_ptr<Result_t> result_;
+    std::vector<std::vector<double>> slots_;
+};
+
+enum class WeightKind
+{
+    kFloat,
+    kDouble,
+    kOther
+};
+
+WeightKind universe_column_kind(ROOT::RDF::RNode &node, const std::string &column)
+{
+    const std::string type = node.GetColumnType(column);
+    const auto defined = node.GetDefinedColumnNames();
+    const bool is_defined = std::find(defined.begin(), defined.end(), column) != defined.end();
+
+    auto matches = [&](const std::string &elem) {
+        if (type == "ROOT::VecOps::RVec<" + elem + ">" || type == "ROOT::RVec<" + elem + ">")
+        {
+            return true;
+        }
+        // Dataset std::vector branches are readable as RVec; defined columns are not.
+        return !is_defined && (type == "vector<" + elem + ">" || type == "std::vector<" + elem + ">");
+    };
+
+    if (matches("float"))
+    {
+        return WeightKind::kFloat;
+    }
+    if (matches("double"))
+    {
+        return WeightKind::kDouble;
+    }
+    return WeightKind::kOther;
+}
+
+template <typename T>
+ROOT::RDF::RResultPtr<UniverseSums> book_family(ROOT::RDF::RNode &node,
+                                                const std::string &column,
+                                                UniverseFillHelper<T> helper)
+{
+    return node.Book<double, double, int, ROOT::VecOps::RVec<T>>(
+        std::move(helper), {k_x_column, k_w_column, k_ch_column, column});
+}
+
+void init_sums(UniverseSums &acc, int n_channels, int n_bins, int n_universes)
+{
+    acc.n_channels = n_channels;
+    acc.n_bins = n_bins;
+    acc.n_universes = n_universes;
+    acc.sumw.assign(acc.offset(n_channels, 0), 0.0);
+}
+
+void add_bootstrap_sums(UniverseSums &acc, int ci, const BootstrapSums &in)
+{
+    const std::size_t n = static_cast<std::size_t>(in.n_bins) * static_cast<std::size_t>(in.n_universes);
+    double *out = acc.sumw.data() + acc.offset(ci, 0);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        out[i] += in.sumw[i];
+    }
+}
+
+void add_sums(UniverseSums &acc, const UniverseSums &in)
+{
+    if (acc.sumw.empty())
+    {
+        acc = in;
+        return;
+    }
+    for (std::size_t i = 0; i < acc.sumw.size(); ++i)
+    {
+        acc.sumw[i] += in.sumw[i];
+    }
+}
+
+} // namespace
+
+
+SystematicUniverseHist::SystematicUniverseHist(TH1DModel spec, std::vector<Family> families, Options opt)
+    : spec_(std::move(spec)),
+      families_(std::move(families)),
+      opt_(std::move(opt)),
+      channel_keys_(Channels::mc_keys())
+{
+    if (spec_.nbins <= 0 || !(spec_.xmax > spec_.xmin))
+    {
+        throw std::runtime_error("SystematicUniverseHist: invalid binning for " + spec_.id);
+    }
+    for (const auto &f : families_)
+    {
+        if (f.name.empty() || (f.column.empty() && !f.bootstrap) || f.n_universes <= 0)
+        {
+            throw std::runtime_error("SystematicUniverseHist: family requires a name, column (or bootstrap) and n_universes > 0");
+        }
+    }
+
+    int max_key = 0;
+    for (int k : channel_keys_)
+    {
+        max_key = std::max(max_key, k);
+    }
+    channel_lookup_.assign(static_cast<std::size_t>(max_key) + 1, -1);
+    for (std::size_t i = 0; i < channel_keys_.size(); ++i)
+    {
+        channel_lookup_[static_cast<std::size_t>(channel_keys_[i])] = static_cast<int>(i);
+    }
+}
+
+void SystematicUniverseHist::compute(const std::vector<const Entry *> &mc)
+{
+    ready_ = false;
+    nominal_.clear();
+    sums_.assign(families_.size(), UniverseSums{});
+
+    const std::vector<double> edges = uniform_edges(spec_.nbins, spec_.xmin, spec_.xmax);
+
+    const std::string channel_column = opt_.channel_column.empty() ? "analysis_channels" : opt_.channel_column;
+    const std::string var = spec_.expr.empty() ? spec_.id : spec_.expr;
+    const std::string weight = spec_.weight.empty() ? "1.0" : spec_.weight;
+    const int n_channels = static_cast<int>(channel_keys_.size());
+
+    std::vector<ROOT::RDF::RResultHandle> handles;
+    std::vector<std::vector<ROOT::RDF::RResultPtr<TH1D>>> booked_nominal;
+    std::vector<std::vector<ROOT::RDF::RResultPtr<UniverseSums>>> booked_sums;
+    // [entry][family][channel], only populated for bootstrap families.
+    std::vector<std::vector<std::vector<ROOT::RDF::RResultPtr<BootstrapSums>>>> booked_boot;
+
+    for (std::size_t ie = 0; ie < mc.size(); ++ie)
+    {
+        const Entry *e = mc[ie];
+        if (!e)
+        {
+            continue;
+        }
+
+        ROOT::RDF::RNode n = apply(e->rnode(), spec_.sel)
+                                 .Define(k_x_column, "static_cast<double>(" + var + ")")
+                                 .Define(k_w_column, "static_cast<double>(" + weight + ")")
+                                 .Define(k_ch_column, "static_cast<int>(" + channel_column + ")");
+
+        std::vector<ROOT::RDF::RResultPtr<TH1D>> nominal;
+        std::vector<std::vector<ROOT::RDF::RResultPtr<BootstrapSums>>> boot(families_.size());
+        for (int ch : channel_keys_)
+        {
+            auto nf = n.Filter([ch](int c) { return c == ch; }, {k_ch_column});
+            nominal.push_back(nf.Histo1D(spec_.model("_su_cv_ch" + std::to_string(ch) + "_src" + std::to_string(ie)),
+                                         k_x_column, k_w_column));
+            handles.emplace_back(nominal.back());
+
+            for (std::size_t fi = 0; fi < families_.size(); ++fi)
+            {
+                const Family &f = families_[fi];
+                if (!f.bootstrap)
+                {
+                    continue;
+                }
+                boot[fi].push_back(book_bootstrap(nf, edges, k_x_column, k_w_column, f.n_universes, f.seed));
+                handles.emplace_back(boot[fi].back());
+            }
+        }
+        booked_nominal.push_back(std::move(nominal));
+        booked_boot.push_back(std::move(boot));
+
+        const unsigned int n_slots = n.GetNSlots();
+        std::vector<ROOT::RDF::RResultPtr<UniverseSums>> sums;
+        for (const auto &f : families_)
+        {
+            if (f.bootstrap)
+            {
+                sums.emplace_back();
+                continue;
+            }
+
+            std::string column = f.column;
+            WeightKind kind = universe_column_kind(n, column);
+            if (kind == WeightKind::kOther)
+            {
+                column = "_nx_su_u_" + f.name + "_";
+                n = n.Define(column, "ROOT::VecOps::RVec<double>(" + f.column + ".begin(), " + f.column + ".end())");
+                kind = WeightKind::kDouble;
+            }
+
+            if (kind == WeightKind::kFloat)
+            {
+                sums.push_back(book_family(n, column,
+                                           UniverseFillHelper<float>(edges, channel_lookup_, n_channels, f.n_universes,
+                                                                     n_slots, sanitise_weights_, f.name)));
+            }
+            else
+            {
+                sums.push_back(book_family(n, column,
+                                           UniverseFillHelper<double>(edges, channel_lookup_, n_channels, f.n_universes,
+                                                                      n_slots, sanitise_weights_, f.name)));
+            }
+            handles.emplace_back(sums.back());
+        }
+        booked_sums.push_back(std::move(sums));
+    }
+
+    ROOT::RDF::RunGraphs(handles);
+
+    nominal_.resize(channel_keys_.size());
+    for (const auto &per_entry : booked_nominal)
+    {
+        for (std::size_t ci = 0; ci < per_entry.size(); ++ci)
+        {
+            const TH1D &h = *per_entry[ci];
+            if (!nominal_[ci])
+            {
+                nominal_[ci].reset(static_cast<TH1D *>(h.Clone()));
+                nominal_[ci]->SetDirectory(nullptr);
+            }
+            else
+            {
+                nominal_[ci]->Add(&h);
+            }
+        }
+    }
+    if (booked_nominal.empty())
+    {
+        for (std::size_t ci = 0; ci < channel_keys_.size(); ++ci)
+        {
+            nominal_[ci] = std::make_unique<TH1D>(
+                (spec_.id + "_su_cv_ch" + std::to_string(channel_keys_[ci])).c_str(), "",
+                spec_.nbins, spec_.xmin, spec_.xmax);
+            nominal_[ci]->SetDirectory(nullptr);
+        }
+    }
+
+    for (std::size_t fi = 0; fi < families_.size(); ++fi)
+    {
+        if (families_[fi].bootstrap)
+        {
+            init_sums(sums_[fi], n_channels, spec_.nbins + 2, families_[fi].n_universes);
+        }
+    }
+    for (std::size_t ie = 0; ie < booked_sums.size(); ++ie)
+    {
+        for (std::size_t fi = 0; fi < families_.size(); ++fi)
+        {
+            if (!families_[fi].bootstrap)
+            {
+                add_sums(sums_[fi], *booked_sums[ie][fi]);
+                continue;
+            }
+            for (std::size_t ci = 0; ci < booked_boot[ie][fi].size(); ++ci)
+            {
+                add_bootstrap_sums(sums_[fi], static_cast<int>(ci), *booked_boot[ie][fi][ci]);
+            }
+        }
+    }
+    for (std::size_t fi = 0; fi < families_.size(); ++fi)
+    {
+        if (sums_[fi].sumw.empty())
+        {
+            init_sums(sums_[fi], n_channels, spec_.nbins + 2, families_[fi].n_universes);
+        }
+    }
+
+    ready_ = true;
+}
+
+int SystematicUniverseHist::channel_index(int channel) const
+{
+    if (channel < 0)
+    {
+        return -1;
+    }
+    if (channel >= static_cast<int>(channel_lookup_.size()) || channel_lookup_[channel] < 0)
+    {
+        throw std::runtime_error("SystematicUniverseHist: unknown channel " + std::to_string(channel));
+    }
+    return channel_lookup_[channel];
+}
+
+std::size_t SystematicUniverseHist::family_index(const std::string &family) const
+{
+    for (std::size_t i = 0; i < families_.size(); ++i)
+    {
+        if (families_[i].name == family)
+        {
+            return i;
+        }
+    }
+    throw std::runtime_error("SystematicUniverseHist: unknown family " + family);
+}
+
+// Universe-major counts over the in-range bins: out[u * nbins + (bin - 1)].
+void SystematicUniverseHist::universe_counts(const UniverseSums &sums, int channel, std::vector<double> &out) const
+{
+    const int nb = spec_.nbins;
+    const int n_univ = sums.n_universes;
+    out.assign(static_cast<std::size_t>(nb) * static_cast<std::size_t>(n_univ), 0.0);
+
+    const int ci = channel_index(channel);
+    const int c_begin = ci < 0 ? 0 : ci;
+    const int c_end = ci < 0 ? sums.n_channels : ci + 1;
+    for (int c = c_begin; c < c_end; ++c)
+    {
+        for (int b = 1; b <= nb; ++b)
+        {
+            const double *row = sums.sumw.data() + sums.offset(c, b);
+            for (int u = 0; u < n_univ; ++u)
+            {
+                out[static_cast<std::size_t>(u) * nb + (b - 1)] += row[u];
+            }
+        }
+    }
+}
+
+void SystematicUniverseHist::nominal_counts(int channel, std::vector<double> &out) const
+{
+    const int nb = spec_.nbins;
+    out.assign(static_cast<std::size_t>(nb), 0.0);
+
+    const int ci = channel_index(channel);
+    for (std::size_t c = 0; c < nominal_.size(); ++c)
+    {
+        if (ci >= 0 && static_cast<int>(c) != ci)
+        {
+            continue;
+        }
+        for (int b = 1; b <= nb; ++b)
+        {
+            out[static_cast<std::size_t>(b - 1)] += nominal_[c]->GetBinContent(b);
+        }
+    }
+}
+
+std::unique_ptr<TH1D> SystematicUniverseHist::nominal_hist(int channel) const
+{
+    if (!ready_)
+    {
+        throw std::runtime_error("SystematicUniverseHist::nominal_hist: compute() has not been called");
+    }
+
+    const int ci = channel_index(channel);
+    std::unique_ptr<TH1D> out;
+    for (std::size_t c = 0; c < nominal_.size(); ++c)
+    {
+        if (ci >= 0 && static_cast<int>(c) != ci)
+        {
+            continue;
+        }
+        if (!out)
+        {
+            out.reset(static_cast<TH1D *>(nominal_[c]->Clone((spec_.id + "_su_cv").c_str())));
+            out->SetDirectory(nullptr);
+        }
+        else
+        {
+            out->Add(nominal_[c].get());
+        }
+    }
+    return out;
+}
+
+std::unique_ptr<TH1D> SystematicUniverseHist::universe_hist(const std::string &family, int universe, int channel) const
+{
+    if (!ready_)
+    {
+        throw std::runtime_error("SystematicUniverseHist::universe_hist: compute() has not been called");
+    }
+
+    const UniverseSums &sums = sums_[family_index(family)];
+    if (universe < 0 || universe >= sums.n_universes)
+    {
+        throw std::runtime_error("SystematicUniverseHist::universe_hist: universe out of range for " + family);
+    }
+
+    const int ci = channel_index(channel);
+    const int c_begin = ci < 0 ? 0 : ci;
+    const int c_end = ci < 0 ? sums.n_channels : ci + 1;
+
+    const std::string name = spec_.id + "_su_" + family + "_u" + std::to_string(universe);
+    auto h = std::make_unique<TH1D>(name.c_str(), spec_.axis_title().c_str(), spec_.nbins, spec_.xmin, spec_.xmax);
+    h->SetDirectory(nullptr);
+    for (int b = 0; b < sums.n_bins; ++b)
+    {
+        double v = 0.0;
+        for (int c = c_begin; c < c_end; ++c)
+        {
+            v += sums.sumw[sums.offset(c, b) + static_cast<std::size_t>(universe)];
+        }
+        h->SetBinContent(b, v);
+    }
+    return h;
+}
+
+TMatrixDSym SystematicUniverseHist::covariance(const std::string &family, int channel) const
+{
+    if (!ready_)
+    {
+        throw std::runtime_error("SystematicUniverseHist::covariance: compute() has not been called");
+    }
+
+    const UniverseSums &sums = sums_[family_index(family)];
+    const int nb = spec_.nbins;
+    const int n_univ = sums.n_universes;
+
+    std::vector<double> counts;
+    universe_counts(sums, channel, counts);
+
+    std::vector<double> centre;
+    if (centre_ == Centre::kNominal)
+    {
+        nominal_counts(channel, centre);
+    }
+    else
+    {
+        centre.assign(static_cast<std::size_t>(nb), 0.0);
+        for (int u = 0; u < n_univ; ++u)
+        {
+            const double *row = counts.data() + static_cast<std::size_t>(u) * nb;
+            for (int i = 0; i < nb; ++i)
+            {
+                centre[i] += row[i];
+            }
+        }
+        for (double &c : centre)
+        {
+            c /= n_univ;
+        }
+    }
+
+    std::vector<double> acc(static_cast<std::size_t>(nb) * nb, 0.0);
+    std::vector<double> d(static_cast<std::size_t>(nb));
+    for (int u = 0; u < n_univ; ++u)
+    {
+        const double *row = counts.data() + static_cast<std::size_t>(u) * nb;
+        for (int i = 0; i < nb; ++i)
+        {
+            d[i] = row[i] - centre[i];
+        }
+        for (int i = 0; i < nb; ++i)
+        {
+            double *out = acc.data() + static_cast<std::size_t>(i) * nb;
+            const double di = d[i];
+            for (int j = i; j < nb; ++j)
+            {
+                out[j] += di * d[j];
+            }
+        }
+    }
+
+    TMatrixDSym cov(nb);
+    for (int i = 0; i < nb; ++i)
+    {
+        for (int j = i; j < nb; ++j)
+        {
+            const double v = acc[static_cast<std::size_t>(i) * nb + j] / n_univ;
+            cov(i, j) = v;
+            cov(j, i) = v;
+        }
+    }
+    return cov;
+}
+
+std::unique_ptr<TH1D> SystematicUniverseHist::variance_hist(const std::string &family, int channel) const
+{
+    const TMatrixDSym cov = covariance(family, channel);
+    const std::string name = spec_.id + "_su_" + family + "_var";
+    auto h = std::make_unique<TH1D>(name.c_str(), spec_.axis_title().c_str(), spec_.nbins, spec_.xmin, spec_.xmax);
+    h->SetDirectory(nullptr);
+    for (int i = 0; i < spec_.nbins; ++i)
+    {
+        h->SetBinContent(i + 1, cov(i, i));
+    }
+    return h;
+}
+
+TMatrixDSym SystematicUniverseHist::total_covariance(int channel) const
+{
+    TMatrixDSym total(spec_.nbins);
+    total.Zero();
+    for (const auto &f : families_)
+    {
+        // Bootstrap universes estimate MC stat; see mc_stat_covariance.
+        if (f.bootstrap)
+        {
+            continue;
+        }
+        total += covariance(f.name, channel);
+    }
+    return total;
+}
+
+TMatrixDSym SystematicUniverseHist::mc_stat_covariance(int channel) const
+{
+    TMatrixDSym total(spec_.nbins);
+    total.Zero();
+    for (const auto &f : families_)
+    {
+        if (f.bootstrap)
+        {
+            total += covariance(f.name, channel);
+        }
+    }
+    return total;
+}
+
+std::shared_ptr<TMatrixDSym> SystematicUniverseHist::total_covariance_ptr(int channel) const
+{
+    return std::make_shared<TMatrixDSym>(total_covariance(channel));
+}
+
+std::shared_ptr<TMatrixDSym> SystematicUniverseHist::mc_stat_covariance_ptr(int channel) const
+{
+    return std::make_shared<TMatrixDSym>(mc_stat_covariance(channel));
+}
+
+TMatrixDSym SystematicUniverseHist::correlation(const TMatrixDSym &cov)
+{
+    const int n = cov.GetNrows();
+    TMatrixDSym corr(n);
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+        {
+            const double norm = std::sqrt(cov(i, i) * cov(j, j));
+            corr(i, j) = norm > 0.0 ? cov(i, j) / norm : (i == j ? 1.0 : 0.0);
+        }
+    }
+    return corr;
+}
+
+} // namespace nu
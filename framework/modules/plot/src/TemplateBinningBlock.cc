@@ -2,7 +2,7 @@
 /**
  *  @file framework/modules/plot/src/TemplateBinningBlock.cc
  *
- *  @brief Implementation of block-style 1D binning container.
+ *  @brief Implementation of block-style 1D/2D/3D binning container.
  */
 
 #include "TemplateBinningBlock.hh"
@@ -25,11 +25,76 @@ TemplateBinningBlock::TemplateBinningBlock(const std::string &name,
     init();
 }
 
+TemplateBinningBlock::TemplateBinningBlock(const std::string &name,
+                                           const std::string &title,
+                                           const std::vector<double> &x_edges,
+                                           const std::vector<std::vector<double>> &y_edges,
+                                           const std::string &selection,
+                                           int bin_type)
+    : TNamed(name.c_str(), title.c_str()),
+      m_name(name),
+      m_title(title),
+      m_edges(x_edges),
+      m_y_edges(y_edges),
+      m_selection(selection),
+      m_bin_type(bin_type),
+      m_dimension(2)
+{
+    init();
+}
+
+TemplateBinningBlock::TemplateBinningBlock(const std::string &name,
+                                           const std::string &title,
+                                           const std::vector<double> &x_edges,
+                                           const std::vector<std::vector<double>> &y_edges,
+                                           const std::vector<std::vector<std::vector<double>>> &z_edges,
+                                           const std::string &selection,
+                                           int bin_type)
+    : TNamed(name.c_str(), title.c_str()),
+      m_name(name),
+      m_title(title),
+      m_edges(x_edges),
+      m_y_edges(y_edges),
+      m_z_edges(z_edges),
+      m_selection(selection),
+      m_bin_type(bin_type),
+      m_dimension(3)
+{
+    init();
+}
+
 void TemplateBinningBlock::init()
 {
     if (m_edges.size() < 2)
         throw std::runtime_error("TemplateBinningBlock requires at least two edges");
 
+    const size_t n_x = m_edges.size() - 1;
+    if (m_dimension >= 2)
+    {
+        if (m_y_edges.size() != n_x)
+            throw std::runtime_error("TemplateBinningBlock requires one set of y edges per x bin");
+        for (const auto &y : m_y_edges)
+        {
+            if (y.size() < 2)
+                throw std::runtime_error("TemplateBinningBlock requires at least two y edges per x bin");
+        }
+    }
+    if (m_dimension == 3)
+    {
+        if (m_z_edges.size() != n_x)
+            throw std::runtime_error("TemplateBinningBlock requires one set of z edges per (x, y) bin");
+        for (size_t i = 0; i < n_x; ++i)
+        {
+            if (m_z_edges[i].size() + 1 != m_y_edges[i].size())
+                throw std::runtime_error("TemplateBinningBlock requires one set of z edges per (x, y) bin");
+            for (const auto &z : m_z_edges[i])
+            {
+                if (z.size() < 2)
+                    throw std::runtime_error("TemplateBinningBlock requires at least two z edges per (x, y) bin");
+            }
+        }
+    }
+
     m_bin_def.clear();
     for (size_t i = 0; i + 1 < m_edges.size(); ++i)
     {
@@ -44,19 +109,91 @@ void TemplateBinningBlock::init()
 }
 
 int TemplateBinningBlock::GetNBinsX() const { return static_cast<int>(m_edges.size()) - 1; }
-int TemplateBinningBlock::GetNBinsY(int) const { return 0; }
-int TemplateBinningBlock::GetNBinsZ(int, int) const { return 0; }
+
+int TemplateBinningBlock::GetNBinsY(int idx) const
+{
+    if (m_dimension < 2)
+        return 0;
+    return static_cast<int>(m_y_edges.at(static_cast<size_t>(idx)).size()) - 1;
+}
+
+int TemplateBinningBlock::GetNBinsZ(int idx, int idy) const
+{
+    if (m_dimension < 3)
+        return 0;
+    return static_cast<int>(m_z_edges.at(static_cast<size_t>(idx)).at(static_cast<size_t>(idy)).size()) - 1;
+}
+
+int TemplateBinningBlock::GetNBinsTotal() const
+{
+    int n = 0;
+    for (int x = 0; x < GetNBinsX(); ++x)
+    {
+        if (m_dimension < 2)
+        {
+            ++n;
+            continue;
+        }
+        for (int y = 0; y < GetNBinsY(x); ++y)
+            n += (m_dimension < 3) ? 1 : GetNBinsZ(x, y);
+    }
+    return n;
+}
 
 std::string TemplateBinningBlock::GetBinDef(int idx) const { return m_bin_def.at(static_cast<size_t>(idx)); }
-std::string TemplateBinningBlock::GetBinDef(int x, int) const { return GetBinDef(x); }
-std::string TemplateBinningBlock::GetBinDef(int x, int, int) const { return GetBinDef(x); }
+
+std::string TemplateBinningBlock::GetBinDef(int x, int y) const
+{
+    if (m_dimension < 2)
+        return GetBinDef(x);
+
+    std::ostringstream os;
+    os << GetBinDef(x) << " x [" << GetBinYLow(x, y) << ", " << GetBinYHigh(x, y) << ")";
+    return os.str();
+}
+
+std::string TemplateBinningBlock::GetBinDef(int x, int y, int z) const
+{
+    if (m_dimension < 3)
+        return GetBinDef(x, y);
+
+    std::ostringstream os;
+    os << GetBinDef(x, y) << " x [" << GetBinZLow(x, y, z) << ", " << GetBinZHigh(x, y, z) << ")";
+    return os.str();
+}
 
 int TemplateBinningBlock::GetBinType() const { return m_bin_type; }
 
 Double_t TemplateBinningBlock::GetBinXLow(int i) const { return m_edges.at(static_cast<size_t>(i)); }
 Double_t TemplateBinningBlock::GetBinXHigh(int i) const { return m_edges.at(static_cast<size_t>(i + 1)); }
-Double_t TemplateBinningBlock::GetBinYLow(int, int) const { return -9999999; }
-Double_t TemplateBinningBlock::GetBinYHigh(int, int) const { return -9999999; }
+
+Double_t TemplateBinningBlock::GetBinYLow(int i, int j) const
+{
+    if (m_dimension < 2)
+        return -9999999;
+    return m_y_edges.at(static_cast<size_t>(i)).at(static_cast<size_t>(j));
+}
+
+Double_t TemplateBinningBlock::GetBinYHigh(int i, int j) const
+{
+    if (m_dimension < 2)
+        return -9999999;
+    return m_y_edges.at(static_cast<size_t>(i)).at(static_cast<size_t>(j + 1));
+}
+
+Double_t TemplateBinningBlock::GetBinZLow(int i, int j, int k) const
+{
+    if (m_dimension < 3)
+        return -9999999;
+    return m_z_edges.at(static_cast<size_t>(i)).at(static_cast<size_t>(j)).at(static_cast<size_t>(k));
+}
+
+Double_t TemplateBinningBlock::GetBinZHigh(int i, int j, int k) const
+{
+    if (m_dimension < 3)
+        return -9999999;
+    return m_z_edges.at(static_cast<size_t>(i)).at(static_cast<size_t>(j)).at(static_cast<size_t>(k + 1));
+}
 
 std::string TemplateBinningBlock::GetXName() const { return m_x_name; }
 std::string TemplateBinningBlock::GetXNameUnit() const { return m_x_name_unit; }
@@ -82,9 +219,21 @@ std::string TemplateBinningBlock::GetZTexTitleUnit() const { return m_z_tex_titl
 std::string TemplateBinningBlock::GetSelection() const { return m_selection; }
 
 std::vector<double> TemplateBinningBlock::GetVector() const { return m_edges; }
-std::vector<double> TemplateBinningBlock::GetVector(int) const { return m_edges; }
-std::vector<double> TemplateBinningBlock::GetVector(int, int) const { return m_edges; }
 
-bool TemplateBinningBlock::Is1D() const { return true; }
-bool TemplateBinningBlock::Is2D() const { return false; }
-bool TemplateBinningBlock::Is3D() const { return false; }
+std::vector<double> TemplateBinningBlock::GetVector(int x) const
+{
+    if (m_dimension < 2)
+        return m_edges;
+    return m_y_edges.at(static_cast<size_t>(x));
+}
+
+std::vector<double> TemplateBinningBlock::GetVector(int x, int y) const
+{
+    if (m_dimension < 3)
+        return GetVector(x);
+    return m_z_edges.at(static_cast<size_t>(x)).at(static_cast<size_t>(y));
+}
+
+bool TemplateBinningBlock::Is1D() const { return m_dimension == 1; }
+bool TemplateBinningBlock::Is2D() const { return m_dimension == 2; }
+bool TemplateBinningBlock::Is3D() const { return m_dimension == 3; }
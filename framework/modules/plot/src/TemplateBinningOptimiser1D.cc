@@ -11,16 +11,23 @@
 #include <TDecompSVD.h>
 #include <TH1.h>
 #include <TMatrixD.h>
-#include <TMatrixDSym.h>
 
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <ostream>
+#include <queue>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 
+#include "PackedSymMatrix.hh"
 #include "TemplateBinningBlock.hh"
 
 namespace
@@ -55,21 +62,12 @@ bool same_binning_x(const TH1 &a, const TH1 &b, const double eps = 1e-12)
     return (std::abs(a_high - b_high) <= eps);
 }
 
-void add_sym_in_place(TMatrixDSym &a, const TMatrixDSym &b, const double scale)
+/// POI variance of a matrix that is not positive definite; the SVD inverse
+/// keeps the old behaviour for degenerate (e.g. unconstrained) nuisances.
+bool svd_poi_variance(const PackedSymMatrix &a, const int poi_index, double &variance)
 {
-    const int n = a.GetNrows();
-    for (int i = 0; i < n; ++i)
-    {
-        for (int j = 0; j <= i; ++j)
-            a(i, j) += scale * b(i, j);
-    }
-}
-
-bool invert_symmetric_svd(const TMatrixDSym &a, TMatrixDSym &a_inverse)
-{
-    const int n = a.GetNrows();
+    const int n = a.dim();
     TMatrixD dense(n, n);
-
     for (int i = 0; i < n; ++i)
     {
         for (int j = 0; j < n; ++j)
@@ -82,16 +80,7 @@ bool invert_symmetric_svd(const TMatrixDSym &a, TMatrixDSym &a_inverse)
     if (!ok)
         return false;
 
-    a_inverse.ResizeTo(n, n);
-    for (int i = 0; i < n; ++i)
-    {
-        for (int j = 0; j <= i; ++j)
-        {
-            const double sym = 0.5 * (inverse(i, j) + inverse(j, i));
-            a_inverse(i, j) = sym;
-        }
-    }
-
+    variance = inverse(poi_index, poi_index);
     return true;
 }
 
@@ -115,6 +104,8 @@ struct FineCache
     std::vector<double> prior_sigmas;
     int poi_index = 0;
 
+    PackedSymOps ops;
+
     std::vector<double> mu;
     std::vector<double> var;
     std::vector<double> dmu;
@@ -133,43 +124,36 @@ struct BinState
     std::vector<double> var;
     std::vector<double> dmu;
 
-    TMatrixDSym fisher;
+    PackedSymMatrix fisher;
 };
 
-TMatrixDSym fisher_from_bin_sums(const BinState &bin,
-                                 const int n_channel,
-                                 const int n_parameter,
-                                 const double mu_floor)
+PackedSymMatrix fisher_from_bin_sums(const BinState &bin,
+                                     const FineCache &cache,
+                                     const double mu_floor)
 {
-    TMatrixDSym fisher(n_parameter);
+    const int n_parameter = cache.n_parameter;
+    PackedSymMatrix fisher(n_parameter);
 
-    for (int c = 0; c < n_channel; ++c)
+    for (int c = 0; c < cache.n_channel; ++c)
     {
         const double mu = bin.mu[c];
         const double denom = std::max(mu, mu_floor);
         if (denom <= 0.0)
             continue;
 
-        for (int a = 0; a < n_parameter; ++a)
-        {
-            const double da = bin.dmu[c * n_parameter + a];
-            for (int b = 0; b <= a; ++b)
-            {
-                const double db = bin.dmu[c * n_parameter + b];
-                fisher(a, b) += (da * db) / denom;
-            }
-        }
+        cache.ops.rank_one(fisher.data(), &bin.dmu[c * n_parameter], 1.0 / denom, n_parameter);
     }
 
     return fisher;
 }
 
-double sigma_poi_from_fisher(const TMatrixDSym &fisher_without_priors,
-                             const std::vector<double> &prior_sigmas,
-                             const int poi_index,
+double sigma_poi_from_fisher(const PackedSymMatrix &fisher_without_priors,
+                             const FineCache &cache,
                              const bool profile_nuisances)
 {
-    const int n_parameter = fisher_without_priors.GetNrows();
+    const int n_parameter = fisher_without_priors.dim();
+    const int poi_index = cache.poi_index;
+    const std::vector<double> &prior_sigmas = cache.prior_sigmas;
     if (n_parameter <= 0)
         return std::numeric_limits<double>::infinity();
 
@@ -184,18 +168,27 @@ double sigma_poi_from_fisher(const TMatrixDSym &fisher_without_priors,
         return 1.0 / std::sqrt(i_pp);
     }
 
-    TMatrixDSym total_fisher(fisher_without_priors);
+    PackedSymMatrix total_fisher(fisher_without_priors);
     for (int a = 0; a < n_parameter; ++a)
     {
         if (prior_sigmas[a] > 0.0)
             total_fisher(a, a) += 1.0 / (prior_sigmas[a] * prior_sigmas[a]);
     }
 
-    TMatrixDSym covariance(n_parameter);
-    if (!invert_symmetric_svd(total_fisher, covariance))
+    // (C^-1)_pp = |L^-1 e_p|^2 for C = L L^T.
+    double variance = 0.0;
+    PackedSymMatrix factor(total_fisher);
+    if (cache.ops.cholesky(factor.data(), n_parameter))
+    {
+        std::vector<double> y(n_parameter, 0.0);
+        y[poi_index] = 1.0;
+        cache.ops.forward(factor.data(), y.data(), poi_index, n_parameter);
+        for (int a = poi_index; a < n_parameter; ++a)
+            variance += y[a] * y[a];
+    }
+    else if (!svd_poi_variance(total_fisher, poi_index, variance))
         return std::numeric_limits<double>::infinity();
 
-    const double variance = covariance(poi_index, poi_index);
     if (!(variance > 0.0) || !std::isfinite(variance))
         return std::numeric_limits<double>::infinity();
 
@@ -348,11 +341,15 @@ FineCache build_fine_cache(const std::vector<TemplateBinningOptimizer1D::Channel
     if (poi_index < 0)
         poi_index = 0;
     cache.poi_index = poi_index;
+    cache.ops = packed_sym_ops(cache.n_parameter);
 
     for (int c = 0; c < cache.n_channel; ++c)
     {
         const TH1 &nominal = *channels[c].p_nominal;
 
+        if (channels[c].p_mc_variance && !same_binning_x(nominal, *channels[c].p_mc_variance))
+            throw std::runtime_error("MC variance histogram has different binning than nominal");
+
         for (int p = 0; p < cache.n_parameter; ++p)
         {
             const auto &parameter = channels[c].parameters[p];
@@ -386,7 +383,8 @@ FineCache build_fine_cache(const std::vector<TemplateBinningOptimizer1D::Channel
             const double mu = nominal.GetBinContent(i);
             const double err = nominal.GetBinError(i);
             cache.mu[c * cache.n_fine + (i - 1)] = mu;
-            cache.var[c * cache.n_fine + (i - 1)] = err * err;
+            cache.var[c * cache.n_fine + (i - 1)] =
+                channels[c].p_mc_variance ? std::max(channels[c].p_mc_variance->GetBinContent(i), 0.0) : err * err;
 
             for (int p = 0; p < cache.n_parameter; ++p)
             {
@@ -438,16 +436,18 @@ BinState make_fine_bin_state(const FineCache &cache,
             state.dmu[c * cache.n_parameter + p] = cache.get_dmu(c, p, i_fine);
     }
 
-    state.fisher = fisher_from_bin_sums(state, cache.n_channel, cache.n_parameter, mu_floor_for_objective);
+    state.fisher = fisher_from_bin_sums(state, cache, mu_floor_for_objective);
     return state;
 }
 
 BinState merge_bins(const BinState &left,
                     const BinState &right,
-                    const int n_channel,
-                    const int n_parameter,
+                    const FineCache &cache,
                     const double mu_floor_for_objective)
 {
+    const int n_channel = cache.n_channel;
+    const int n_parameter = cache.n_parameter;
+
     BinState merged;
     merged.low = std::min(left.low, right.low);
     merged.high = std::max(left.high, right.high);
@@ -464,170 +464,662 @@ BinState merge_bins(const BinState &left,
             merged.dmu[c * n_parameter + p] = left.dmu[c * n_parameter + p] + right.dmu[c * n_parameter + p];
     }
 
-    merged.fisher = fisher_from_bin_sums(merged, n_channel, n_parameter, mu_floor_for_objective);
+    merged.fisher = fisher_from_bin_sums(merged, cache, mu_floor_for_objective);
     return merged;
 }
 
-} // namespace
+/// Candidate merge of the bin starting at `low` with its right neighbour.
+/// Everything here depends only on the two bins, so it stays valid until one
+/// of them is merged with something else.
+struct MergeCandidate
+{
+    BinState merged;
+    ConstraintEval eval;
+    double width_cost = 0.0;
+
+    /// Fisher change of the merge as a signed rank-r sum,
+    ///   dF = sum_j s_j u_j u_j^T,
+    /// with u_j the per-channel derivative vectors of the merged, left and
+    /// right bins (column-major, n_parameter x r).
+    std::vector<double> u;
+    std::vector<double> s;
+    double delta_poi = 0.0;
+
+    unsigned version = 0;
+};
 
-TemplateBinningOptimizer1D::TemplateBinningOptimizer1D(Config cfg) : m_cfg(std::move(cfg)) {}
+struct HeapEntry
+{
+    double cost = 0.0;
+    std::uint64_t tie = 0;
+    int low = 0;
+    unsigned version = 0;
+    int stamp = 0;
+};
 
-TemplateBinningOptimizer1D::Result TemplateBinningOptimizer1D::optimise(const Channel &channel) const
+struct HeapOrder
 {
-    return optimise(std::vector<Channel>{channel});
+    /// Min-heap on (cost, tie); with the default tie key the leftmost pair
+    /// wins, as in the first-index argmin of a left-to-right scan.
+    bool operator()(const HeapEntry &a, const HeapEntry &b) const
+    {
+        if (a.cost != b.cost)
+            return a.cost > b.cost;
+        return a.tie > b.tie;
+    }
+};
+
+void append_rank_one(MergeCandidate &cand,
+                     const BinState &bin,
+                     const int c,
+                     const int n_parameter,
+                     const double sign,
+                     const double mu_floor)
+{
+    const double denom = std::max(bin.mu[c], mu_floor);
+    if (denom <= 0.0)
+        return;
+
+    for (int p = 0; p < n_parameter; ++p)
+        cand.u.push_back(bin.dmu[c * n_parameter + p]);
+    cand.s.push_back(sign / denom);
 }
 
-TemplateBinningOptimizer1D::Result TemplateBinningOptimizer1D::optimise(const std::vector<Channel> &channels) const
+MergeCandidate make_candidate(const BinState &left,
+                              const BinState &right,
+                              const FineCache &cache,
+                              const TemplateBinningOptimizer1D::Config &cfg)
 {
-    FineCache cache = build_fine_cache(channels, m_cfg);
+    MergeCandidate cand;
+    cand.merged = merge_bins(left, right, cache, cfg.mu_floor_for_objective);
+    cand.eval = evaluate_constraints(cand.merged, cfg, cache.n_channel, cfg.mu_floor_for_objective);
+    cand.width_cost = cfg.width_penalty * (cache.edges[cand.merged.high + 1] - cache.edges[cand.merged.low]);
+
+    cand.u.reserve(3 * cache.n_channel * cache.n_parameter);
+    cand.s.reserve(3 * cache.n_channel);
+    for (int c = 0; c < cache.n_channel; ++c)
+    {
+        append_rank_one(cand, cand.merged, c, cache.n_parameter, +1.0, cfg.mu_floor_for_objective);
+        append_rank_one(cand, left, c, cache.n_parameter, -1.0, cfg.mu_floor_for_objective);
+        append_rank_one(cand, right, c, cache.n_parameter, -1.0, cfg.mu_floor_for_objective);
+    }
 
-    std::vector<BinState> bins;
-    bins.reserve(cache.n_fine);
-    for (int i = 0; i < cache.n_fine; ++i)
-        bins.push_back(make_fine_bin_state(cache, i, m_cfg.mu_floor_for_objective));
+    for (size_t j = 0; j < cand.s.size(); ++j)
+    {
+        const double u_poi = cand.u[j * cache.n_parameter + cache.poi_index];
+        cand.delta_poi += cand.s[j] * u_poi * u_poi;
+    }
 
-    TMatrixDSym total_fisher(cache.n_parameter);
-    for (const auto &bin : bins)
-        add_sym_in_place(total_fisher, bin.fisher, +1.0);
+    return cand;
+}
 
-    double sigma_current = sigma_poi_from_fisher(total_fisher, cache.prior_sigmas, cache.poi_index, m_cfg.profile_nuisances);
+/// Solves the small dense system a x = b in place (partial pivoting).
+bool solve_dense(std::vector<double> &a, std::vector<double> &b, const int n)
+{
+    double scale = 0.0;
+    for (double v : a)
+        scale = std::max(scale, std::abs(v));
+    const double tiny = 1e-14 * scale;
 
-    auto need_more_merging = [&](const std::vector<BinState> &states) {
-        bool any_failing = false;
-        for (const auto &state : states)
+    for (int col = 0; col < n; ++col)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < n; ++row)
         {
-            const auto eval = evaluate_constraints(state, m_cfg, cache.n_channel, m_cfg.mu_floor_for_objective);
-            if (!eval.passes)
-            {
-                any_failing = true;
-                break;
-            }
+            if (std::abs(a[row * n + col]) > std::abs(a[pivot * n + col]))
+                pivot = row;
         }
+        if (!(std::abs(a[pivot * n + col]) > tiny) || !std::isfinite(a[pivot * n + col]))
+            return false;
 
-        const bool too_many_bins = (m_cfg.max_bins > 0) && (static_cast<int>(states.size()) > m_cfg.max_bins);
-        return any_failing || too_many_bins;
-    };
+        if (pivot != col)
+        {
+            for (int k = 0; k < n; ++k)
+                std::swap(a[col * n + k], a[pivot * n + k]);
+            std::swap(b[col], b[pivot]);
+        }
 
-    int iteration = 0;
-    while (bins.size() > 1 && need_more_merging(bins))
+        for (int row = col + 1; row < n; ++row)
+        {
+            const double f = a[row * n + col] / a[col * n + col];
+            if (f == 0.0)
+                continue;
+            for (int k = col; k < n; ++k)
+                a[row * n + k] -= f * a[col * n + k];
+            b[row] -= f * b[col];
+        }
+    }
+
+    for (int row = n - 1; row >= 0; --row)
     {
-        ++iteration;
+        double sum = b[row];
+        for (int k = row + 1; k < n; ++k)
+            sum -= a[row * n + k] * b[k];
+        b[row] = sum / a[row * n + row];
+    }
+
+    return true;
+}
+
+/// Scratch buffers reused across candidate updates.
+struct Workspace
+{
+    std::vector<double> z;
+    std::vector<double> m;
+    std::vector<double> w;
+    std::vector<double> x;
+};
+
+/// Profiled POI variance after applying a candidate's rank-r Fisher change to
+/// a model with Cholesky factor C = L L^T and y = L^-1 e_poi, via Woodbury:
+///   (C + U S U^T)^-1_pp = |y|^2 - w^T (S^-1 + Z^T Z)^-1 w,
+///   Z = L^-1 U, w = Z^T y.
+bool profiled_variance_update(const FineCache &cache,
+                              const PackedSymMatrix &factor,
+                              const std::vector<double> &y,
+                              const double y_norm2,
+                              const MergeCandidate &cand,
+                              Workspace &ws,
+                              double &variance)
+{
+    const int n_parameter = cache.n_parameter;
+    const int r = static_cast<int>(cand.s.size());
+    variance = y_norm2;
+    if (r == 0)
+        return true;
+
+    ws.z.assign(cand.u.begin(), cand.u.end());
+    for (int j = 0; j < r; ++j)
+        cache.ops.forward(factor.data(), &ws.z[j * n_parameter], 0, n_parameter);
+
+    ws.m.assign(r * r, 0.0);
+    ws.w.assign(r, 0.0);
+    for (int i = 0; i < r; ++i)
+    {
+        const double *z_i = &ws.z[i * n_parameter];
+        for (int j = 0; j <= i; ++j)
+        {
+            const double *z_j = &ws.z[j * n_parameter];
+            double sum = 0.0;
+            for (int a = 0; a < n_parameter; ++a)
+                sum += z_i[a] * z_j[a];
+            ws.m[i * r + j] = sum;
+            ws.m[j * r + i] = sum;
+        }
+        ws.m[i * r + i] += 1.0 / cand.s[i];
+
+        double sum = 0.0;
+        for (int a = cache.poi_index; a < n_parameter; ++a)
+            sum += z_i[a] * y[a];
+        ws.w[i] = sum;
+    }
+
+    ws.x.assign(ws.w.begin(), ws.w.end());
+    if (!solve_dense(ws.m, ws.x, r))
+        return false;
+
+    for (int i = 0; i < r; ++i)
+        variance -= ws.w[i] * ws.x[i];
+    return std::isfinite(variance);
+}
+
+/// Below this many candidates per worker the scan stays on one thread.
+constexpr int k_min_candidates_per_thread = 64;
+
+int resolve_threads(const int n_threads)
+{
+    if (n_threads > 0)
+        return n_threads;
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+std::pair<int, int> chunk(const int n, const int parts, const int index)
+{
+    const long long begin = static_cast<long long>(n) * index / parts;
+    const long long end = static_cast<long long>(n) * (index + 1) / parts;
+    return {static_cast<int>(begin), static_cast<int>(end)};
+}
+
+/// Tie-breaking key of the pair starting at `low`: the position itself for
+/// seed 0 (leftmost pair wins), otherwise a seeded bijective hash of it.
+std::uint64_t tie_key(const std::uint64_t seed, const int low)
+{
+    if (seed == 0)
+        return static_cast<std::uint64_t>(low);
+
+    std::uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (static_cast<std::uint64_t>(low) + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct ScanBest
+{
+    double cost = std::numeric_limits<double>::infinity();
+    std::uint64_t tie = 0;
+    int low = -1;
 
-        std::vector<bool> fails(bins.size(), false);
-        bool any_failing = false;
-        for (size_t i = 0; i < bins.size(); ++i)
+    /// Strict improvement on (cost, tie); an infinite or NaN cost never wins.
+    void offer(const double c, const std::uint64_t t, const int l)
+    {
+        if (c < cost || (low >= 0 && c == cost && t < tie))
         {
-            const auto eval = evaluate_constraints(bins[i], m_cfg, cache.n_channel, m_cfg.mu_floor_for_objective);
-            fails[i] = !eval.passes;
-            any_failing = any_failing || fails[i];
+            cost = c;
+            tie = t;
+            low = l;
         }
+    }
 
-        int best_index = -1;
-        double best_cost = std::numeric_limits<double>::infinity();
-        double best_sigma = sigma_current;
-        BinState best_merged;
+    void merge(const ScanBest &other)
+    {
+        if (other.low >= 0)
+            offer(other.cost, other.tie, other.low);
+    }
+};
+
+/// Persistent workers for the per-iteration candidate scan. run(fn) calls
+/// fn(worker) once on every worker, the caller acting as worker 0, and
+/// returns when all of them are done.
+class ScanPool
+{
+  public:
+    explicit ScanPool(const int n_workers)
+    {
+        for (int w = 1; w < n_workers; ++w)
+            m_threads.emplace_back([this, w] { work(w); });
+    }
 
-        for (int k = 0; k < static_cast<int>(bins.size()) - 1; ++k)
+    ~ScanPool()
+    {
         {
-            const bool touches_failing_bin = fails[k] || fails[k + 1];
-            if (any_failing && !touches_failing_bin)
-                continue;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto &t : m_threads)
+            t.join();
+    }
 
-            BinState merged = merge_bins(bins[k], bins[k + 1], cache.n_channel, cache.n_parameter, m_cfg.mu_floor_for_objective);
+    ScanPool(const ScanPool &) = delete;
+    ScanPool &operator=(const ScanPool &) = delete;
 
-            TMatrixDSym candidate_fisher(total_fisher);
-            add_sym_in_place(candidate_fisher, bins[k].fisher, -1.0);
-            add_sym_in_place(candidate_fisher, bins[k + 1].fisher, -1.0);
-            add_sym_in_place(candidate_fisher, merged.fisher, +1.0);
+    int size() const { return static_cast<int>(m_threads.size()) + 1; }
 
-            const double sigma_candidate =
-                sigma_poi_from_fisher(candidate_fisher, cache.prior_sigmas, cache.poi_index, m_cfg.profile_nuisances);
+    void run(const std::function<void(int)> &fn)
+    {
+        if (m_threads.empty())
+        {
+            fn(0);
+            return;
+        }
 
-            const auto merged_eval = evaluate_constraints(merged, m_cfg, cache.n_channel, m_cfg.mu_floor_for_objective);
-            const double width = cache.edges[merged.high + 1] - cache.edges[merged.low];
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fn = &fn;
+            m_pending = static_cast<int>(m_threads.size());
+            ++m_generation;
+        }
+        m_start.notify_all();
 
-            const double cost =
-                (sigma_candidate - sigma_current) +
-                merged_eval.penalty +
-                m_cfg.width_penalty * width;
+        fn(0);
 
-            if (cost < best_cost)
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0; });
+        m_fn = nullptr;
+    }
+
+  private:
+    void work(const int worker)
+    {
+        unsigned seen = 0;
+        for (;;)
+        {
+            const std::function<void(int)> *fn = nullptr;
             {
-                best_cost = cost;
-                best_index = k;
-                best_sigma = sigma_candidate;
-                best_merged = std::move(merged);
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_stop || m_generation != seen; });
+                if (m_stop)
+                    return;
+                seen = m_generation;
+                fn = m_fn;
             }
+
+            (*fn)(worker);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0)
+                m_done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    const std::function<void(int)> *m_fn = nullptr;
+    int m_pending = 0;
+    unsigned m_generation = 0;
+    bool m_stop = false;
+};
+
+TemplateBinningOptimizer1D::Result run_greedy(const FineCache &cache, const TemplateBinningOptimizer1D::Config &cfg)
+{
+    const int n_fine = cache.n_fine;
+    const int n_parameter = cache.n_parameter;
+    const int poi_index = cache.poi_index;
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    // Bins are contiguous fine ranges keyed by their first fine index, so the
+    // right neighbour of `low` is bins[low].high + 1 and merges never reindex.
+    std::vector<BinState> bins(n_fine);
+    std::vector<int> prev(n_fine, -1);
+    std::vector<char> is_head(n_fine, 1);
+    std::vector<char> fails(n_fine, 0);
+    int n_bins = n_fine;
+    int n_failing = 0;
+
+    const PackedSymOps &ops = cache.ops;
+    PackedSymMatrix total_fisher(n_parameter);
+    for (int i = 0; i < n_fine; ++i)
+    {
+        bins[i] = make_fine_bin_state(cache, i, cfg.mu_floor_for_objective);
+        prev[i] = i - 1;
+        fails[i] = !evaluate_constraints(bins[i], cfg, cache.n_channel, cfg.mu_floor_for_objective).passes;
+        n_failing += fails[i];
+        ops.add(total_fisher.data(), bins[i].fisher.data(), +1.0, n_parameter);
+    }
+
+    auto next_of = [&](const int low) { return bins[low].high + 1; };
+
+    // Without profiling (or with the POI alone) the objective only needs the
+    // POI information, which each candidate shifts by its own delta_poi.
+    // Otherwise the Cholesky factor of the model is kept and candidates are
+    // priced with a rank-r Woodbury update against it.
+    const bool scalar_objective = !cfg.profile_nuisances || n_parameter == 1;
+    const double poi_prior_information =
+        (cache.prior_sigmas[poi_index] > 0.0)
+            ? 1.0 / (cache.prior_sigmas[poi_index] * cache.prior_sigmas[poi_index])
+            : 0.0;
+
+    double information_poi = 0.0;
+    PackedSymMatrix factor(n_parameter);
+    std::vector<double> factor_poi(n_parameter, 0.0);
+    double variance_current = 0.0;
+    bool factor_ok = false;
+    double sigma_current = infinity;
+
+    // Candidate pricing is spread over contiguous chunks of the bin list, one
+    // per worker, each with its own scratch space.
+    ScanPool pool(resolve_threads(cfg.n_threads));
+    std::vector<Workspace> workspaces(pool.size());
+
+    auto sigma_from_information = [&](const double information) {
+        return (information > 0.0 && std::isfinite(information)) ? 1.0 / std::sqrt(information) : infinity;
+    };
+
+    auto refresh_objective = [&]() {
+        if (scalar_objective)
+        {
+            information_poi = total_fisher(poi_index, poi_index) + poi_prior_information;
+            sigma_current = sigma_from_information(information_poi);
+            return;
+        }
+
+        factor = total_fisher;
+        for (int a = 0; a < n_parameter; ++a)
+        {
+            if (cache.prior_sigmas[a] > 0.0)
+                factor(a, a) += 1.0 / (cache.prior_sigmas[a] * cache.prior_sigmas[a]);
+        }
+
+        factor_ok = ops.cholesky(factor.data(), n_parameter);
+        if (!factor_ok)
+        {
+            sigma_current = sigma_poi_from_fisher(total_fisher, cache, cfg.profile_nuisances);
+            return;
         }
 
-        if (best_index < 0)
+        std::fill(factor_poi.begin(), factor_poi.end(), 0.0);
+        factor_poi[poi_index] = 1.0;
+        ops.forward(factor.data(), factor_poi.data(), poi_index, n_parameter);
+
+        variance_current = 0.0;
+        for (int a = poi_index; a < n_parameter; ++a)
+            variance_current += factor_poi[a] * factor_poi[a];
+        sigma_current = (variance_current > 0.0 && std::isfinite(variance_current)) ? std::sqrt(variance_current) : infinity;
+    };
+
+    refresh_objective();
+
+    std::vector<MergeCandidate> candidates(n_fine);
+
+    auto candidate_sigma = [&](const int low, Workspace &ws) {
+        const MergeCandidate &cand = candidates[low];
+        if (scalar_objective)
+            return sigma_from_information(information_poi + cand.delta_poi);
+
+        double variance = 0.0;
+        if (factor_ok &&
+            profiled_variance_update(cache, factor, factor_poi, variance_current, cand, ws, variance))
+            return (variance > 0.0 && std::isfinite(variance)) ? std::sqrt(variance) : infinity;
+
+        // Degenerate total or update: price this candidate from scratch.
+        PackedSymMatrix candidate_fisher(total_fisher);
+        ops.add(candidate_fisher.data(), bins[low].fisher.data(), -1.0, n_parameter);
+        ops.add(candidate_fisher.data(), bins[next_of(low)].fisher.data(), -1.0, n_parameter);
+        ops.add(candidate_fisher.data(), cand.merged.fisher.data(), +1.0, n_parameter);
+        return sigma_poi_from_fisher(candidate_fisher, cache, cfg.profile_nuisances);
+    };
+
+    auto candidate_cost = [&](const int low, const double sigma) {
+        const MergeCandidate &cand = candidates[low];
+        return (sigma - sigma_current) + cand.eval.penalty + cand.width_cost;
+    };
+
+    // Lazy re-pricing is exact when no merge can lower another candidate's
+    // cost: with a scalar objective that holds as long as no merge adds POI
+    // information (delta_poi <= 0, true unless mu_floor clamps a bin). A
+    // stale heap key is then a lower bound on the current cost, so a freshly
+    // priced top entry is the argmin of a full scan.
+    bool use_heap = scalar_objective && std::isfinite(sigma_current);
+    int n_merges = 0;
+
+    using Heap = std::priority_queue<HeapEntry, std::vector<HeapEntry>, HeapOrder>;
+    Heap heap_all;
+    Heap heap_failing;
+
+    auto push_candidate = [&](const int low) {
+        const double cost = candidate_cost(low, candidate_sigma(low, workspaces[0]));
+        if (!std::isfinite(cost))
+            return;
+
+        const HeapEntry entry{cost, tie_key(cfg.tie_seed, low), low, candidates[low].version, n_merges};
+        heap_all.push(entry);
+        if (fails[low] || fails[next_of(low)])
+            heap_failing.push(entry);
+    };
+
+    auto build_candidate = [&](const int low) {
+        const unsigned version = candidates[low].version + 1;
+        candidates[low] = make_candidate(bins[low], bins[next_of(low)], cache, cfg);
+        candidates[low].version = version;
+    };
+
+    pool.run([&](const int worker) {
+        const auto range = chunk(n_fine - 1, pool.size(), worker);
+        for (int low = range.first; low < range.second; ++low)
+            build_candidate(low);
+    });
+
+    for (int low = 0; low + 1 < n_fine; ++low)
+    {
+        if (!(candidates[low].delta_poi <= 0.0))
+            use_heap = false;
+    }
+
+    if (use_heap)
+    {
+        for (int low = 0; low + 1 < n_fine; ++low)
+            push_candidate(low);
+    }
+
+    auto heap_select = [&](Heap &heap) {
+        while (!heap.empty())
         {
-            for (int k = 0; k < static_cast<int>(bins.size()) - 1; ++k)
+            const HeapEntry top = heap.top();
+            const bool alive = is_head[top.low] && next_of(top.low) < n_fine &&
+                               candidates[top.low].version == top.version;
+            if (!alive)
             {
-                BinState merged = merge_bins(bins[k], bins[k + 1], cache.n_channel, cache.n_parameter, m_cfg.mu_floor_for_objective);
+                heap.pop();
+                continue;
+            }
 
-                TMatrixDSym candidate_fisher(total_fisher);
-                add_sym_in_place(candidate_fisher, bins[k].fisher, -1.0);
-                add_sym_in_place(candidate_fisher, bins[k + 1].fisher, -1.0);
-                add_sym_in_place(candidate_fisher, merged.fisher, +1.0);
+            if (top.stamp == n_merges)
+                return top.low;
 
-                const double sigma_candidate =
-                    sigma_poi_from_fisher(candidate_fisher, cache.prior_sigmas, cache.poi_index, m_cfg.profile_nuisances);
-                const auto merged_eval = evaluate_constraints(merged, m_cfg, cache.n_channel, m_cfg.mu_floor_for_objective);
-                const double width = cache.edges[merged.high + 1] - cache.edges[merged.low];
+            heap.pop();
+            const double cost = candidate_cost(top.low, candidate_sigma(top.low, workspaces[0]));
+            if (std::isfinite(cost))
+                heap.push(HeapEntry{cost, top.tie, top.low, top.version, n_merges});
+        }
+        return -1;
+    };
 
-                const double cost =
-                    (sigma_candidate - sigma_current) +
-                    merged_eval.penalty +
-                    m_cfg.width_penalty * width;
+    std::vector<int> heads;
+    std::vector<ScanBest> chunk_best(pool.size());
 
-                if (cost < best_cost)
-                {
-                    best_cost = cost;
-                    best_index = k;
-                    best_sigma = sigma_candidate;
-                    best_merged = std::move(merged);
-                }
+    // Each chunk keeps its own strict (cost, tie) minimum; the order is total,
+    // so the reduction picks the same pair for any thread count.
+    auto scan_select = [&](const bool only_failing) {
+        heads.clear();
+        for (int low = 0; next_of(low) < n_fine; low = next_of(low))
+            heads.push_back(low);
+
+        const int n_heads = static_cast<int>(heads.size());
+        const int n_chunks = (n_heads >= k_min_candidates_per_thread * pool.size()) ? pool.size() : 1;
+
+        auto scan_chunk = [&](const int worker) {
+            ScanBest best;
+            const auto range = chunk(n_heads, n_chunks, worker);
+            for (int h = range.first; h < range.second; ++h)
+            {
+                const int low = heads[h];
+                if (only_failing && !fails[low] && !fails[next_of(low)])
+                    continue;
+
+                best.offer(candidate_cost(low, candidate_sigma(low, workspaces[worker])), tie_key(cfg.tie_seed, low), low);
             }
+            chunk_best[worker] = best;
+        };
+
+        if (n_chunks > 1)
+            pool.run(scan_chunk);
+        else
+            scan_chunk(0);
+
+        ScanBest best;
+        for (int w = 0; w < n_chunks; ++w)
+            best.merge(chunk_best[w]);
+        return best.low;
+    };
+
+    auto need_more_merging = [&]() {
+        const bool too_many_bins = (cfg.max_bins > 0) && (n_bins > cfg.max_bins);
+        return n_failing > 0 || too_many_bins;
+    };
+
+    int iteration = 0;
+    while (n_bins > 1 && need_more_merging())
+    {
+        ++iteration;
+
+        // Pairs touching a failing bin first; all pairs if none of those has
+        // a finite cost.
+        int best_low = -1;
+        if (use_heap)
+        {
+            if (n_failing > 0)
+                best_low = heap_select(heap_failing);
+            if (best_low < 0)
+                best_low = heap_select(heap_all);
+        }
+        else
+        {
+            best_low = scan_select(n_failing > 0);
+            if (best_low < 0)
+                best_low = scan_select(false);
         }
 
-        if (best_index < 0)
+        if (best_low < 0)
             break;
 
-        add_sym_in_place(total_fisher, bins[best_index].fisher, -1.0);
-        add_sym_in_place(total_fisher, bins[best_index + 1].fisher, -1.0);
-        add_sym_in_place(total_fisher, best_merged.fisher, +1.0);
+        const int right = next_of(best_low);
 
-        bins[best_index] = std::move(best_merged);
-        bins.erase(bins.begin() + best_index + 1);
+        ops.add(total_fisher.data(), bins[best_low].fisher.data(), -1.0, n_parameter);
+        ops.add(total_fisher.data(), bins[right].fisher.data(), -1.0, n_parameter);
+        ops.add(total_fisher.data(), candidates[best_low].merged.fisher.data(), +1.0, n_parameter);
 
-        sigma_current = best_sigma;
+        n_failing -= fails[best_low] + fails[right];
+        fails[best_low] = !candidates[best_low].eval.passes;
+        n_failing += fails[best_low];
 
-        if (m_cfg.verbose && m_cfg.p_log)
+        bins[best_low] = std::move(candidates[best_low].merged);
+        bins[right] = BinState{};
+        is_head[right] = 0;
+        --n_bins;
+        ++n_merges;
+
+        const int after = next_of(best_low);
+        if (after < n_fine)
+            prev[after] = best_low;
+
+        refresh_objective();
+        if (use_heap && !std::isfinite(sigma_current))
+            use_heap = false;
+
+        // Only the pairs that share a bin with the merge change.
+        const int left = prev[best_low];
+        if (left >= 0)
+            build_candidate(left);
+        if (after < n_fine)
+            build_candidate(best_low);
+
+        if (use_heap)
+        {
+            if (left >= 0)
+                push_candidate(left);
+            if (after < n_fine)
+                push_candidate(best_low);
+        }
+
+        if (cfg.verbose && cfg.p_log)
         {
-            (*m_cfg.p_log) << "[TemplateBinningOptimizer1D] iter=" << iteration
-                           << " bins=" << bins.size()
+            (*cfg.p_log) << "[TemplateBinningOptimizer1D] iter=" << iteration
+                           << " bins=" << n_bins
                            << " expected_sigma_poi=" << sigma_current
                            << "\n";
         }
     }
 
-    Result out;
-    out.edges.reserve(bins.size() + 1);
-    out.edges.push_back(cache.edges[bins.front().low]);
-    for (const auto &bin : bins)
-        out.edges.push_back(cache.edges[bin.high + 1]);
+    TemplateBinningOptimizer1D::Result out;
+    out.edges.reserve(n_bins + 1);
+    out.edges.push_back(cache.edges[0]);
+    for (int low = 0; low < n_fine; low = next_of(low))
+        out.edges.push_back(cache.edges[bins[low].high + 1]);
 
     out.expected_sigma_poi = sigma_current;
 
-    out.bins.reserve(bins.size());
-    for (const auto &bin : bins)
+    out.bins.reserve(n_bins);
+    for (int low = 0; low < n_fine; low = next_of(low))
     {
-        BinReport report;
+        const BinState &bin = bins[low];
+
+        TemplateBinningOptimizer1D::BinReport report;
         report.low = cache.edges[bin.low];
         report.high = cache.edges[bin.high + 1];
 
-        const auto eval = evaluate_constraints(bin, m_cfg, cache.n_channel, m_cfg.mu_floor_for_objective);
+        const auto eval = evaluate_constraints(bin, cfg, cache.n_channel, cfg.mu_floor_for_objective);
         report.mu_sum = eval.mu_sum;
         report.rel_mc_worst = eval.rel_mc_worst;
         report.passes_constraints = eval.passes;
@@ -638,6 +1130,112 @@ TemplateBinningOptimizer1D::Result TemplateBinningOptimizer1D::optimise(const st
     return out;
 }
 
+} // namespace
+
+TemplateBinningOptimizer1D::TemplateBinningOptimizer1D(Config cfg) : m_cfg(std::move(cfg)) {}
+
+TemplateBinningOptimizer1D::Result TemplateBinningOptimizer1D::optimise(const Channel &channel) const
+{
+    return optimise(std::vector<Channel>{channel});
+}
+
+TemplateBinningOptimizer1D::Result TemplateBinningOptimizer1D::optimise(const std::vector<Channel> &channels) const
+{
+    const FineCache cache = build_fine_cache(channels, m_cfg);
+    if (m_cfg.starts.empty())
+        return run_greedy(cache, m_cfg);
+
+    const int n_starts = static_cast<int>(m_cfg.starts.size());
+    const int n_threads = resolve_threads(m_cfg.n_threads);
+    const int n_concurrent = std::min(n_threads, n_starts);
+
+    std::vector<Result> results(n_starts);
+    auto run_start = [&](const int i) {
+        Config cfg = m_cfg;
+        cfg.width_penalty = m_cfg.starts[i].width_penalty;
+        cfg.tie_seed = m_cfg.starts[i].tie_seed;
+        cfg.starts.clear();
+        cfg.n_threads = std::max(1, n_threads / n_concurrent);
+        cfg.verbose = m_cfg.verbose && n_concurrent == 1;
+        results[i] = run_greedy(cache, cfg);
+    };
+
+    // Static round-robin assignment; results are kept in start order.
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(n_concurrent);
+    for (int t = 1; t < n_concurrent; ++t)
+    {
+        threads.emplace_back([&, t] {
+            try
+            {
+                for (int i = t; i < n_starts; i += n_concurrent)
+                    run_start(i);
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    try
+    {
+        for (int i = 0; i < n_starts; i += n_concurrent)
+            run_start(i);
+    }
+    catch (...)
+    {
+        errors[0] = std::current_exception();
+    }
+    for (auto &t : threads)
+        t.join();
+    for (const auto &e : errors)
+    {
+        if (e)
+            std::rethrow_exception(e);
+    }
+
+    // Best = all bins passing first, then the smallest expected POI error;
+    // the earliest start wins a tie.
+    auto all_pass = [](const Result &r) {
+        return std::all_of(r.bins.begin(), r.bins.end(), [](const BinReport &b) { return b.passes_constraints; });
+    };
+
+    int best = 0;
+    for (int i = 1; i < n_starts; ++i)
+    {
+        const bool pass_i = all_pass(results[i]);
+        const bool pass_best = all_pass(results[best]);
+        if ((pass_i && !pass_best) ||
+            (pass_i == pass_best && results[i].expected_sigma_poi < results[best].expected_sigma_poi))
+            best = i;
+    }
+
+    Result out = results[best];
+    out.runs.reserve(n_starts);
+    for (int i = 0; i < n_starts; ++i)
+    {
+        Run run;
+        run.start = m_cfg.starts[i];
+        run.edges = results[i].edges;
+        run.expected_sigma_poi = results[i].expected_sigma_poi;
+        run.bins = results[i].bins;
+        out.runs.push_back(std::move(run));
+
+        if (m_cfg.verbose && m_cfg.p_log)
+        {
+            (*m_cfg.p_log) << "[TemplateBinningOptimizer1D] start=" << i
+                           << " width_penalty=" << m_cfg.starts[i].width_penalty
+                           << " tie_seed=" << m_cfg.starts[i].tie_seed
+                           << " bins=" << results[i].bins.size()
+                           << " expected_sigma_poi=" << results[i].expected_sigma_poi
+                           << (i == best ? " (best)" : "")
+                           << "\n";
+        }
+    }
+
+    return out;
+}
+
 std::shared_ptr<TemplateBinningBlock> TemplateBinningOptimizer1D::Result::make_block(const std::string &name,
                                                                                       const std::string &title,
                                                                                       const std::string &selection,
@@ -0,0 +1,987 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/modules/plot/src/TemplateBinningOptimiserND.cc
+ *
+ *  @brief Implementation for template-based 2D/3D binning optimisation.
+ */
+
+#include "TemplateBinningOptimizerND.hh"
+
+#include <TAxis.h>
+#include <TDecompSVD.h>
+#include <TH1.h>
+#include <TH1D.h>
+#include <TMatrixD.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "PackedSymMatrix.hh"
+#include "TemplateBinningBlock.hh"
+
+namespace
+{
+
+using Config = TemplateBinningOptimizerND::Config;
+
+std::vector<double> extract_edges(const TAxis &axis)
+{
+    const int n = axis.GetNbins();
+    std::vector<double> edges(n + 1);
+    for (int i = 1; i <= n; ++i)
+        edges[i - 1] = axis.GetBinLowEdge(i);
+    edges[n] = axis.GetBinUpEdge(n);
+    return edges;
+}
+
+bool same_axis(const TAxis &a, const TAxis &b, const double eps = 1e-12)
+{
+    if (a.GetNbins() != b.GetNbins())
+        return false;
+
+    const int n = a.GetNbins();
+    for (int i = 1; i <= n; ++i)
+    {
+        if (std::abs(a.GetBinLowEdge(i) - b.GetBinLowEdge(i)) > eps)
+            return false;
+    }
+    return (std::abs(a.GetBinUpEdge(n) - b.GetBinUpEdge(n)) <= eps);
+}
+
+bool same_binning(const TH1 &a, const TH1 &b)
+{
+    return a.GetDimension() == b.GetDimension() &&
+           same_axis(*a.GetXaxis(), *b.GetXaxis()) &&
+           same_axis(*a.GetYaxis(), *b.GetYaxis()) &&
+           same_axis(*a.GetZaxis(), *b.GetZaxis());
+}
+
+/// Half-open box of fine bins, [x0, x1) x [y0, y1) x [z0, z1), 0-based.
+struct Box
+{
+    int x0 = 0;
+    int x1 = 0;
+    int y0 = 0;
+    int y1 = 0;
+    int z0 = 0;
+    int z1 = 0;
+};
+
+/**
+ *  Fine grid with inclusive cumulative sums of every per-channel quantity
+ *  (mu, MC variance, d mu / d theta_p), so any box sum is eight lookups.
+ *  2D inputs are stored as a grid with a single z bin.
+ */
+struct GridCache
+{
+    int dimension = 2;
+    int n_x = 0;
+    int n_y = 0;
+    int n_z = 1;
+
+    std::array<std::vector<double>, 3> edges;
+
+    int n_channel = 0;
+    int n_parameter = 0;
+    std::vector<std::string> parameter_names;
+    std::vector<double> prior_sigmas;
+    int poi_index = 0;
+    PackedSymOps ops;
+
+    int n_quantity = 0;
+    std::vector<double> prefix;
+
+    int q_mu(const int c) const { return c * (2 + n_parameter); }
+    int q_var(const int c) const { return c * (2 + n_parameter) + 1; }
+    int q_dmu(const int c, const int p) const { return c * (2 + n_parameter) + 2 + p; }
+
+    size_t prefix_index(const int q, const int i, const int j, const int k) const
+    {
+        return ((static_cast<size_t>(q) * (n_x + 1) + i) * (n_y + 1) + j) * (n_z + 1) + k;
+    }
+
+    double box(const int q, const Box &b) const
+    {
+        auto p = [&](const int i, const int j, const int k) { return prefix[prefix_index(q, i, j, k)]; };
+        return p(b.x1, b.y1, b.z1) - p(b.x0, b.y1, b.z1) - p(b.x1, b.y0, b.z1) - p(b.x1, b.y1, b.z0) +
+               p(b.x0, b.y0, b.z1) + p(b.x0, b.y1, b.z0) + p(b.x1, b.y0, b.z0) - p(b.x0, b.y0, b.z0);
+    }
+};
+
+double cell_value(const TH1 &h, const int dimension, const int i, const int j, const int k)
+{
+    return (dimension == 3) ? h.GetBinContent(i, j, k) : h.GetBinContent(i, j);
+}
+
+double cell_error(const TH1 &h, const int dimension, const int i, const int j, const int k)
+{
+    return (dimension == 3) ? h.GetBinError(i, j, k) : h.GetBinError(i, j);
+}
+
+GridCache build_grid_cache(const std::vector<TemplateBinningOptimizerND::Channel> &channels, const Config &cfg)
+{
+    if (channels.empty())
+        throw std::runtime_error("optimise() called with zero channels");
+
+    const TH1 *p_histogram_0 = channels.front().p_nominal;
+    if (!p_histogram_0)
+        throw std::runtime_error("channel[0] has null nominal histogram");
+
+    const int dimension = p_histogram_0->GetDimension();
+    if (dimension != 2 && dimension != 3)
+        throw std::runtime_error("N-D binning optimisation requires TH2 or TH3 nominal histograms");
+
+    for (const auto &channel : channels)
+    {
+        if (!channel.p_nominal)
+            throw std::runtime_error("a channel has null nominal histogram");
+        if (!same_binning(*p_histogram_0, *channel.p_nominal))
+            throw std::runtime_error("channels have different nominal binnings; shared-edge optimisation requires identical fine binning");
+        if (channel.p_mc_variance && !same_binning(*channel.p_nominal, *channel.p_mc_variance))
+            throw std::runtime_error("MC variance histogram has different binning than nominal");
+    }
+
+    const auto &parameters_0 = channels[0].parameters;
+    if (parameters_0.empty())
+        throw std::runtime_error("channel[0] has no parameters; need at least a POI for objective");
+
+    for (const auto &channel : channels)
+    {
+        if (channel.parameters.size() != parameters_0.size())
+            throw std::runtime_error("channels have different parameter counts");
+
+        for (size_t p = 0; p < parameters_0.size(); ++p)
+        {
+            const auto &parameter = channel.parameters[p];
+            if (parameter.name != parameters_0[p].name)
+                throw std::runtime_error("channels have different parameter name/order");
+            if (parameter.is_poi != parameters_0[p].is_poi)
+                throw std::runtime_error("channels have inconsistent is_poi flags");
+            if (std::abs(parameter.prior_sigma - parameters_0[p].prior_sigma) > 0.0)
+                throw std::runtime_error("channels have inconsistent prior_sigma for a parameter");
+
+            if (parameter.p_derivative)
+            {
+                if (!same_binning(*channel.p_nominal, *parameter.p_derivative))
+                    throw std::runtime_error("derivative histogram has different binning than nominal");
+            }
+            else
+            {
+                if (!parameter.p_up || !parameter.p_down)
+                    throw std::runtime_error("parameter must provide either derivative or (up and down)");
+                if (!same_binning(*channel.p_nominal, *parameter.p_up) ||
+                    !same_binning(*channel.p_nominal, *parameter.p_down))
+                    throw std::runtime_error("up/down histogram has different binning than nominal");
+                if (!(parameter.step > 0.0))
+                    throw std::runtime_error("parameter step must be > 0 for up/down finite difference");
+            }
+        }
+    }
+
+    GridCache cache;
+    cache.dimension = dimension;
+    cache.n_x = p_histogram_0->GetNbinsX();
+    cache.n_y = p_histogram_0->GetNbinsY();
+    cache.n_z = (dimension == 3) ? p_histogram_0->GetNbinsZ() : 1;
+    cache.edges[0] = extract_edges(*p_histogram_0->GetXaxis());
+    cache.edges[1] = extract_edges(*p_histogram_0->GetYaxis());
+    cache.edges[2] = (dimension == 3) ? extract_edges(*p_histogram_0->GetZaxis()) : std::vector<double>{0.0, 1.0};
+
+    cache.n_channel = static_cast<int>(channels.size());
+    cache.n_parameter = static_cast<int>(parameters_0.size());
+    cache.ops = packed_sym_ops(cache.n_parameter);
+    cache.parameter_names.resize(cache.n_parameter);
+    cache.prior_sigmas.resize(cache.n_parameter, 0.0);
+
+    int poi_index = -1;
+    for (int p = 0; p < cache.n_parameter; ++p)
+    {
+        cache.parameter_names[p] = parameters_0[p].name;
+        cache.prior_sigmas[p] = parameters_0[p].prior_sigma;
+        if (parameters_0[p].is_poi)
+        {
+            if (poi_index >= 0)
+                throw std::runtime_error("multiple parameters marked is_poi=true; require exactly one");
+            poi_index = p;
+        }
+    }
+    cache.poi_index = (poi_index < 0) ? 0 : poi_index;
+
+    cache.n_quantity = cache.n_channel * (2 + cache.n_parameter);
+    cache.prefix.assign(static_cast<size_t>(cache.n_quantity) * (cache.n_x + 1) * (cache.n_y + 1) * (cache.n_z + 1), 0.0);
+
+    for (int c = 0; c < cache.n_channel; ++c)
+    {
+        const auto &channel = channels[c];
+        for (int i = 1; i <= cache.n_x; ++i)
+        {
+            for (int j = 1; j <= cache.n_y; ++j)
+            {
+                for (int k = 1; k <= cache.n_z; ++k)
+                {
+                    const TH1 &nominal = *channel.p_nominal;
+                    const double err = cell_error(nominal, dimension, i, j, k);
+                    cache.prefix[cache.prefix_index(cache.q_mu(c), i, j, k)] = cell_value(nominal, dimension, i, j, k);
+                    cache.prefix[cache.prefix_index(cache.q_var(c), i, j, k)] =
+                        channel.p_mc_variance ? std::max(cell_value(*channel.p_mc_variance, dimension, i, j, k), 0.0)
+                                              : err * err;
+
+                    for (int p = 0; p < cache.n_parameter; ++p)
+                    {
+                        const auto &parameter = channel.parameters[p];
+                        double derivative = 0.0;
+                        if (parameter.p_derivative)
+                            derivative = cell_value(*parameter.p_derivative, dimension, i, j, k);
+                        else
+                        {
+                            const double up = cell_value(*parameter.p_up, dimension, i, j, k);
+                            const double down = cell_value(*parameter.p_down, dimension, i, j, k);
+                            derivative = (up - down) / (2.0 * parameter.step);
+                        }
+                        cache.prefix[cache.prefix_index(cache.q_dmu(c, p), i, j, k)] = derivative;
+                    }
+                }
+            }
+        }
+    }
+
+    // Running sums along z, then y, then x turn cell values into box sums
+    // anchored at the origin.
+    for (int q = 0; q < cache.n_quantity; ++q)
+    {
+        for (int i = 1; i <= cache.n_x; ++i)
+        {
+            for (int j = 1; j <= cache.n_y; ++j)
+            {
+                for (int k = 1; k <= cache.n_z; ++k)
+                    cache.prefix[cache.prefix_index(q, i, j, k)] += cache.prefix[cache.prefix_index(q, i, j, k - 1)];
+            }
+        }
+        for (int i = 1; i <= cache.n_x; ++i)
+        {
+            for (int j = 1; j <= cache.n_y; ++j)
+            {
+                for (int k = 1; k <= cache.n_z; ++k)
+                    cache.prefix[cache.prefix_index(q, i, j, k)] += cache.prefix[cache.prefix_index(q, i, j - 1, k)];
+            }
+        }
+        for (int i = 1; i <= cache.n_x; ++i)
+        {
+            for (int j = 1; j <= cache.n_y; ++j)
+            {
+                for (int k = 1; k <= cache.n_z; ++k)
+                    cache.prefix[cache.prefix_index(q, i, j, k)] += cache.prefix[cache.prefix_index(q, i - 1, j, k)];
+            }
+        }
+    }
+
+    if (cfg.base.verbose && cfg.base.p_log)
+    {
+        (*cfg.base.p_log) << "[TemplateBinningOptimizerND] fine bins=" << cache.n_x << "x" << cache.n_y;
+        if (dimension == 3)
+            (*cfg.base.p_log) << "x" << cache.n_z;
+        (*cfg.base.p_log) << " channels=" << cache.n_channel
+                          << " parameters=" << cache.n_parameter
+                          << " POI=" << cache.parameter_names[cache.poi_index] << "\n";
+    }
+
+    return cache;
+}
+
+struct CellEval
+{
+    bool passes = true;
+    double penalty = 0.0;
+
+    double mu_sum = 0.0;
+    double rel_mc_worst = 0.0;
+};
+
+/// Same yield / MC-stat constraints and penalty as the 1D optimiser.
+CellEval evaluate_cell(const GridCache &cache, const Box &box, const TemplateBinningOptimizer1D::Config &cfg)
+{
+    CellEval out;
+    const double mu_floor = cfg.mu_floor_for_objective;
+
+    auto penalty_for = [&](const double mu, const double rel) {
+        double penalty = 0.0;
+        if (mu < cfg.mu_min)
+        {
+            out.passes = false;
+            penalty += (cfg.mu_min > 0.0) ? (cfg.mu_min - mu) / cfg.mu_min : 1.0;
+        }
+        if (cfg.rel_mc_max > 0.0 && rel > cfg.rel_mc_max)
+        {
+            out.passes = false;
+            penalty += (rel - cfg.rel_mc_max) / cfg.rel_mc_max;
+        }
+        return penalty;
+    };
+
+    auto relative = [&](const double mu, const double var) {
+        return (mu > 0.0) ? std::sqrt(std::max(var, 0.0)) / std::max(mu, mu_floor)
+                          : std::numeric_limits<double>::infinity();
+    };
+
+    if (cfg.require_per_channel_constraints)
+    {
+        double worst_penalty = 0.0;
+        for (int c = 0; c < cache.n_channel; ++c)
+        {
+            const double mu = cache.box(cache.q_mu(c), box);
+            const double rel = relative(mu, cache.box(cache.q_var(c), box));
+            out.mu_sum += mu;
+            out.rel_mc_worst = std::max(out.rel_mc_worst, rel);
+            worst_penalty = std::max(worst_penalty, penalty_for(mu, rel));
+        }
+        out.penalty = 1000.0 * worst_penalty;
+        return out;
+    }
+
+    double var_sum = 0.0;
+    for (int c = 0; c < cache.n_channel; ++c)
+    {
+        out.mu_sum += cache.box(cache.q_mu(c), box);
+        var_sum += cache.box(cache.q_var(c), box);
+    }
+    out.rel_mc_worst = relative(out.mu_sum, var_sum);
+    out.penalty = 1000.0 * penalty_for(out.mu_sum, out.rel_mc_worst);
+    return out;
+}
+
+void add_cell_fisher(const GridCache &cache,
+                     const Box &box,
+                     const double mu_floor,
+                     const double scale,
+                     PackedSymMatrix &fisher,
+                     std::vector<double> &dmu)
+{
+    dmu.resize(cache.n_parameter);
+    for (int c = 0; c < cache.n_channel; ++c)
+    {
+        const double denom = std::max(cache.box(cache.q_mu(c), box), mu_floor);
+        if (denom <= 0.0)
+            continue;
+
+        for (int p = 0; p < cache.n_parameter; ++p)
+            dmu[p] = cache.box(cache.q_dmu(c, p), box);
+        cache.ops.rank_one(fisher.data(), dmu.data(), scale / denom, cache.n_parameter);
+    }
+}
+
+/// POI variance from the SVD inverse, for a Fisher matrix that is not
+/// positive definite (e.g. an unconstrained nuisance with no sensitivity).
+bool svd_poi_variance(const PackedSymMatrix &a, const int poi_index, double &variance)
+{
+    const int n = a.dim();
+    TMatrixD dense(n, n);
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+            dense(i, j) = a(i, j);
+    }
+
+    TDecompSVD svd(dense);
+    Bool_t ok = kFALSE;
+    TMatrixD inverse = svd.Invert(ok);
+    if (!ok)
+        return false;
+
+    variance = inverse(poi_index, poi_index);
+    return true;
+}
+
+double sigma_poi(const GridCache &cache, const PackedSymMatrix &fisher, const bool profile_nuisances)
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    const int n_parameter = cache.n_parameter;
+    const int poi_index = cache.poi_index;
+
+    if (!profile_nuisances)
+    {
+        double i_pp = fisher(poi_index, poi_index);
+        if (cache.prior_sigmas[poi_index] > 0.0)
+            i_pp += 1.0 / (cache.prior_sigmas[poi_index] * cache.prior_sigmas[poi_index]);
+        return (i_pp > 0.0 && std::isfinite(i_pp)) ? 1.0 / std::sqrt(i_pp) : infinity;
+    }
+
+    PackedSymMatrix total(fisher);
+    for (int a = 0; a < n_parameter; ++a)
+    {
+        if (cache.prior_sigmas[a] > 0.0)
+            total(a, a) += 1.0 / (cache.prior_sigmas[a] * cache.prior_sigmas[a]);
+    }
+
+    double variance = 0.0;
+    PackedSymMatrix factor(total);
+    if (cache.ops.cholesky(factor.data(), n_parameter))
+    {
+        std::vector<double> y(n_parameter, 0.0);
+        y[poi_index] = 1.0;
+        cache.ops.forward(factor.data(), y.data(), poi_index, n_parameter);
+        for (int a = poi_index; a < n_parameter; ++a)
+            variance += y[a] * y[a];
+    }
+    else if (!svd_poi_variance(total, poi_index, variance))
+        return infinity;
+
+    return (variance > 0.0 && std::isfinite(variance)) ? std::sqrt(variance) : infinity;
+}
+
+/// Cut positions (fine edge indices) per axis for every cell of the result.
+/// Conditional: y cuts per x bin and z cuts per (x, y) bin. Rectilinear
+/// results are stored the same way with repeated cuts.
+struct Cuts
+{
+    std::vector<int> x;
+    std::vector<std::vector<int>> y;
+    std::vector<std::vector<std::vector<int>>> z;
+};
+
+/// Runs the 1D optimiser along `axis` over fine range [first, last) with the
+/// other two axes summed over `box`, and returns the cuts in fine indices.
+std::vector<int> optimise_slice(const GridCache &cache,
+                                const std::vector<TemplateBinningOptimizerND::Channel> &channels,
+                                const Config &cfg,
+                                const int axis,
+                                const Box &box,
+                                const int max_bins)
+{
+    const int first = (axis == 0) ? box.x0 : (axis == 1) ? box.y0 : box.z0;
+    const int last = (axis == 0) ? box.x1 : (axis == 1) ? box.y1 : box.z1;
+    const int n = last - first;
+
+    std::vector<double> edges(cache.edges[axis].begin() + first, cache.edges[axis].begin() + last + 1);
+    if (n <= 1)
+        return {first, last};
+
+    auto make_hist = [&](const std::string &name) {
+        auto h = std::make_unique<TH1D>(name.c_str(), "", n, edges.data());
+        h->SetDirectory(nullptr);
+        return h;
+    };
+
+    std::vector<std::unique_ptr<TH1D>> owned;
+    std::vector<TemplateBinningOptimizer1D::Channel> slice_channels(cache.n_channel);
+    for (int c = 0; c < cache.n_channel; ++c)
+    {
+        auto nominal = make_hist("_nd_slice_mu");
+        auto variance = make_hist("_nd_slice_var");
+        std::vector<std::unique_ptr<TH1D>> derivatives;
+        for (int p = 0; p < cache.n_parameter; ++p)
+            derivatives.push_back(make_hist("_nd_slice_dmu"));
+
+        for (int i = 0; i < n; ++i)
+        {
+            Box b = box;
+            int &lo = (axis == 0) ? b.x0 : (axis == 1) ? b.y0 : b.z0;
+            int &hi = (axis == 0) ? b.x1 : (axis == 1) ? b.y1 : b.z1;
+            lo = first + i;
+            hi = first + i + 1;
+
+            const double var = cache.box(cache.q_var(c), b);
+            nominal->SetBinContent(i + 1, cache.box(cache.q_mu(c), b));
+            nominal->SetBinError(i + 1, std::sqrt(std::max(var, 0.0)));
+            variance->SetBinContent(i + 1, var);
+            for (int p = 0; p < cache.n_parameter; ++p)
+                derivatives[p]->SetBinContent(i + 1, cache.box(cache.q_dmu(c, p), b));
+        }
+
+        auto &slice = slice_channels[c];
+        slice.name = channels[c].name;
+        slice.p_nominal = nominal.get();
+        slice.p_mc_variance = variance.get();
+        for (int p = 0; p < cache.n_parameter; ++p)
+        {
+            TemplateBinningOptimizer1D::Parameter parameter;
+            parameter.name = cache.parameter_names[p];
+            parameter.p_derivative = derivatives[p].get();
+            parameter.prior_sigma = cache.prior_sigmas[p];
+            parameter.is_poi = (p == cache.poi_index);
+            slice.parameters.push_back(parameter);
+        }
+
+        owned.push_back(std::move(nominal));
+        owned.push_back(std::move(variance));
+        for (auto &d : derivatives)
+            owned.push_back(std::move(d));
+    }
+
+    TemplateBinningOptimizer1D::Config slice_cfg = cfg.base;
+    slice_cfg.max_bins = max_bins;
+    slice_cfg.verbose = false;
+    const auto result = TemplateBinningOptimizer1D(slice_cfg).optimise(slice_channels);
+
+    const auto &fine = cache.edges[axis];
+    const double tol = 1e-9 * std::max(1.0, std::abs(fine.back() - fine.front()));
+    std::vector<int> cuts;
+    cuts.reserve(result.edges.size());
+    for (const double edge : result.edges)
+    {
+        auto it = std::lower_bound(fine.begin(), fine.end(), edge - tol);
+        if (it == fine.end() || std::abs(*it - edge) > tol)
+            throw std::runtime_error("slice optimisation returned an edge that is not a fine bin edge");
+        cuts.push_back(static_cast<int>(it - fine.begin()));
+    }
+    return cuts;
+}
+
+Cuts optimise_conditional(const GridCache &cache,
+                          const std::vector<TemplateBinningOptimizerND::Channel> &channels,
+                          const Config &cfg)
+{
+    const Box all{0, cache.n_x, 0, cache.n_y, 0, cache.n_z};
+
+    Cuts cuts;
+    cuts.x = optimise_slice(cache, channels, cfg, 0, all, cfg.max_bins_x);
+
+    const int n_x = static_cast<int>(cuts.x.size()) - 1;
+    cuts.y.resize(n_x);
+    cuts.z.resize(n_x);
+    for (int ix = 0; ix < n_x; ++ix)
+    {
+        Box column = all;
+        column.x0 = cuts.x[ix];
+        column.x1 = cuts.x[ix + 1];
+        cuts.y[ix] = optimise_slice(cache, channels, cfg, 1, column, cfg.max_bins_y);
+
+        const int n_y = static_cast<int>(cuts.y[ix].size()) - 1;
+        cuts.z[ix].resize(n_y);
+        for (int iy = 0; iy < n_y; ++iy)
+        {
+            Box cell = column;
+            cell.y0 = cuts.y[ix][iy];
+            cell.y1 = cuts.y[ix][iy + 1];
+            cuts.z[ix][iy] = (cache.dimension == 3) ? optimise_slice(cache, channels, cfg, 2, cell, cfg.max_bins_z)
+                                                    : std::vector<int>{0, cache.n_z};
+        }
+
+        if (cfg.base.verbose && cfg.base.p_log)
+        {
+            (*cfg.base.p_log) << "[TemplateBinningOptimizerND] x bin=" << ix
+                              << " y bins=" << n_y << "\n";
+        }
+    }
+
+    return cuts;
+}
+
+Cuts optimise_rectilinear(const GridCache &cache, const Config &cfg)
+{
+    const auto &base = cfg.base;
+    const double infinity = std::numeric_limits<double>::infinity();
+    const std::array<int, 3> axis_limit = {cfg.max_bins_x, cfg.max_bins_y, cfg.max_bins_z};
+    const int n_axes = cache.dimension;
+    const int n_parameter = cache.n_parameter;
+
+    std::array<std::vector<int>, 3> cuts;
+    for (int a = 0; a < 3; ++a)
+    {
+        const int n = (a == 0) ? cache.n_x : (a == 1) ? cache.n_y : cache.n_z;
+        for (int i = 0; i <= n; ++i)
+            cuts[a].push_back(i);
+    }
+
+    using Index = std::array<int, 3>;
+    std::array<int, 3> n_bins = {cache.n_x, cache.n_y, cache.n_z};
+    auto grid_index = [](const std::array<int, 3> &dims, const Index &i) {
+        return (i[0] * dims[1] + i[1]) * dims[2] + i[2];
+    };
+    auto grid_size = [](const std::array<int, 3> &dims) { return static_cast<size_t>(dims[0]) * dims[1] * dims[2]; };
+    auto cell_index = [&](const Index &i) { return grid_index(n_bins, i); };
+    auto cell_box = [&](const Index &i) {
+        return Box{cuts[0][i[0]], cuts[0][i[0] + 1], cuts[1][i[1]], cuts[1][i[1] + 1], cuts[2][i[2]], cuts[2][i[2] + 1]};
+    };
+
+    auto for_range = [](const Index &lo, const Index &hi, const auto &fn) {
+        for (int ix = lo[0]; ix < hi[0]; ++ix)
+            for (int iy = lo[1]; iy < hi[1]; ++iy)
+                for (int iz = lo[2]; iz < hi[2]; ++iz)
+                    fn(Index{ix, iy, iz});
+    };
+    // Slab k along axis a of a grid: all indices with k on that axis.
+    auto for_slab = [&](const std::array<int, 3> &dims, const int a, const int k, const auto &fn) {
+        Index lo = {0, 0, 0};
+        Index hi = dims;
+        lo[a] = k;
+        hi[a] = k + 1;
+        for_range(lo, hi, fn);
+    };
+
+    // Cell Fisher matrices and constraint flags are built once and then only
+    // updated for the slab a merge rewrites.
+    std::vector<double> dmu;
+    std::vector<PackedSymMatrix> cell_fisher(grid_size(n_bins), PackedSymMatrix(n_parameter));
+    std::vector<char> cell_fails(cell_fisher.size(), 0);
+    PackedSymMatrix total_fisher(n_parameter);
+    for_range({0, 0, 0}, n_bins, [&](const Index &i) {
+        const Box box = cell_box(i);
+        const int index = cell_index(i);
+        add_cell_fisher(cache, box, base.mu_floor_for_objective, 1.0, cell_fisher[index], dmu);
+        cache.ops.add(total_fisher.data(), cell_fisher[index].data(), 1.0, n_parameter);
+        cell_fails[index] = !evaluate_cell(cache, box, base).passes;
+    });
+
+    // Merging cell i with its neighbour along axis b changes the total Fisher
+    // by the pair's `delta`. A candidate merge of slabs k and k+1 is the sum
+    // over its pairs, so a merge only reprices the pairs that overlap it.
+    struct Price
+    {
+        PackedSymMatrix delta;
+        double penalty = 0.0;
+    };
+    std::array<std::vector<Price>, 3> pairs;
+    std::array<std::vector<Price>, 3> candidates;
+    std::array<bool, 3> priced = {false, false, false};
+
+    auto pair_dims = [&](const int b) {
+        std::array<int, 3> dims = n_bins;
+        --dims[b];
+        return dims;
+    };
+
+    auto price_pair = [&](const int b, const Index &i) {
+        Price out;
+        out.delta = PackedSymMatrix(n_parameter);
+        Index next = i;
+        ++next[b];
+        cache.ops.add(out.delta.data(), cell_fisher[cell_index(i)].data(), -1.0, n_parameter);
+        cache.ops.add(out.delta.data(), cell_fisher[cell_index(next)].data(), -1.0, n_parameter);
+
+        Box merged = cell_box(i);
+        int &hi = (b == 0) ? merged.x1 : (b == 1) ? merged.y1 : merged.z1;
+        hi = cuts[b][i[b] + 2];
+        add_cell_fisher(cache, merged, base.mu_floor_for_objective, 1.0, out.delta, dmu);
+        out.penalty = evaluate_cell(cache, merged, base).penalty;
+        return out;
+    };
+
+    auto sum_candidate = [&](const int b, const int k) {
+        Price &c = candidates[b][k];
+        c.delta = PackedSymMatrix(n_parameter);
+        c.penalty = 0.0;
+        const auto dims = pair_dims(b);
+        for_slab(dims, b, k, [&](const Index &i) {
+            const Price &p = pairs[b][grid_index(dims, i)];
+            cache.ops.add(c.delta.data(), p.delta.data(), 1.0, n_parameter);
+            c.penalty = std::max(c.penalty, p.penalty);
+        });
+    };
+
+    // Pairs along an axis are priced the first time that axis opens.
+    auto price_axis = [&](const int b) {
+        if (priced[b])
+            return;
+        const auto dims = pair_dims(b);
+        pairs[b].resize(grid_size(dims));
+        for_range({0, 0, 0}, dims, [&](const Index &i) { pairs[b][grid_index(dims, i)] = price_pair(b, i); });
+        candidates[b].resize(std::max(0, n_bins[b] - 1));
+        for (int k = 0; k + 1 < n_bins[b]; ++k)
+            sum_candidate(b, k);
+        priced[b] = true;
+    };
+
+    int iteration = 0;
+    for (;;)
+    {
+        const int n_cells = n_bins[0] * n_bins[1] * n_bins[2];
+        const bool any_failing = std::any_of(cell_fails.begin(), cell_fails.end(), [](char f) { return f != 0; });
+        const double sigma_current = sigma_poi(cache, total_fisher, base.profile_nuisances);
+
+        // Axes allowed to merge: all of them while a cell fails or the total
+        // cell count is too high, otherwise only those over their own limit.
+        std::array<bool, 3> axis_open = {false, false, false};
+        bool any_open = false;
+        for (int a = 0; a < n_axes; ++a)
+        {
+            axis_open[a] = (axis_limit[a] > 0 && n_bins[a] > axis_limit[a]);
+            any_open = any_open || axis_open[a];
+        }
+        const bool too_many_cells = (base.max_bins > 0 && n_cells > base.max_bins);
+        if (any_failing || too_many_cells)
+        {
+            for (int a = 0; a < n_axes; ++a)
+                axis_open[a] = true;
+            any_open = true;
+        }
+        if (!any_open)
+            break;
+
+        int best_axis = -1;
+        int best_k = -1;
+        double best_cost = infinity;
+
+        auto scan = [&](const bool only_failing) {
+            for (int a = 0; a < n_axes; ++a)
+            {
+                if (!axis_open[a])
+                    continue;
+
+                price_axis(a);
+                for (int k = 0; k + 1 < n_bins[a]; ++k)
+                {
+                    bool touches_failing = false;
+                    auto check = [&](const Index &i) { touches_failing = touches_failing || cell_fails[cell_index(i)]; };
+                    for_slab(n_bins, a, k, check);
+                    for_slab(n_bins, a, k + 1, check);
+                    if (only_failing && !touches_failing)
+                        continue;
+
+                    const Price &c = candidates[a][k];
+                    PackedSymMatrix candidate(total_fisher);
+                    cache.ops.add(candidate.data(), c.delta.data(), 1.0, n_parameter);
+
+                    const double width = cache.edges[a][cuts[a][k + 2]] - cache.edges[a][cuts[a][k]];
+                    const double cost = (sigma_poi(cache, candidate, base.profile_nuisances) - sigma_current) +
+                                        c.penalty + base.width_penalty * width;
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_axis = a;
+                        best_k = k;
+                    }
+                }
+            }
+        };
+
+        scan(any_failing);
+        if (best_axis < 0 && any_failing)
+            scan(false);
+        if (best_axis < 0)
+            break;
+
+        // Apply the merge: the total moves by the priced delta, slab best_k is
+        // rebuilt from the merged boxes and the other slabs are only reindexed.
+        const int a = best_axis;
+        cache.ops.add(total_fisher.data(), candidates[a][best_k].delta.data(), 1.0, n_parameter);
+        cuts[a].erase(cuts[a].begin() + best_k + 1);
+
+        const std::array<int, 3> old_bins = n_bins;
+        --n_bins[a];
+
+        // Maps an index on the new grid (of cells or of pairs along some
+        // axis) back to the old one; the merged slab maps to its low half.
+        auto old_source = [&](Index i) {
+            if (i[a] > best_k)
+                ++i[a];
+            return i;
+        };
+
+        std::vector<PackedSymMatrix> next_fisher(grid_size(n_bins));
+        std::vector<char> next_fails(next_fisher.size(), 0);
+        for_range({0, 0, 0}, n_bins, [&](const Index &i) {
+            const int index = cell_index(i);
+            if (i[a] == best_k)
+            {
+                const Box box = cell_box(i);
+                next_fisher[index] = PackedSymMatrix(n_parameter);
+                add_cell_fisher(cache, box, base.mu_floor_for_objective, 1.0, next_fisher[index], dmu);
+                next_fails[index] = !evaluate_cell(cache, box, base).passes;
+                return;
+            }
+            const int from = grid_index(old_bins, old_source(i));
+            next_fisher[index] = std::move(cell_fisher[from]);
+            next_fails[index] = cell_fails[from];
+        });
+        cell_fisher = std::move(next_fisher);
+        cell_fails = std::move(next_fails);
+
+        // Along the merged axis only the two pairs that include the merged
+        // slab are repriced; their candidates are re-summed and the rest
+        // shift down by one.
+        if (priced[a])
+        {
+            std::array<int, 3> old_dims = old_bins;
+            --old_dims[a];
+            const auto dims = pair_dims(a);
+            std::vector<Price> next_pairs(grid_size(dims));
+            for_range({0, 0, 0}, dims, [&](const Index &i) {
+                if (i[a] == best_k - 1 || i[a] == best_k)
+                    next_pairs[grid_index(dims, i)] = price_pair(a, i);
+                else
+                    next_pairs[grid_index(dims, i)] = std::move(pairs[a][grid_index(old_dims, old_source(i))]);
+            });
+            pairs[a] = std::move(next_pairs);
+
+            auto &along = candidates[a];
+            along.erase(along.begin() + best_k);
+            if (best_k > 0)
+                sum_candidate(a, best_k - 1);
+            if (best_k < static_cast<int>(along.size()))
+                sum_candidate(a, best_k);
+        }
+
+        // On every other axis only the pairs lying in the merged slab change:
+        // each candidate swaps the two old rows of pairs for the new one.
+        for (int b = 0; b < 3; ++b)
+        {
+            if (b == a || !priced[b])
+                continue;
+
+            std::array<int, 3> old_dims = old_bins;
+            --old_dims[b];
+            const auto dims = pair_dims(b);
+            std::vector<Price> next_pairs(grid_size(dims));
+            for_slab(dims, a, best_k, [&](const Index &i) { next_pairs[grid_index(dims, i)] = price_pair(b, i); });
+
+            for (int k = 0; k + 1 < n_bins[b]; ++k)
+            {
+                Price &c = candidates[b][k];
+                Index lo = {0, 0, 0};
+                Index hi = dims;
+                lo[b] = k;
+                hi[b] = k + 1;
+                lo[a] = best_k;
+                hi[a] = best_k + 1;
+                for_range(lo, hi, [&](const Index &i) {
+                    Index low = i;
+                    Index high = i;
+                    ++high[a];
+                    cache.ops.add(c.delta.data(), pairs[b][grid_index(old_dims, low)].delta.data(), -1.0, n_parameter);
+                    cache.ops.add(c.delta.data(), pairs[b][grid_index(old_dims, high)].delta.data(), -1.0, n_parameter);
+                    cache.ops.add(c.delta.data(), next_pairs[grid_index(dims, i)].delta.data(), 1.0, n_parameter);
+                });
+            }
+
+            for_range({0, 0, 0}, dims, [&](const Index &i) {
+                if (i[a] != best_k)
+                    next_pairs[grid_index(dims, i)] = std::move(pairs[b][grid_index(old_dims, old_source(i))]);
+            });
+            pairs[b] = std::move(next_pairs);
+
+            // The penalty is a maximum, so it is rescanned from the stored
+            // pair penalties rather than updated in place.
+            for (int k = 0; k + 1 < n_bins[b]; ++k)
+            {
+                Price &c = candidates[b][k];
+                c.penalty = 0.0;
+                for_slab(dims, b, k, [&](const Index &i) { c.penalty = std::max(c.penalty, pairs[b][grid_index(dims, i)].penalty); });
+            }
+        }
+
+        ++iteration;
+
+        if (base.verbose && base.p_log)
+        {
+            (*base.p_log) << "[TemplateBinningOptimizerND] iter=" << iteration
+                          << " axis=" << best_axis
+                          << " bins=" << cuts[0].size() - 1 << "x" << cuts[1].size() - 1;
+            if (cache.dimension == 3)
+                (*base.p_log) << "x" << cuts[2].size() - 1;
+            (*base.p_log) << " expected_sigma_poi(before)=" << sigma_current << "\n";
+        }
+    }
+
+    Cuts out;
+    out.x = cuts[0];
+    const int n_x = static_cast<int>(cuts[0].size()) - 1;
+    const int n_y = static_cast<int>(cuts[1].size()) - 1;
+    out.y.assign(n_x, cuts[1]);
+    out.z.assign(n_x, std::vector<std::vector<int>>(n_y, cuts[2]));
+    return out;
+}
+
+} // namespace
+
+TemplateBinningOptimizerND::TemplateBinningOptimizerND(Config cfg) : m_cfg(std::move(cfg)) {}
+
+TemplateBinningOptimizerND::Result TemplateBinningOptimizerND::optimise(const Channel &channel) const
+{
+    return optimise(std::vector<Channel>{channel});
+}
+
+TemplateBinningOptimizerND::Result TemplateBinningOptimizerND::optimise(const std::vector<Channel> &channels) const
+{
+    const GridCache cache = build_grid_cache(channels, m_cfg);
+
+    const Cuts cuts = (m_cfg.strategy == Strategy::kRectilinear) ? optimise_rectilinear(cache, m_cfg)
+                                                                 : optimise_conditional(cache, channels, m_cfg);
+
+    Result out;
+    out.dimension = cache.dimension;
+
+    const auto &ex = cache.edges[0];
+    const auto &ey = cache.edges[1];
+    const auto &ez = cache.edges[2];
+
+    for (const int cut : cuts.x)
+        out.x_edges.push_back(ex[cut]);
+
+    std::vector<double> dmu;
+    PackedSymMatrix total_fisher(cache.n_parameter);
+
+    const int n_x = static_cast<int>(cuts.x.size()) - 1;
+    out.y_edges.resize(n_x);
+    if (cache.dimension == 3)
+        out.z_edges.resize(n_x);
+
+    for (int ix = 0; ix < n_x; ++ix)
+    {
+        for (const int cut : cuts.y[ix])
+            out.y_edges[ix].push_back(ey[cut]);
+
+        const int n_y = static_cast<int>(cuts.y[ix].size()) - 1;
+        if (cache.dimension == 3)
+            out.z_edges[ix].resize(n_y);
+
+        for (int iy = 0; iy < n_y; ++iy)
+        {
+            const auto &z_cuts = cuts.z[ix][iy];
+            if (cache.dimension == 3)
+            {
+                for (const int cut : z_cuts)
+                    out.z_edges[ix][iy].push_back(ez[cut]);
+            }
+
+            for (size_t iz = 0; iz + 1 < z_cuts.size(); ++iz)
+            {
+                const Box box{cuts.x[ix], cuts.x[ix + 1], cuts.y[ix][iy], cuts.y[ix][iy + 1], z_cuts[iz], z_cuts[iz + 1]};
+                add_cell_fisher(cache, box, m_cfg.base.mu_floor_for_objective, 1.0, total_fisher, dmu);
+
+                const auto eval = evaluate_cell(cache, box, m_cfg.base);
+
+                CellReport report;
+                report.x_low = ex[box.x0];
+                report.x_high = ex[box.x1];
+                report.y_low = ey[box.y0];
+                report.y_high = ey[box.y1];
+                if (cache.dimension == 3)
+                {
+                    report.z_low = ez[box.z0];
+                    report.z_high = ez[box.z1];
+                }
+                report.mu_sum = eval.mu_sum;
+                report.rel_mc_worst = eval.rel_mc_worst;
+                report.passes_constraints = eval.passes;
+                out.cells.push_back(report);
+            }
+        }
+    }
+
+    out.expected_sigma_poi = sigma_poi(cache, total_fisher, m_cfg.base.profile_nuisances);
+
+    if (m_cfg.base.verbose && m_cfg.base.p_log)
+    {
+        (*m_cfg.base.p_log) << "[TemplateBinningOptimizerND] cells=" << out.cells.size()
+                            << " expected_sigma_poi=" << out.expected_sigma_poi << "\n";
+    }
+
+    return out;
+}
+
+std::shared_ptr<TemplateBinningBlock> TemplateBinningOptimizerND::Result::make_block(const std::string &name,
+                                                                                      const std::string &title,
+                                                                                      const std::string &selection,
+                                                                                      int bin_type) const
+{
+    if (dimension == 3)
+        return std::make_shared<TemplateBinningBlock>(name, title, x_edges, y_edges, z_edges, selection, bin_type);
+    return std::make_shared<TemplateBinningBlock>(name, title, x_edges, y_edges, selection, bin_type);
+}
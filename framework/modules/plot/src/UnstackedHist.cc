@@ -16,6 +16,7 @@
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,6 +31,7 @@
 #include "TMatrixDSym.h"
 #include "TPad.h"
 
+#include "CovarianceSolver.hh"
 #include "PlotChannels.hh"
 #include "Plotter.hh"
 
@@ -88,6 +90,37 @@ UnstackedHist::UnstackedHist(TH1DModel spec,
 {
 }
 
+UnstackedHist::UnstackedHist(TH1DModel spec, Options opt, HistogramCache cache)
+    : spec_(std::move(spec)),
+      opt_(std::move(opt)),
+      cache_(std::make_shared<const HistogramCache>(std::move(cache))),
+      plot_name_(Plotter::sanitise(spec_.id)),
+      output_directory_(opt_.out_dir)
+{
+    if (opt_.particle_level)
+    {
+        throw std::runtime_error("UnstackedHist: particle-level plots are not supported from a histogram cache");
+    }
+    if (!cache_->channel_keys().empty())
+    {
+        for (int ch : opt_.unstack_channel_keys)
+        {
+            if (!cache_->channel(ch))
+            {
+                throw std::runtime_error("UnstackedHist: histogram cache has no channel " + std::to_string(ch) +
+                                         "; build it with the same unstack_channel_keys");
+            }
+        }
+    }
+    const std::vector<double> edges = cache_->edges();
+    if (edges.size() >= 2)
+    {
+        spec_.nbins = static_cast<int>(edges.size()) - 1;
+        spec_.xmin = edges.front();
+        spec_.xmax = edges.back();
+    }
+}
+
 void UnstackedHist::setup_pads(TCanvas &c, TPad *&p_main, TPad *&p_ratio, TPad *&p_legend) const
 {
     auto disable_primitive_ownership = [](TPad *pad) {
@@ -263,7 +296,7 @@ void UnstackedHist::build_histograms()
                                           : opt_.unstack_channel_keys;
     const TH1DModel &fill_spec = spec_;
 
-    for (size_t ie = 0; ie < mc_.size(); ++ie)
+    for (size_t ie = 0; !cache_ && ie < mc_.size(); ++ie)
     {
         unstack_debug_log("build_histograms: booking MC source index=" + std::to_string(ie));
         const Entry *e = mc_[ie];
@@ -291,6 +324,17 @@ void UnstackedHist::build_histograms()
 
     for (int ch : channels)
     {
+        if (cache_)
+        {
+            if (const TH1D *h = cache_->channel(ch))
+            {
+                std::unique_ptr<TH1D> sum(static_cast<TH1D *>(h->Clone((spec_.id + "_mc_sum_ch" + std::to_string(ch)).c_str())));
+                sum->SetDirectory(nullptr);
+                sum_by_channel.emplace(ch, std::move(sum));
+            }
+            continue;
+        }
+
         auto it = booked.find(ch);
         if (it == booked.end() || it->second.empty())
         {
@@ -398,7 +442,12 @@ void UnstackedHist::build_histograms()
                       " total_mc_events=" + std::to_string(total_mc_events_));
 
     // Data
-    if (!data_.empty())
+    if (cache_ && cache_->data())
+    {
+        data_hist_.reset(static_cast<TH1D *>(cache_->data()->Clone((spec_.id + "_data").c_str())));
+        data_hist_->SetDirectory(nullptr);
+    }
+    if (!cache_ && !data_.empty())
     {
         std::vector<ROOT::RDF::RResultPtr<TH1D>> parts;
         for (size_t ie = 0; ie < data_.size(); ++ie)
@@ -426,13 +475,13 @@ void UnstackedHist::build_histograms()
                 data_hist_->Add(&h);
             }
         }
-        if (data_hist_)
-        {
-            data_hist_->SetMarkerStyle(kFullCircle);
-            data_hist_->SetMarkerSize(0.9);
-            data_hist_->SetLineColor(kBlack);
-            data_hist_->SetFillStyle(0);
-        }
+    }
+    if (data_hist_)
+    {
+        data_hist_->SetMarkerStyle(kFullCircle);
+        data_hist_->SetMarkerSize(0.9);
+        data_hist_->SetLineColor(kBlack);
+        data_hist_->SetFillStyle(0);
     }
 
     // Signal overlay (scaled to total in visible range), same logic as StackedHist.
@@ -649,16 +698,7 @@ void UnstackedHist::draw_ratio(TPad *p_ratio)
 
     if (opt_.show_ratio_band)
     {
-        ratio_band_.reset(static_cast<TH1D *>(mc_total_->Clone((spec_.id + "_ratio_band").c_str())));
-        ratio_band_->SetDirectory(nullptr);
-        const int nb = ratio_band_->GetNbinsX();
-        for (int i = 1; i <= nb; ++i)
-        {
-            const double m = mc_total_->GetBinContent(i);
-            const double em = mc_total_->GetBinError(i);
-            ratio_band_->SetBinContent(i, 1.0);
-            ratio_band_->SetBinError(i, (m > 0 ? em / m : 0.0));
-        }
+        ratio_band_ = CovarianceSolver::ratio_band(*mc_total_, spec_.id + "_ratio_band");
         ratio_band_->SetFillColor(kBlack);
         ratio_band_->SetFillStyle(3004);
         ratio_band_->SetLineColor(kBlack);
@@ -1072,7 +1112,8 @@ void UnstackedHist::draw(TCanvas &canvas)
     canvas.Update();
 }
 
-void UnstackedHist::draw_and_save(const std::string &image_format)
+void UnstackedHist::draw_and_save(const std::string &image_format,
+                                  const std::vector<std::string> &extra_outputs)
 {
     std::filesystem::create_directories(output_directory_);
     unstack_debug_log("draw_and_save enter: plot='" + plot_name_ +
@@ -1089,6 +1130,10 @@ void UnstackedHist::draw_and_save(const std::string &image_format)
 
     unstack_debug_log("SaveAs start: plot='" + plot_name_ + "', file='" + out + "'");
     canvas.SaveAs(out.c_str());
+    for (const auto &extra : extra_outputs)
+    {
+        canvas.SaveAs(extra.c_str());
+    }
     unstack_debug_log("SaveAs done: plot='" + plot_name_ + "'");
 }
 
@@ -0,0 +1,236 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/tests/ana/LogitCalibratorLookupTest.cc
+ *
+ *  @brief Checks the compiled isotonic lookup of LogitCalibrator against a
+ *         plain std::upper_bound over the edges, on random, clustered and
+ *         degenerate edge sets, and the blocked batch evaluation against the
+ *         scalar methods.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "LogitCalibrator.hh"
+
+namespace
+{
+
+const double k_inf = std::numeric_limits<double>::infinity();
+
+std::size_t expected_bin(const std::vector<double> &edges, std::size_t n_values, double x)
+{
+    const std::ptrdiff_t idx = std::upper_bound(edges.begin(), edges.end(), x) - edges.begin() - 1;
+    return std::min(static_cast<std::size_t>(std::max<std::ptrdiff_t>(idx, 0)), n_values - 1);
+}
+
+// Probes: every edge and its neighbouring doubles, the non-finite inputs and
+// n_random draws over (and just beyond) the finite edge range.
+std::vector<double> probes(const std::vector<double> &edges, std::mt19937_64 &rng, int n_random)
+{
+    std::vector<double> xs = {k_inf, -k_inf, std::numeric_limits<double>::quiet_NaN(), 0.0, -0.0};
+    double lo = 0.0;
+    double hi = 0.0;
+    bool have_finite = false;
+    for (double e : edges)
+    {
+        xs.push_back(e);
+        xs.push_back(std::nextafter(e, -k_inf));
+        xs.push_back(std::nextafter(e, k_inf));
+        if (std::isfinite(e))
+        {
+            lo = have_finite ? std::min(lo, e) : e;
+            hi = have_finite ? std::max(hi, e) : e;
+            have_finite = true;
+        }
+    }
+
+    const double span = (hi > lo && std::isfinite(hi - lo)) ? hi - lo : 1.0;
+    std::uniform_real_distribution<double> u(lo - 0.1 * span, hi + 0.1 * span);
+    std::uniform_int_distribution<std::size_t> pick(0, edges.size() - 1);
+    std::uniform_real_distribution<double> jitter(-1e-9, 1e-9);
+    for (int i = 0; i < n_random; ++i)
+    {
+        xs.push_back(u(rng));
+        const double e = edges[pick(rng)];
+        if (std::isfinite(e))
+        {
+            xs.push_back(e + jitter(rng) * std::max(1.0, std::abs(e)));
+        }
+    }
+    return xs;
+}
+
+bool check(const std::string &name, const std::vector<double> &edges, std::mt19937_64 &rng)
+{
+    const std::size_t n_values = edges.size() - 1;
+    std::vector<double> values(n_values);
+    for (std::size_t i = 0; i < n_values; ++i)
+    {
+        values[i] = (static_cast<double>(i) + 1.0) / (static_cast<double>(n_values) + 1.0);
+    }
+
+    heron::LogitCalibrator c;
+    c.set_isotonic_mapping(edges, values);
+    const std::vector<double> &stored = c.get_values();
+
+    std::size_t n_bad = 0;
+    const std::vector<double> xs = probes(edges, rng, 20000);
+    for (double x : xs)
+    {
+        const double want = stored[expected_bin(edges, n_values, x)];
+        const double got = c.prob(x);
+        if (got != want)
+        {
+            if (n_bad < 5)
+            {
+                std::cerr << "[LogitCalibratorLookupTest] case=" << name << " x=" << x << " got=" << got
+                          << " want=" << want << "\n";
+            }
+            ++n_bad;
+        }
+    }
+    if (!c.verify_isotonic_lookup())
+    {
+        std::cerr << "[LogitCalibratorLookupTest] case=" << name << " verify_isotonic_lookup failed\n";
+        ++n_bad;
+    }
+
+    std::cout << "[LogitCalibratorLookupTest] case=" << name << " edges=" << edges.size() << " probes=" << xs.size()
+              << " mismatches=" << n_bad << "\n";
+    return n_bad == 0;
+}
+
+bool same(double a, double b)
+{
+    return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+// Every batch output, from double and float logits over a length that is not
+// a multiple of the block, must match the scalar method bit for bit.
+bool check_batch(const std::string &name, const heron::LogitCalibrator &c, const std::vector<double> &xs)
+{
+    using Output = heron::LogitCalibrator::Output;
+    const double pi_target = 0.2;
+    const std::vector<float> xs_float(xs.begin(), xs.end());
+    std::vector<double> out(xs.size());
+
+    std::size_t n_bad = 0;
+    auto compare = [&](Output what, const auto &input, const auto &scalar) {
+        c.evaluate(what, input.data(), input.size(), out.data(), pi_target);
+        for (std::size_t i = 0; i < input.size(); ++i)
+        {
+            n_bad += !same(out[i], scalar(static_cast<double>(input[i])));
+        }
+    };
+    auto run = [&](const auto &input) {
+        compare(Output::kProb, input, [&](double x) { return c.prob(x); });
+        compare(Output::kLogOdds, input, [&](double x) { return c.log_odds(x); });
+        compare(Output::kLLR, input, [&](double x) { return c.llr(x); });
+        compare(Output::kPosterior, input, [&](double x) { return c.posterior(x, pi_target); });
+        compare(Output::kLogOddsTarget, input, [&](double x) { return c.log_odds_target(x, pi_target); });
+    };
+    run(xs);
+    run(xs_float);
+
+    std::cout << "[LogitCalibratorLookupTest] case=" << name << " probes=" << xs.size() << " mismatches=" << n_bad
+              << "\n";
+    return n_bad == 0;
+}
+
+std::vector<double> sorted(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937_64 rng(20240611);
+    bool ok = true;
+
+    // Random: uniform and heavy-tailed edges, with and without infinite ends.
+    {
+        std::uniform_real_distribution<double> u(-8.0, 8.0);
+        std::vector<double> e(257);
+        for (double &x : e)
+        {
+            x = u(rng);
+        }
+        ok &= check("random_uniform", sorted(e), rng);
+
+        std::cauchy_distribution<double> cauchy(0.0, 1.0);
+        for (double &x : e)
+        {
+            x = cauchy(rng);
+        }
+        e = sorted(e);
+        e.front() = -k_inf;
+        e.back() = k_inf;
+        ok &= check("random_cauchy_open", e, rng);
+    }
+
+    // Clustered: most edges packed inside one grid cell, so the walk from the
+    // cell start would be long without the binary-search fallback.
+    {
+        std::vector<double> e = {-k_inf, -10.0, 10.0, k_inf};
+        std::uniform_real_distribution<double> tight(0.5, 0.5 + 1e-6);
+        for (int i = 0; i < 4000; ++i)
+        {
+            e.push_back(tight(rng));
+        }
+        ok &= check("clustered_one_cell", sorted(e), rng);
+
+        std::vector<double> f;
+        for (int k = -3; k <= 3; ++k)
+        {
+            std::normal_distribution<double> g(static_cast<double>(k), 1e-4);
+            for (int i = 0; i < 300; ++i)
+            {
+                f.push_back(g(rng));
+            }
+        }
+        ok &= check("clustered_groups", sorted(f), rng);
+    }
+
+    // Degenerate: too few edges for a grid, repeated edges, an empty or
+    // non-finite interior range, and a subnormally narrow one.
+    ok &= check("two_edges", {-1.0, 1.0}, rng);
+    ok &= check("three_edges", {-1.0, 0.0, 1.0}, rng);
+    ok &= check("repeated_edges", {-1.0, 0.0, 0.0, 0.0, 1.0, 2.0}, rng);
+    ok &= check("all_equal_interior", {-k_inf, 0.5, 0.5, 0.5, 0.5, k_inf}, rng);
+    ok &= check("infinite_interior", {-k_inf, -std::numeric_limits<double>::max(), 0.0,
+                                      std::numeric_limits<double>::max(), k_inf},
+                rng);
+    ok &= check("subnormal_range", {-1.0, 0.0, std::numeric_limits<double>::denorm_min(),
+                                    2.0 * std::numeric_limits<double>::denorm_min(), 1.0},
+                rng);
+
+    // Batch: Platt and isotonic calibrations through the blocked kernel.
+    {
+        std::vector<double> e = {-k_inf, -2.0, -0.5, 0.0, 0.3, 1.5, 4.0, k_inf};
+        std::vector<double> xs = probes(e, rng, 5000);
+        xs.push_back(std::numeric_limits<double>::max());
+        xs.push_back(-std::numeric_limits<double>::max());
+
+        heron::LogitCalibrator platt;
+        platt.set_platt(0.7, -0.2, 0.3);
+        ok &= check_batch("batch_platt", platt, xs);
+
+        heron::LogitCalibrator isotonic;
+        isotonic.set_isotonic_mapping(e, {0.05, 0.1, 0.3, 0.45, 0.6, 0.8, 0.95});
+        isotonic.set_pi_fit(0.3);
+        ok &= check_batch("batch_isotonic", isotonic, xs);
+    }
+
+    std::cout << "[LogitCalibratorLookupTest] " << (ok ? "passed" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,342 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/tests/io/ColumnarExportRoundTripTest.cc
+ *
+ *  @brief Writes scalar, bool, fixed-size and variable-length list columns
+ *         with ColumnarExportService and reads the Arrow IPC file back with
+ *         a minimal reader: schema, record batch lengths and every value.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RVec.hxx>
+
+#include "ColumnarExportService.hh"
+
+namespace
+{
+
+const ULong64_t k_rows = 1000;
+const int k_image_size = 4;
+
+int expected_i32(ULong64_t e) { return static_cast<int>(e) - 500; }
+double expected_f64(ULong64_t e) { return 0.5 * static_cast<double>(e); }
+bool expected_flag(ULong64_t e) { return e % 3 == 0; }
+float expected_pixel(ULong64_t e, int k) { return static_cast<float>(10 * e + k); }
+std::size_t expected_n_hits(ULong64_t e) { return e % 5; }
+unsigned short expected_hit(ULong64_t e, std::size_t k) { return static_cast<unsigned short>(e + k); }
+
+// Bounds-checked little-endian reads over the whole file.
+class Bytes
+{
+  public:
+    explicit Bytes(std::vector<uint8_t> data) : m_data(std::move(data)) {}
+
+    template <class T>
+    T get(std::size_t at) const
+    {
+        check(at, sizeof(T));
+        T v;
+        std::memcpy(&v, m_data.data() + at, sizeof(T));
+        return v;
+    }
+
+    std::string str(std::size_t at, std::size_t n) const
+    {
+        check(at, n);
+        return std::string(reinterpret_cast<const char *>(m_data.data() + at), n);
+    }
+
+    std::size_t size() const { return m_data.size(); }
+
+  private:
+    void check(std::size_t at, std::size_t n) const
+    {
+        if (at > m_data.size() || n > m_data.size() - at)
+            throw std::runtime_error("read past the end of the file at " + std::to_string(at));
+    }
+
+    std::vector<uint8_t> m_data;
+};
+
+// A FlatBuffers table at an absolute position in the file.
+struct Table
+{
+    const Bytes *bytes = nullptr;
+    std::size_t pos = 0;
+
+    std::size_t field(int slot) const
+    {
+        const std::size_t vtable = pos - bytes->get<int32_t>(pos);
+        const uint16_t vtable_size = bytes->get<uint16_t>(vtable);
+        const std::size_t entry = 4 + 2 * static_cast<std::size_t>(slot);
+        return entry < vtable_size ? bytes->get<uint16_t>(vtable + entry) : 0;
+    }
+
+    template <class T>
+    T scalar(int slot, T fallback = T()) const
+    {
+        const std::size_t off = field(slot);
+        return off ? bytes->get<T>(pos + off) : fallback;
+    }
+
+    std::size_t target(int slot) const
+    {
+        const std::size_t off = field(slot);
+        if (!off)
+            throw std::runtime_error("missing table field " + std::to_string(slot));
+        return pos + off + bytes->get<uint32_t>(pos + off);
+    }
+
+    Table table(int slot) const { return Table{bytes, target(slot)}; }
+
+    std::string string(int slot) const
+    {
+        const std::size_t at = target(slot);
+        return bytes->str(at + 4, bytes->get<uint32_t>(at));
+    }
+
+    uint32_t length(int slot) const { return bytes->get<uint32_t>(target(slot)); }
+
+    Table table_at(int slot, uint32_t i) const
+    {
+        const std::size_t at = target(slot) + 4 + 4 * static_cast<std::size_t>(i);
+        return Table{bytes, at + bytes->get<uint32_t>(at)};
+    }
+
+    std::size_t struct_at(int slot, uint32_t i, std::size_t struct_size) const
+    {
+        return target(slot) + 4 + struct_size * i;
+    }
+};
+
+Table root_table(const Bytes &bytes, std::size_t at) { return Table{&bytes, at + bytes.get<uint32_t>(at)}; }
+
+struct Field
+{
+    std::string name;
+    uint8_t type_id = 0;
+    Table type;
+    std::vector<Field> children;
+};
+
+Field read_field(const Table &t)
+{
+    Field f;
+    f.name = t.string(0);
+    f.type_id = t.scalar<uint8_t>(2);
+    f.type = t.table(3);
+    for (uint32_t i = 0; i < t.length(5); ++i)
+        f.children.push_back(read_field(t.table_at(5, i)));
+    return f;
+}
+
+bool is_int(const Field &f, int bits, bool is_signed)
+{
+    return f.type_id == 2 && f.type.scalar<int32_t>(0) == bits && (f.type.scalar<uint8_t>(1) != 0) == is_signed;
+}
+
+bool is_float(const Field &f, int16_t precision) { return f.type_id == 3 && f.type.scalar<int16_t>(0) == precision; }
+
+bool check_schema(const std::vector<Field> &fields)
+{
+    const bool ok = fields.size() == 5 && fields[0].name == "i32" && is_int(fields[0], 32, true) &&
+                    fields[1].name == "f64" && is_float(fields[1], 2) && fields[2].name == "flag" &&
+                    fields[2].type_id == 6 && fields[3].name == "image" && fields[3].type_id == 16 &&
+                    fields[3].type.scalar<int32_t>(0) == k_image_size && fields[3].children.size() == 1 &&
+                    is_float(fields[3].children[0], 1) && fields[4].name == "hits" && fields[4].type_id == 21 &&
+                    fields[4].children.size() == 1 && is_int(fields[4].children[0], 16, false);
+    std::cout << "[ColumnarExportRoundTripTest] case=schema" << (ok ? " ok" : " FAILED") << "\n";
+    return ok;
+}
+
+// One record batch's field nodes and body buffers, consumed in pre-order.
+struct Batch
+{
+    const Bytes *bytes = nullptr;
+    Table header;
+    std::size_t body = 0;
+    uint32_t node = 0;
+    uint32_t buffer = 0;
+
+    int64_t next_node()
+    {
+        return bytes->get<int64_t>(header.struct_at(1, node++, 16));
+    }
+
+    std::size_t next_buffer(int64_t &size)
+    {
+        const std::size_t at = header.struct_at(2, buffer++, 16);
+        size = bytes->get<int64_t>(at + 8);
+        return body + static_cast<std::size_t>(bytes->get<int64_t>(at));
+    }
+};
+
+// Checks one batch holding file rows [first, first + length).
+bool check_batch(Batch &b, ULong64_t first, int64_t length)
+{
+    bool ok = b.header.scalar<int64_t>(0) == length;
+    int64_t size = 0;
+
+    ok = ok && b.next_node() == length;
+    b.next_buffer(size);
+    const std::size_t i32 = b.next_buffer(size);
+    ok = ok && size == 4 * length;
+    for (int64_t r = 0; ok && r < length; ++r)
+        ok = b.bytes->get<int32_t>(i32 + 4 * r) == expected_i32(first + r);
+
+    ok = ok && b.next_node() == length;
+    b.next_buffer(size);
+    const std::size_t f64 = b.next_buffer(size);
+    ok = ok && size == 8 * length;
+    for (int64_t r = 0; ok && r < length; ++r)
+        ok = b.bytes->get<double>(f64 + 8 * r) == expected_f64(first + r);
+
+    ok = ok && b.next_node() == length;
+    b.next_buffer(size);
+    const std::size_t flag = b.next_buffer(size);
+    ok = ok && size == (length + 7) / 8;
+    for (int64_t r = 0; ok && r < length; ++r)
+        ok = ((b.bytes->get<uint8_t>(flag + r / 8) >> (r % 8) & 1u) != 0) == expected_flag(first + r);
+
+    ok = ok && b.next_node() == length;
+    b.next_buffer(size);
+    ok = ok && b.next_node() == length * k_image_size;
+    b.next_buffer(size);
+    const std::size_t image = b.next_buffer(size);
+    ok = ok && size == 4 * length * k_image_size;
+    for (int64_t r = 0; ok && r < length; ++r)
+    {
+        for (int k = 0; ok && k < k_image_size; ++k)
+            ok = b.bytes->get<float>(image + 4 * (r * k_image_size + k)) == expected_pixel(first + r, k);
+    }
+
+    ok = ok && b.next_node() == length;
+    b.next_buffer(size);
+    const std::size_t offsets = b.next_buffer(size);
+    ok = ok && size == 8 * (length + 1);
+    int64_t n_hits = 0;
+    for (int64_t r = 0; ok && r < length; ++r)
+    {
+        ok = b.bytes->get<int64_t>(offsets + 8 * r) == n_hits;
+        n_hits += static_cast<int64_t>(expected_n_hits(first + r));
+    }
+    ok = ok && b.bytes->get<int64_t>(offsets + 8 * length) == n_hits;
+    ok = ok && b.next_node() == n_hits;
+    b.next_buffer(size);
+    const std::size_t hits = b.next_buffer(size);
+    ok = ok && size == 2 * n_hits;
+    for (int64_t r = 0, at = 0; ok && r < length; ++r)
+    {
+        for (std::size_t k = 0; ok && k < expected_n_hits(first + r); ++k, ++at)
+            ok = b.bytes->get<uint16_t>(hits + 2 * at) == expected_hit(first + r, k);
+    }
+    return ok;
+}
+
+bool check_round_trip(const std::string &name, std::size_t chunk_bytes, const std::vector<int64_t> &want_lengths)
+{
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / ("heron_columnar_round_trip_" + name);
+    std::filesystem::remove_all(dir);
+
+    ROOT::RDF::RNode node = ROOT::RDataFrame(k_rows);
+    node = node.Define("i32", expected_i32, {"rdfentry_"})
+               .Define("f64", expected_f64, {"rdfentry_"})
+               .Define("flag", expected_flag, {"rdfentry_"})
+               .Define("image",
+                       [](ULong64_t e)
+                       {
+                           ROOT::RVec<float> v(k_image_size);
+                           for (int k = 0; k < k_image_size; ++k)
+                               v[k] = expected_pixel(e, k);
+                           return v;
+                       },
+                       {"rdfentry_"})
+               .Define("hits",
+                       [](ULong64_t e)
+                       {
+                           ROOT::RVec<unsigned short> v(expected_n_hits(e));
+                           for (std::size_t k = 0; k < v.size(); ++k)
+                               v[k] = expected_hit(e, k);
+                           return v;
+                       },
+                       {"rdfentry_"});
+
+    ColumnarExportService::Options opt;
+    opt.batch_rows = 64;
+    opt.chunk_bytes = chunk_bytes;
+    opt.fixed_size_columns = {"image"};
+    const auto manifest =
+        ColumnarExportService::write_arrow(node, dir.string(), "events", {"i32", "f64", "flag", "image", "hits"}, opt);
+
+    bool ok = manifest.rows == static_cast<Long64_t>(k_rows) && manifest.shards.size() == 1 &&
+              manifest.shards[0].batches == static_cast<Long64_t>(want_lengths.size());
+    try
+    {
+        std::ifstream in(dir / manifest.shards.at(0).path, std::ios::binary);
+        const Bytes bytes(std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {}));
+        ok = ok && bytes.str(0, 6) == "ARROW1" && bytes.str(bytes.size() - 6, 6) == "ARROW1";
+
+        const std::size_t footer_size = static_cast<std::size_t>(bytes.get<int32_t>(bytes.size() - 10));
+        const Table footer = root_table(bytes, bytes.size() - 10 - footer_size);
+        const Table schema = footer.table(1);
+        std::vector<Field> fields;
+        for (uint32_t i = 0; i < schema.length(1); ++i)
+            fields.push_back(read_field(schema.table_at(1, i)));
+        ok = check_schema(fields) && ok;
+
+        std::vector<int64_t> lengths;
+        ULong64_t first = 0;
+        for (uint32_t i = 0; i < footer.length(3); ++i)
+        {
+            const std::size_t block = footer.struct_at(3, i, 24);
+            const auto offset = static_cast<std::size_t>(bytes.get<int64_t>(block));
+            const auto metadata_length = static_cast<std::size_t>(bytes.get<int32_t>(block + 8));
+
+            const Table message = root_table(bytes, offset + 8);
+            ok = ok && bytes.get<uint32_t>(offset) == 0xFFFFFFFFu && message.scalar<uint8_t>(1) == 3;
+            Batch batch{&bytes, message.table(2), offset + metadata_length};
+            const int64_t length = batch.header.scalar<int64_t>(0);
+            lengths.push_back(length);
+            ok = ok && check_batch(batch, first, length);
+            first += static_cast<ULong64_t>(length);
+        }
+        ok = ok && lengths == want_lengths && first == k_rows;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "[ColumnarExportRoundTripTest] " << e.what() << "\n";
+        ok = false;
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << "[ColumnarExportRoundTripTest] case=" << name << " batches=" << want_lengths.size()
+              << (ok ? " ok" : " FAILED") << "\n";
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    // Any buffered byte closes a batch at every batch_rows boundary; a large
+    // chunk keeps the whole shard in one batch.
+    std::vector<int64_t> every_boundary(k_rows / 64, 64);
+    every_boundary.push_back(k_rows % 64);
+
+    bool ok = check_round_trip("every_boundary", 1, every_boundary);
+    ok &= check_round_trip("one_batch", 1u << 30, {static_cast<int64_t>(k_rows)});
+
+    std::cout << "[ColumnarExportRoundTripTest] " << (ok ? "passed" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/tests/plot/TemplateBinningBlockTest.cc
+ *
+ *  @brief Checks that TemplateBinningBlock accepts conditional 2D/3D edges
+ *         and rejects y/z edge sets that do not match the bins they hang
+ *         off.
+ */
+
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TemplateBinningBlock.hh"
+
+namespace
+{
+
+using Edges = std::vector<double>;
+using Edges2 = std::vector<Edges>;
+using Edges3 = std::vector<Edges2>;
+
+bool expect_throw(const std::string &name, const std::function<void()> &make)
+{
+    bool threw = false;
+    try
+    {
+        make();
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    std::cout << "[TemplateBinningBlockTest] case=" << name << (threw ? " ok" : " FAILED") << "\n";
+    return threw;
+}
+
+bool check_conditional()
+{
+    const Edges x = {0.0, 1.0, 2.0};
+    const Edges2 y = {{0.0, 0.5, 1.0}, {0.0, 1.0}};
+    const Edges3 z = {{{0.0, 1.0}, {0.0, 0.2, 0.6, 1.0}}, {{0.0, 0.5, 1.0}}};
+
+    const TemplateBinningBlock block_2d("b2", "", x, y, "", 1);
+    const TemplateBinningBlock block_3d("b3", "", x, y, z, "", 1);
+
+    const bool ok = block_2d.Is2D() && block_2d.GetNBinsTotal() == 3 && block_2d.GetNBinsY(0) == 2 &&
+                    block_2d.GetNBinsY(1) == 1 && block_3d.Is3D() && block_3d.GetNBinsTotal() == 6 &&
+                    block_3d.GetNBinsZ(0, 1) == 3 && block_3d.GetBinZHigh(0, 1, 1) == 0.6;
+    std::cout << "[TemplateBinningBlockTest] case=conditional" << (ok ? " ok" : " FAILED") << "\n";
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    const Edges x = {0.0, 1.0, 2.0};
+    const Edges2 y = {{0.0, 0.5, 1.0}, {0.0, 1.0}};
+
+    bool ok = check_conditional();
+
+    ok &= expect_throw("y_sets_short", [&] { TemplateBinningBlock("b", "", x, Edges2{{0.0, 1.0}}, "", 1); });
+    ok &= expect_throw("y_sets_long", [&] { TemplateBinningBlock("b", "", x, Edges2(3, Edges{0.0, 1.0}), "", 1); });
+    ok &= expect_throw("y_set_single_edge", [&] { TemplateBinningBlock("b", "", x, Edges2{{0.0, 1.0}, {0.0}}, "", 1); });
+
+    ok &= expect_throw("z_sets_per_x", [&] {
+        TemplateBinningBlock("b", "", x, y, Edges3{{{0.0, 1.0}, {0.0, 1.0}}}, "", 1);
+    });
+    ok &= expect_throw("z_sets_per_y", [&] {
+        TemplateBinningBlock("b", "", x, y, Edges3{{{0.0, 1.0}}, {{0.0, 1.0}}}, "", 1);
+    });
+    ok &= expect_throw("z_set_single_edge", [&] {
+        TemplateBinningBlock("b", "", x, y, Edges3{{{0.0, 1.0}, {1.0}}, {{0.0, 1.0}}}, "", 1);
+    });
+
+    std::cout << "[TemplateBinningBlockTest] " << (ok ? "passed" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/tests/plot/TemplateBinningOptimiser1DTest.cc
+ *
+ *  @brief Checks TemplateBinningOptimizer1D against a plain greedy rescan:
+ *         the profiled POI error of a fixed binning (which must see the
+ *         nuisance correlation), and the edges chosen by the incremental
+ *         merger on random templates, profiled and not.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <TH1D.h>
+
+#include "TemplateBinningOptimizer1D.hh"
+
+namespace
+{
+
+struct Templates
+{
+    std::vector<double> mu;
+    std::vector<std::vector<double>> dmu; // [parameter][bin]
+    std::vector<double> prior_sigma;      // 0 => free
+    int poi = 0;
+};
+
+std::unique_ptr<TH1D> make_hist(const std::string &name, const std::vector<double> &values)
+{
+    const int n = static_cast<int>(values.size());
+    auto h = std::make_unique<TH1D>(name.c_str(), "", n, 0.0, 1.0);
+    h->SetDirectory(nullptr);
+    for (int i = 0; i < n; ++i)
+    {
+        h->SetBinContent(i + 1, values[static_cast<std::size_t>(i)]);
+        h->SetBinError(i + 1, 1e-3 * std::abs(values[static_cast<std::size_t>(i)]));
+    }
+    return h;
+}
+
+// (C^-1)_pp by Gauss-Jordan elimination, C = sum_bins d d^T / mu + priors.
+double reference_sigma(const Templates &t, const std::vector<std::pair<int, int>> &bins, bool profile)
+{
+    const std::size_t n = t.dmu.size();
+    std::vector<double> c(n * n, 0.0);
+    for (const auto &b : bins)
+    {
+        double mu = 0.0;
+        std::vector<double> d(n, 0.0);
+        for (int i = b.first; i <= b.second; ++i)
+        {
+            mu += t.mu[static_cast<std::size_t>(i)];
+            for (std::size_t a = 0; a < n; ++a)
+                d[a] += t.dmu[a][static_cast<std::size_t>(i)];
+        }
+        for (std::size_t a = 0; a < n; ++a)
+        {
+            for (std::size_t k = 0; k < n; ++k)
+                c[a * n + k] += d[a] * d[k] / mu;
+        }
+    }
+    for (std::size_t a = 0; a < n; ++a)
+    {
+        if (t.prior_sigma[a] > 0.0)
+            c[a * n + a] += 1.0 / (t.prior_sigma[a] * t.prior_sigma[a]);
+    }
+
+    const std::size_t p = static_cast<std::size_t>(t.poi);
+    if (!profile)
+        return 1.0 / std::sqrt(c[p * n + p]);
+
+    std::vector<double> x(n, 0.0);
+    x[p] = 1.0;
+    for (std::size_t col = 0; col < n; ++col)
+    {
+        std::size_t piv = col;
+        for (std::size_t r = col + 1; r < n; ++r)
+        {
+            if (std::abs(c[r * n + col]) > std::abs(c[piv * n + col]))
+                piv = r;
+        }
+        for (std::size_t k = 0; k < n; ++k)
+            std::swap(c[col * n + k], c[piv * n + k]);
+        std::swap(x[col], x[piv]);
+        const double diag = c[col * n + col];
+        for (std::size_t r = 0; r < n; ++r)
+        {
+            if (r == col)
+                continue;
+            const double f = c[r * n + col] / diag;
+            for (std::size_t k = 0; k < n; ++k)
+                c[r * n + k] -= f * c[col * n + k];
+            x[r] -= f * x[col];
+        }
+    }
+    return std::sqrt(x[p] / c[p * n + p]);
+}
+
+// The merge loop as it was before candidates were cached: price every
+// adjacent pair from scratch and take the first with the lowest sigma.
+std::vector<std::pair<int, int>> reference_greedy(const Templates &t, int max_bins, bool profile)
+{
+    std::vector<std::pair<int, int>> bins;
+    for (int i = 0; i < static_cast<int>(t.mu.size()); ++i)
+        bins.emplace_back(i, i);
+
+    while (static_cast<int>(bins.size()) > max_bins)
+    {
+        int best = -1;
+        double best_sigma = std::numeric_limits<double>::infinity();
+        for (std::size_t k = 0; k + 1 < bins.size(); ++k)
+        {
+            std::vector<std::pair<int, int>> trial(bins);
+            trial[k].second = trial[k + 1].second;
+            trial.erase(trial.begin() + static_cast<std::ptrdiff_t>(k) + 1);
+            const double s = reference_sigma(t, trial, profile);
+            if (s < best_sigma)
+            {
+                best_sigma = s;
+                best = static_cast<int>(k);
+            }
+        }
+        bins[static_cast<std::size_t>(best)].second = bins[static_cast<std::size_t>(best) + 1].second;
+        bins.erase(bins.begin() + best + 1);
+    }
+    return bins;
+}
+
+TemplateBinningOptimizer1D::Result run(const Templates &t, int max_bins, bool profile)
+{
+    std::vector<std::unique_ptr<TH1D>> owned;
+    TemplateBinningOptimizer1D::Channel ch;
+    ch.name = "c";
+    owned.push_back(make_hist("nominal", t.mu));
+    ch.p_nominal = owned.back().get();
+    for (std::size_t a = 0; a < t.dmu.size(); ++a)
+    {
+        owned.push_back(make_hist("d" + std::to_string(a), t.dmu[a]));
+        TemplateBinningOptimizer1D::Parameter par;
+        par.name = "p" + std::to_string(a);
+        par.p_derivative = owned.back().get();
+        par.prior_sigma = t.prior_sigma[a];
+        par.is_poi = static_cast<int>(a) == t.poi;
+        ch.parameters.push_back(par);
+    }
+
+    TemplateBinningOptimizer1D::Config cfg;
+    cfg.mu_min = 0.0;
+    cfg.rel_mc_max = 1e9;
+    cfg.max_bins = max_bins;
+    cfg.profile_nuisances = profile;
+    return TemplateBinningOptimizer1D(cfg).optimise(ch);
+}
+
+bool close(double a, double b)
+{
+    return std::abs(a - b) <= 1e-9 * std::max(std::abs(a), std::abs(b));
+}
+
+// A nuisance almost degenerate with the POI must inflate the profiled error;
+// reading only one triangle of the Fisher matrix used to hide it.
+bool check_profiled_fixed_binning()
+{
+    Templates t;
+    t.mu = {40.0, 35.0, 22.0, 15.0, 9.0, 4.0};
+    t.dmu = {{8.0, 7.0, 5.0, 3.0, 2.0, 1.0}, {6.0, 5.8, 4.1, 2.3, 1.5, 0.9}};
+    t.prior_sigma = {0.0, 0.5};
+
+    const auto r = run(t, -1, true);
+    std::vector<std::pair<int, int>> fine;
+    for (int i = 0; i < 6; ++i)
+        fine.emplace_back(i, i);
+    const double want = reference_sigma(t, fine, true);
+    const double unprofiled = reference_sigma(t, fine, false);
+
+    const bool ok = r.edges.size() == 7 && close(r.expected_sigma_poi, want) && want > 1.01 * unprofiled;
+    std::cout << "[TemplateBinningOptimiser1DTest] case=profiled_fixed_binning sigma=" << r.expected_sigma_poi
+              << " want=" << want << " unprofiled=" << unprofiled << (ok ? " ok" : " FAILED") << "\n";
+    return ok;
+}
+
+bool check_greedy_parity(std::mt19937_64 &rng, int n_parameter, bool profile)
+{
+    const int n_fine = 40;
+    std::uniform_real_distribution<double> u(0.2, 1.0);
+    Templates t;
+    t.poi = 0;
+    t.dmu.assign(static_cast<std::size_t>(n_parameter), {});
+    for (int a = 0; a < n_parameter; ++a)
+        t.prior_sigma.push_back(a == 0 ? 0.0 : 0.3 + u(rng));
+    for (int i = 0; i < n_fine; ++i)
+    {
+        const double mu = 50.0 * u(rng) * std::exp(-0.05 * i);
+        t.mu.push_back(mu);
+        for (int a = 0; a < n_parameter; ++a)
+            t.dmu[static_cast<std::size_t>(a)].push_back(mu * (a == 0 ? 0.2 + 0.01 * i : 0.3 * u(rng) - 0.1));
+    }
+
+    const int max_bins = 6;
+    const auto r = run(t, max_bins, profile);
+    const auto want = reference_greedy(t, max_bins, profile);
+
+    bool ok = r.edges.size() == want.size() + 1;
+    for (std::size_t k = 0; ok && k < want.size(); ++k)
+    {
+        const double low = static_cast<double>(want[k].first) / n_fine;
+        ok = std::abs(r.edges[k] - low) < 1e-12;
+    }
+    ok = ok && close(r.expected_sigma_poi, reference_sigma(t, want, profile));
+
+    std::cout << "[TemplateBinningOptimiser1DTest] case=greedy_parity parameters=" << n_parameter
+              << " profile=" << profile << " bins=" << want.size() << (ok ? " ok" : " FAILED") << "\n";
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937_64 rng(20240702);
+    bool ok = check_profiled_fixed_binning();
+    for (int n_parameter = 1; n_parameter <= 4; ++n_parameter)
+    {
+        for (int rep = 0; rep < 5; ++rep)
+        {
+            ok &= check_greedy_parity(rng, n_parameter, true);
+            ok &= check_greedy_parity(rng, n_parameter, false);
+        }
+    }
+
+    std::cout << "[TemplateBinningOptimiser1DTest] " << (ok ? "passed" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+/* -- C++ -- */
+/**
+ *  @file  framework/tests/plot/TemplateBinningOptimiserNDTest.cc
+ *
+ *  @brief Checks TemplateBinningOptimizerND: the per-cell yields read from
+ *         the cumulative-sum grid against a brute-force sum over fine bins,
+ *         and that a 2D run with a single y bin reproduces the edges and
+ *         POI error of TemplateBinningOptimizer1D, for both strategies.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TH3D.h>
+
+#include "TemplateBinningOptimizer1D.hh"
+#include "TemplateBinningOptimizerND.hh"
+
+namespace
+{
+
+using Strategy = TemplateBinningOptimizerND::Strategy;
+
+const char *strategy_name(Strategy s) { return s == Strategy::kRectilinear ? "rectilinear" : "conditional"; }
+
+bool close(double a, double b)
+{
+    return std::abs(a - b) <= 1e-9 * std::max(std::abs(a), std::abs(b));
+}
+
+/// Fine templates on [0, 1)^d with n bins per axis, stored x-fastest.
+struct Grid
+{
+    int dimension = 2;
+    int n_x = 0;
+    int n_y = 0;
+    int n_z = 1;
+    std::vector<double> mu;
+    std::vector<std::vector<double>> dmu; // [parameter][cell]
+
+    std::size_t index(int i, int j, int k) const
+    {
+        return (static_cast<std::size_t>(k) * n_y + j) * n_x + i;
+    }
+};
+
+Grid make_grid(std::mt19937_64 &rng, int dimension, int n_x, int n_y, int n_z, int n_parameter)
+{
+    std::uniform_real_distribution<double> u(0.2, 1.0);
+    Grid g;
+    g.dimension = dimension;
+    g.n_x = n_x;
+    g.n_y = n_y;
+    g.n_z = (dimension == 3) ? n_z : 1;
+    g.dmu.assign(static_cast<std::size_t>(n_parameter), {});
+    for (int k = 0; k < g.n_z; ++k)
+    {
+        for (int j = 0; j < g.n_y; ++j)
+        {
+            for (int i = 0; i < g.n_x; ++i)
+            {
+                const double mu = 20.0 * u(rng) * std::exp(-0.08 * i - 0.05 * j - 0.05 * k);
+                g.mu.push_back(mu);
+                for (int a = 0; a < n_parameter; ++a)
+                    g.dmu[static_cast<std::size_t>(a)].push_back(mu * (a == 0 ? 0.2 + 0.02 * i + 0.01 * j : 0.3 * u(rng) - 0.1));
+            }
+        }
+    }
+    return g;
+}
+
+std::unique_ptr<TH1> make_hist(const std::string &name, const Grid &g, const std::vector<double> &values)
+{
+    std::unique_ptr<TH1> h;
+    if (g.dimension == 3)
+        h = std::make_unique<TH3D>(name.c_str(), "", g.n_x, 0.0, 1.0, g.n_y, 0.0, 1.0, g.n_z, 0.0, 1.0);
+    else
+        h = std::make_unique<TH2D>(name.c_str(), "", g.n_x, 0.0, 1.0, g.n_y, 0.0, 1.0);
+    h->SetDirectory(nullptr);
+    for (int k = 0; k < g.n_z; ++k)
+    {
+        for (int j = 0; j < g.n_y; ++j)
+        {
+            for (int i = 0; i < g.n_x; ++i)
+            {
+                const double v = values[g.index(i, j, k)];
+                if (g.dimension == 3)
+                {
+                    h->SetBinContent(i + 1, j + 1, k + 1, v);
+                    h->SetBinError(i + 1, j + 1, k + 1, 1e-3 * std::abs(v));
+                }
+                else
+                {
+                    h->SetBinContent(i + 1, j + 1, v);
+                    h->SetBinError(i + 1, j + 1, 1e-3 * std::abs(v));
+                }
+            }
+        }
+    }
+    return h;
+}
+
+/// One channel per grid; parameter 0 is the POI, the rest have unit priors.
+template <class Hist, class Make>
+std::vector<TemplateBinningOptimizer1D::Channel> make_channels(const std::vector<Grid> &grids,
+                                                              std::vector<std::unique_ptr<Hist>> &owned,
+                                                              const Make &make)
+{
+    std::vector<TemplateBinningOptimizer1D::Channel> channels;
+    for (std::size_t c = 0; c < grids.size(); ++c)
+    {
+        const Grid &g = grids[c];
+        TemplateBinningOptimizer1D::Channel ch;
+        ch.name = "c" + std::to_string(c);
+        owned.push_back(make("nominal" + std::to_string(c), g, g.mu));
+        ch.p_nominal = owned.back().get();
+        for (std::size_t a = 0; a < g.dmu.size(); ++a)
+        {
+            owned.push_back(make("d" + std::to_string(c) + "_" + std::to_string(a), g, g.dmu[a]));
+            TemplateBinningOptimizer1D::Parameter par;
+            par.name = "p" + std::to_string(a);
+            par.p_derivative = owned.back().get();
+            par.prior_sigma = (a == 0) ? 0.0 : 1.0;
+            par.is_poi = (a == 0);
+            ch.parameters.push_back(par);
+        }
+        channels.push_back(ch);
+    }
+    return channels;
+}
+
+/// Fine index of a coarse edge on the unit axis.
+int fine_index(double edge, int n)
+{
+    return static_cast<int>(std::lround(edge * n));
+}
+
+// Every reported cell's yield must be the plain sum of the fine bins it
+// covers, summed over channels, and the cells must tile the whole grid.
+bool check_box_sums(std::mt19937_64 &rng, int dimension, Strategy strategy)
+{
+    std::vector<Grid> grids;
+    for (int c = 0; c < 2; ++c)
+        grids.push_back(make_grid(rng, dimension, 12, 9, 7, 2));
+
+    std::vector<std::unique_ptr<TH1>> owned;
+    const auto channels = make_channels(grids, owned, make_hist);
+
+    TemplateBinningOptimizerND::Config cfg;
+    cfg.strategy = strategy;
+    cfg.base.mu_min = 0.0;
+    cfg.base.rel_mc_max = 1e9;
+    cfg.max_bins_x = 4;
+    cfg.max_bins_y = 3;
+    cfg.max_bins_z = 2;
+    const auto r = TemplateBinningOptimizerND(cfg).optimise(channels);
+
+    const Grid &g = grids.front();
+    double covered = 0.0;
+    double total = 0.0;
+    bool ok = !r.cells.empty();
+    for (const auto &cell : r.cells)
+    {
+        const int x0 = fine_index(cell.x_low, g.n_x);
+        const int x1 = fine_index(cell.x_high, g.n_x);
+        const int y0 = fine_index(cell.y_low, g.n_y);
+        const int y1 = fine_index(cell.y_high, g.n_y);
+        const int z0 = (dimension == 3) ? fine_index(cell.z_low, g.n_z) : 0;
+        const int z1 = (dimension == 3) ? fine_index(cell.z_high, g.n_z) : 1;
+
+        double want = 0.0;
+        for (const auto &grid : grids)
+        {
+            for (int k = z0; k < z1; ++k)
+                for (int j = y0; j < y1; ++j)
+                    for (int i = x0; i < x1; ++i)
+                        want += grid.mu[grid.index(i, j, k)];
+        }
+        ok = ok && close(cell.mu_sum, want);
+        covered += cell.mu_sum;
+    }
+    for (const auto &grid : grids)
+    {
+        for (const double mu : grid.mu)
+            total += mu;
+    }
+    ok = ok && close(covered, total);
+
+    std::cout << "[TemplateBinningOptimiserNDTest] case=box_sums dimension=" << dimension
+              << " strategy=" << strategy_name(strategy) << " cells=" << r.cells.size()
+              << (ok ? " ok" : " FAILED") << "\n";
+    return ok;
+}
+
+std::unique_ptr<TH1D> make_projection(const std::string &name, const Grid &g, const std::vector<double> &values)
+{
+    auto h = std::make_unique<TH1D>(name.c_str(), "", g.n_x, 0.0, 1.0);
+    h->SetDirectory(nullptr);
+    for (int i = 0; i < g.n_x; ++i)
+    {
+        h->SetBinContent(i + 1, values[g.index(i, 0, 0)]);
+        h->SetBinError(i + 1, 1e-3 * std::abs(values[g.index(i, 0, 0)]));
+    }
+    return h;
+}
+
+// With one y bin both strategies reduce to the 1D greedy merge along x.
+bool check_one_axis_parity(std::mt19937_64 &rng, Strategy strategy, bool profile)
+{
+    const int max_bins = 5;
+    const std::vector<Grid> grids = {make_grid(rng, 2, 30, 1, 1, 3)};
+
+    std::vector<std::unique_ptr<TH1D>> owned_1d;
+    const auto channels_1d = make_channels(grids, owned_1d, make_projection);
+    TemplateBinningOptimizer1D::Config cfg_1d;
+    cfg_1d.mu_min = 0.0;
+    cfg_1d.rel_mc_max = 1e9;
+    cfg_1d.max_bins = max_bins;
+    cfg_1d.profile_nuisances = profile;
+    const auto want = TemplateBinningOptimizer1D(cfg_1d).optimise(channels_1d);
+
+    std::vector<std::unique_ptr<TH1>> owned_nd;
+    const auto channels_nd = make_channels(grids, owned_nd, make_hist);
+    TemplateBinningOptimizerND::Config cfg;
+    cfg.base = cfg_1d;
+    cfg.strategy = strategy;
+    cfg.max_bins_x = max_bins;
+    const auto r = TemplateBinningOptimizerND(cfg).optimise(channels_nd);
+
+    bool ok = r.x_edges.size() == want.edges.size() && r.cells.size() + 1 == want.edges.size();
+    for (std::size_t k = 0; ok && k < want.edges.size(); ++k)
+        ok = std::abs(r.x_edges[k] - want.edges[k]) < 1e-12;
+    ok = ok && close(r.expected_sigma_poi, want.expected_sigma_poi);
+
+    std::cout << "[TemplateBinningOptimiserNDTest] case=one_axis_parity strategy=" << strategy_name(strategy)
+              << " profile=" << profile << " bins=" << r.cells.size() << " sigma=" << r.expected_sigma_poi
+              << " want=" << want.expected_sigma_poi << (ok ? " ok" : " FAILED") << "\n";
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937_64 rng(20240815);
+    bool ok = true;
+    for (const Strategy strategy : {Strategy::kConditional, Strategy::kRectilinear})
+    {
+        ok &= check_box_sums(rng, 2, strategy);
+        ok &= check_box_sums(rng, 3, strategy);
+        for (int rep = 0; rep < 3; ++rep)
+        {
+            ok &= check_one_axis_parity(rng, strategy, true);
+            ok &= check_one_axis_parity(rng, strategy, false);
+        }
+    }
+
+    std::cout << "[TemplateBinningOptimiserNDTest] " << (ok ? "passed" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}